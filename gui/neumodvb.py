@@ -24,7 +24,7 @@ from functools import lru_cache
 #the following import also sets up import path
 import neumodvb
 
-from neumodvb.util import load_gtk3_stylesheet, dtdebug, dterror, maindir, get_object, get_last_scan_text_dict
+from neumodvb.util import load_gtk3_stylesheet, dtdebug, dterror, maindir, get_objects, get_last_scan_text_dict
 from neumodvb.config import options, get_configfile
 from neumodvb.neumo_dialogs import ShowMessage
 
@@ -156,7 +156,10 @@ class neumoMainFrame(mainFrame):
             self.SetAcceleratorTable(accel_tbl)
 
     def OnSubscriberCallback(self, evt):
-        data = get_object(evt)
+        for data in get_objects(evt):
+            self.OnSubscriberNotification(data)
+
+    def OnSubscriberNotification(self, data):
         if type(data) == pydevdb.scan_stats.scan_stats:
             st = data
         elif type(data) == str:
@@ -704,6 +707,9 @@ class NeumoGui(wx.App):
     def Jump(self, seconds):
         self.current_mpv_player.jump(seconds)
 
+    def TrickPlay(self, direction):
+        self.current_mpv_player.trick_play(direction)
+
     def AudioLang(self, dark_mode):
         langs = self.current_mpv_player.audio_languages()
         from neumodvb.language_dialog import show_audio_language_dialog
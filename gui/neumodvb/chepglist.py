@@ -223,7 +223,7 @@ class ChEpgGrid(NeumoGridBase):
 
     def handle_service_change(self, evt):
         dtdebug(f'handle_service_change')
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(evt)
 
     def CurrentServiceAndEpgRecord(self):
@@ -218,7 +218,7 @@ class ChgmGridBase(NeumoGridBase):
         wx.CallAfter(self.handle_chg_change, None, self.chgm)
 
     def handle_chg_change(self, evt, chgm):
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(evt, chgm)
 
     def CurrentChgAndChgm(self):
@@ -249,7 +249,7 @@ class DvbsMuxGridBase(NeumoGridBase):
     def SelectMux(self, mux):
         self.mux = mux
     def handle_sat_change(self, evt, sat, mux):
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(None, mux)
         if mux is None:
             mux = self.table.screen.record_at_row(0)
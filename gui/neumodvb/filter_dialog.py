@@ -234,7 +234,7 @@ class FilterDialog(FilterDialog_):
         self.grid = None
         wx.CallAfter(grid.Destroy)
         if changed:
-            self.parent_table.GetRow.cache_clear()
+            self.parent_table.ClearRowCache()
         if event is not None:
             event.Skip()
 
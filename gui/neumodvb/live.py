@@ -35,11 +35,11 @@ import pychdb
 import pyepgdb
 import pyrecdb
 from pyreceiver import set_gtk_window_name, gtk_add_window_style, gtk_remove_window_style
-from pyreceiver import get_object as get_object_
+from pyreceiver import get_objects as get_objects_
 
-def get_object(evt):
+def get_objects(evt):
     s = evt.GetExtraLong()
-    return get_object_(s)
+    return get_objects_(s)
 
 class RowType(Enum):
     GRIDEPG = 1
@@ -1045,7 +1045,10 @@ class MosaicPanel(wx.Panel):
             self.RemoveMpvPlayer(glcanvas, force=True)
         evt.Skip()
     def OnSubscriberCallback(self, evt):
-        data = get_object(evt)
+        for data in get_objects(evt):
+            self.OnSubscriberNotification(data)
+
+    def OnSubscriberNotification(self, data):
         if type(data) == str:
             ShowMessage("Subscription failed", data)
     def AddMpvPlayer(self):
@@ -2706,6 +2709,14 @@ class LivePanel(wx.Panel):
         dtdebug('CmdJumpBack')
         return wx.GetApp().Jump(-60)
 
+    def CmdFastForward(self, event=None):
+        dtdebug('CmdFastForward')
+        return wx.GetApp().TrickPlay(1)
+
+    def CmdRewind(self, event=None):
+        dtdebug('CmdRewind')
+        return wx.GetApp().TrickPlay(-1)
+
     def CmdVolumeUp(self, evt):
         dtdebug('CmdVolumeUp')
         self.mosaic_panel.ChangeVolume(+1)
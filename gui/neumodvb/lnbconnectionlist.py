@@ -243,7 +243,7 @@ class LnbConnectionGrid(NeumoGridBase):
         self.EnableEditing(self.app.frame.edit_mode)
 
     def handle_lnb_change(self, lnb, rf_path):
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(None, rf_path)
         if rf_path is None:
             self.rf_path = self.table.screen.record_at_row(0)
@@ -261,7 +261,7 @@ class LnbNetworkGrid(NeumoGridBase):
         self.EnableEditing(self.app.frame.edit_mode)
 
     def handle_lnb_change(self, lnb, network):
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(None, network)
         if lnb_network is None:
             self.network = self.table.screen.record_at_row(0)
@@ -56,11 +56,14 @@ def NeumoGetBestSize(self, grid, attr, dc, row, col):
 #wx.grid.GridCellAutoWrapStringRenderer.GetBestSize = NeumoGetBestSize
 
 class screen_if_t(object):
+    row_window_size = 64 #number of records retrieved at once when drawing the grid
+
     def __init__(self, screen, invert_rows):
         self.screen = screen
         #if True: translate all incoming/outgoing row_numbers to turn screen upside down
         self.invert_rows = invert_rows
         self.editing_record_ = None
+        self.row_window = None #(first row, records) of the last retrieved window of rows
 
     @property
     def editing_record(self):
@@ -88,9 +91,46 @@ class screen_if_t(object):
         assert(rowno < self.list_size)
         if self.invert_rows:
             rowno = self.list_size -1 - rowno
-        return self.screen.record_at_row(rowno)
+        return self.record_at_screen_row(rowno)
+
+    def record_at_screen_row(self, rowno):
+        """
+        The grid requests rows one by one while scrolling. Retrieve them from the screen in windows
+        of row_window_size rows, using a single cursor walk per window
+        """
+        if not hasattr(self.screen, 'records_at_rows'): #screens implemented in python
+            return self.screen.record_at_row(rowno)
+        if self.row_window is not None:
+            start, records = self.row_window
+            if start <= rowno < start + len(records):
+                return records[rowno - start]
+        start = rowno - rowno % self.row_window_size
+        records = self.screen.records_at_rows(start, start + self.row_window_size)
+        if not start <= rowno < start + len(records):
+            self.row_window = None
+            return self.screen.record_at_row(rowno)
+        self.row_window = (start, records)
+        return records[rowno - start]
+
+    def columns_at_rows(self, start, end, keys):
+        """
+        Values of the fields in keys for rows [start, end) as a dict of numpy arrays (numbers, enums)
+        or lists (strings), retrieved in a single call
+        """
+        end = min(end, self.list_size)
+        if not hasattr(self.screen, 'columns_at_rows'): #screens implemented in python
+            records = [self.record_at_row(rowno) for rowno in range(start, end)]
+            return { k: [neumodbutils.get_subfield(rec, k) for rec in records] for k in keys }
+        if not self.invert_rows:
+            return self.screen.columns_at_rows(start, end, keys)
+        ret = self.screen.columns_at_rows(self.list_size - end, self.list_size - start, keys)
+        return { k: v[::-1] for k, v in ret.items() }
+
+    def clear_row_window(self):
+        self.row_window = None
 
     def update(self, txn):
+        self.clear_row_window()
         return self.screen.update(txn)
 
     def set_reference(self, rec):
@@ -362,6 +402,15 @@ class NeumoTableBase(wx.grid.GridTableBase):
     def GetRow(self, rowno):
         assert 0
 
+    def ClearRowCache(self):
+        """
+        Forget all cached records, e.g., after the screen changed or an edit was undone
+        """
+        self.GetRow.cache_clear()
+        screen = getattr(self, 'screen', None)
+        if isinstance(screen, screen_if_t):
+            screen.clear_row_window()
+
     def CurrentlySelectedRecord(self):
         rowno = self.parent.GetGridCursorRow()
         if rowno < 0:
@@ -408,10 +457,12 @@ class NeumoTableBase(wx.grid.GridTableBase):
 
     def SetValue(self, rowno, colno, val):
         try:
-            if rowno == self.row_being_edited :
-                rec = self.record_being_edited if self.record_being_edited is not None else self.GetRow(rowno)
+            if rowno == self.row_being_edited and self.record_being_edited is not None:
+                rec = self.record_being_edited
             else:
                 rec =  self.GetRow(rowno)
+                #records are shared with the row cache; edit a copy
+                rec = None if rec is None else rec.copy()
         except:
             dterror(f"row {rowno} out of range {self.GetNumberRows()}")
             return
@@ -476,7 +527,7 @@ class NeumoTableBase(wx.grid.GridTableBase):
         self.record_being_edited = rec
         self.row_being_edited = rowno
         self.Backup("edit", rowno, oldrecord, rec)
-        self.GetRow.cache_clear()
+        self.ClearRowCache()
 
 
     def GetColLabelValue(self, colno):
@@ -534,11 +585,29 @@ class NeumoTableBase(wx.grid.GridTableBase):
         for colno in range(num_cols):
             row.append(self.GetColLabelValue(colno).replace('-', '').replace('\n',''))
         writer.writerow(row)
-        for rowno in range(num_rows):
-            row = []
-            for colno in range(num_cols):
-                row.append(self.GetValue_text(rowno, colno))
-            writer.writerow(row)
+        #columns which are displayed without conversion are retrieved in bulk
+        record_t = getattr(self, 'record_t', None)
+        bulk_colnos = [] if record_t is None or self.screen is None else \
+            [ colno for colno in range(num_cols) if self.columns[colno].dfn is None
+              and self.columns[colno].cfn is None and self.columns[colno].key != 'icons'
+              and type(neumodbutils.get_subfield(record_t(), self.columns[colno].key)) in (int, str) ]
+        bulk_keys = [self.columns[colno].key for colno in bulk_colnos]
+        list_size = 0 if self.screen is None else self.screen.list_size
+        edited_rowno = getattr(self, 'row_being_edited', None) \
+            if getattr(self, 'record_being_edited', None) is not None else None
+        block_size = 1024
+        for start in range(0, num_rows, block_size):
+            end = min(start + block_size, num_rows)
+            columns = self.screen.columns_at_rows(start, min(end, list_size), bulk_keys) \
+                if len(bulk_keys) > 0 and start < list_size else {}
+            for rowno in range(start, end):
+                row = []
+                for colno in range(num_cols):
+                    if rowno < list_size and rowno != edited_rowno and colno in bulk_colnos:
+                        row.append(str(columns[self.columns[colno].key][rowno - start]))
+                    else:
+                        row.append(self.GetValue_text(rowno, colno))
+                writer.writerow(row)
 
 class NeumoTable(NeumoTableBase):
     #label: to show in header
@@ -693,6 +762,7 @@ class NeumoTable(NeumoTableBase):
         self.undo_list.append(self.BCK(operation, first.oldrow, firstrec, last.newrecord))
         self.record_being_edited = None
         self.row_being_edited = None
+        self.ClearRowCache()
         return ret, firstrec, last.newrecord, first.oldrow
 
 
@@ -704,7 +774,7 @@ class NeumoTable(NeumoTableBase):
             #self.data[last.oldrow] = last.oldrecord
             assert last.oldrow == self.row_being_edited
             self.record_being_edited = last.oldrecord
-            self.GetRow.cache_clear()
+            self.ClearRowCache()
             return 0
         elif len(self.undo_list)>0:
             last = self.undo_list.pop()
@@ -716,7 +786,7 @@ class NeumoTable(NeumoTableBase):
                 changed = self.screen.update(txn)
                 txn.commit()
                 if changed:
-                    self.GetRow.cache_clear()
+                    self.ClearRowCache()
                     if self.do_autosize_rows:
                         self.parent.AutoSizeRows()
                     self.parent.SelectRecord(l.oldrecord)
@@ -730,7 +800,7 @@ class NeumoTable(NeumoTableBase):
                 changed = self.screen.update(txn)
                 txn.commit()
                 if changed:
-                    self.GetRow.cache_clear()
+                    self.ClearRowCache()
                     if self.do_autosize_rows:
                         self.parent.AutoSizeRows()
                     self.parent.SelectRecord(last.oldrecord)
@@ -747,7 +817,7 @@ class NeumoTable(NeumoTableBase):
                 changed = self.screen.update(txn)
                 txn.commit()
                 if changed:
-                    self.GetRow.cache_clear()
+                    self.ClearRowCache()
                     if self.do_autosize_rows:
                         self.parent.AutoSizeRows()
                     self.parent.ForceRefresh()
@@ -760,7 +830,7 @@ class NeumoTable(NeumoTableBase):
         """
         called when a screen changes and therefore colours of rows may change
         """
-        self.GetRow.cache_clear()
+        self.ClearRowCache()
         self.parent.ForceRefresh()
     def on_screen_changed(self):
         """
@@ -794,7 +864,7 @@ class NeumoTable(NeumoTableBase):
             del txn
             idx =0
             self.FinalizeUnsavedEdits() # merge all unsaved edits into one (they are in the same row)
-            self.GetRow.cache_clear()
+            self.ClearRowCache()
             if changed:
                 self.parent.sync_rows()
                 if self.do_autosize_rows:
@@ -834,7 +904,7 @@ class NeumoTable(NeumoTableBase):
 
         self.parent.sync_rows()
         if changed:
-            self.GetRow.cache_clear()
+            self.ClearRowCache()
             rowno = max(min(rows) - 1, 0)
             colno = self.parent.GetGridCursorCol()
             if self.GetNumberRows() > 0:
@@ -885,7 +955,7 @@ class NeumoTable(NeumoTableBase):
         if need_new_data:
             self.__get_data__()
         self.screen.invert_rows = self.sort_order == 2
-        self.GetRow.cache_clear()
+        self.ClearRowCache()
 
     def set_initial_sort_column(self, key):
         #need_refresh = False
@@ -1117,7 +1187,7 @@ class NeumoGridBase(wx.grid.Grid, glr.GridWithLabelRenderersMixin):
         changed |= self.check_screen_update(self.table.screen)
         if changed:
             self.table.on_screen_changed()
-            self.table.GetRow.cache_clear()
+            self.table.ClearRowCache()
             if self.table.do_autosize_rows:
                 self.AutoSizeRows()
             self.OnRefresh(None, None)
@@ -1389,7 +1459,7 @@ class NeumoGridBase(wx.grid.Grid, glr.GridWithLabelRenderersMixin):
         rec= self.table.new_row()
         self.table.screen.editing_record = rec
         n = self.table.GetNumberRows()
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.sync_rows()
         self.MakeCellVisible(self.GetNumberRows()-1, 0)
         wx.CallAfter(self.SetGridCursor, self.GetNumberRows()-1, 0)
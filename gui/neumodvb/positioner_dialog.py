@@ -37,7 +37,7 @@ import pyreceiver
 import pychdb
 import pydevdb
 import pystatdb
-from pyreceiver import get_object as get_object_
+from pyreceiver import get_objects as get_objects_
 
 AbortTuneEvent, EVT_ABORT_TUNE = wx.lib.newevent.NewEvent()
 
@@ -51,9 +51,9 @@ def same_mux_key(a, b):
     return a.sat_pos == b.sat_pos and  a.stream_id == b.stream_id \
         and a.t2mi_pid == b.t2mi_pid and a.mux_id == b.mux_id
 
-def get_object(evt):
+def get_objects(evt):
     s = evt.GetExtraLong()
-    return get_object_(s)
+    return get_objects_(s)
 
 def get_isi_list(stream_id, signal_info):
     lst = [ x & 0xff for x in signal_info.matype_list ]
@@ -241,7 +241,10 @@ class TuneMuxPanel(TuneMuxPanel_):
         return opts.usals_location
 
     def OnSubscriberCallback(self, evt):
-        data = get_object(evt)
+        for data in get_objects(evt):
+            self.OnSubscriberNotification(data)
+
+    def OnSubscriberNotification(self, data):
         if type(data) == str:
             self.parent.OnSubscriberCallback(data)
             return
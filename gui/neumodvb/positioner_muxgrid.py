@@ -148,13 +148,13 @@ class PositionerDvbsMuxGrid(NeumoGridBase):
             evt.Skip(True)
 
     def Reset(self):
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.table.FinalizeUnsavedEdits()
         mux = self.tune_mux_panel.mux
         wx.CallAfter(self.doit, None, mux)
 
     def doit(self, evt, mux):
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(None, mux)
 
     def OnTune(self, evt):
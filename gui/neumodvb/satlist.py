@@ -149,7 +149,7 @@ class SatGridBase(NeumoGridBase):
         self.allow_all = True
 
     def handle_sat_band_change(self, evt, sat_band, sat):
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(None, sat)
 
     def CmdSelectSatBand(self, evt):
@@ -237,7 +237,7 @@ class ServiceGridBase(NeumoGridBase):
 
     def handle_sat_change(self, evt, service):
         dtdebug(f'doit rec_to_select={service}')
-        self.table.GetRow.cache_clear()
+        self.table.ClearRowCache()
         self.OnRefresh(evt, service)
 
     def CurrentSatAndService(self):
@@ -29,7 +29,7 @@ from neumodvb.signalhistory_dialog_gui import SignalHistoryDialog_, MuxListPanel
 from neumodvb.neumo_dialogs import ShowMessage, ShowOkCancel
 from neumodvb.signalhistoryplot import SignalType
 import pyreceiver
-from pyreceiver import get_object as get_object_
+from pyreceiver import get_objects as get_objects_
 
 class MuxListPanel(MuxListPanel_):
     def __init__(self, parent, *args, **kwds):
@@ -112,9 +112,6 @@ class SignalHistory(object):
 
         receiver = wx.GetApp().receiver
         cards = { c: k for k,c in wx.GetApp().get_cards_with_rf_in().items()}
-        txn = receiver.statdb.rtxn()
-        stats = pystatdb.signal_stat.get_by_mux_fuzzy(txn, mux.k.sat_pos, mux.pol, mux.frequency)
-        txn.abort()
         signals={}
         if self.signal_type == SignalType.SNR:
             minsignal, maxsignal = 0, 20
@@ -122,6 +119,22 @@ class SignalHistory(object):
             minsignal, maxsignal = 0, -80
         elif self.signal_type == SignalType.BER:
             minsignal, maxsignal = None, None
+        txn = receiver.statdb.rtxn()
+        history = pystatdb.signal_history.get_range(txn, mux.k.sat_pos, mux.pol, mux.frequency,
+                                                    0, int(time.time()) + 1, self.parent.resolution)
+        stats = [] if len(history) > 0 else \
+            pystatdb.signal_stat.get_by_mux_fuzzy(txn, mux.k.sat_pos, mux.pol, mux.frequency)
+        txn.abort()
+        field = { SignalType.SNR: 'snr', SignalType.STRENGTH: 'signal_strength', SignalType.BER: 'ber'}[self.signal_type]
+        scale = 1. if self.signal_type == SignalType.BER else 1e-3
+        for series in history:
+            t = np.array([datetime.datetime.fromtimestamp(x) for x in series['time']])
+            values = series[f'{field}_mean'] * scale
+            rf_path = series['rf_path']
+            rf_path = f'D{rf_path.lnb.dish_id}' + cards.get((rf_path.card_mac_address, rf_path.rf_input), '???')
+            signal = signals.get(rf_path, [])
+            signal.append((t, values))
+            signals[rf_path] = signal
         for ss in stats:
             t =[]
             values = []
@@ -176,6 +189,7 @@ class SignalHistoryPlot(wx.Panel):
         self.xlimits = None
         self.ylimits = None
         self.zoom_time= 3600 #zoom all graphs to this amount of time
+        self.resolution = 300 #requested resolution of the signal history in seconds
         self.start_time = datetime.datetime.now(tz = tz.tzlocal())
         self.parent = parent
         self.spectrum = pystatdb.spectrum.spectrum()
@@ -27,16 +27,16 @@ from neumodvb.util import dtdebug, dterror, is_circ, get_last_scan_text_dict
 from neumodvb.spectrum_dialog_gui import SpectrumDialog_, SpectrumButtons_, SpectrumListPanel_
 from neumodvb.neumo_dialogs import ShowMessage, ShowOkCancel
 import pyreceiver
-from pyreceiver import get_object as get_object_
+from pyreceiver import get_objects as get_objects_
 
 def lnb_matches_spectrum(lnb,  spectrum):
     start_freq, end_freq = pydevdb.lnb.lnb_frequency_range(lnb)
     return (start_freq <= spectrum.start_freq <= end_freq) and \
         (start_freq <= spectrum.end_freq <= end_freq)
 
-def get_object(evt):
+def get_objects(evt):
     s = evt.GetExtraLong()
-    return get_object_(s)
+    return get_objects_(s)
 
 class SpectrumButtons(SpectrumButtons_):
     def __init__(self, parent, *args, **kwargs):
@@ -136,10 +136,10 @@ def load_gtk3_stylesheet(fname):
     )
 
 
-def get_object(evt):
+def get_objects(evt):
     s = evt.GetExtraLong()
     import pyreceiver
-    return pyreceiver.get_object(s)
+    return pyreceiver.get_objects(s)
 
 def dtdebug(message):
     import pyreceiver
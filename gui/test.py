@@ -27,7 +27,7 @@ from functools import lru_cache
 #the following import also sets up import path
 import neumodvb
 
-from neumodvb.util import load_gtk3_stylesheet, dtdebug, dterror, maindir, get_object
+from neumodvb.util import load_gtk3_stylesheet, dtdebug, dterror, maindir, get_objects
 from neumodvb.config import options, get_configfile
 
 import pydevdb
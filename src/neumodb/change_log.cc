@@ -0,0 +1,140 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "neumodb/change_log.h"
+#include <string.h>
+
+namespace change_log {
+
+	//key of the entry storing the start of the log; consumer names cannot start with '#'
+	static constexpr const char* log_start_key = "#log_start";
+
+	/*
+		the table with consumer positions, which is opened when the database is opened (mdb_dbi_open
+		must not be called from concurrent transactions). nullptr if the database has no such table
+	*/
+	static lmdb::dbi* consumers_dbi(db_txn& txn) {
+		auto& dbi = txn.pdb->aux_tables->consumers;
+		return dbi.handle() == 0 ? nullptr : &dbi;
+	}
+
+	static size_t get_value(db_txn& txn, lmdb::dbi& dbi, const char* key) {
+		lmdb::val k{key, strlen(key)};
+		lmdb::val v{};
+		size_t ret{0};
+		if (dbi.get(txn, k, v) && v.size() == sizeof(ret))
+			memcpy(&ret, v.data(), sizeof(ret));
+		return ret;
+	}
+
+	static void put_value(db_txn& wtxn, lmdb::dbi& dbi, const char* key, size_t value) {
+		lmdb::val k{key, strlen(key)};
+		lmdb::val v{&value, sizeof(value)};
+		dbi.put(wtxn, k, v);
+	}
+
+	size_t consumer_position(db_txn& txn, const char* consumer) {
+		auto* dbi = consumers_dbi(txn);
+		if (!dbi)
+			return 0;
+		return get_value(txn, *dbi, consumer);
+	}
+
+	void set_consumer_position(db_txn& wtxn, const char* consumer, size_t next_txn_id) {
+		assert(consumer[0] != '#');
+		auto* dbi = consumers_dbi(wtxn);
+		if (!dbi) {
+			dterrorf("Cannot store position of change log consumer {}", consumer);
+			return;
+		}
+		put_value(wtxn, *dbi, consumer, next_txn_id);
+	}
+
+	void remove_consumer(db_txn& wtxn, const char* consumer) {
+		auto* dbi = consumers_dbi(wtxn);
+		if (!dbi)
+			return;
+		lmdb::val k{consumer, strlen(consumer)};
+		dbi->del(wtxn, k);
+	}
+
+	size_t log_start(db_txn& txn) {
+		auto* dbi = consumers_dbi(txn);
+		if (!dbi)
+			return 0;
+		return get_value(txn, *dbi, log_start_key);
+	}
+
+	size_t limit_trim(db_txn& wtxn, size_t end_id) {
+		auto* dbi_ = consumers_dbi(wtxn);
+		if (!dbi_)
+			return end_id;
+		auto& dbi = *dbi_;
+		size_t current_id = wtxn.txn_id();
+		auto c = lmdb::cursor::open(wtxn, dbi);
+		lmdb::val k{};
+		lmdb::val v{};
+		for (bool ok = c.get(k, v, MDB_FIRST); ok; ok = c.get(k, v, MDB_NEXT)) {
+			size_t next_txn_id{0};
+			if (v.size() != sizeof(next_txn_id) || (k.size() > 0 && *(const char*)k.data() == '#'))
+				continue;
+			memcpy(&next_txn_id, v.data(), sizeof(next_txn_id));
+			if (next_txn_id == 0) //consumer will rescan anyway
+				continue;
+			if (next_txn_id + max_lag < current_id) {
+				dtdebugf("change log consumer {} lags by {:d} transactions; it will need to rescan",
+								 std::string((const char*)k.data(), k.size()), current_id - next_txn_id);
+				continue;
+			}
+			end_id = std::min(end_id, next_txn_id);
+		}
+		c.close();
+		if (end_id > get_value(wtxn, dbi, log_start_key))
+			put_value(wtxn, dbi, log_start_key, end_id);
+		return end_id;
+	}
+
+}; // namespace change_log
+
+change_consumer_t::change_consumer_t(db_txn& txn, const char* name_)
+	: name(name_)
+	, next_txn_id(change_log::consumer_position(txn, name_)) {}
+
+bool change_consumer_t::begin_batch(db_txn& rtxn, size_t max_txns) {
+	size_t snapshot_id = rtxn.txn_id();
+	if (next_txn_id == 0 || next_txn_id < change_log::log_start(rtxn)) {
+		//the full scan will reflect all transactions up to the snapshot
+		batch_end_txn_id = snapshot_id;
+		next_txn_id = 0;
+		return false;
+	}
+	if (next_txn_id > snapshot_id) //rtxn is older than the last acknowledged batch
+		batch_end_txn_id = next_txn_id - 1;
+	else if (max_txns < snapshot_id - next_txn_id + 1)
+		batch_end_txn_id = next_txn_id + max_txns - 1;
+	else
+		batch_end_txn_id = snapshot_id;
+	return true;
+}
+
+void change_consumer_t::ack(db_txn& wtxn) {
+	next_txn_id = batch_end_txn_id + 1;
+	change_log::set_consumer_position(wtxn, name.c_str(), next_txn_id);
+}
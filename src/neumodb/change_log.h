@@ -0,0 +1,121 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <limits>
+#include <string>
+#include "neumodb/cursors.h"
+
+/*
+	Change data capture on top of the log table.
+
+	For each write transaction, update_log stores a (type_id, txn_id) -> primary key entry in the log for
+	every record which is written or deleted. The log does not record how the record was changed, so
+	a change is reported as an upsert (with the current value of the record) if the record still exists,
+	and as a delete (with only the primary key) otherwise. As with update_from, this is only correct when
+	changes are consumed up to the end of a read transaction's snapshot, which change_consumer_t ensures.
+
+	Consumers have a name and a persistent position (the first transaction they have not yet processed),
+	stored in the "change_consumers" table of the environment. clean_log does not remove log entries
+	which are still needed by a consumer, unless that consumer lags by more than max_lag transactions.
+	Consumers which fell that far behind, and new consumers, are told to rescan their tables.
+
+	Typical use:
+
+	change_consumer_t consumer(rtxn, "autorec");
+	if(!consumer.begin_batch(rtxn))
+		full_scan(rtxn); //also needed the first time
+	else {
+		ss::vector<change_t<recdb::rec_t>, 16> changes;
+		consumer.changes(rtxn, changes);
+		...
+	}
+	auto wtxn = db.wtxn();
+	consumer.ack(wtxn);
+	wtxn.commit();
+*/
+
+enum class change_op_t : uint8_t {
+	upsert, //record was added or changed
+	erase //record was deleted
+};
+
+template <typename record_t> struct change_t {
+	size_t txn_id{0}; //last transaction in the batch which changed the record
+	change_op_t op{change_op_t::upsert};
+	ss::bytebuffer<32> primary_key;
+	record_t record; //only valid if op==change_op_t::upsert
+};
+
+namespace change_log {
+	//consumers lagging more than this number of transactions no longer prevent log cleaning
+	constexpr size_t max_lag = 1000000;
+
+	//position of a consumer, or 0 if unknown
+	size_t consumer_position(db_txn& txn, const char* consumer);
+	void set_consumer_position(db_txn& wtxn, const char* consumer, size_t next_txn_id);
+	void remove_consumer(db_txn& wtxn, const char* consumer);
+
+	//first transaction for which the log is still complete
+	size_t log_start(db_txn& txn);
+
+	/*
+		called by clean_log before removing log entries for transactions before end_id.
+		Returns the (possibly lower) txn_id up to which the log can be removed without losing changes
+		needed by consumers, and remembers it as the new start of the log
+	*/
+	size_t limit_trim(db_txn& wtxn, size_t end_id);
+
+	/*
+		append all changes to records of type record_t in transactions from_txn_id...to_txn_id (inclusive).
+		If coalesce is true, a record changed in multiple transactions is reported only once, at the position
+		of its last change. Returns the number of changes added
+	*/
+	template <typename record_t>
+	int get_changes(db_txn& txn, size_t from_txn_id, size_t to_txn_id, ss::vector_<change_t<record_t>>& changes,
+									bool coalesce = true);
+}; // namespace change_log
+
+struct change_consumer_t {
+	std::string name;
+	size_t next_txn_id{0}; //first transaction not yet processed; 0 means a full scan is needed
+	size_t batch_end_txn_id{0}; //last transaction of the current batch
+
+	change_consumer_t(db_txn& txn, const char* name);
+
+	/*
+		start a new batch, covering at most max_txns transactions up to the snapshot of rtxn.
+		Returns false if changes have been lost (new consumer, or log was cleaned) and the consumer
+		must rescan all tables in rtxn instead of calling changes()
+	*/
+	bool begin_batch(db_txn& rtxn, size_t max_txns = std::numeric_limits<size_t>::max());
+
+	template <typename record_t> int changes(db_txn& rtxn, ss::vector_<change_t<record_t>>& out, bool coalesce = true) {
+		return change_log::get_changes<record_t>(rtxn, next_txn_id, batch_end_txn_id, out, coalesce);
+	}
+
+	//true if the last batch ended at the snapshot of its read transaction
+	bool up_to_date(db_txn& rtxn) {
+		return batch_end_txn_id >= (size_t)rtxn.txn_id();
+	}
+
+	//mark the current batch as processed, so that its log entries can be cleaned
+	void ack(db_txn& wtxn);
+};
@@ -0,0 +1,89 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "neumodb/change_log.h"
+#include "neumodb/db_keys_helper.h"
+
+template <typename record_t>
+int change_log::get_changes(db_txn& txn, size_t from_txn_id, size_t to_txn_id,
+														ss::vector_<change_t<record_t>>& changes, bool coalesce) {
+	if (from_txn_id > to_txn_id)
+		return 0;
+	struct entry_t {
+		size_t txn_id;
+		std::string primary_key;
+	};
+	std::vector<entry_t> entries;
+	std::unordered_map<std::string, int> last_entry; //index in entries of the last change of each record
+
+	//make a key containing (type_id, from_txn_id) as its value; this is a key in the log table
+	auto start_logkey = record_t::make_log_key(from_txn_id);
+
+	//make a prefix, which will restrict the type of the records we will actually handle
+	ss::bytebuffer<32> key_prefix;
+	encode_ascending(key_prefix, data_types::data_type<record_t>());
+
+	auto c = txn.pdb->template tcursor_log<record_t>(txn, key_prefix);
+	find_by_serialized_secondary_key(c, start_logkey, key_prefix, find_type_t::find_geq);
+
+	/*we cannot use c.range() because some secondary keys in
+		log may point to deleted records and my not have a primary record
+	*/
+	for (bool done = !c.is_valid(); !done; done = !c.next()) {
+		auto log_key = c.current_serialized_secondary_key();
+		uint64_t txn_id{0};
+		if (decode_ascending(txn_id, log_key, sizeof(uint32_t)) < 0)
+			continue;
+		if (txn_id > to_txn_id)
+			break;
+		auto pk = c.current_serialized_primary_key();
+		std::string primary_key((const char*)pk.buffer(), pk.size());
+		if (coalesce) {
+			auto [it, inserted] = last_entry.try_emplace(primary_key, (int)entries.size());
+			if (!inserted) {
+				entries[it->second].txn_id = 0; //superseded by the current entry
+				it->second = entries.size();
+			}
+		}
+		entries.push_back(entry_t{txn_id, std::move(primary_key)});
+	}
+
+	//read the current value of each changed record only once
+	auto mc = txn.pdb->template tcursor<record_t>(txn);
+	int count = 0;
+	for (auto& e : entries) {
+		if (e.txn_id == 0)
+			continue;
+		change_t<record_t> change;
+		change.txn_id = e.txn_id;
+		change.primary_key = ss::bytebuffer<32>(e.primary_key.data(), e.primary_key.size());
+		if (mc.find(change.primary_key) && mc.get_value(change.record))
+			change.op = change_op_t::upsert;
+		else
+			change.op = change_op_t::erase;
+		changes.push_back(change);
+		count++;
+	}
+	return count;
+}
@@ -24,6 +24,8 @@
 #include <cstdlib>
 #include <cmath>
 #include <variant>
+#include <algorithm>
+#include <optional>
 
 #include "neumodb/chdb/chdb_db.h"
 #pragma GCC visibility push(default)
@@ -464,6 +466,54 @@ above comment is probably no longer valid. todo has been solved?
 		auto c = service_t::find_by_key(txn, mux_key, find_geq, service_t::partial_keys_t::mux /*key_prefix*/);
 		return c;
 	}
+
+/*
+	Insert or update multiple services on the same mux (e.g., all services in an SDT section).
+
+	Instead of a lookup per service, the services are sorted by service_id (which is also the order of the
+	primary key within a mux) and merged with the existing records in a single cursor sweep, covering only
+	the range of service_ids being updated.
+
+	For each service, in order of increasing service_id, merge(service, db_service) is called, with db_service
+	pointing to the existing record, or nullptr for a new service. merge must update service to the record which
+	should be stored and return true if it must be written. Only those records are written.
+
+	Returns the number of records written
+*/
+	template<typename merge_fn_t>
+	int bulk_upsert(db_txn& wtxn, const mux_key_t& mux_key, ss::vector_<service_t>& services, merge_fn_t merge) {
+		if(services.size() == 0)
+			return 0;
+		std::sort(services.begin(), services.end(), [](const service_t& a, const service_t& b) {
+			return a.k.service_id < b.k.service_id;
+		});
+		auto c = service_t::find_by_key(wtxn, mux_key, services[0].k.service_id, find_geq,
+																		service_t::partial_keys_t::mux /*key_prefix*/);
+		auto r = c.range();
+		auto it = r.begin();
+		std::optional<service_t> db_service; //existing record at cursor, not yet merged
+		int num_written{0};
+		for(auto& service: services) {
+			service.k.mux = mux_key;
+			while(!db_service || db_service->k.service_id < service.k.service_id) {
+				if(db_service)
+					++it;
+				if(it == r.end()) {
+					db_service.reset();
+					break;
+				}
+				db_service = *it;
+			}
+			bool found = db_service && db_service->k.service_id == service.k.service_id;
+			if(merge(service, found ? &*db_service : nullptr)) {
+				put_record(wtxn, service);
+				++num_written;
+				if(found)
+					*db_service = service; //in case of duplicate service_ids
+			}
+		}
+		return num_written;
+	}
 }
 
 namespace chdb {
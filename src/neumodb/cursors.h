@@ -190,6 +190,12 @@ struct db_txn : public lmdb::txn {
 	const char* lmdb_file{nullptr};
 	int lmdb_line{-1};
 
+	//runtime statistics (see db_stats.h); only maintained when statistics are enabled
+	steady_time_t start_time{};
+	int num_reads{0};
+	int num_writes{0};
+	bool is_child{false};
+
 	db_txn(db_txn&& other)
 		: lmdb::txn(std::move(other))
 		, pdb(other.pdb)
@@ -199,8 +205,13 @@ struct db_txn : public lmdb::txn {
 		, dbi_log(other.dbi_log.handle())
 		, lmdb_file(other.lmdb_file)
 		, lmdb_line(other.lmdb_line)
+		, start_time(other.start_time)
+		, num_reads(other.num_reads)
+		, num_writes(other.num_writes)
+		, is_child(other.is_child)
 		{
 			other._handle = nullptr;
+			other.start_time = {};
 		}
 
 	db_txn() = default;
@@ -218,6 +229,11 @@ struct db_txn : public lmdb::txn {
 			dbi_log = std::move(other.dbi_log);
 			lmdb_file = other.lmdb_file;
 			lmdb_line = other.lmdb_line;
+			start_time = other.start_time;
+			other.start_time = {};
+			num_reads = other.num_reads;
+			num_writes = other.num_writes;
+			is_child = other.is_child;
 
 			return *this;
 		}
@@ -241,8 +257,12 @@ struct db_txn : public lmdb::txn {
 	bool can_commit() const {
 		return this->_handle;
 	}
+	inline void start_stats();
+	inline void end_stats() noexcept;
+
 	void commit() {
 		assert(this->_handle);
+		end_stats();
 		if(readonly)
 			this->lmdb::txn::reset();
 		else {
@@ -253,6 +273,7 @@ struct db_txn : public lmdb::txn {
 
 	void abort() noexcept {
 		assert(this->_handle);
+		end_stats();
 		if(readonly)
 			this->lmdb::txn::reset();
 		else {
@@ -265,6 +286,7 @@ struct db_txn : public lmdb::txn {
 		assert(this->_handle);
 		assert(readonly);
 		this->lmdb::txn::renew();
+		start_stats();
 	}
 
 	~db_txn() {
@@ -290,6 +312,7 @@ struct db_cursor : private lmdb::cursor {
 	bool valid_ = false; //true if a cursor was positioned to some entry
 	bool dead_ = false; //true if a cursor has been destroyed explicitly
 	ss::bytebuffer<16> key_prefix; //cursor is valid if it points to a record with a matching key
+	int64_t num_steps{0}; //number of next/prev calls, for statistics
 #if 0
 	inline void log(ss::bytebuffer_& primary_key, db_txn::update_type_t update_type) {
 		txn.log(primary_key, update_type);
@@ -419,9 +442,11 @@ struct db_cursor : private lmdb::cursor {
 		, txn(other.txn)
 		, is_index_cursor(other.is_index_cursor)
 		, valid_(other.valid_)
-		, key_prefix(other.key_prefix) {
+		, key_prefix(other.key_prefix)
+		, num_steps(other.num_steps) {
 			assert(txn.handle() != nullptr);
 			txn.num_cursors++;
+			other.num_steps = 0;
 		}
 
 	db_cursor(const db_cursor& other, clone_t*)
@@ -446,10 +471,15 @@ struct db_cursor : private lmdb::cursor {
 			}
 		}
 
+	inline void count_scan();
+	inline void count_write(const lmdb::val& k, size_t val_size);
+
 	inline void destroy() {
 #ifdef ASSERT_DEAD
 		assert(!dead_); //may only be destroyed once
 #endif
+		if(num_steps > 0)
+			count_scan();
 		if(!txn.is_valid()) {
 			_handle = nullptr;
 		}
@@ -496,6 +526,10 @@ struct db_cursor : private lmdb::cursor {
 			other.valid_ = false;
 			key_prefix = other.key_prefix;
 			other.key_prefix.clear();
+			if(num_steps > 0)
+				count_scan();
+			num_steps = other.num_steps;
+			other.num_steps = 0;
 		}
 			return *this;
 	}
@@ -599,6 +633,7 @@ struct db_cursor : private lmdb::cursor {
 #ifdef ASSERT_DEAD
 		assert(!dead_);
 #endif
+		num_steps++;
 		lmdb::val k{}, v{};
 		bool ret = get(k, v, op);
 		if(!ret) //we reached the end of the index table
@@ -618,6 +653,7 @@ struct db_cursor : private lmdb::cursor {
 #ifdef ASSERT_DEAD
 		assert(!dead_);
 #endif
+		num_steps++;
 		lmdb::val k{}, v{};
 		bool ret = this->get(k, v, (const MDB_cursor_op) MDB_PREV);
 		if(!ret) //we reached the start of the index table
@@ -739,7 +775,10 @@ struct db_cursor : private lmdb::cursor {
 #endif
 		lmdb::val k{serialized_key.buffer(), (size_t)serialized_key.size()};
 
-		return this->del(k);
+		bool ret = this->del(k);
+		if(ret)
+			count_write(k, 0);
+		return ret;
 	}
 
 	//delete at a specific key and value; used for MDB_DUP index
@@ -861,6 +900,17 @@ public:
 	//returns false if key already existed
 	bool put_kv(const ss::bytebuffer_& serialized_key, const data_t& val, unsigned int put_flags=0) {
 		assert(!this->is_index_cursor);
+		if constexpr (requires { data_t::has_compressed_fields; }) {
+			/*the compressed size is not known in advance, so MDB_RESERVE cannot be used;
+				serialized_size would overestimate it*/
+			string_compression::dict_scope_t scope(this->txn.pdb->compression_dict_id);
+			ss::bytebuffer<1024> serialized_val;
+			serialize(serialized_val, val);
+			lmdb::val k{serialized_key.buffer(), (size_t)serialized_key.size()};
+			lmdb::val v{serialized_val.buffer(), (size_t)serialized_val.size()};
+			this->count_write(k, v.size());
+			return this->put(k, v, put_flags);
+		}
 		auto val_size = serialized_size(val);
 		lmdb::val k{serialized_key.buffer(), (size_t)serialized_key.size()};
 		lmdb::val v{nullptr, (size_t)val_size};
@@ -874,12 +924,23 @@ public:
 		bool ret=this->put(k, v, MDB_RESERVE | put_flags);
 		auto  serialized_val = ss::bytebuffer_::view((uint8_t*)v.data(), v.size(), 0);
 		serialize(serialized_val, val);
+		this->count_write(k, v.size());
 		return ret;
 	}
 
 	//update data at the current cursor
 	bool put_kv_at_cursor(const data_t& val) {
 		auto serialized_key = current_serialized_key();
+		if constexpr (requires { data_t::has_compressed_fields; }) {
+			string_compression::dict_scope_t scope(this->txn.pdb->compression_dict_id);
+			ss::bytebuffer<1024> serialized_val;
+			serialize(serialized_val, val);
+			lmdb::val k{serialized_key.buffer(), (size_t)serialized_key.size()};
+			lmdb::val v{serialized_val.buffer(), (size_t)serialized_val.size()};
+			this->cursor_put(k, v, MDB_CURRENT);
+			this->count_write(k, v.size());
+			return true;
+		}
 		auto val_size = serialized_size(val);
 		lmdb::val k{serialized_key.buffer(), (size_t)serialized_key.size()};
 		lmdb::val v{nullptr, (size_t)val_size};
@@ -893,6 +954,7 @@ public:
 		this->cursor_put(k, v, MDB_RESERVE|MDB_CURRENT);
 		auto  serialized_val = ss::bytebuffer_::view((uint8_t*)v.data(), v.size(), 0);
 		serialize(serialized_val, val);
+		this->count_write(k, v.size());
 		return true;
 	}
 
@@ -1106,6 +1168,7 @@ inline	db_txn::db_txn(neumodb_t& db_, bool readonly, unsigned int flags) :
 	, lmdb_file(::lmdb_file)
 	, lmdb_line(::lmdb_line)
 {
+	start_stats();
 }
 
 inline	db_txn::db_txn(db_txn& parent_txn, neumodb_t& db_, bool readonly, unsigned int flags) :
@@ -1116,8 +1179,49 @@ inline	db_txn::db_txn(db_txn& parent_txn, neumodb_t& db_, bool readonly, unsigne
 	, dbi_log(db_.dbi_log.handle())
 	, lmdb_file(::lmdb_file)
 	, lmdb_line(::lmdb_line)
+	, is_child(true)
 {
 	assert(!parent_txn.readonly);
+	start_stats();
+}
+
+inline void db_txn::start_stats() {
+	if(pdb && pdb->stats->enabled.load(std::memory_order_relaxed))
+		start_time = steady_clock_t::now();
+}
+
+inline void db_txn::end_stats() noexcept {
+	if(start_time == steady_time_t{})
+		return; //statistics were disabled when the transaction started
+	if(pdb->stats->enabled.load(std::memory_order_relaxed)) {
+		auto duration = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock_t::now() - start_time);
+		pdb->stats->on_txn_end(*this, duration.count());
+	}
+	start_time = {};
+	num_reads = 0;
+	num_writes = 0;
+}
+
+inline void db_cursor::count_scan() {
+	if(!txn.pdb)
+		return;
+	auto& stats = *txn.pdb->stats;
+	if(stats.enabled.load(std::memory_order_relaxed))
+		stats.on_scan(key_prefix.buffer(), key_prefix.size(), is_index_cursor, num_steps);
+	num_steps = 0;
+}
+
+inline void db_cursor::count_write(const lmdb::val& k, size_t val_size) {
+	txn.num_writes++;
+	if(!txn.pdb)
+		return;
+	auto& stats = *txn.pdb->stats;
+	if(!stats.enabled.load(std::memory_order_relaxed))
+		return;
+	if(val_size == 0) //deletion
+		stats.on_delete(db_stats_t::type_id_for_key(k.data(), k.size()));
+	else
+		stats.on_write(k.data(), k.size(), val_size);
 }
 
 inline	db_txn db_txn::child_txn(neumodb_t& db) {
@@ -1138,6 +1242,9 @@ inline bool db_cursor::get_value(data_t& out, const MDB_cursor_op op) {
 	const bool found = get(k, v, op);
 	if(!found)
 		return found;
+	txn.num_reads++;
+	if(txn.pdb->stats->enabled.load(std::memory_order_relaxed))
+		txn.pdb->stats->on_read(k.data(), k.size(), v.size());
 	auto serialized = ss::bytebuffer_::view((uint8_t*)v.data(), v.size(), v.size());
 	if(this->txn.pdb->schema_is_current) {
 		//Note: this could be replaced with out = this->txn.db.dbdesc.get_value_safe(out, serialized)
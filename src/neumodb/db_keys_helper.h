@@ -21,6 +21,7 @@
 
 #pragma once
 #include "cursors.h"
+#include "change_log.h"
 #ifndef HIDDEN
 #define HIDDEN __attribute__((visibility("hidden")))
 #endif
@@ -426,6 +427,8 @@ template<typename record_t> HIDDEN void clean_log(db_txn& txn, int num_keep)
 	if (end_id<=num_keep)
 		return;
 	end_id -= num_keep;
+	//do not remove changes which change log consumers have not yet processed
+	end_id = change_log::limit_trim(txn, end_id);
 	decltype(end_id) start_id{0};
 
 	auto start_logkey = record_t::make_log_key(start_id);
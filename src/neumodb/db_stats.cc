@@ -0,0 +1,265 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "neumodb/db_stats.h"
+#include "neumodb/cursors.h"
+#include "neumodb/dbdesc.h"
+#include <algorithm>
+#include <pthread.h>
+
+void db_stats_t::on_scan(const void* key_prefix, size_t key_prefix_size, bool is_index, int64_t steps) {
+	auto& s = for_type(type_id_for_key(key_prefix, key_prefix_size), is_index);
+	add(s.num_scans, 1);
+	add(s.scan_steps, steps);
+	update_max(s.max_scan_steps, steps);
+	int bucket = steps <= 1 ? 0 : 64 - __builtin_clzll(steps - 1);
+	add(scan_length_histogram[std::min(bucket, num_histogram_buckets - 1)], 1);
+}
+
+void db_stats_t::on_txn_end(const db_txn& txn, int64_t duration_us) {
+	if (!txn.is_child) {
+		if (txn.readonly) {
+			add(num_rtxns, 1);
+			add(rtxn_time, duration_us);
+			update_max(max_rtxn_time, duration_us);
+		} else {
+			add(num_wtxns, 1);
+			add(wtxn_time, duration_us);
+			update_max(max_wtxn_time, duration_us);
+		}
+	}
+	char thread_name[16];
+	pthread_getname_np(pthread_self(), thread_name, sizeof(thread_name));
+	std::scoped_lock lck(mutex);
+	auto& t = threads[thread_name];
+	//time spent in child transactions is already included in the time of their parent
+	if (!txn.is_child) {
+		if (txn.readonly) {
+			t.num_rtxns++;
+			t.rtxn_time += duration_us;
+		} else {
+			t.num_wtxns++;
+			t.wtxn_time += duration_us;
+			t.max_wtxn_time = std::max(t.max_wtxn_time, duration_us);
+		}
+	}
+	t.num_reads += txn.num_reads;
+	t.num_writes += txn.num_writes;
+}
+
+void db_stats_t::on_wtxn_wait(int64_t duration_us) {
+	add(num_wtxn_waits, 1);
+	add(wtxn_wait_time, duration_us);
+	update_max(max_wtxn_wait_time, duration_us);
+}
+
+void db_stats_t::reset() {
+	for (auto* table : {&types, &indexes}) {
+		for (auto& s : *table) {
+			s.type_id = unused_type_id;
+			s.num_reads = 0;
+			s.num_writes = 0;
+			s.num_deletes = 0;
+			s.bytes_serialized = 0;
+			s.bytes_deserialized = 0;
+			s.num_scans = 0;
+			s.scan_steps = 0;
+			s.max_scan_steps = 0;
+		}
+	}
+	for (auto& x : scan_length_histogram)
+		x = 0;
+	for (auto* x : {&num_rtxns, &rtxn_time, &max_rtxn_time, &num_wtxns, &wtxn_time, &max_wtxn_time,
+								 &num_wtxn_waits, &wtxn_wait_time, &max_wtxn_wait_time})
+		*x = 0;
+	std::scoped_lock lck(mutex);
+	threads.clear();
+	reset_time = steady_clock_t::now();
+}
+
+static void table_stats(db_env_stats_t& ret, lmdb::txn& txn, lmdb::dbi& dbi, const char* name) {
+	if (dbi.handle() == 0)
+		return;
+	auto st = dbi.stat(txn);
+	db_table_stats_t t;
+	t.name = name;
+	t.entries = st.ms_entries;
+	t.depth = st.ms_depth;
+	t.branch_pages = st.ms_branch_pages;
+	t.leaf_pages = st.ms_leaf_pages;
+	t.overflow_pages = st.ms_overflow_pages;
+	ret.tables.push_back(t);
+}
+
+db_env_stats_t get_env_stats(neumodb_t& db) {
+	db_env_stats_t ret;
+	if (!db.is_open() || !db.envp)
+		return ret;
+	MDB_envinfo info;
+	MDB_stat st;
+	if (mdb_env_info(*db.envp, &info) != 0 || mdb_env_stat(*db.envp, &st) != 0)
+		return ret;
+	ret.page_size = st.ms_psize;
+	ret.map_size = info.me_mapsize;
+	ret.map_used = (int64_t)(info.me_last_pgno + 1) * st.ms_psize;
+	ret.num_readers = info.me_numreaders;
+	ret.max_readers = info.me_maxreaders;
+	try {
+		//a plain lmdb transaction, so that it is not counted in the statistics
+		auto txn = lmdb::txn::begin(*db.envp, nullptr, MDB_RDONLY);
+		table_stats(ret, txn, db.dbi, "data");
+		table_stats(ret, txn, db.dbi_index, "index");
+		table_stats(ret, txn, db.dbi_log, "log");
+		txn.abort();
+	} catch (const lmdb::error& e) {
+		dterrorf("Could not read lmdb statistics: {}", e.what());
+	}
+	return ret;
+}
+
+db_stats_snapshot_t db_stats_t::snapshot(neumodb_t& db) {
+	db_stats_snapshot_t ret;
+	auto copy_types = [&db](std::vector<db_type_stats_snapshot_t>& out, type_table_t& in, bool is_index) {
+		for (auto& s : in) {
+			if (s.type_id == unused_type_id)
+				continue;
+			db_type_stats_snapshot_t t;
+			t.type_id = s.type_id;
+			t.num_reads = s.num_reads;
+			t.num_writes = s.num_writes;
+			t.num_deletes = s.num_deletes;
+			t.bytes_serialized = s.bytes_serialized;
+			t.bytes_deserialized = s.bytes_deserialized;
+			t.num_scans = s.num_scans;
+			t.scan_steps = s.scan_steps;
+			t.max_scan_steps = s.max_scan_steps;
+			if (t.num_reads + t.num_writes + t.num_deletes + t.num_scans == 0)
+				continue;
+			if (db.dbdesc) {
+				if (is_index) {
+					auto* index_desc = db.dbdesc->index_desc_for_index_type(t.type_id);
+					auto* desc = index_desc ? db.dbdesc->schema_for_type(index_desc->type_id) : nullptr;
+					if (index_desc)
+						t.name = std::string(desc ? desc->name.c_str() : "") + "." + index_desc->name.c_str();
+				} else {
+					auto* desc = db.dbdesc->schema_for_type(t.type_id);
+					if (desc)
+						t.name = desc->name.c_str();
+				}
+			}
+			if (t.name.empty())
+				t.name = fmt::format("0x{:x}", t.type_id);
+			out.push_back(t);
+		}
+		std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return a.type_id < b.type_id; });
+	};
+	copy_types(ret.types, types, false);
+	copy_types(ret.indexes, indexes, true);
+	for (auto& x : scan_length_histogram)
+		ret.scan_length_histogram.push_back(x);
+	ret.num_rtxns = num_rtxns;
+	ret.rtxn_time = rtxn_time;
+	ret.max_rtxn_time = max_rtxn_time;
+	ret.num_wtxns = num_wtxns;
+	ret.wtxn_time = wtxn_time;
+	ret.max_wtxn_time = max_wtxn_time;
+	ret.num_wtxn_waits = num_wtxn_waits;
+	ret.wtxn_wait_time = wtxn_wait_time;
+	ret.max_wtxn_wait_time = max_wtxn_wait_time;
+	{
+		std::scoped_lock lck(mutex);
+		ret.period = std::chrono::duration<double>(steady_clock_t::now() - reset_time).count();
+		for (auto& [name, t] : threads) {
+			db_thread_stats_snapshot_t s;
+			s.thread_name = name;
+			s.num_rtxns = t.num_rtxns;
+			s.num_wtxns = t.num_wtxns;
+			s.rtxn_time = t.rtxn_time;
+			s.wtxn_time = t.wtxn_time;
+			s.max_wtxn_time = t.max_wtxn_time;
+			s.num_reads = t.num_reads;
+			s.num_writes = t.num_writes;
+			ret.threads.push_back(s);
+		}
+	}
+	ret.env = get_env_stats(db);
+	return ret;
+}
+
+std::string db_stats_snapshot_t::to_string() const {
+	std::string ret;
+	auto out = std::back_inserter(ret);
+	fmt::format_to(out, "period={:.1f}s\n", period);
+	fmt::format_to(out, "rtxn: count={:d} total={:.1f}ms max={:.1f}ms\n", num_rtxns, rtxn_time / 1000.,
+								 max_rtxn_time / 1000.);
+	fmt::format_to(out, "wtxn: count={:d} total={:.1f}ms max={:.1f}ms waits={:d} wait={:.1f}ms max_wait={:.1f}ms\n",
+								 num_wtxns, wtxn_time / 1000., max_wtxn_time / 1000., num_wtxn_waits, wtxn_wait_time / 1000.,
+								 max_wtxn_wait_time / 1000.);
+	for (auto& t : types)
+		fmt::format_to(out,
+									 "  {:<24s} reads={:d} ({:d} bytes) writes={:d} ({:d} bytes) deletes={:d} "
+									 "scans={:d} steps={:d} max_steps={:d}\n",
+									 t.name, t.num_reads, t.bytes_deserialized, t.num_writes, t.bytes_serialized, t.num_deletes,
+									 t.num_scans, t.scan_steps, t.max_scan_steps);
+	for (auto& t : indexes)
+		fmt::format_to(out, "  {:<24s} scans={:d} steps={:d} max_steps={:d}\n", t.name, t.num_scans, t.scan_steps,
+									 t.max_scan_steps);
+	for (auto& t : threads)
+		fmt::format_to(out,
+									 "  thread {:<16s} rtxn={:d} ({:.1f}ms) wtxn={:d} ({:.1f}ms max={:.1f}ms) "
+									 "reads={:d} writes={:d}\n",
+									 t.thread_name, t.num_rtxns, t.rtxn_time / 1000., t.num_wtxns, t.wtxn_time / 1000.,
+									 t.max_wtxn_time / 1000., t.num_reads, t.num_writes);
+	fmt::format_to(out, "env: map={:d}MB used={:d}MB page_size={:d} readers={:d}/{:d}\n", env.map_size >> 20,
+								 env.map_used >> 20, env.page_size, env.num_readers, env.max_readers);
+	for (auto& t : env.tables)
+		fmt::format_to(out, "  {:<6s} entries={:d} depth={:d} pages: branch={:d} leaf={:d} overflow={:d}\n", t.name,
+									 t.entries, t.depth, t.branch_pages, t.leaf_pages, t.overflow_pages);
+	return ret;
+}
+
+void db_stats_t::start_periodic_dump(neumodb_t& db, int period_s) {
+	stop_periodic_dump();
+	if (period_s <= 0)
+		return;
+	dump_period_s = period_s;
+	dump_thread = std::thread([this, &db] {
+		pthread_setname_np(pthread_self(), "dbstats");
+		std::unique_lock<std::mutex> lk(mutex);
+		while (dump_period_s > 0) {
+			if (dump_cv.wait_for(lk, std::chrono::seconds(dump_period_s), [this] { return dump_period_s == 0; }))
+				break;
+			lk.unlock();
+			auto s = snapshot(db);
+			dtinfof("Database statistics:\n{}", s.to_string());
+			lk.lock();
+		}
+	});
+}
+
+void db_stats_t::stop_periodic_dump() {
+	{
+		std::scoped_lock lck(mutex);
+		dump_period_s = 0;
+	}
+	dump_cv.notify_all();
+	if (dump_thread.joinable())
+		dump_thread.join();
+}
@@ -0,0 +1,230 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "util/time_util.h"
+
+class neumodb_t;
+struct db_txn;
+
+/*
+	Snapshot of the runtime statistics of a database, as returned by neumodb_t::get_statistics.
+	All times are in microseconds.
+ */
+struct db_type_stats_snapshot_t {
+	uint32_t type_id{0}; //record type or index type
+	std::string name;
+	int64_t num_reads{0}; //records deserialized
+	int64_t num_writes{0};
+	int64_t num_deletes{0};
+	int64_t bytes_serialized{0};
+	int64_t bytes_deserialized{0};
+	int64_t num_scans{0}; //cursors which were moved with next/prev
+	int64_t scan_steps{0}; //total number of next/prev calls
+	int64_t max_scan_steps{0};
+};
+
+struct db_thread_stats_snapshot_t {
+	std::string thread_name;
+	int64_t num_rtxns{0};
+	int64_t num_wtxns{0};
+	int64_t rtxn_time{0};
+	int64_t wtxn_time{0};
+	int64_t max_wtxn_time{0};
+	int64_t num_reads{0};
+	int64_t num_writes{0};
+};
+
+struct db_table_stats_t {
+	std::string name; //data, index, log
+	int64_t entries{0};
+	int depth{0};
+	int64_t branch_pages{0};
+	int64_t leaf_pages{0};
+	int64_t overflow_pages{0};
+};
+
+struct db_env_stats_t {
+	int64_t map_size{0}; //bytes
+	int64_t map_used{0}; //bytes in use by pages, including free pages
+	int page_size{0};
+	int num_readers{0}; //reader slots in use
+	int max_readers{0};
+	std::vector<db_table_stats_t> tables;
+};
+
+struct db_stats_snapshot_t {
+	double period{0}; //seconds since the statistics were last reset
+	int64_t num_rtxns{0};
+	int64_t rtxn_time{0};
+	int64_t max_rtxn_time{0};
+	int64_t num_wtxns{0};
+	int64_t wtxn_time{0}; //time between start and end of write transactions
+	int64_t max_wtxn_time{0};
+	int64_t num_wtxn_waits{0}; //waits for the shared write transaction in wtxn_reservation_t
+	int64_t wtxn_wait_time{0};
+	int64_t max_wtxn_wait_time{0};
+	std::vector<int64_t> scan_length_histogram; //entry i counts scans with 2^(i-1) < length <= 2^i
+	std::vector<db_type_stats_snapshot_t> types;
+	std::vector<db_type_stats_snapshot_t> indexes;
+	std::vector<db_thread_stats_snapshot_t> threads;
+	db_env_stats_t env;
+
+	std::string to_string() const;
+};
+
+/*
+	Live statistics of a neumodb_t, which help find out which code is loading the database.
+	Counting is cheap (relaxed atomics, and a mutex per transaction for the per thread counters),
+	but disabled by default.
+
+	Record and index types are identified by their full type_id (the low byte is not unique: e.g.,
+	dvbs_mux, dvbc_mux and dvbt_mux share it). Per type counters are kept in a small open addressing
+	table, in which a slot is claimed for a type_id the first time it is counted.
+ */
+struct db_stats_t {
+	static constexpr int num_histogram_buckets = 24;
+
+	static constexpr int num_type_slots = 256; //per table; more than the number of types in any database
+	static constexpr uint32_t unused_type_id = 0xffffffff;
+
+	struct type_stats_t {
+		std::atomic<uint32_t> type_id{unused_type_id};
+		std::atomic<int64_t> num_reads{0};
+		std::atomic<int64_t> num_writes{0};
+		std::atomic<int64_t> num_deletes{0};
+		std::atomic<int64_t> bytes_serialized{0};
+		std::atomic<int64_t> bytes_deserialized{0};
+		std::atomic<int64_t> num_scans{0};
+		std::atomic<int64_t> scan_steps{0};
+		std::atomic<int64_t> max_scan_steps{0};
+	};
+
+	struct thread_stats_t {
+		int64_t num_rtxns{0};
+		int64_t num_wtxns{0};
+		int64_t rtxn_time{0};
+		int64_t wtxn_time{0};
+		int64_t max_wtxn_time{0};
+		int64_t num_reads{0};
+		int64_t num_writes{0};
+	};
+
+	std::atomic<bool> enabled{false};
+
+	using type_table_t = std::array<type_stats_t, num_type_slots>;
+	type_table_t types;
+	type_table_t indexes;
+	type_stats_t overflow; //used when a table is full; not reported
+	std::array<std::atomic<int64_t>, num_histogram_buckets> scan_length_histogram{};
+
+	std::atomic<int64_t> num_rtxns{0};
+	std::atomic<int64_t> rtxn_time{0};
+	std::atomic<int64_t> max_rtxn_time{0};
+	std::atomic<int64_t> num_wtxns{0};
+	std::atomic<int64_t> wtxn_time{0};
+	std::atomic<int64_t> max_wtxn_time{0};
+	std::atomic<int64_t> num_wtxn_waits{0};
+	std::atomic<int64_t> wtxn_wait_time{0};
+	std::atomic<int64_t> max_wtxn_wait_time{0};
+
+	std::mutex mutex; //protects the fields below
+	std::map<std::string, thread_stats_t> threads; //indexed by thread name
+	steady_time_t reset_time{steady_clock_t::now()};
+
+	//periodic dumping to the log
+	std::thread dump_thread;
+	std::condition_variable dump_cv;
+	int dump_period_s{0};
+
+	//type_id of the record or index with the serialized key
+	static inline uint32_t type_id_for_key(const void* key, size_t size) {
+		if (size < sizeof(uint32_t))
+			return 0;
+		auto* p = (const uint8_t*)key;
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+
+	inline type_stats_t& for_type(uint32_t type_id, bool is_index = false) {
+		auto& table = is_index ? indexes : types;
+		auto h = (type_id * 2654435761u) % num_type_slots;
+		for (int i = 0; i < num_type_slots; ++i) {
+			auto& s = table[(h + i) % num_type_slots];
+			auto id = s.type_id.load(std::memory_order_relaxed);
+			if (id == unused_type_id)
+				s.type_id.compare_exchange_strong(id, type_id, std::memory_order_relaxed);
+			//after a failed exchange, id is the type_id stored by another thread
+			if (id == unused_type_id || id == type_id)
+				return s;
+		}
+		return overflow;
+	}
+
+	static inline void add(std::atomic<int64_t>& x, int64_t val) {
+		x.fetch_add(val, std::memory_order_relaxed);
+	}
+
+	static inline void update_max(std::atomic<int64_t>& x, int64_t val) {
+		auto old = x.load(std::memory_order_relaxed);
+		while (val > old && !x.compare_exchange_weak(old, val, std::memory_order_relaxed))
+			;
+	}
+
+	inline void on_read(const void* key, size_t key_size, size_t val_size) {
+		auto& s = for_type(type_id_for_key(key, key_size));
+		add(s.num_reads, 1);
+		add(s.bytes_deserialized, val_size);
+	}
+
+	inline void on_write(const void* key, size_t key_size, size_t val_size) {
+		auto& s = for_type(type_id_for_key(key, key_size));
+		add(s.num_writes, 1);
+		add(s.bytes_serialized, val_size);
+	}
+
+	inline void on_delete(uint32_t type_id) {
+		add(for_type(type_id).num_deletes, 1);
+	}
+
+	void on_scan(const void* key_prefix, size_t key_prefix_size, bool is_index, int64_t steps);
+	void on_txn_end(const db_txn& txn, int64_t duration_us);
+	void on_wtxn_wait(int64_t duration_us);
+
+	void reset();
+	db_stats_snapshot_t snapshot(neumodb_t& db);
+
+	void start_periodic_dump(neumodb_t& db, int period_s);
+	void stop_periodic_dump();
+
+	~db_stats_t() {
+		stop_periodic_dump();
+	}
+};
+
+db_env_stats_t get_env_stats(neumodb_t& db);
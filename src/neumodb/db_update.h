@@ -23,6 +23,7 @@
 #include "cursors.h"
 #include "lmdb++.h"
 #include "db_keys_helper.h"
+#include "change_log_impl.h"
 
 inline static int key_cmp(const ss::bytebuffer_& a, const ss::bytebuffer_& b)
 {
@@ -47,34 +48,16 @@ template<typename record_t>
 int update_from(db_txn& to_txn, db_txn& from_txn, neumodb_t& to_db, neumodb_t& from_db,
 								 size_t to_txnid)
 {
-	int count =0;
-	auto start_logkey = record_t::make_log_key(to_txnid);
-
-	ss::bytebuffer<32> key_prefix;
-	encode_ascending(key_prefix, data_types::data_type<record_t>());
-
-	auto c = from_db.tcursor_log<record_t>(from_txn, key_prefix);
-	find_by_serialized_secondary_key(c, start_logkey, key_prefix, find_type_t::find_geq);
-
-	/*we cannot use c.range() because some secondary keys in
-		log may point to deleted records and my not have a primary record
-	*/
-	auto done = !c.is_valid();
-	for(; !done; done=!c.next()) {
-		assert(c.is_valid());
-		auto k = c.current_serialized_secondary_key();
-		count++;
-		record_t record;
-		if(c.get_value(record)) {
-			bool new_record = put_record(to_txn,record);
-			if(new_record)
-				printf("New record\n");
-			else
-				printf("Updated record\n");
-		} else {
-			delete_record(to_txn,record);
-			printf("Print deleted record\n");
+	ss::vector<change_t<record_t>, 16> changes;
+	int count = change_log::get_changes<record_t>(from_txn, to_txnid, from_txn.txn_id(), changes);
+	for(auto& change: changes) {
+		if(change.op == change_op_t::upsert)
+			put_record(to_txn, change.record);
+		else {
+			auto c = to_db.template tcursor<record_t>(to_txn);
+			if(c.find(change.primary_key))
+				delete_record_at_cursor(c);
 		}
-	 }
+	}
 	return count;
 }
@@ -21,6 +21,7 @@
 #pragma once
 #include "serialize.h"
 #include "decode.h"
+#include "string_compression.h"
 
 //deserialization of a simple primitive type
 template<typename T>
@@ -230,7 +231,10 @@ inline int deserialize(const ss::bytebuffer_ & ser, ss::string_& str, int offset
 			//printf("Insufficient data to deserialise\n");
 			return -1;
 		}
-		str.copy_raw((const char*)ser.buffer()+offset, size);
+		if(string_compression::is_compressed(ser.buffer()+offset, size))
+			string_compression::decompress(str, ser.buffer()+offset, size); //on error, str is left empty
+		else
+			str.copy_raw((const char*)ser.buffer()+offset, size);
 	}
 	return offset + size + 1;
 }
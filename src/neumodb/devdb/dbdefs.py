@@ -430,7 +430,11 @@ user_options = db_struct(name ='user_options',
                         (9, 'int32_t', 'livebuffer_mpm_part_duration', '10*60'),  #10 minutes
                         (19, 'ss::string<16>', 'softcam_server', '"192.168.2.254"'),
                         (20, 'int16_t', 'softcam_port', '9000'),
-                        (21, 'bool', 'softcam_enabled', 'true')
+                        (21, 'bool', 'softcam_enabled', 'true'),
+                        (22, 'bool', 'livebuffer_use_io_uring', 'false'),
+                        (23, 'bool', 'livebuffer_use_o_direct', 'false'),
+                        (24, 'int32_t', 'playback_readahead_seconds', '10'),
+                        (25, 'int32_t', 'recording_copy_max_mb_per_second', '100')
                     ))
 
 
@@ -638,7 +642,9 @@ scan_stats = db_struct(
 	            (11, 'int16_t', 'locked_peaks', '0'), #peaks which we could lock with frequency/symbolrate from spectrum
 	            (12, 'int16_t', 'locked_muxes', '0'), #muxes which locked
 	            (13, 'int16_t', 'si_muxes', '0'), #muxes with si data
-              (14, 'bool', 'finished', 'false')
+              (14, 'bool', 'finished', 'false'),
+              (15, 'int32_t', 'band_reuses', '0'), #muxes tuned on a subscription whose lnb was already in the same band/pol
+              (16, 'int32_t', 'band_switches', '0') #muxes tuned on a subscription whose lnb had to change band/pol
               ))
 
 scan_command = db_struct(
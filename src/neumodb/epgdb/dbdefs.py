@@ -111,7 +111,9 @@ epg_record = db_struct(name='epg_record',
                                  (11, 'ss::vector<uint16_t,4>',  'content_codes')),
                        filter_fields = (
                            ('epg_service', 'k.service'),
-                       )
+                       ),
+                       #compressed with a trained zstd dictionary if one is present (see neumoupgrade --compress)
+                       compressed_fields = ('event_name', 'story', 'service_name')
                        )
 
 
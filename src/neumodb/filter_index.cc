@@ -0,0 +1,247 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "neumodb/filter_index.h"
+#include <algorithm>
+#include <assert.h>
+
+bool roaring_bitmap_t::container_t::contains(uint16_t low) const {
+	if (is_bitset())
+		return (bits[low >> 6] >> (low & 63)) & 1;
+	return std::binary_search(array.begin(), array.end(), low);
+}
+
+bool roaring_bitmap_t::container_t::add(uint16_t low) {
+	if (is_bitset()) {
+		auto& word = bits[low >> 6];
+		auto mask = uint64_t(1) << (low & 63);
+		if (word & mask)
+			return false;
+		word |= mask;
+		cardinality++;
+		return true;
+	}
+	auto it = std::lower_bound(array.begin(), array.end(), low);
+	if (it != array.end() && *it == low)
+		return false;
+	array.insert(it, low);
+	cardinality++;
+	if (cardinality > max_array_size)
+		to_bitset();
+	return true;
+}
+
+bool roaring_bitmap_t::container_t::remove(uint16_t low) {
+	if (is_bitset()) {
+		auto& word = bits[low >> 6];
+		auto mask = uint64_t(1) << (low & 63);
+		if (!(word & mask))
+			return false;
+		word &= ~mask;
+		cardinality--;
+		if (cardinality <= max_array_size / 2) //hysteresis to avoid converting back and forth
+			to_array();
+		return true;
+	}
+	auto it = std::lower_bound(array.begin(), array.end(), low);
+	if (it == array.end() || *it != low)
+		return false;
+	array.erase(it);
+	cardinality--;
+	return true;
+}
+
+void roaring_bitmap_t::container_t::to_bitset() {
+	assert(!is_bitset());
+	bits.assign(bitset_words, 0);
+	for (auto low : array)
+		bits[low >> 6] |= uint64_t(1) << (low & 63);
+	array.clear();
+	array.shrink_to_fit();
+}
+
+void roaring_bitmap_t::container_t::to_array() {
+	assert(is_bitset());
+	array.clear();
+	array.reserve(cardinality);
+	for (int w = 0; w < bitset_words; ++w) {
+		for (auto word = bits[w]; word; word &= word - 1)
+			array.push_back(w * 64 + __builtin_ctzll(word));
+	}
+	bits.clear();
+	bits.shrink_to_fit();
+}
+
+roaring_bitmap_t::container_t* roaring_bitmap_t::find_container(uint16_t high) {
+	auto it = std::lower_bound(containers.begin(), containers.end(), high,
+														 [](const container_t& c, uint16_t high) { return c.high < high; });
+	return (it != containers.end() && it->high == high) ? &*it : nullptr;
+}
+
+const roaring_bitmap_t::container_t* roaring_bitmap_t::find_container(uint16_t high) const {
+	return const_cast<roaring_bitmap_t*>(this)->find_container(high);
+}
+
+bool roaring_bitmap_t::contains(uint32_t x) const {
+	auto* c = find_container(x >> 16);
+	return c && c->contains(x & 0xffff);
+}
+
+void roaring_bitmap_t::add(uint32_t x) {
+	uint16_t high = x >> 16;
+	auto it = std::lower_bound(containers.begin(), containers.end(), high,
+														 [](const container_t& c, uint16_t high) { return c.high < high; });
+	if (it == containers.end() || it->high != high) {
+		it = containers.insert(it, container_t{});
+		it->high = high;
+	}
+	it->add(x & 0xffff);
+}
+
+void roaring_bitmap_t::remove(uint32_t x) {
+	uint16_t high = x >> 16;
+	auto it = std::lower_bound(containers.begin(), containers.end(), high,
+														 [](const container_t& c, uint16_t high) { return c.high < high; });
+	if (it == containers.end() || it->high != high)
+		return;
+	it->remove(x & 0xffff);
+	if (it->cardinality == 0)
+		containers.erase(it);
+}
+
+int64_t roaring_bitmap_t::cardinality() const {
+	int64_t ret = 0;
+	for (auto& c : containers)
+		ret += c.cardinality;
+	return ret;
+}
+
+static roaring_bitmap_t::container_t intersect_containers(const roaring_bitmap_t::container_t& a,
+																													const roaring_bitmap_t::container_t& b) {
+	roaring_bitmap_t::container_t ret;
+	ret.high = a.high;
+	if (a.is_bitset() && b.is_bitset()) {
+		ret.bits.resize(roaring_bitmap_t::bitset_words);
+		for (int w = 0; w < roaring_bitmap_t::bitset_words; ++w) {
+			ret.bits[w] = a.bits[w] & b.bits[w];
+			ret.cardinality += __builtin_popcountll(ret.bits[w]);
+		}
+		if (ret.cardinality <= roaring_bitmap_t::max_array_size)
+			ret.to_array();
+	} else if (a.is_bitset() || b.is_bitset()) {
+		auto& array = a.is_bitset() ? b.array : a.array;
+		auto& bitset = a.is_bitset() ? a : b;
+		for (auto low : array) {
+			if (bitset.contains(low))
+				ret.array.push_back(low);
+		}
+		ret.cardinality = ret.array.size();
+	} else {
+		std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+													std::back_inserter(ret.array));
+		ret.cardinality = ret.array.size();
+	}
+	return ret;
+}
+
+roaring_bitmap_t roaring_bitmap_t::intersect(const roaring_bitmap_t& a, const roaring_bitmap_t& b) {
+	roaring_bitmap_t ret;
+	auto ia = a.containers.begin();
+	auto ib = b.containers.begin();
+	while (ia != a.containers.end() && ib != b.containers.end()) {
+		if (ia->high < ib->high)
+			++ia;
+		else if (ib->high < ia->high)
+			++ib;
+		else {
+			auto c = intersect_containers(*ia, *ib);
+			if (c.cardinality > 0)
+				ret.containers.push_back(std::move(c));
+			++ia;
+			++ib;
+		}
+	}
+	return ret;
+}
+
+void filter_index_t::clear(int num_fields) {
+	txn_id = -1;
+	primary_keys.clear();
+	rows.clear();
+	free_rows.clear();
+	fields.clear();
+	fields.resize(num_fields);
+}
+
+void filter_index_t::put(std::string_view primary_key, const std::string* values) {
+	uint32_t row;
+	auto [it, inserted] = rows.try_emplace(std::string(primary_key), 0);
+	if (inserted) {
+		if (free_rows.empty()) {
+			row = primary_keys.size();
+			primary_keys.emplace_back(primary_key);
+			for (auto& field : fields)
+				field.row_values.push_back(0);
+		} else {
+			row = free_rows.back();
+			free_rows.pop_back();
+			primary_keys[row] = primary_key;
+		}
+		it->second = row;
+	} else
+		row = it->second;
+
+	for (int i = 0; i < (int)fields.size(); ++i) {
+		auto& field = fields[i];
+		auto [vit, new_value] = field.value_ids.try_emplace(values[i], field.bitmaps.size());
+		if (new_value)
+			field.bitmaps.emplace_back();
+		auto value_id = vit->second;
+		if (!inserted) {
+			auto old_value_id = field.row_values[row];
+			if (old_value_id == value_id)
+				continue;
+			field.bitmaps[old_value_id].remove(row);
+		}
+		field.bitmaps[value_id].add(row);
+		field.row_values[row] = value_id;
+	}
+}
+
+void filter_index_t::erase(std::string_view primary_key) {
+	auto it = rows.find(std::string(primary_key));
+	if (it == rows.end())
+		return;
+	auto row = it->second;
+	for (auto& field : fields)
+		field.bitmaps[field.row_values[row]].remove(row);
+	primary_keys[row].clear();
+	free_rows.push_back(row);
+	rows.erase(it);
+}
+
+const roaring_bitmap_t* filter_index_t::bitmap(int field_idx, const std::string& value) const {
+	auto& field = fields[field_idx];
+	auto it = field.value_ids.find(value);
+	if (it == field.value_ids.end())
+		return nullptr;
+	auto& ret = field.bitmaps[it->second];
+	return ret.empty() ? nullptr : &ret;
+}
@@ -0,0 +1,136 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/*
+	Compressed bitmap of 32 bit row numbers, organised in the same way as "roaring" bitmaps:
+	row numbers are grouped per 65536 values sharing the same upper 16 bits. Each group is stored
+	either as a sorted array of the lower 16 bits (sparse groups) or as a 65536 bit bitset (dense groups).
+ */
+struct roaring_bitmap_t {
+	static constexpr int max_array_size = 4096; //larger containers are converted to bitsets
+	static constexpr int bitset_words = 65536 / 64;
+
+	struct container_t {
+		uint16_t high{0};
+		int cardinality{0};
+		std::vector<uint16_t> array; //sorted values; used if bits is empty
+		std::vector<uint64_t> bits;
+
+		inline bool is_bitset() const {
+			return !bits.empty();
+		}
+		bool contains(uint16_t low) const;
+		bool add(uint16_t low); //returns true if value was added
+		bool remove(uint16_t low); //returns true if value was removed
+		void to_bitset();
+		void to_array();
+
+		template<typename fn_t>
+		void for_each(fn_t fn) const {
+			uint32_t h = uint32_t(high) << 16;
+			if (is_bitset()) {
+				for (int w = 0; w < bitset_words; ++w) {
+					for (auto word = bits[w]; word; word &= word - 1)
+						fn(h | (w * 64 + __builtin_ctzll(word)));
+				}
+			} else {
+				for (auto low : array)
+					fn(h | low);
+			}
+		}
+	};
+
+	std::vector<container_t> containers; //sorted by high
+
+	bool contains(uint32_t x) const;
+	void add(uint32_t x);
+	void remove(uint32_t x);
+	int64_t cardinality() const;
+
+	inline bool empty() const {
+		return containers.empty();
+	}
+
+	static roaring_bitmap_t intersect(const roaring_bitmap_t& a, const roaring_bitmap_t& b);
+
+	template<typename fn_t>
+	void for_each(fn_t fn) const {
+		for (auto& c : containers)
+			c.for_each(fn);
+	}
+
+private:
+	container_t* find_container(uint16_t high);
+	const container_t* find_container(uint16_t high) const;
+};
+
+/*
+	In-memory bitmap indexes for the filter_fields of one record type. Each record receives a row number,
+	and for each filter field and each value of that field, a bitmap records which rows have that value.
+	Values are the serialized (encode_ascending) values of the subfields making up the filter field.
+
+	The index is built from the database on first use and then kept up to date by following the
+	change log, in the same way as screens are updated (see filter_index_impl.h)
+ */
+struct filter_index_t {
+	//rebuild from scratch if the change log may have been cleaned since the last sync
+	static constexpr int max_txn_lag = 5000;
+
+	struct field_t {
+		std::unordered_map<std::string, uint32_t> value_ids;
+		std::vector<roaring_bitmap_t> bitmaps; //indexed by value_id
+		std::vector<uint32_t> row_values; //value_id for each row
+	};
+
+	int txn_id{-1}; //the index reflects the database at the end of this transaction; -1 means: rebuild
+	std::vector<std::string> primary_keys; //primary key of each row; empty for unused rows
+	std::unordered_map<std::string, uint32_t> rows; //row of each primary key
+	std::vector<uint32_t> free_rows;
+	std::vector<field_t> fields;
+
+	void clear(int num_fields);
+	void put(std::string_view primary_key, const std::string* values);
+	void erase(std::string_view primary_key);
+
+	inline int64_t num_records() const {
+		return rows.size();
+	}
+
+	//returns nullptr if no record has this value
+	const roaring_bitmap_t* bitmap(int field_idx, const std::string& value) const;
+};
+
+/*
+	All filter indexes of one database, indexed by record type_id
+ */
+struct filter_indexes_t {
+	std::mutex mutex;
+	std::map<uint32_t, std::unique_ptr<filter_index_t>> indexes;
+};
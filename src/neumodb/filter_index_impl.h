@@ -0,0 +1,167 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include "neumodb/filter_index.h"
+#include "neumodb/db_keys_helper.h"
+
+/*
+	Helpers for the bitmap indexes of record types which have filter_fields.
+	record_t must provide num_filter_fields, filter_value and filter_field_is_matched,
+	which are generated for such record types.
+ */
+
+template<typename record_t>
+inline void filter_index_put(filter_index_t& index, const ss::bytebuffer_& primary_key, const record_t& record) {
+	std::array<std::string, record_t::num_filter_fields> values;
+	for (int i = 0; i < record_t::num_filter_fields; ++i) {
+		ss::bytebuffer<32> value;
+		record_t::filter_value(value, i, record);
+		values[i].assign((const char*)value.buffer(), value.size());
+	}
+	index.put(std::string_view((const char*)primary_key.buffer(), primary_key.size()), values.data());
+}
+
+template<typename record_t>
+inline void filter_index_rebuild(db_txn& txn, filter_index_t& index) {
+	index.clear(record_t::num_filter_fields);
+	auto key_prefix = record_t::make_key(record_t::keys_t::key, record_t::partial_keys_t::none, nullptr);
+	auto c = primary_key_t::find_by_serialized_key<record_t>(txn, key_prefix, key_prefix, find_type_t::find_geq);
+	c.set_key_prefix(key_prefix);
+	for (; c.is_valid(); c.next()) {
+		auto record = c.current();
+		filter_index_put(index, c.current_serialized_primary_key(), record);
+	}
+	index.txn_id = txn.txn_id();
+}
+
+/*
+	Bring index up to date with the database state seen by txn, by processing the change log.
+	Returns false if txn sees an older database state than the one in the index, in which case
+	the index cannot be used.
+ */
+template<typename record_t>
+inline bool filter_index_sync(db_txn& txn, filter_index_t& index) {
+	auto txn_id = txn.txn_id();
+	if (index.txn_id >= 0 && txn_id < index.txn_id)
+		return false;
+	if (index.txn_id == txn_id)
+		return true;
+	if (index.txn_id < 0 || !txn.pdb->use_log || txn_id - index.txn_id > filter_index_t::max_txn_lag) {
+		filter_index_rebuild<record_t>(txn, index);
+		return true;
+	}
+
+	auto start_logkey = record_t::make_log_key(index.txn_id + 1);
+	ss::bytebuffer<32> key_prefix;
+	encode_ascending(key_prefix, data_types::data_type<record_t>());
+	auto c = txn.pdb->template tcursor_log<record_t>(txn, key_prefix);
+	find_by_serialized_secondary_key(c, start_logkey, key_prefix, find_type_t::find_geq);
+
+	for (auto done = !c.is_valid(); !done; done = !c.next()) {
+		auto primary_key = c.current_serialized_primary_key();
+		bool has_been_deleted = !c.maincursor.is_valid();
+		if (has_been_deleted) {
+			index.erase(std::string_view((const char*)primary_key.buffer(), primary_key.size()));
+			continue;
+		}
+		record_t record;
+		if (c.get_value(record))
+			filter_index_put(index, primary_key, record);
+	}
+	index.txn_id = txn_id;
+	return true;
+}
+
+/*
+	Use the bitmap indexes to find the primary keys of all records which could match
+	field_matchers/match_data and field_matchers2/match_data2. Only equality matchers on filter_fields
+	are taken into account, so the caller must still check the other matchers.
+
+	Returns false if the indexes cannot be used: no filter field is restricted by the matchers,
+	or the matchers select a large part of the database, in which case a sequential scan is faster.
+ */
+template<typename record_t>
+inline bool filter_index_candidates(db_txn& txn, const ss::vector_<field_matcher_t>& field_matchers,
+																		const record_t* match_data,
+																		const ss::vector_<field_matcher_t>& field_matchers2,
+																		const record_t* match_data2, std::vector<std::string>& primary_keys) {
+	constexpr int n = record_t::num_filter_fields;
+	std::array<std::string, n> values;
+	std::array<bool, n> restricted{};
+	bool contradiction{false};
+	auto restrict = [&](const ss::vector_<field_matcher_t>& field_matchers, const record_t* match_data) {
+		if (!match_data)
+			return;
+		for (int i = 0; i < n; ++i) {
+			if (!record_t::filter_field_is_matched(i, field_matchers))
+				continue;
+			ss::bytebuffer<32> value;
+			record_t::filter_value(value, i, *match_data);
+			std::string v((const char*)value.buffer(), value.size());
+			if (restricted[i] && values[i] != v)
+				contradiction = true;
+			values[i] = std::move(v);
+			restricted[i] = true;
+		}
+	};
+	restrict(field_matchers, match_data);
+	restrict(field_matchers2, match_data2);
+	if (std::none_of(restricted.begin(), restricted.end(), [](bool x) { return x; }))
+		return false;
+	primary_keys.clear();
+	if (contradiction)
+		return true;
+
+	auto& indexes = *txn.pdb->filter_indexes;
+	std::scoped_lock lck(indexes.mutex);
+	auto& index = indexes.indexes[data_types::data_type<record_t>()];
+	if (!index)
+		index = std::make_unique<filter_index_t>();
+	if (!filter_index_sync<record_t>(txn, *index))
+		return false;
+
+	std::vector<const roaring_bitmap_t*> bitmaps;
+	for (int i = 0; i < n; ++i) {
+		if (!restricted[i])
+			continue;
+		auto* bitmap = index->bitmap(i, values[i]);
+		if (!bitmap)
+			return true; //no record has this value
+		bitmaps.push_back(bitmap);
+	}
+	//intersect the smallest bitmaps first
+	std::sort(bitmaps.begin(), bitmaps.end(),
+						[](const roaring_bitmap_t* a, const roaring_bitmap_t* b) { return a->cardinality() < b->cardinality(); });
+	if (bitmaps[0]->cardinality() * 8 > index->num_records())
+		return false;
+	roaring_bitmap_t result;
+	if (bitmaps.size() > 1) {
+		result = roaring_bitmap_t::intersect(*bitmaps[0], *bitmaps[1]);
+		for (int i = 2; i < (int)bitmaps.size(); ++i)
+			result = roaring_bitmap_t::intersect(result, *bitmaps[i]);
+	}
+	auto& rows = bitmaps.size() > 1 ? result : *bitmaps[0];
+	primary_keys.reserve(rows.cardinality());
+	rows.for_each([&](uint32_t row) { primary_keys.push_back(index->primary_keys[row]); });
+	return true;
+}
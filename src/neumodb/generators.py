@@ -129,7 +129,7 @@ class db_enum(object):
 class db_struct(object):
 
     def __init__(self, db, name, fname, type_id, version, fields, primary_key=None, keys=[],
-                 is_table=False, filter_fields=[], ignore_for_equality_fields=[]):
+                 is_table=False, filter_fields=[], ignore_for_equality_fields=[], compressed_fields=[]):
         self.hpp_template = db.get_template("structs.h")
         self.cpp_template = db.get_template("structs.cc")
         self.pybind_cpp_template = db.get_template("structs_pybind.cc")
@@ -164,6 +164,12 @@ class db_struct(object):
             self.add_key(*key)
         for filter_field in filter_fields:
             self.add_filter_field(*filter_field)
+        self.compressed_fields = compressed_fields
+        for field in self.fields:
+            field['is_compressed'] = field['name'] in compressed_fields
+            if field['is_compressed']:
+                assert field['type'].startswith('ss::string'), \
+                    f"{self.name}: compressed field {field['name']} is not a string"
         #self.dump()
     def get_field_type(self, field_name):
         try:
@@ -761,6 +767,20 @@ class db_db(object):
         processed = {}
         for idx,struct in enumerate(structs):
             self.compute_subfield_keys_for_struct(struct)
+    def compute_filter_subfields(self):
+        """
+        for each filter field, find the subfields making up its value, e.g., 'k.service' consists of
+        'k.service.sat_pos', 'k.service.network_id', ... These are used to compute the keys of the bitmap indexes
+        and to decide if field matchers restrict the filter field to a single value
+        """
+        for struct in self.all_structs.values():
+            for filter_field in struct.filter_fields:
+                key = filter_field['key']
+                filter_field['subfields'] = [f for f in struct.subfields if
+                                             (f['name'] == key or f['name'].startswith(key + '.'))
+                                             and not f['is_vector']]
+                if len(filter_field['subfields']) == 0:
+                    raise ValueError(f"{struct.name}: filter field {filter_field['name']} has no subfields")
     def prepare_keys(self):
         """
         compute additional info on each key
@@ -891,6 +911,7 @@ class db_db(object):
         self.expand_keys()
         #self.prepare_keys()
         self.compute_subfield_keys()
+        self.compute_filter_subfields()
         self.remove_duplicate_keys()
     def save_enums(self):
         fname = os.path.join(self.gen_options['output_dir'], "enums.cc")
@@ -17,10 +17,19 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  *
  */
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <fstream>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "dbdesc.h"
+#include "neumodb/filter_index.h"
+#include "neumodb/replica.h"
+#include "neumodb/string_compression.h"
 #include "neumodb/schema/schema_db.h"
 
 void neumodb_t::init(const all_schemas_t& all_sw_schemas) {
@@ -33,20 +42,48 @@ neumodb_t::neumodb_t(bool readonly_, bool is_temp_, bool autoconvert_, bool auto
 	,  autoconvert_major_version(autoconvert_major_version_)
 	, is_temp(is_temp_)
 	, readonly(readonly_)
-	, envp(std::make_shared<lmdb::env>(lmdb::env::create())) {
+	, envp(std::make_shared<lmdb::env>(lmdb::env::create()))
+	, filter_indexes(std::make_shared<filter_indexes_t>())
+	, aux_tables(std::make_shared<aux_tables_t>())
+	, stats(std::make_shared<db_stats_t>()) {
 }
 
 neumodb_t& neumodb_t::operator=(const neumodb_t& other) {
 	envp = other.envp;
 	dbdesc = other.dbdesc;
+	compression_dict_id = other.compression_dict_id;
+	aux_tables = other.aux_tables;
 	return *this;
 }
 
 neumodb_t::neumodb_t(const neumodb_t& main)
 	: autoconvert(main.autoconvert), is_temp(main.is_temp), readonly(main.readonly), envp(main.envp)
+	, filter_indexes(std::make_shared<filter_indexes_t>())
+	, compression_dict_id(main.compression_dict_id)
+	, aux_tables(main.aux_tables)
+	, stats(std::make_shared<db_stats_t>())
 //, dbdesc(main.dbdesc) deliberately not copied, as the copy of the neumodb_t needs to be initialised
 {}
 
+/*
+	Open the auxiliary tables in the transaction which opens the database. Afterwards
+	they are only accessed through their handles: unlike mdb_get and mdb_put, mdb_dbi_open
+	is not safe when called from concurrent transactions
+ */
+void neumodb_t::open_aux_tables(lmdb::txn& txn) {
+	auto open_table = [&](lmdb::dbi& dbi, const char* name) {
+		try {
+			dbi = lmdb::dbi(lmdb::dbi::open(txn, name, readonly ? 0 : MDB_CREATE));
+		} catch (const lmdb::not_found_error&) {
+			dbi = lmdb::dbi(0);
+		}
+	};
+	open_table(aux_tables->consumers, "change_consumers");
+	open_table(aux_tables->replica, "replica_state");
+	open_table(aux_tables->dicts, "compression_dicts");
+	open_table(aux_tables->signal_history, "signal_history");
+}
+
 neumodb_t::~neumodb_t() {
 		close();
 	}
@@ -56,52 +93,264 @@ inline auto decode_ascending(uint32_t x) {
 	return (encoded[0] << 24) | (encoded[1] << 16) | (encoded[2] << 8) | (encoded[3]);
 }
 
+namespace {
+	/*
+		A range of consecutive records in the old database, converted by one worker thread
+		and stored in one write transaction
+	*/
+	struct convert_chunk_t {
+		std::string start_key; //key of first record in the chunk
+		int num_records{0};
+		bool converted{false};
+		bool failed{false};
+		std::vector<std::unique_ptr<converted_record_t>> records;
+	};
+
+	std::string read_resume_key(const std::string& resume_file, bool& done) {
+		std::string ret;
+		done = false;
+		std::ifstream f(resume_file, std::ios::binary);
+		if(!f)
+			return ret;
+		std::string line;
+		std::getline(f, line);
+		if(line == "done") {
+			done = true;
+			return ret;
+		}
+		for(size_t i = 0; i + 1 < line.size(); i += 2)
+			ret.push_back((char)std::stoi(line.substr(i, 2), nullptr, 16));
+		return ret;
+	}
+
+	/*
+		write the progress atomically: either "done", or the hex encoded key of the first record
+		which remains to be converted (empty: start from the beginning)
+	*/
+	void write_resume_key(const std::string& resume_file, const std::string& key, bool done) {
+		auto tmp = resume_file + ".tmp";
+		{
+			std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+			if(done)
+				f << "done";
+			else
+				for(auto c: key)
+					f << fmt::format("{:02x}", (uint8_t)c);
+			f << "\n";
+		}
+		std::filesystem::rename(tmp, resume_file);
+	}
+
+	inline std::string current_key(db_cursor& cursor) {
+		ss::bytebuffer<32> key;
+		cursor.get_serialized_key(key);
+		return std::string((const char*)key.buffer(), key.size());
+	}
+
+	/*
+		position cursor at key, or at the first record after key
+	*/
+	inline bool find_geq(db_cursor& cursor, const std::string& key) {
+		if(key.size() == 0) {
+			lmdb::val k{};
+			return cursor.get(k, nullptr, MDB_FIRST);
+		}
+		ss::bytebuffer<32> k;
+		k.append_raw(key.data(), key.size());
+		return cursor.find(k, MDB_SET_RANGE);
+	}
+};
+
+/*
+	Convert the records in a chunk, using a read transaction owned by the calling thread
+*/
+static void convert_chunk(neumodb_t& from_db, neumodb_t& to_db, db_txn& from_txn, convert_chunk_t& chunk) {
+	auto& current = *to_db.dbdesc;
+	auto from_cursor = from_db.generic_cursor(from_txn);
+	chunk.records.reserve(chunk.num_records);
+	int count = 0;
+	for (auto status = find_geq(from_cursor, chunk.start_key); status && count < chunk.num_records;
+			 status = from_cursor.next(), ++count) {
+		ss::bytebuffer<32> key;
+		from_cursor.get_serialized_key(key);
+		if (key.size() <= (int)sizeof(uint32_t)) {
+			dterrorf("This key is too short");
+			continue;
+		}
+		auto encoded_type_id = *(uint32_t*)key.buffer();
+		auto type_id = decode_ascending(encoded_type_id);
+		auto* desc = current.schema_for_type(type_id);
+		if (desc == nullptr) {
+			if (type_id == data_types::data_type<schema::neumo_schema_t>()) {
+				dtdebugf("schema record found");
+			} else {
+				dtdebugf("unrecognized type=0x{:x}", type_id);
+			}
+			continue;
+		}
+		auto record = to_db.read_converted_record(from_cursor, type_id);
+		if(record)
+			chunk.records.push_back(std::move(record));
+	}
+}
+
 /*!
 	read an old database record by record using from_txn, transforming the records to
 	the latest format and storing them in to_txn
 
-	put_flags can be set to MDB_APPEND for databases (e.g. recdb) which
-	are always appended. This results in a lot of space saving as no free room
-	is left between records.
+	The records are first split in chunks of options.records_per_txn consecutive records (which
+	only requires reading the keys). Worker threads then convert the chunks, while the calling
+	thread stores the converted chunks in key order, each in its own write transaction. At most
+	2*num_threads chunks are kept in memory.
+
+	When options.resume_file is set, the key of the first record of the next chunk is saved
+	after each transaction, so that an interrupted conversion can continue. Records which were
+	already stored by the interrupted run are simply overwritten.
 */
-int convert_db(neumodb_t& from_db, neumodb_t& to_db, unsigned int put_flags) {
-	try {
-		// using namespace schema;
-		auto from_txn = from_db.rtxn();
-		auto from_cursor = from_db.generic_get_first(from_txn);
-		auto to_txn = to_db.wtxn();
+int convert_db(neumodb_t& from_db, neumodb_t& to_db, unsigned int put_flags,
+							 const convert_db_options_t& options) {
+	/*Check if both databases are related; this does NOT compare if the stored
+		schemas match, but rather that the programmer does not try to convert
+		unrelated databases; the test is a partial test (checks pointers)
+	*/
+	assert(from_db.dbdesc->p_all_sw_schemas == to_db.dbdesc->p_all_sw_schemas);
+	int num_threads = options.num_threads > 0 ? options.num_threads
+		: std::max(1, (int)std::thread::hardware_concurrency());
+	int records_per_txn = std::max(1, options.records_per_txn);
+	bool resume = options.resume_file.size() > 0;
+
+	std::vector<convert_chunk_t> chunks;
+	std::atomic<bool> must_exit{false};
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable cv;
+	int next_chunk{0}; //next chunk to convert
+	int num_stored{0}; //number of chunks which have been written
+	auto stop_workers = [&]() {
+		must_exit = true;
+		cv.notify_all();
+		for(auto& t: workers)
+			t.join();
+		workers.clear();
+	};
 
-		/*Check if both databases are related; this does NOT compare if the stored
-			schemas match, but rather that the programmer does not try to convert
-			unrelated databases; the test is a partial test (checks pointers)
-		*/
-		assert(from_db.dbdesc->p_all_sw_schemas == to_db.dbdesc->p_all_sw_schemas);
-		auto& current = *to_db.dbdesc;
-		for (auto status = from_cursor.is_valid(); status; status = from_cursor.next()) {
-			ss::bytebuffer<32> key;
-			from_cursor.get_serialized_key(key);
-			if (key.size() <= (int)sizeof(uint32_t)) {
-				dterrorf("This key is too short");
-				continue;
+	try {
+		bool done{false};
+		std::string resume_key = resume ? read_resume_key(options.resume_file, done) : std::string();
+		if(done) {
+			dtinfof("Conversion was already completed");
+			return 1;
+		}
+		if(resume_key.size() > 0)
+			dtinfof("Resuming interrupted conversion");
+		else if(resume)
+			write_resume_key(options.resume_file, resume_key, false);
+
+		// find the chunk boundaries
+		int64_t num_records{0};
+		{
+			auto from_txn = from_db.rtxn();
+			auto from_cursor = from_db.generic_cursor(from_txn);
+			for (auto status = find_geq(from_cursor, resume_key); status; status = from_cursor.next()) {
+				if(num_records % records_per_txn == 0)
+					chunks.push_back(convert_chunk_t{current_key(from_cursor)});
+				chunks.back().num_records++;
+				num_records++;
 			}
-			auto encoded_type_id = *(uint32_t*)key.buffer();
-			auto type_id = decode_ascending(encoded_type_id);
-			auto* desc = current.schema_for_type(type_id);
-			if (desc == nullptr) {
-				if (type_id == data_types::data_type<schema::neumo_schema_t>()) {
-					dtdebugf("schema record found");
-				} else {
-					dtdebugf("unrecognized type=0x{:x}", type_id);
+			from_txn.commit();
+		}
+
+		auto worker = [&]() {
+			auto from_txn = from_db.rtxn();
+			for(;;) {
+				int idx;
+				{
+					std::unique_lock lck(mutex);
+					//limit memory use by not running too far ahead of the writer
+					cv.wait(lck, [&]() { return must_exit || next_chunk >= (int)chunks.size() ||
+								next_chunk < num_stored + 2 * num_threads; });
+					if(must_exit || next_chunk >= (int)chunks.size())
+						break;
+					idx = next_chunk++;
 				}
-				continue;
+				auto& chunk = chunks[idx];
+				bool failed{false};
+				try {
+					convert_chunk(from_db, to_db, from_txn, chunk);
+				} catch(...) {
+					failed = true;
+				}
+				{
+					std::scoped_lock lck(mutex);
+					chunk.converted = true;
+					chunk.failed = failed;
+				}
+				cv.notify_all();
 			}
-			to_db.convert_record(from_cursor, to_txn, type_id);
+			from_txn.abort();
+		};
+		for(int i = 0; i < num_threads; ++i)
+			workers.emplace_back(worker);
+
+		//last key in the output database; records with larger keys can be appended
+		std::string last_key;
+		{
+			auto to_txn = to_db.rtxn();
+			auto c = to_db.generic_cursor(to_txn);
+			lmdb::val k{};
+			if(c.get(k, nullptr, MDB_LAST))
+				last_key = current_key(c);
+			to_txn.commit();
 		}
 
+		auto start_time = steady_clock_t::now();
+		auto last_report_time = start_time;
+		int64_t num_done{0};
+		for(int idx = 0; idx < (int)chunks.size(); ++idx) {
+			auto& chunk = chunks[idx];
+			{
+				std::unique_lock lck(mutex);
+				cv.wait(lck, [&]() { return chunk.converted; });
+			}
+			if(chunk.failed) {
+				dterrorf("EXCEPTION occurred");
+				stop_workers();
+				return -1;
+			}
+			auto to_txn = to_db.wtxn();
+			for(auto& record: chunk.records)
+				record->put(to_txn, last_key, put_flags);
+			to_txn.commit();
+			num_done += chunk.num_records;
+			chunk.records = {}; //release memory
+			{
+				std::scoped_lock lck(mutex);
+				num_stored = idx + 1;
+			}
+			cv.notify_all();
+			if(resume && idx + 1 < (int)chunks.size())
+				write_resume_key(options.resume_file, chunks[idx + 1].start_key, false);
+			auto now = steady_clock_t::now();
+			if(options.show_progress && (now - last_report_time >= 1s || idx + 1 == (int)chunks.size())) {
+				last_report_time = now;
+				auto secs = std::chrono::duration<double>(now - start_time).count();
+				printf("\rConverted %ld/%ld records (%.1f%%) %.0f records/s", num_done, num_records,
+							 num_records ? 100. * num_done / num_records : 100., secs > 0 ? num_done / secs : 0.);
+				fflush(stdout);
+			}
+		}
+		if(options.show_progress && chunks.size() > 0)
+			printf("\n");
+		stop_workers();
+
 		// add a schema to the output database
+		auto to_txn = to_db.wtxn();
 		to_db.store_schema(to_txn, put_flags);
 		to_txn.commit();
+		if(resume)
+			write_resume_key(options.resume_file, std::string(), true);
 	} catch (...) {
+		stop_workers();
 		dterrorf("EXCEPTION occurred");
 		return -1;
 	}
@@ -217,7 +466,7 @@ void neumodb_t::open_(const char* dbpath, bool allow_degraded_mode, const char*
 			envp->set_max_dbs((MDB_dbi)128);
 			envp->open(dbpath, MDB_NOTLS | MDB_NOSYNC | MDB_WRITEMAP, 0664);
 		} else {
-			envp->set_max_dbs((MDB_dbi)12);
+			envp->set_max_dbs((MDB_dbi)16);
 			envp->open(dbpath, MDB_NOTLS | extra_flags, 0664);
 		}
 		envp->set_mapsize(mapsize);
@@ -242,6 +491,8 @@ void neumodb_t::open_(const char* dbpath, bool allow_degraded_mode, const char*
 			dbi_index = lmdb::dbi(lmdb::dbi::open(txn, "index", MDB_CREATE | MDB_DUPSORT));
 			dbi_log = lmdb::dbi(lmdb::dbi::open(txn, "log", MDB_CREATE | MDB_DUPSORT));
 		}
+		if (!is_temp)
+			open_aux_tables(txn);
 		txn.commit();
 	} catch (...) {
 		dterrorf("Fatal error opening lmdb database {}", dbpath);
@@ -258,6 +509,10 @@ void neumodb_t::open_(const char* dbpath, bool allow_degraded_mode, const char*
 	}
 
 	this->use_log = use_log;
+	if (!is_temp) {
+		string_compression::load_dicts(*this);
+		load_or_create_db_uuid(*this);
+	}
 
 	/*
 		TODO:
@@ -271,6 +526,8 @@ void neumodb_t::open_(const char* dbpath, bool allow_degraded_mode, const char*
 }
 
 void neumodb_t::close() {
+	if (stats)
+		stats->stop_periodic_dump();
 	if (envp) {
 		/*envp->close(); Do not call this because env may be used by other (secondary) databases
 			destructor will take care of it
@@ -279,6 +536,24 @@ void neumodb_t::close() {
 	}
 }
 
+db_stats_snapshot_t neumodb_t::get_statistics(bool reset) {
+	auto ret = stats->snapshot(*this);
+	if (reset)
+		stats->reset();
+	return ret;
+}
+
+/*
+	Log statistics every period_s seconds; period_s=0 stops logging
+ */
+void neumodb_t::dump_statistics_periodically(int period_s) {
+	if (period_s > 0) {
+		stats->enabled = true;
+		stats->start_periodic_dump(*this, period_s);
+	} else
+		stats->stop_periodic_dump();
+}
+
 /*
 	Open a temporary database with a unique name, stored as a subdir of where
 */
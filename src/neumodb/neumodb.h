@@ -27,6 +27,10 @@
 #include "util/logger.h"
 #include "util/util.h"
 #include "screen.h"
+#include "neumodb/db_stats.h"
+#include <array>
+#include <memory>
+#include <string>
 #ifndef HIDDEN
 #define HIDDEN __attribute__((visibility("hidden")))
 #endif
@@ -40,6 +44,7 @@
 constexpr int neumo_schema_version{3};
 
 class dbdesc_t;
+struct filter_indexes_t;
 struct record_desc_t;
 struct schema_entry_t;
 
@@ -55,6 +60,19 @@ struct db_upgrade_info_t {
 		{}
 };
 
+/*
+	A record read from an old database and converted to the current format, but not yet stored
+*/
+struct converted_record_t {
+	virtual ~converted_record_t() = default;
+
+	/*
+		store the record in to_txn. If its primary key sorts after last_key, MDB_APPEND is used
+		and last_key is updated
+	*/
+	virtual void put(db_txn& to_txn, std::string& last_key, unsigned int put_flags) = 0;
+};
+
 class neumodb_t {
 private:
 	bool is_open_{false};
@@ -70,6 +88,7 @@ protected:
 
 	void open_(const char* dbpath, bool allow_degraded_mode = false,
 						 const char* table_name = NULL, bool use_log =true, size_t mapsize = 256*1024u*1024u);
+	void open_aux_tables(lmdb::txn& txn);
 	neumodb_t(bool readonly=false, bool is_temp=false, bool autoconvert=false, bool autoconvert_major_version=false);
 public:
 	int extra_flags{0};
@@ -119,6 +138,41 @@ public:
 
 	lmdb::dbi dbi_log{0}; //dangerous but convenient; could lead to errors if open is not called
 
+	//in-memory bitmap indexes for filter_fields, built on first use; not shared with copies
+	std::shared_ptr<filter_indexes_t> filter_indexes;
+
+	//zstd dictionary used for compressing compressed_fields; 0 means: no compression (see string_compression.h)
+	uint32_t compression_dict_id{0};
+
+	//identifies the database; generated when it is first opened, so a recreated database has a new one (see replica.h)
+	std::array<uint8_t, 16> uuid{};
+
+	/*
+		auxiliary tables, opened once in open(), because mdb_dbi_open must not be called from concurrent
+		transactions. A handle of 0 means: the table does not exist (temporary or readonly database).
+		Shared with copies (secondary databases), which use the same environment
+	*/
+	struct aux_tables_t {
+		lmdb::dbi consumers{0}; //change log consumer positions (see change_log.h)
+		lmdb::dbi replica{0}; //replica positions and database uuid (see replica.h)
+		lmdb::dbi dicts{0}; //compression dictionaries (see string_compression.h)
+		lmdb::dbi signal_history{0}; //signal history blocks (see statdb/signal_history.h)
+	};
+	std::shared_ptr<aux_tables_t> aux_tables;
+
+	//runtime statistics; not shared with copies
+	std::shared_ptr<db_stats_t> stats;
+
+	void set_statistics_enabled(bool enabled) {
+		stats->enabled = enabled;
+	}
+
+	//returns the statistics collected since the last reset, and the current lmdb environment statistics
+	db_stats_snapshot_t get_statistics(bool reset=false);
+
+	//log the statistics every period_s seconds; 0 stops logging
+	void dump_statistics_periodically(int period_s);
+
 	neumodb_t(const neumodb_t& main);
 
 	neumodb_t& operator = (const neumodb_t& other);
@@ -262,22 +316,70 @@ public:
 			return -1;
 		};
 
+	/*
+		same as convert_record, but only reads and converts the record, so that this work
+		can be done on multiple threads
+	 */
+	virtual std::unique_ptr<converted_record_t> read_converted_record(db_cursor& from_cursor, uint32_t type_id)
+		{ assert (0);
+			return {};
+		};
+
 	virtual void store_schema(db_txn& txn, unsigned int put_flags)
 		{ assert (0);
 		};
 
+	/*
+		train a compression dictionary on the compressed_fields of at most max_samples records in from_db
+		(which may have an older schema) and use it for compressing records in this database.
+		Returns the id of the new dictionary, or 0 if the database has no compressed_fields
+	 */
+	virtual uint32_t train_compression_dict(neumodb_t& from_db, int max_samples=20000)
+		{ return 0;
+		};
+
+	/*
+		serialize the record at from_cursor (of type type_id) for sending it to a replica (see replica.h).
+		Returns false if the type is not known
+	 */
+	virtual bool serialize_for_replica(db_cursor& from_cursor, uint32_t type_id, ss::bytebuffer_& out)
+		{ return false;
+		};
+
+	/*
+		store a record received by a replica, or delete the record with the given primary key if
+		val is empty. Returns -1 if the type is not known or the record is corrupt, 0 if there was nothing
+		to delete and 1 otherwise
+	 */
+	virtual int put_from_replica(db_txn& to_txn, uint32_t type_id, const ss::bytebuffer_& primary_key,
+															 const ss::bytebuffer_& val)
+		{ return -1;
+		};
+
 
 };
 
 
+struct convert_db_options_t {
+	int num_threads{0}; //number of threads converting records; 0 means: one per cpu
+	int records_per_txn{4096}; //records stored per write transaction
+	/*if not empty, the key of the next record to convert is saved in this file after each
+		write transaction, and an interrupted conversion continues from there*/
+	std::string resume_file;
+	bool show_progress{true};
+};
+
 /*!
 	read an old database record by record using from_txn, transforming the records to
 	the latest format and storing them in to_txn
-	put_flags can be set to MDB_APPEND for databases (e.g. recdb) which
-	are always appended. This results in a lot of space saving as no free room
-	is left between records.
+
+	Records are converted in parallel in chunks of options.records_per_txn, and each chunk
+	is written in its own transaction. MDB_APPEND is used for each record which sorts
+	after all records already stored, which is normally the case. This results in a lot of space
+	saving as no free room is left between records.
 */
-int convert_db(neumodb_t& from_db, neumodb_t& to_db, unsigned int put_flags);
+int convert_db(neumodb_t& from_db, neumodb_t& to_db, unsigned int put_flags,
+							 const convert_db_options_t& options = {});
 int stats_db(neumodb_t& from_db);
 
 namespace schema {
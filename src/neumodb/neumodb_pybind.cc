@@ -20,12 +20,14 @@
 
 #include "neumodb/cursors.h"
 #include "neumodb/neumodb.h"
+#include "neumodb/replica.h"
 #include "receiver/streamparser/streamparser.h"
 #include "stackstring/stackstring.h"
 #include "stackstring/stackstring_pybind.h"
 #include "util/identification.h"
 #include "neumotime.h"
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 #include <stdio.h>
 namespace py = pybind11;
 void export_find_type(py::module& m) {
@@ -86,6 +88,110 @@ void export_milli_seconds_t(py::module& m) {
 		;
 }
 
+void export_db_stats(py::module& m) {
+	static int called = false;
+	if (called)
+		return;
+	called = true;
+
+	py::class_<db_type_stats_snapshot_t>(m, "db_type_stats")
+		.def_readonly("type_id", &db_type_stats_snapshot_t::type_id)
+		.def_readonly("name", &db_type_stats_snapshot_t::name)
+		.def_readonly("num_reads", &db_type_stats_snapshot_t::num_reads)
+		.def_readonly("num_writes", &db_type_stats_snapshot_t::num_writes)
+		.def_readonly("num_deletes", &db_type_stats_snapshot_t::num_deletes)
+		.def_readonly("bytes_serialized", &db_type_stats_snapshot_t::bytes_serialized)
+		.def_readonly("bytes_deserialized", &db_type_stats_snapshot_t::bytes_deserialized)
+		.def_readonly("num_scans", &db_type_stats_snapshot_t::num_scans)
+		.def_readonly("scan_steps", &db_type_stats_snapshot_t::scan_steps)
+		.def_readonly("max_scan_steps", &db_type_stats_snapshot_t::max_scan_steps)
+		;
+
+	py::class_<db_thread_stats_snapshot_t>(m, "db_thread_stats")
+		.def_readonly("thread_name", &db_thread_stats_snapshot_t::thread_name)
+		.def_readonly("num_rtxns", &db_thread_stats_snapshot_t::num_rtxns)
+		.def_readonly("num_wtxns", &db_thread_stats_snapshot_t::num_wtxns)
+		.def_readonly("rtxn_time", &db_thread_stats_snapshot_t::rtxn_time)
+		.def_readonly("wtxn_time", &db_thread_stats_snapshot_t::wtxn_time)
+		.def_readonly("max_wtxn_time", &db_thread_stats_snapshot_t::max_wtxn_time)
+		.def_readonly("num_reads", &db_thread_stats_snapshot_t::num_reads)
+		.def_readonly("num_writes", &db_thread_stats_snapshot_t::num_writes)
+		;
+
+	py::class_<db_table_stats_t>(m, "db_table_stats")
+		.def_readonly("name", &db_table_stats_t::name)
+		.def_readonly("entries", &db_table_stats_t::entries)
+		.def_readonly("depth", &db_table_stats_t::depth)
+		.def_readonly("branch_pages", &db_table_stats_t::branch_pages)
+		.def_readonly("leaf_pages", &db_table_stats_t::leaf_pages)
+		.def_readonly("overflow_pages", &db_table_stats_t::overflow_pages)
+		;
+
+	py::class_<db_env_stats_t>(m, "db_env_stats")
+		.def_readonly("map_size", &db_env_stats_t::map_size)
+		.def_readonly("map_used", &db_env_stats_t::map_used)
+		.def_readonly("page_size", &db_env_stats_t::page_size)
+		.def_readonly("num_readers", &db_env_stats_t::num_readers)
+		.def_readonly("max_readers", &db_env_stats_t::max_readers)
+		.def_readonly("tables", &db_env_stats_t::tables)
+		;
+
+	py::class_<db_stats_snapshot_t>(m, "db_stats")
+		.def("__repr__", &db_stats_snapshot_t::to_string)
+		.def_readonly("period", &db_stats_snapshot_t::period)
+		.def_readonly("num_rtxns", &db_stats_snapshot_t::num_rtxns)
+		.def_readonly("rtxn_time", &db_stats_snapshot_t::rtxn_time)
+		.def_readonly("max_rtxn_time", &db_stats_snapshot_t::max_rtxn_time)
+		.def_readonly("num_wtxns", &db_stats_snapshot_t::num_wtxns)
+		.def_readonly("wtxn_time", &db_stats_snapshot_t::wtxn_time)
+		.def_readonly("max_wtxn_time", &db_stats_snapshot_t::max_wtxn_time)
+		.def_readonly("num_wtxn_waits", &db_stats_snapshot_t::num_wtxn_waits)
+		.def_readonly("wtxn_wait_time", &db_stats_snapshot_t::wtxn_wait_time)
+		.def_readonly("max_wtxn_wait_time", &db_stats_snapshot_t::max_wtxn_wait_time)
+		.def_readonly("scan_length_histogram", &db_stats_snapshot_t::scan_length_histogram)
+		.def_readonly("types", &db_stats_snapshot_t::types)
+		.def_readonly("indexes", &db_stats_snapshot_t::indexes)
+		.def_readonly("threads", &db_stats_snapshot_t::threads)
+		.def_readonly("env", &db_stats_snapshot_t::env)
+		;
+}
+
+void export_replica(py::module& m) {
+	static int called = false;
+	if (called)
+		return;
+	called = true;
+
+	py::class_<replica_options_t>(m, "replica_options")
+		.def(py::init<>())
+		.def_readwrite("poll_interval_ms", &replica_options_t::poll_interval_ms)
+		.def_readwrite("records_per_batch", &replica_options_t::records_per_batch)
+		.def_readwrite("max_unacked_batches", &replica_options_t::max_unacked_batches)
+		.def_readwrite("reconnect_interval_ms", &replica_options_t::reconnect_interval_ms)
+		;
+
+	// py::keep_alive<1, 2>() => ensure that the database outlives the server/client
+	py::class_<replica_server_t>(m, "replica_server")
+		.def(py::init<neumodb_t&, const std::string&, const replica_options_t&>(), py::keep_alive<1, 2>(),
+				 py::arg("db"), py::arg("address"), py::arg("options") = replica_options_t{})
+		.def("start", &replica_server_t::start, py::call_guard<py::gil_scoped_release>())
+		.def("stop", &replica_server_t::stop, py::call_guard<py::gil_scoped_release>())
+		.def_property_readonly("num_clients", &replica_server_t::num_clients)
+		;
+
+	py::class_<replica_client_t>(m, "replica_client")
+		.def(py::init<neumodb_t&, const std::string&, const std::string&, const replica_options_t&>(),
+				 py::keep_alive<1, 2>(), py::arg("db"), py::arg("address"), py::arg("name"),
+				 py::arg("options") = replica_options_t{})
+		.def("start", &replica_client_t::start)
+		.def("stop", &replica_client_t::stop, py::call_guard<py::gil_scoped_release>())
+		.def_property_readonly("connected", [](const replica_client_t& self) { return self.connected.load(); })
+		.def_property_readonly("num_records", [](const replica_client_t& self) { return self.num_records.load(); })
+		.def_property_readonly("num_batches", [](const replica_client_t& self) { return self.num_batches.load(); })
+		.def_property_readonly("next_txn_id", [](const replica_client_t& self) { return self.next_txn_id.load(); })
+		;
+}
+
 EXPORT void export_neumodb(py::module& m) {
 	static bool called = false;
 	m.attr("neumo_schema_version") = neumo_schema_version; //needs to be before the if(called)
@@ -105,6 +211,8 @@ EXPORT void export_neumodb(py::module& m) {
 	export_ss_vector(m, int64_t);
 
 	export_milli_seconds_t(m);
+	export_db_stats(m);
+	export_replica(m);
 	py::class_<db_txn>(m, "db_txn")
 		.def("commit", &db_txn::commit, "Commit transaction")
 		.def(
@@ -122,5 +230,11 @@ EXPORT void export_neumodb(py::module& m) {
 		.def("rtxn", &neumodb_t::rtxn, py::keep_alive<0, 1>())
 		.def_readonly("db_version", &neumodb_t::db_version)
 		.def("stats", &stats_db)
+		.def("set_statistics_enabled", &neumodb_t::set_statistics_enabled, "Start or stop collecting runtime statistics",
+				 py::arg("enabled") = true)
+		.def("get_statistics", &neumodb_t::get_statistics, "Runtime statistics since the last reset",
+				 py::arg("reset") = false)
+		.def("dump_statistics_periodically", &neumodb_t::dump_statistics_periodically,
+				 "Log runtime statistics every period_s seconds; 0 stops logging", py::arg("period_s"))
 		;
 }
@@ -21,4 +21,5 @@
 
 template<typename db_t>
 int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
-										bool force_overwrite, bool inplace_upgrade, bool dont_backup);
+										bool force_overwrite, bool inplace_upgrade, bool dont_backup, int num_threads=0,
+										bool compress=false);
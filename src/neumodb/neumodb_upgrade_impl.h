@@ -28,6 +28,7 @@
 #include "cursors.h"
 #include "util/template_util.h"
 #include "neumodb/neumodb.h"
+#include "neumodb/string_compression.h"
 #include "neumodb/schema/schema_db.h"
 #include "neumodb/chdb/chdb_extra.h"
 #include "neumodb/statdb/statdb_extra.h"
@@ -40,7 +41,8 @@ namespace fs = std::filesystem;
 
 template<typename db_t>
 int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
-										bool force_overwrite, bool inplace_upgrade, bool dont_backup)
+										bool force_overwrite, bool inplace_upgrade, bool dont_backup, int num_threads,
+										bool compress)
 {
 	std::error_code err;
 	unsigned int put_flags = 0;
@@ -72,7 +74,28 @@ int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
 		return -1;
 	}
 	auto path_to = fs::path(to_dbname);
-	if(fs::exists(path_to, err)) {
+	/*
+		files recording the progress of each table; if present, an earlier upgrade to the same to_dbname
+		was interrupted and will be continued
+	*/
+	auto progress_file = [&path_to](const char* table_name) {
+		return (path_to / (std::string("upgrade_progress") + (table_name ? "_" : "") +
+											 (table_name ? table_name : ""))).string();
+	};
+	auto convert_options = [&](const char* table_name) {
+		convert_db_options_t ret;
+		ret.num_threads = num_threads;
+		ret.resume_file = progress_file(table_name);
+		return ret;
+	};
+	auto remove_progress_files = [&]() {
+		for(auto* table_name: {(const char*) nullptr, "epg", "service", "idx"})
+			fs::remove(progress_file(table_name), err);
+	};
+	bool resume = fs::exists(progress_file(nullptr), err);
+	if(resume) {
+		fprintf(stderr, "Continuing interrupted upgrade in %s\n", to_dbname);
+	} else if(fs::exists(path_to, err)) {
 		if(force_overwrite) {
 			auto num_deleted = fs::remove_all(path_to, err);
 			if(err || num_deleted==0) {
@@ -88,8 +111,19 @@ int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
 		return -1;
 	}
 
-	to_db.open_without_log(to_dbname);
-	if(convert_db(from_db, to_db, put_flags)<0) {
+	/*make sure the output database can hold the converted input database*/
+	std::error_code size_err;
+	auto from_size = fs::file_size(fs::path(from_dbname) / "data.mdb", size_err);
+	size_t mapsize = std::max((size_t)256*1024u*1024u, size_err ? (size_t)0 : (size_t) 2 * from_size);
+	to_db.open_without_log(to_dbname, false /*allow_degraded_mode*/, nullptr /*table_name*/, mapsize);
+	if(!resume) {
+		/*keep compressing strings with the dictionaries of the old database, or train a new dictionary
+			on the old data (an interrupted upgrade continues with the dictionary it already stored)*/
+		string_compression::copy_dicts(from_db, to_db);
+		if(compress && to_db.train_compression_dict(from_db) == 0)
+			fprintf(stderr, "Could not train compression dictionary; strings will not be compressed\n");
+	}
+	if(convert_db(from_db, to_db, put_flags, convert_options(nullptr))<0) {
 		fprintf(stderr, "Conversion failed; cleaning up %s\n", to_dbname);
 		auto num_deleted = fs::remove_all(path_to, err);
 		if(err || num_deleted==0) {
@@ -105,7 +139,9 @@ int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
 		epgdb::epgdb_t to_epgdb (to_db);
 		from_epgdb.open_secondary("epg", allow_degraded_mode);
 		to_epgdb.open_secondary("epg");
-		if(convert_db(from_epgdb, to_epgdb, put_flags)<0) {
+		if(compress && !resume && to_epgdb.train_compression_dict(from_epgdb) == 0)
+			fprintf(stderr, "Could not train compression dictionary; strings will not be compressed\n");
+		if(convert_db(from_epgdb, to_epgdb, put_flags, convert_options("epg"))<0) {
 			fprintf(stderr, "Conversion (epg) failed; cleaning up %s\n", to_dbname);
 			auto num_deleted = fs::remove_all(path_to, err);
 			if(err || num_deleted==0) {
@@ -118,7 +154,7 @@ int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
 		chdb::chdb_t to_chdb (to_db);
 		from_chdb.open_secondary("service", allow_degraded_mode);
 		to_chdb.open_secondary("service");
-		if(convert_db(from_chdb, to_chdb, put_flags)<0) {
+		if(convert_db(from_chdb, to_chdb, put_flags, convert_options("service"))<0) {
 			fprintf(stderr, "Conversion (service) failed; cleaning up %s\n", to_dbname);
 			auto num_deleted = fs::remove_all(path_to, err);
 			if(err || num_deleted==0) {
@@ -132,7 +168,7 @@ int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
 		recdb::recdb_t to_idxdb (to_db);
 		from_idxdb.open_secondary("idx", allow_degraded_mode);
 		to_idxdb.open_secondary("idx");
-		if(convert_db(from_idxdb, to_idxdb, put_flags)<0) {
+		if(convert_db(from_idxdb, to_idxdb, put_flags, convert_options("idx"))<0) {
 			fprintf(stderr, "Conversion (idx) failed; cleaning up %s\n", to_dbname);
 			auto num_deleted = fs::remove_all(path_to, err);
 			if(err || num_deleted==0) {
@@ -143,6 +179,7 @@ int neumodb_upgrade(const char* from_dbname, const char* to_dbname,
 
 	}
 	///////////end: specific for recdb ////////////////////
+	remove_progress_files();
 	if(inplace_upgrade) {
 		//atomically replace input and output db
 			if(file_swap(from_dbname, to_dbname)<0) {
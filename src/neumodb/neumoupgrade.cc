@@ -64,6 +64,8 @@ struct options_t {
 	bool inplace_upgrade = false;
 	bool dont_backup = false;
 	bool force_overwrite = false;
+	int num_threads = 0;
+	bool compress = false;
 	options_t() = default;
 
 	int parse_options(int argc, char** argv);
@@ -88,6 +90,10 @@ int options_t::parse_options(int argc, char** argv) {
 			 ->implicit_value(false), "Overwrite existing output or backup")
 			("db-type,t", po::value<std::string>(&db_type)
 			 ->implicit_value("chdb"), "database type")
+			("threads,j", po::value<int>(&num_threads)
+			 ->default_value(0), "Number of threads converting records (0: one per cpu)")
+			("compress,z",
+			 "Train a dictionary on the input and store strings compressed (requires zstd)")
 			;
 
 		po::positional_options_description pd;
@@ -120,6 +126,8 @@ int options_t::parse_options(int argc, char** argv) {
 			dont_backup = true;
 		if (vm.count("force-overwrite") > 0)
 			force_overwrite = true;
+		if (vm.count("compress") > 0)
+			compress = true;
 		if (backup_db.size() == 0) {
 			// user specified -b, without a value
 			ss::string<128> tmp;
@@ -149,19 +157,26 @@ int main(int argc, char** argv) {
 	bool force_overwrite = options.force_overwrite;
 	bool inplace_upgrade = options.inplace_upgrade;
 	bool dont_backup = options.dont_backup;
+	int num_threads = options.num_threads;
+	bool compress = options.compress;
 	if (options.db_type == "devdb") {
-		return neumodb_upgrade<devdb::devdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup);
+		return neumodb_upgrade<devdb::devdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup, num_threads,
+																		 compress);
 	} else  if (options.db_type == "chdb") {
-		return neumodb_upgrade<chdb::chdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup);
+		return neumodb_upgrade<chdb::chdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup, num_threads,
+																		 compress);
 	} else if (options.db_type == "statdb") {
-		return neumodb_upgrade<statdb::statdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup);
+		return neumodb_upgrade<statdb::statdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup, num_threads,
+																		 compress);
 	} else if (options.db_type == "epgdb") {
 		;
-		return neumodb_upgrade<epgdb::epgdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup);
+		return neumodb_upgrade<epgdb::epgdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup, num_threads,
+																		 compress);
 
 	} else if (options.db_type == "recdb") {
 
-		return neumodb_upgrade<recdb::recdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup);
+		return neumodb_upgrade<recdb::recdb_t>(from_dbname, to_dbname, force_overwrite, inplace_upgrade, dont_backup, num_threads,
+																		 compress);
 
 	} else {
 		fprintf(stderr, "Illegal db_type: %s\n", options.db_type.c_str());
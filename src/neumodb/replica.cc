@@ -0,0 +1,732 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "neumodb/replica.h"
+#include "neumodb/change_log.h"
+#include "neumodb/cursors.h"
+#include "neumodb/dbdesc.h"
+#include <array>
+#include <errno.h>
+#include <limits>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unordered_set>
+#include <unistd.h>
+#include <uuid/uuid.h>
+
+namespace {
+	enum class msg_type_t : uint32_t {
+		hello = 1, //client->server: hello_t
+		error, //server->client: error message
+		snapshot, //server->client: remove all records; a full copy follows; payload is the uuid of the database
+		record, //server->client: type_id, key size, key, value; an empty value means: delete
+		commit, //server->client: end of batch; payload is the position after the batch, or 0 inside a snapshot
+		ack //client->server: batch was stored; same payload as commit
+	};
+
+	constexpr uint32_t msg_magic = 0x4e524550; //"NREP"
+	constexpr uint32_t max_message_size = 64 * 1024 * 1024;
+	constexpr uint32_t byte_order_mark = 0x01020304;
+
+	struct msg_header_t {
+		uint32_t magic{msg_magic};
+		msg_type_t type{};
+		uint32_t size{0};
+	};
+
+	struct hello_t {
+		uint32_t byte_order{byte_order_mark};
+		int32_t schema_version{neumo_schema_version};
+		uint64_t schema_fingerprint{0};
+		uint64_t next_txn_id{0};
+		uint8_t db_uuid[16]{}; //uuid of the server database to which next_txn_id refers
+		char db_type[16]{};
+		char name[64]{};
+	};
+
+	//detects mismatching record definitions between client and server
+	uint64_t schema_fingerprint(neumodb_t& db) {
+		uint64_t ret = 14695981039346656037ull; //FNV-1a
+		auto mix = [&ret](uint64_t x) {
+			ret ^= x;
+			ret *= 1099511628211ull;
+		};
+		if (!db.dbdesc || !db.dbdesc->p_all_sw_schemas)
+			return 0;
+		for (auto& entry : *db.dbdesc->p_all_sw_schemas) {
+			for (auto& record_desc : *entry.pschema) {
+				mix(record_desc.type_id);
+				mix(record_desc.record_version);
+				for (auto& field : record_desc.fields) {
+					mix(field.field_id);
+					mix(field.type_id);
+				}
+			}
+		}
+		return ret;
+	}
+
+	bool write_all(int fd, const void* data, size_t size) {
+		auto* p = (const uint8_t*)data;
+		while (size > 0) {
+			auto ret = ::send(fd, p, size, MSG_NOSIGNAL);
+			if (ret < 0) {
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+			p += ret;
+			size -= ret;
+		}
+		return true;
+	}
+
+	bool read_all(int fd, void* data, size_t size) {
+		auto* p = (uint8_t*)data;
+		while (size > 0) {
+			auto ret = ::read(fd, p, size);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				return false;
+			p += ret;
+			size -= ret;
+		}
+		return true;
+	}
+
+	//messages are collected in a buffer and written once per batch
+	struct msg_writer_t {
+		int fd;
+		std::string buffer;
+
+		void add(msg_type_t type, const void* payload, uint32_t size) {
+			msg_header_t h{msg_magic, type, size};
+			buffer.append((const char*)&h, sizeof(h));
+			buffer.append((const char*)payload, size);
+		}
+
+		void add_record(uint32_t type_id, const lmdb::val& key, const ss::bytebuffer_& val) {
+			uint32_t key_size = key.size();
+			msg_header_t h{msg_magic, msg_type_t::record, uint32_t(2 * sizeof(uint32_t) + key_size + val.size())};
+			buffer.append((const char*)&h, sizeof(h));
+			buffer.append((const char*)&type_id, sizeof(type_id));
+			buffer.append((const char*)&key_size, sizeof(key_size));
+			buffer.append((const char*)key.data(), key_size);
+			buffer.append((const char*)val.buffer(), val.size());
+		}
+
+		bool flush() {
+			bool ret = write_all(fd, buffer.data(), buffer.size());
+			buffer.clear();
+			return ret;
+		}
+	};
+
+	bool read_msg(int fd, msg_type_t& type, std::string& payload) {
+		msg_header_t h;
+		if (!read_all(fd, &h, sizeof(h)))
+			return false;
+		if (h.magic != msg_magic || h.size > max_message_size) {
+			dterrorf("Bad replica message");
+			return false;
+		}
+		type = h.type;
+		payload.resize(h.size);
+		return read_all(fd, payload.data(), h.size);
+	}
+
+	/*
+		parse "unix:/path", "host:port", "*:port" or "port"
+		returns a socket address suitable for bind or connect
+		"port" is the loopback interface; only "*:port" listens on all interfaces
+	*/
+	bool parse_address(const std::string& address, bool for_listen, sockaddr_storage& addr, socklen_t& len) {
+		memset(&addr, 0, sizeof(addr));
+		if (address.starts_with("unix:")) {
+			auto path = address.substr(5);
+			auto& a = (sockaddr_un&)addr;
+			if (path.size() >= sizeof(a.sun_path))
+				return false;
+			a.sun_family = AF_UNIX;
+			strcpy(a.sun_path, path.c_str());
+			len = sizeof(a);
+			return true;
+		}
+		auto pos = address.rfind(':');
+		std::string host = pos == std::string::npos ? "127.0.0.1" : address.substr(0, pos);
+		std::string port = pos == std::string::npos ? address : address.substr(pos + 1);
+		addrinfo hints{};
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		if (for_listen && host == "*")
+			hints.ai_flags = AI_PASSIVE;
+		addrinfo* res{nullptr};
+		if (getaddrinfo(host == "*" ? nullptr : host.c_str(), port.c_str(), &hints, &res) != 0 || !res)
+			return false;
+		memcpy(&addr, res->ai_addr, res->ai_addrlen);
+		len = res->ai_addrlen;
+		freeaddrinfo(res);
+		return true;
+	}
+
+	int open_socket(const sockaddr_storage& addr) {
+		int fd = socket(addr.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if (fd < 0) {
+			dterrorf("socket failed: {}", strerror(errno));
+			return -1;
+		}
+		if (addr.ss_family == AF_INET) {
+			int one = 1;
+			if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0 ||
+					setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one)) < 0 ||
+					setsockopt(fd, SOL_TCP, TCP_NODELAY, &one, sizeof(one)) < 0)
+				dterrorf("setsockopt failed: {}", strerror(errno));
+		}
+		return fd;
+	}
+
+	/*
+		position of the replica, stored in the replica database itself (neumodb_t::aux_tables), keyed by server address.
+		The same table stores the uuid of the database itself; addresses cannot start with '#'
+	*/
+	constexpr const char* db_uuid_key = "#uuid";
+
+	struct position_t {
+		uint64_t next_txn_id{0};
+		std::array<uint8_t, 16> db_uuid{}; //of the server database
+	};
+
+	position_t load_position(neumodb_t& db, const std::string& address) {
+		auto txn = db.rtxn();
+		position_t ret;
+		auto& dbi = db.aux_tables->replica;
+		lmdb::val k{address.c_str(), address.size()};
+		lmdb::val v{};
+		//positions stored without uuid (older versions) are treated as unknown server databases
+		if (dbi.handle() != 0 && dbi.get(txn, k, v) && v.size() == sizeof(ret))
+			memcpy(&ret, v.data(), sizeof(ret));
+		txn.commit();
+		return ret;
+	}
+
+	void store_position(db_txn& wtxn, const std::string& address, const position_t& position) {
+		auto& dbi = wtxn.pdb->aux_tables->replica;
+		if (dbi.handle() == 0) {
+			dterrorf("Cannot store replica position for {}", address);
+			return;
+		}
+		lmdb::val k{address.c_str(), address.size()};
+		lmdb::val v{&position, sizeof(position)};
+		dbi.put(wtxn, k, v);
+	}
+
+	inline uint32_t key_type_id(const lmdb::val& k) {
+		if (k.size() < sizeof(uint32_t))
+			return 0;
+		auto* p = (const uint8_t*)k.data();
+		return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+	}
+}; //namespace
+
+void load_or_create_db_uuid(neumodb_t& db) {
+	auto& dbi = db.aux_tables->replica;
+	if (dbi.handle() == 0)
+		return;
+	lmdb::val k{db_uuid_key, strlen(db_uuid_key)};
+	{
+		auto txn = db.rtxn();
+		bool found{false};
+		lmdb::val v{};
+		if (dbi.get(txn, k, v) && v.size() == db.uuid.size()) {
+			memcpy(db.uuid.data(), v.data(), v.size());
+			found = true;
+		}
+		txn.commit();
+		if (found || db.readonly)
+			return;
+	}
+	uuid_t uuid;
+	static_assert(sizeof(uuid) == sizeof(db.uuid));
+	uuid_generate(uuid);
+	memcpy(db.uuid.data(), uuid, sizeof(uuid));
+	auto wtxn = db.wtxn();
+	lmdb::val v{db.uuid.data(), db.uuid.size()};
+	dbi.put(wtxn, k, v);
+	wtxn.commit();
+}
+
+replica_server_t::replica_server_t(neumodb_t& db_, const std::string& address_, const replica_options_t& options_)
+	: db(db_)
+	, address(address_)
+	, options(options_) {}
+
+replica_server_t::~replica_server_t() {
+	stop();
+}
+
+int replica_server_t::start() {
+	sockaddr_storage addr;
+	socklen_t len;
+	if (!parse_address(address, true, addr, len)) {
+		dterrorf("Bad replica address: {}", address);
+		return -1;
+	}
+	if (addr.ss_family == AF_UNIX)
+		unlink(((sockaddr_un&)addr).sun_path);
+	listen_fd = open_socket(addr);
+	if (listen_fd < 0)
+		return -1;
+	if (bind(listen_fd, (sockaddr*)&addr, len) < 0 || listen(listen_fd, 8) < 0) {
+		dterrorf("Cannot listen on {}: {}", address, strerror(errno));
+		::close(listen_fd);
+		listen_fd = -1;
+		return -1;
+	}
+	//clients are not authenticated: only the owner (and group) may connect to a unix socket
+	if (addr.ss_family == AF_UNIX && chmod(((sockaddr_un&)addr).sun_path, 0660) < 0)
+		dterrorf("Cannot change permissions of {}: {}", address, strerror(errno));
+	must_exit = false;
+	accept_thread = std::thread([this] { accept_loop(); });
+	dtinfof("Replica server for {} listening on {}", db.db_type, address);
+	if (address.starts_with("*:"))
+		dtinfof("Replica server for {} accepts unauthenticated connections from all hosts", db.db_type);
+	return 0;
+}
+
+void replica_server_t::stop() {
+	must_exit = true;
+	if (listen_fd >= 0)
+		::shutdown(listen_fd, SHUT_RDWR); //wakes up accept
+	if (accept_thread.joinable())
+		accept_thread.join();
+	if (listen_fd >= 0) {
+		::close(listen_fd);
+		listen_fd = -1;
+	}
+	std::scoped_lock lck(mutex);
+	for (auto& conn : connections)
+		::shutdown(conn.fd, SHUT_RDWR); //wakes up reads
+	for (auto& conn : connections) {
+		if (conn.thread.joinable())
+			conn.thread.join();
+		::close(conn.fd);
+	}
+	connections.clear();
+}
+
+int replica_server_t::num_clients() {
+	std::scoped_lock lck(mutex);
+	int ret = 0;
+	for (auto& conn : connections)
+		ret += !conn.done;
+	return ret;
+}
+
+void replica_server_t::accept_loop() {
+	pthread_setname_np(pthread_self(), "replica");
+	while (!must_exit) {
+		int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			if (!must_exit)
+				dterrorf("accept failed: {}", strerror(errno));
+			break;
+		}
+		std::scoped_lock lck(mutex);
+		//clean up connections which have ended
+		for (auto it = connections.begin(); it != connections.end();) {
+			if (it->done) {
+				it->thread.join();
+				::close(it->fd);
+				it = connections.erase(it);
+			} else
+				++it;
+		}
+		auto& conn = connections.emplace_back();
+		conn.fd = fd;
+		conn.thread = std::thread([this, &conn] {
+			serve(conn);
+			conn.done = true;
+		});
+	}
+}
+
+void replica_server_t::serve(connection_t& conn) {
+	pthread_setname_np(pthread_self(), "replica_conn");
+	msg_type_t type;
+	std::string payload;
+	if (!read_msg(conn.fd, type, payload) || type != msg_type_t::hello || payload.size() != sizeof(hello_t))
+		return;
+	hello_t hello;
+	memcpy(&hello, payload.data(), sizeof(hello));
+	hello.name[sizeof(hello.name) - 1] = 0;
+	hello.db_type[sizeof(hello.db_type) - 1] = 0;
+	msg_writer_t out{conn.fd};
+	std::string error;
+	if (hello.byte_order != byte_order_mark)
+		error = "Replica has a different architecture";
+	else if (hello.db_type != std::string_view(db.db_type.c_str()))
+		error = fmt::format("Replica has wrong database type: {} instead of {}", hello.db_type, db.db_type);
+	else if (hello.schema_version != neumo_schema_version || hello.schema_fingerprint != schema_fingerprint(db))
+		error = "Replica runs a different software version";
+	if (!error.empty()) {
+		dterrorf("Refusing replica {}: {}", hello.name, error);
+		out.add(msg_type_t::error, error.c_str(), error.size());
+		out.flush();
+		return;
+	}
+	auto consumer_name = fmt::format("replica:{}", hello.name);
+	dtinfof("Replica {} connected for {}; position={:d}", hello.name, db.db_type, hello.next_txn_id);
+
+	uint64_t position = hello.next_txn_id; //first server transaction not yet sent
+	if (position != 0 && memcmp(hello.db_uuid, db.uuid.data(), db.uuid.size()) != 0) {
+		//the replica's position refers to a database which has since been recreated or restored
+		dtinfof("Replica {} was made from another {} database", hello.name, db.db_type);
+		position = 0;
+	}
+	uint64_t acked_position = position; //first server transaction not yet stored by the client
+	uint64_t saved_position = 0; //position of the change log consumer
+	int unacked = 0;
+	auto last_commit_time = steady_clock_t::now();
+	auto last_save_time = steady_clock_t::time_point{};
+
+	//read acknowledgements; wait at most timeout_ms for the first one
+	auto read_acks = [&](int timeout_ms) {
+		for (;;) {
+			pollfd pfd{conn.fd, POLLIN, 0};
+			int ret = poll(&pfd, 1, timeout_ms);
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				return ret == 0;
+			if (!read_msg(conn.fd, type, payload) || type != msg_type_t::ack || payload.size() != sizeof(uint64_t))
+				return false;
+			uint64_t next_txn_id;
+			memcpy(&next_txn_id, payload.data(), sizeof(next_txn_id));
+			unacked--;
+			if (next_txn_id != 0)
+				acked_position = next_txn_id;
+			timeout_ms = 0;
+		}
+	};
+
+	//end a batch, and wait while too many batches have not been stored yet
+	auto commit = [&](uint64_t next_txn_id) {
+		out.add(msg_type_t::commit, &next_txn_id, sizeof(next_txn_id));
+		if (!out.flush())
+			return false;
+		unacked++;
+		last_commit_time = steady_clock_t::now();
+		while (unacked >= options.max_unacked_batches) {
+			if (must_exit || !read_acks(500))
+				return false;
+		}
+		return true;
+	};
+
+	ss::bytebuffer<1024> val;
+	auto send_snapshot = [&](db_txn& rtxn) {
+		out.add(msg_type_t::snapshot, db.uuid.data(), db.uuid.size());
+		int count = 0;
+		for (auto c = db.generic_get_first(rtxn); c.is_valid(); c.next()) {
+			lmdb::val k{}, v{};
+			if (!c.get(k, v, MDB_GET_CURRENT))
+				break;
+			val.clear();
+			if (!db.serialize_for_replica(c, key_type_id(k), val))
+				continue; //schema record, or unknown type
+			out.add_record(key_type_id(k), k, val);
+			if (++count % options.records_per_batch == 0 && !commit(0))
+				return false;
+		}
+		return true;
+	};
+
+	//send all records changed in transactions from_txn_id...to_txn_id; returns -1 on error
+	auto send_changes = [&](db_txn& rtxn, uint64_t from_txn_id, uint64_t to_txn_id) {
+		int count = 0;
+		std::unordered_set<std::string> sent; //records changed in multiple transactions are sent once
+		auto log_cursor = lmdb::cursor::open(rtxn, db.dbi_log);
+		db_cursor mc(rtxn, db.dbi);
+		lmdb::val k{}, v{};
+		/*the log is sorted by (type_id, txn_id): for each type present in the log, jump to
+			the first entry for from_txn_id*/
+		bool ok = log_cursor.get(k, v, MDB_FIRST);
+		while (ok) {
+			auto type_id = key_type_id(k);
+			ss::bytebuffer<16> seek_key;
+			encode_ascending(seek_key, type_id);
+			encode_ascending(seek_key, (size_t)from_txn_id);
+			k = lmdb::val{seek_key.buffer(), (size_t)seek_key.size()};
+			for (ok = log_cursor.get(k, v, MDB_SET_RANGE); ok && key_type_id(k) == type_id;
+					 ok = log_cursor.get(k, v, MDB_NEXT)) {
+				uint64_t txn_id{0};
+				auto log_key = ss::bytebuffer_::view((uint8_t*)k.data(), k.size(), k.size());
+				if (decode_ascending(txn_id, log_key, sizeof(uint32_t)) < 0 || txn_id > to_txn_id)
+					break;
+				std::string primary_key((const char*)v.data(), v.size());
+				if (!sent.insert(primary_key).second)
+					continue;
+				val.clear();
+				auto pk = ss::bytebuffer_::view((uint8_t*)primary_key.data(), primary_key.size(), primary_key.size());
+				lmdb::val key{primary_key.data(), primary_key.size()};
+				if (mc.find(pk) && !db.serialize_for_replica(mc, type_id, val))
+					continue;
+				out.add_record(type_id, key, val); //empty val for deleted records
+				if (++count % options.records_per_batch == 0 && !commit(0))
+					return -1;
+			}
+			if (type_id == std::numeric_limits<uint32_t>::max())
+				break;
+			//jump to the next type
+			seek_key.clear();
+			encode_ascending(seek_key, type_id + 1);
+			k = lmdb::val{seek_key.buffer(), (size_t)seek_key.size()};
+			ok = log_cursor.get(k, v, MDB_SET_RANGE);
+		}
+		return count;
+	};
+
+	while (!must_exit) {
+		auto rtxn = db.rtxn();
+		uint64_t snapshot_id = rtxn.txn_id();
+		bool ok = true;
+		if (position == 0 || position < change_log::log_start(rtxn)) {
+			dtinfof("Sending snapshot of {} to replica {}", db.db_type, hello.name);
+			ok = send_snapshot(rtxn) && commit(snapshot_id + 1);
+			position = snapshot_id + 1;
+		} else if (position <= snapshot_id) {
+			int count = send_changes(rtxn, position, snapshot_id);
+			ok = count >= 0;
+			//also send empty batches once in a while, so that the replica's position advances
+			if (ok && (count > 0 || steady_clock_t::now() - last_commit_time > std::chrono::seconds(1))) {
+				ok = commit(snapshot_id + 1);
+				position = snapshot_id + 1;
+			}
+		}
+		rtxn.commit();
+		if (!ok || !read_acks(options.poll_interval_ms))
+			break;
+		//keep the log entries the replica has not yet stored
+		if (acked_position != saved_position && steady_clock_t::now() - last_save_time > std::chrono::seconds(10)) {
+			auto wtxn = db.wtxn();
+			change_log::set_consumer_position(wtxn, consumer_name.c_str(), acked_position);
+			wtxn.commit();
+			saved_position = acked_position;
+			last_save_time = steady_clock_t::now();
+		}
+	}
+	/*
+		stop pinning the log: otherwise a replica which never returns keeps clean_log from removing
+		up to change_log::max_lag transactions. A replica which reconnects continues from its own
+		position if the log still covers it, and otherwise receives a snapshot
+	*/
+	if (saved_position != 0) {
+		auto wtxn = db.wtxn();
+		change_log::remove_consumer(wtxn, consumer_name.c_str());
+		wtxn.commit();
+	}
+	dtinfof("Replica {} disconnected from {}", hello.name, db.db_type);
+}
+
+replica_client_t::replica_client_t(neumodb_t& db_, const std::string& address_, const std::string& name_,
+																	 const replica_options_t& options_)
+	: db(db_)
+	, address(address_)
+	, name(name_)
+	, options(options_) {}
+
+replica_client_t::~replica_client_t() {
+	stop();
+}
+
+void replica_client_t::start() {
+	must_exit = false;
+	thread = std::thread([this] { run(); });
+}
+
+void replica_client_t::stop() {
+	must_exit = true;
+	if (fd >= 0)
+		::shutdown(fd, SHUT_RDWR); //wakes up reads
+	if (thread.joinable())
+		thread.join();
+}
+
+void replica_client_t::run() {
+	pthread_setname_np(pthread_self(), "replica_client");
+	while (!must_exit) {
+		sync();
+		connected = false;
+		for (int i = 0; i < options.reconnect_interval_ms / 100 && !must_exit; ++i)
+			usleep(100000);
+	}
+}
+
+/*
+	connect to the server and store records until the connection is lost
+*/
+int replica_client_t::sync() {
+	sockaddr_storage addr;
+	socklen_t len;
+	if (!parse_address(address, false, addr, len)) {
+		dterrorf("Bad replica address: {}", address);
+		return -1;
+	}
+	int sock = open_socket(addr);
+	if (sock < 0)
+		return -1;
+	if (connect(sock, (sockaddr*)&addr, len) < 0) {
+		dtdebugf("Cannot connect to replica server {}: {}", address, strerror(errno));
+		::close(sock);
+		return -1;
+	}
+	fd = sock;
+	connected = true;
+
+	hello_t hello;
+	hello.schema_fingerprint = schema_fingerprint(db);
+	auto position = load_position(db, address);
+	hello.next_txn_id = position.next_txn_id;
+	memcpy(hello.db_uuid, position.db_uuid.data(), sizeof(hello.db_uuid));
+	strncpy(hello.db_type, db.db_type.c_str(), sizeof(hello.db_type) - 1);
+	strncpy(hello.name, name.c_str(), sizeof(hello.name) - 1);
+	next_txn_id = hello.next_txn_id;
+
+	msg_writer_t out{sock};
+	out.add(msg_type_t::hello, &hello, sizeof(hello));
+	int ret = out.flush() ? 0 : -1;
+
+	std::optional<db_txn> wtxn;
+	msg_type_t type;
+	std::string payload;
+	while (ret == 0 && !must_exit && read_msg(sock, type, payload)) {
+		switch (type) {
+		case msg_type_t::error:
+			dterrorf("Replica server {} refused connection: {}", address, payload);
+			ret = -1;
+			break;
+		case msg_type_t::snapshot: {
+			//remove all records which the server will send again
+			if (payload.size() != position.db_uuid.size()) {
+				ret = -1;
+				break;
+			}
+			if (!wtxn)
+				wtxn.emplace(db.wtxn());
+			memcpy(position.db_uuid.data(), payload.data(), position.db_uuid.size());
+			position.next_txn_id = 0;
+			store_position(*wtxn, address, position); //a new snapshot is needed if we crash before it is complete
+			std::vector<std::pair<uint32_t, std::string>> keys;
+			{
+				auto c = lmdb::cursor::open(*wtxn, db.dbi);
+				lmdb::val k{}, v{};
+				for (bool ok = c.get(k, v, MDB_FIRST); ok; ok = c.get(k, v, MDB_NEXT))
+					keys.emplace_back(key_type_id(k), std::string((const char*)k.data(), k.size()));
+			}
+			ss::bytebuffer<8> empty;
+			int count = 0;
+			for (auto& [type_id, key] : keys) {
+				auto k = ss::bytebuffer_::view((uint8_t*)key.data(), key.size(), key.size());
+				if (db.put_from_replica(*wtxn, type_id, k, empty) > 0 && ++count % options.records_per_batch == 0) {
+					wtxn->commit();
+					wtxn.emplace(db.wtxn());
+				}
+			}
+			break;
+		}
+		case msg_type_t::record: {
+			uint32_t type_id;
+			uint32_t key_size;
+			if (payload.size() < 2 * sizeof(uint32_t)) {
+				ret = -1;
+				break;
+			}
+			memcpy(&type_id, payload.data(), sizeof(type_id));
+			memcpy(&key_size, payload.data() + sizeof(type_id), sizeof(key_size));
+			auto* p = (uint8_t*)payload.data() + 2 * sizeof(uint32_t);
+			int val_size = payload.size() - 2 * sizeof(uint32_t) - key_size;
+			if (val_size < 0) {
+				ret = -1;
+				break;
+			}
+			if (!wtxn)
+				wtxn.emplace(db.wtxn());
+			auto key = ss::bytebuffer_::view(p, key_size, key_size);
+			auto val = ss::bytebuffer_::view(p + key_size, val_size, val_size);
+			if (db.put_from_replica(*wtxn, type_id, key, val) < 0)
+				dtdebugf("Replica: could not store record of type {:x}", type_id);
+			num_records++;
+			break;
+		}
+		case msg_type_t::commit: {
+			uint64_t next{0};
+			if (payload.size() != sizeof(next)) {
+				ret = -1;
+				break;
+			}
+			memcpy(&next, payload.data(), sizeof(next));
+			if (!wtxn)
+				wtxn.emplace(db.wtxn());
+			if (next != 0) {
+				position.next_txn_id = next;
+				store_position(*wtxn, address, position);
+			}
+			wtxn->commit();
+			wtxn.reset();
+			if (next != 0)
+				next_txn_id = next;
+			num_batches++;
+			out.add(msg_type_t::ack, &next, sizeof(next));
+			if (!out.flush())
+				ret = -1;
+			break;
+		}
+		default:
+			dterrorf("Unexpected replica message {:d}", (int)type);
+			ret = -1;
+			break;
+		}
+	}
+	if (wtxn)
+		wtxn->abort();
+	fd = -1;
+	::close(sock);
+	return ret;
+}
+
+std::string replica_address_for_db(const std::string& address, const char* dbname, int idx) {
+	if (address.starts_with("unix:"))
+		return fmt::format("{}.{}", address, dbname);
+	auto pos = address.rfind(':');
+	auto host = pos == std::string::npos ? std::string() : address.substr(0, pos + 1);
+	auto port = std::atoi((pos == std::string::npos ? address : address.substr(pos + 1)).c_str());
+	return fmt::format("{}{:d}", host, port + idx);
+}
@@ -0,0 +1,138 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class neumodb_t;
+
+/*
+	Read-only replicas of a database (chdb, epgdb, recdb...) on other hosts.
+
+	replica_server_t listens on a socket, and streams the records of a database to each connecting
+	replica_client_t: first a snapshot of all records (only when the client has no data yet, or when it
+	fell too far behind), and then all changes found in the log table (see change_log.h).
+	replica_client_t stores the records in a local database with put_record, so that secondary
+	indexes, the log and screens on the replica work as on the server. Deleted records are deleted on the
+	replica as well.
+
+	Records are sent in batches; the client commits each batch in a write transaction and acknowledges it.
+	The server stops sending when too many batches are unacknowledged (backpressure). The client stores the
+	position of the last complete batch in its own database, in the same transaction as the records, and
+	continues from there after reconnecting. While a client is connected, the server registers it as a
+	change log consumer "replica:<name>" so that clean_log keeps the changes the client has not yet received.
+	The consumer is removed when the client disconnects. The client also stores the uuid of the server
+	database, and receives a new snapshot when the server database has been replaced.
+
+	Addresses are either "unix:/path/to/socket" or "host:port" (tcp); the server accepts "port" to listen
+	on the loopback interface only. Clients are not authenticated and the data is not encrypted, so anyone
+	who can connect can read the whole database: prefer unix sockets (which are created with mode 0660),
+	and only use "*:port" (all interfaces) or the address of a public interface on a trusted network.
+	Client and server must run the same software version (same schema) and architecture; this is checked
+	when connecting.
+
+	The server polls the database for new transactions every poll_interval_ms, so replicas lag by
+	about poll_interval_ms plus the time needed to transfer and store a batch.
+*/
+
+struct replica_options_t {
+	int poll_interval_ms{100};
+	int records_per_batch{2048};
+	int max_unacked_batches{4};
+	int reconnect_interval_ms{2000}; //client only
+};
+
+class replica_server_t {
+	struct connection_t {
+		int fd{-1};
+		std::thread thread;
+		std::atomic<bool> done{false};
+	};
+
+	neumodb_t& db;
+	std::string address;
+	replica_options_t options;
+	int listen_fd{-1};
+	std::atomic<bool> must_exit{false};
+	std::thread accept_thread;
+	std::mutex mutex; //protects connections
+	std::list<connection_t> connections;
+
+	void accept_loop();
+	void serve(connection_t& conn);
+
+public:
+	replica_server_t(neumodb_t& db, const std::string& address, const replica_options_t& options = {});
+	~replica_server_t();
+
+	//returns -1 if the socket could not be opened
+	int start();
+	void stop();
+	int num_clients();
+};
+
+class replica_client_t {
+	neumodb_t& db;
+	std::string address;
+	std::string name;
+	replica_options_t options;
+	std::atomic<int> fd{-1};
+	std::atomic<bool> must_exit{false};
+	std::thread thread;
+
+	void run();
+	int sync();
+
+public:
+	//statistics, for monitoring the replica
+	std::atomic<bool> connected{false};
+	std::atomic<int64_t> num_records{0}; //records received (including deletions)
+	std::atomic<int64_t> num_batches{0};
+	std::atomic<int64_t> next_txn_id{0}; //server transaction up to which the replica is complete
+
+	/*
+		db must be open; its records of all types known to db are replaced by those of the server
+		name identifies the replica on the server and must be unique per server database
+	*/
+	replica_client_t(neumodb_t& db, const std::string& address, const std::string& name,
+									 const replica_options_t& options = {});
+	~replica_client_t();
+
+	void start();
+	void stop();
+};
+
+/*
+	load the uuid of db, or generate and store it if db does not have one yet (new database).
+	Replicas store the uuid of the server database with their position: txn ids of a recreated
+	or restored database do not continue those of the old one, so a replica whose uuid differs
+	receives a new snapshot
+*/
+void load_or_create_db_uuid(neumodb_t& db);
+
+/*
+	address of the replica server for one of several databases served by the same process:
+	"unix:/path" becomes "unix:/path.dbname", and "host:port" becomes "host:<port+idx>"
+*/
+std::string replica_address_for_db(const std::string& address, const char* dbname, int idx);
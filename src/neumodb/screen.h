@@ -170,6 +170,8 @@ private:
 																										 monitor_t::reference_t& reference);
 	HIDDEN inline db_tcursor_index<record_t> first_cursor(db_txn& rtxn);
 	HIDDEN inline db_tcursor_index<record_t> last_cursor(db_txn& rtxn);
+	HIDDEN inline db_tcursor_index<record_t> cursor_at_row(db_txn& rtxn, int row_number, int& count,
+																												 monitor_t::reference_t*& reference);
 
 
 	HIDDEN inline bool put_screen_record(db_tcursor<record_t>& tcursor,
@@ -276,6 +278,10 @@ public:
 	EXPORT bool update(db_txn& master_txn);
 
 	EXPORT record_t record_at_row(int row_number);
+	/*
+		returns the records in rows [start_row, end_row[ using a single cursor walk
+	 */
+	EXPORT ss::vector_<record_t> records_at_rows(int start_row, int end_row);
 	/*
 		sets a reference arnd return a row number
 	 */
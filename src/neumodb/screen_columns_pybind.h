@@ -0,0 +1,63 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <type_traits>
+#include "stackstring.h"
+
+namespace py = pybind11;
+
+/*
+	Helpers for screen_t::columns_at_rows: convert one field of a range of records into
+	a single python object:
+	  numbers and booleans => numpy array of the same type
+		enums => numpy array of the underlying integer type
+		strings => list of python strings
+		anything else => list of python objects
+*/
+template <typename record_t, typename getter_t>
+inline py::object screen_column(const ss::vector_<record_t>& records, getter_t get) {
+	using field_t = std::decay_t<decltype(get(std::declval<const record_t&>()))>;
+	auto n = records.size();
+	if constexpr (std::is_enum_v<field_t> || std::is_arithmetic_v<field_t>) {
+		using value_t = typename std::conditional_t<std::is_enum_v<field_t>, std::underlying_type<field_t>,
+																								std::type_identity<field_t>>::type;
+		py::array_t<value_t> ret(n);
+		auto out = ret.template mutable_unchecked<1>();
+		for (int i = 0; i < n; ++i)
+			out(i) = value_t(get(records[i]));
+		return std::move(ret);
+	} else if constexpr (std::is_base_of_v<ss::string_, field_t>) {
+		py::list ret(n);
+		for (int i = 0; i < n; ++i) {
+			const auto& s = get(records[i]);
+			ret[i] = py::str(s.c_str(), s.size());
+		}
+		return std::move(ret);
+	} else {
+		py::list ret(n);
+		for (int i = 0; i < n; ++i)
+			ret[i] = py::cast(get(records[i]));
+		return std::move(ret);
+	}
+}
@@ -493,13 +493,15 @@ int screen_t<record_t>::set_reference(const record_t& record)
 }
 
 /*
-	sets a reference to specifc row
+	returns a cursor positioned at row_number and updates one of the reference records
+	(see set_reference(int)) to point to this row. count is set to the row number
+	of the returned cursor, or -1 if the list is empty
 */
 template <typename record_t>
-int screen_t<record_t>::set_reference(int row_number)
+db_tcursor_index<record_t> screen_t<record_t>::cursor_at_row(db_txn& rtxn, int row_number, int& count,
+																														 monitor_t::reference_t*& reference)
 {
 	const int large_jump_threshold{50};
-	auto rtxn = tmpdb->rtxn();
 
 	/*
 		wxGrid seems to request rows at the beginning of the table to
@@ -522,7 +524,7 @@ int screen_t<record_t>::set_reference(int row_number)
 		return -1;
 	};
 
-	auto * reference = &monitor.reference;
+	reference = &monitor.reference;
 
 	auto startc = [this, &rtxn, &reference, &cursor_type]() {
 		auto ct = cursor_type(*reference, true);
@@ -556,7 +558,7 @@ int screen_t<record_t>::set_reference(int row_number)
 
 	auto c =  startc();
 
-	int count= reference->row_number;
+	count= reference->row_number;
 	if(std::abs(row_number - count)>=large_jump_threshold) {
 		dtdebugf("LARGE JUMP: {} -> {} aux={}",  count, row_number, reference == &monitor.auxiliary_reference);
 	}
@@ -586,12 +588,44 @@ int screen_t<record_t>::set_reference(int row_number)
 			c = first_cursor(rtxn);
 			count = 0;
 		}
-		if(c.is_valid())
-			c.get_value((reference == &monitor.auxiliary_reference) ? auxiliary_current_record : primary_current_record);
 	}
+	return c;
+}
+
+/*
+	sets a reference to specifc row
+*/
+template <typename record_t>
+int screen_t<record_t>::set_reference(int row_number)
+{
+	auto rtxn = tmpdb->rtxn();
+	int count{-1};
+	monitor_t::reference_t* reference{nullptr};
+	auto c = cursor_at_row(rtxn, row_number, count, reference);
+	if(count >= 0 && c.is_valid())
+		c.get_value((reference == &monitor.auxiliary_reference) ? auxiliary_current_record : primary_current_record);
 	return count;
 }
 
+template <typename record_t>
+ss::vector_<record_t> screen_t<record_t>::records_at_rows(int start_row, int end_row)
+{
+	ss::vector_<record_t> records;
+	end_row = std::min(end_row, list_size());
+	if(start_row < 0 || start_row >= end_row)
+		return records;
+	records.reserve(end_row - start_row);
+	auto rtxn = tmpdb->rtxn();
+	int count{-1};
+	monitor_t::reference_t* reference{nullptr};
+	auto c = cursor_at_row(rtxn, start_row, count, reference);
+	if(count != start_row)
+		return records;
+	for(; c.is_valid() && count < end_row; c.next(), ++count)
+		records.push_back(c.current());
+	return records;
+}
+
 //used by gridepg_screen and by channel epg screen
 template <typename record_t>
 screen_t<record_t>::screen_t
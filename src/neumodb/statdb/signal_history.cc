@@ -0,0 +1,604 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "neumodb/statdb/signal_history.h"
+#include "neumodb/decode.h"
+#include "neumodb/encode.h"
+#include <algorithm>
+#include <optional>
+#include <string.h>
+
+using namespace statdb;
+using namespace statdb::signal_history;
+
+namespace {
+	constexpr uint8_t block_version = 1;
+	constexpr int num_columns = 3 * num_metrics; //min, mean, max for each metric
+
+	//the table is opened together with the database (see neumodb_t::open_aux_tables)
+	bool open_table(db_txn& txn, lmdb::dbi& dbi) {
+		dbi = lmdb::dbi(txn.pdb->aux_tables->signal_history.handle());
+		return dbi.handle() != 0;
+	}
+
+	inline time_t block_start_of(time_t t, int resolution) {
+		time_t span = resolution * (time_t)samples_per_block;
+		return t - t % span;
+	}
+
+	inline float& column(bucket_t& b, int c) {
+		int m = c % num_metrics;
+		switch (c / num_metrics) {
+		case 0:
+			return b.min[m];
+		case 1:
+			return b.mean[m];
+		default:
+			return b.max[m];
+		}
+	}
+
+	void encode_series_prefix(ss::bytebuffer_& k, int level, int16_t sat_pos, chdb::fe_polarisation_t pol) {
+		encode_ascending(k, (uint8_t)level);
+		encode_ascending(k, sat_pos);
+		encode_ascending(k, pol);
+	}
+
+	void encode_key(ss::bytebuffer_& k, int level, const series_key_t& key, time_t block_start) {
+		encode_series_prefix(k, level, key.sat_pos, key.pol);
+		encode_ascending(k, key.frequency);
+		encode_ascending(k, key.rf_path.card_mac_address);
+		encode_ascending(k, key.rf_path.rf_input);
+		encode_ascending(k, key.rf_path.lnb.dish_id);
+		encode_ascending(k, key.rf_path.lnb.lnb_id);
+		encode_ascending(k, key.rf_path.lnb.lnb_type);
+		encode_ascending(k, (int64_t)block_start);
+	}
+
+	//returns the offset of block_start in the key, or -1
+	int decode_key(const ss::bytebuffer_& k, int& level, series_key_t& key, time_t& block_start) {
+		uint8_t level_{0};
+		int64_t block_start_{0};
+		int offset = decode_ascending(level_, k, 0);
+		offset = offset < 0 ? offset : decode_ascending(key.sat_pos, k, offset);
+		offset = offset < 0 ? offset : decode_ascending(key.pol, k, offset);
+		offset = offset < 0 ? offset : decode_ascending(key.frequency, k, offset);
+		offset = offset < 0 ? offset : decode_ascending(key.rf_path.card_mac_address, k, offset);
+		offset = offset < 0 ? offset : decode_ascending(key.rf_path.rf_input, k, offset);
+		offset = offset < 0 ? offset : decode_ascending(key.rf_path.lnb.dish_id, k, offset);
+		offset = offset < 0 ? offset : decode_ascending(key.rf_path.lnb.lnb_id, k, offset);
+		offset = offset < 0 ? offset : decode_ascending(key.rf_path.lnb.lnb_type, k, offset);
+		int ret = offset;
+		offset = offset < 0 ? offset : decode_ascending(block_start_, k, offset);
+		if (offset < 0)
+			return -1;
+		level = level_;
+		block_start = block_start_;
+		return ret;
+	}
+
+	void put_varint(ss::bytebuffer_& out, uint32_t x) {
+		while (x >= 0x80) {
+			out.push_back((uint8_t)(x | 0x80));
+			x >>= 7;
+		}
+		out.push_back((uint8_t)x);
+	}
+
+	bool get_varint(uint32_t& x, const uint8_t*& p, const uint8_t* end) {
+		x = 0;
+		for (int shift = 0; p < end && shift < 35; shift += 7) {
+			uint8_t b = *p++;
+			x |= (uint32_t)(b & 0x7f) << shift;
+			if (!(b & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	struct bit_writer_t {
+		ss::bytebuffer_& out;
+		uint64_t acc{0};
+		int num_bits{0};
+
+		bit_writer_t(ss::bytebuffer_& out) : out(out) {}
+
+		void put(uint32_t bits, int n) {
+			if (n == 0)
+				return;
+			acc = (acc << n) | (n == 32 ? bits : (bits & ((1u << n) - 1)));
+			num_bits += n;
+			while (num_bits >= 8) {
+				num_bits -= 8;
+				out.push_back((uint8_t)(acc >> num_bits));
+			}
+		}
+
+		void finish() {
+			if (num_bits > 0)
+				out.push_back((uint8_t)(acc << (8 - num_bits)));
+			num_bits = 0;
+		}
+	};
+
+	struct bit_reader_t {
+		const uint8_t* p;
+		const uint8_t* end;
+		uint64_t acc{0};
+		int num_bits{0};
+		bool error{false};
+
+		bit_reader_t(const uint8_t* p, const uint8_t* end) : p(p), end(end) {}
+
+		uint32_t get(int n) {
+			if (n == 0)
+				return 0;
+			while (num_bits < n) {
+				if (p >= end) {
+					error = true;
+					return 0;
+				}
+				acc = (acc << 8) | *p++;
+				num_bits += 8;
+			}
+			num_bits -= n;
+			return (uint32_t)(acc >> num_bits) & (n == 32 ? 0xffffffffu : ((1u << n) - 1));
+		}
+	};
+
+	/*
+		xor encoding of a column of floats: the first value is stored as is; for later values
+		the xor with the previous value is stored as
+		  '0' if the value is unchanged
+		  '10' followed by the meaningful bits if they fit in the window of the previous xor
+		  '11' followed by 5 bits of leading zeros, 5 bits of (length-1), and the meaningful bits
+	*/
+	struct xor_encoder_t {
+		uint32_t prev{0};
+		int leading{-1};
+		int trailing{0};
+
+		void put(bit_writer_t& w, float value, bool first) {
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			if (first) {
+				w.put(bits, 32);
+				prev = bits;
+				return;
+			}
+			uint32_t x = bits ^ prev;
+			prev = bits;
+			if (x == 0) {
+				w.put(0, 1);
+				return;
+			}
+			int l = std::min(__builtin_clz(x), 31);
+			int t = __builtin_ctz(x);
+			if (leading >= 0 && l >= leading && t >= trailing) {
+				w.put(2, 2);
+				w.put(x >> trailing, 32 - leading - trailing);
+				return;
+			}
+			leading = l;
+			trailing = t;
+			int len = 32 - l - t;
+			w.put(3, 2);
+			w.put(l, 5);
+			w.put(len - 1, 5);
+			w.put(x >> t, len);
+		}
+	};
+
+	struct xor_decoder_t {
+		uint32_t prev{0};
+		int leading{-1};
+		int trailing{0};
+
+		float get(bit_reader_t& r, bool first) {
+			if (first)
+				prev = r.get(32);
+			else if (r.get(1)) {
+				if (r.get(1) == 1) {
+					leading = r.get(5);
+					int len = r.get(5) + 1;
+					trailing = 32 - leading - len;
+					if (trailing < 0) {
+						r.error = true;
+						return 0;
+					}
+				} else if (leading < 0) {
+					r.error = true;
+					return 0;
+				}
+				prev ^= r.get(32 - leading - trailing) << trailing;
+			}
+			float ret;
+			memcpy(&ret, &prev, sizeof(ret));
+			return ret;
+		}
+	};
+
+	//merge new buckets into old ones; buckets with the same time are replaced by the new version
+	void merge_buckets(std::vector<bucket_t>& buckets, const bucket_t* new_buckets, int num_new) {
+		buckets.insert(buckets.end(), new_buckets, new_buckets + num_new);
+		std::stable_sort(buckets.begin(), buckets.end(),
+										 [](const bucket_t& a, const bucket_t& b) { return a.time < b.time; });
+		int n = 0;
+		for (int i = 0; i < (int)buckets.size(); ++i) {
+			if (n > 0 && buckets[n - 1].time == buckets[i].time)
+				buckets[n - 1] = buckets[i];
+			else
+				buckets[n++] = buckets[i];
+		}
+		buckets.resize(n);
+	}
+
+	int level_for_resolution(int resolution) {
+		int level = 0;
+		for (int l = 1; l < num_levels; ++l)
+			if (level_resolution[l] <= resolution)
+				level = l;
+		return level;
+	}
+
+}; //end of anonymous namespace
+
+void bucket_t::add(const signal_stat_entry_t& e) {
+	float v[num_metrics];
+	v[metric_t::signal_strength] = e.signal_strength;
+	v[metric_t::snr] = e.snr;
+	v[metric_t::ber] = e.ber;
+	count++;
+	for (int m = 0; m < num_metrics; ++m) {
+		if (count == 1) {
+			min[m] = mean[m] = max[m] = v[m];
+			continue;
+		}
+		min[m] = std::min(min[m], v[m]);
+		max[m] = std::max(max[m], v[m]);
+		mean[m] += (v[m] - mean[m]) / count;
+	}
+}
+
+void bucket_t::add(const bucket_t& other) {
+	if (other.count == 0)
+		return;
+	if (count == 0) {
+		auto t = time;
+		*this = other;
+		time = t;
+		return;
+	}
+	auto total = count + other.count;
+	for (int m = 0; m < num_metrics; ++m) {
+		min[m] = std::min(min[m], other.min[m]);
+		max[m] = std::max(max[m], other.max[m]);
+		mean[m] = (mean[m] * count + other.mean[m] * other.count) / total;
+	}
+	count = total;
+}
+
+void series_t::push_back(const bucket_t& b) {
+	time.push_back(b.time);
+	count.push_back(b.count);
+	for (int m = 0; m < num_metrics; ++m) {
+		min[m].push_back(b.min[m]);
+		mean[m].push_back(b.mean[m]);
+		max[m].push_back(b.max[m]);
+	}
+}
+
+void signal_history::encode_block(ss::bytebuffer_& out, const bucket_t* buckets, int num_buckets,
+																	time_t block_start, int resolution) {
+	out.clear();
+	out.push_back(block_version);
+	put_varint(out, num_buckets);
+	int prev_idx = -1;
+	for (int i = 0; i < num_buckets; ++i) {
+		int idx = (buckets[i].time - block_start) / resolution;
+		assert(idx > prev_idx && idx < samples_per_block);
+		put_varint(out, idx - prev_idx - 1);
+		prev_idx = idx;
+	}
+	for (int i = 0; i < num_buckets; ++i)
+		put_varint(out, buckets[i].count);
+	bit_writer_t w(out);
+	for (int c = 0; c < num_columns; ++c) {
+		xor_encoder_t enc;
+		for (int i = 0; i < num_buckets; ++i)
+			enc.put(w, column((bucket_t&)buckets[i], c), i == 0);
+	}
+	w.finish();
+}
+
+int signal_history::decode_block(std::vector<bucket_t>& out, const uint8_t* data, size_t size,
+																 time_t block_start, int resolution) {
+	out.clear();
+	const uint8_t* p = data;
+	const uint8_t* end = data + size;
+	uint32_t num_buckets{0};
+	if (size < 1 || *p++ != block_version || !get_varint(num_buckets, p, end) || num_buckets > samples_per_block)
+		return -1;
+	out.resize(num_buckets);
+	int idx = -1;
+	for (auto& b : out) {
+		uint32_t delta;
+		if (!get_varint(delta, p, end))
+			return -1;
+		idx += delta + 1;
+		b.time = block_start + idx * (time_t)resolution;
+	}
+	for (auto& b : out) {
+		if (!get_varint(b.count, p, end))
+			return -1;
+	}
+	bit_reader_t r(p, end);
+	for (int c = 0; c < num_columns; ++c) {
+		xor_decoder_t dec;
+		for (int i = 0; i < (int)num_buckets; ++i)
+			column(out[i], c) = dec.get(r, i == 0);
+	}
+	return r.error ? -1 : (int)num_buckets;
+}
+
+void signal_history::put_buckets(db_txn& wtxn, const series_key_t& key, int level, const bucket_t* buckets,
+																 int num_buckets) {
+	lmdb::dbi dbi{0};
+	if (!open_table(wtxn, dbi)) {
+		dterrorf("Cannot store signal history");
+		return;
+	}
+	auto resolution = level_resolution[level];
+	std::vector<bucket_t> block;
+	ss::bytebuffer<64> k;
+	ss::bytebuffer<1024> v;
+	for (int i = 0; i < num_buckets;) {
+		auto block_start = block_start_of(buckets[i].time, resolution);
+		int j = i + 1;
+		while (j < num_buckets && block_start_of(buckets[j].time, resolution) == block_start)
+			++j;
+		k.clear();
+		encode_key(k, level, key, block_start);
+		lmdb::val lk{k.buffer(), (size_t)k.size()};
+		lmdb::val lv{};
+		block.clear();
+		if (dbi.get(wtxn, lk, lv) &&
+				decode_block(block, (const uint8_t*)lv.data(), lv.size(), block_start, resolution) < 0) {
+			dterrorf("Corrupt signal history block at level {:d}; discarding", level);
+			block.clear();
+		}
+		merge_buckets(block, buckets + i, j - i);
+		encode_block(v, block.data(), block.size(), block_start, resolution);
+		lmdb::val nv{v.buffer(), (size_t)v.size()};
+		dbi.put(wtxn, lk, nv);
+		i = j;
+	}
+}
+
+std::vector<series_t> signal_history::get_range(db_txn& rtxn, int16_t sat_pos, chdb::fe_polarisation_t pol,
+																								int frequency, time_t start_time, time_t end_time,
+																								int resolution, int tolerance) {
+	std::vector<series_t> ret;
+	lmdb::dbi dbi{0};
+	if (!open_table(rtxn, dbi))
+		return ret;
+	int level = level_for_resolution(resolution);
+	resolution = std::max(resolution, level_resolution[level]);
+	auto level_res = level_resolution[level];
+	auto first_block = block_start_of(start_time, level_res);
+
+	//per rf_path: the output bins
+	std::vector<std::vector<bucket_t>> bins;
+	auto find_series = [&](const series_key_t& sk) -> int {
+		for (int i = 0; i < (int)ret.size(); ++i)
+			if (ret[i].rf_path == sk.rf_path)
+				return i;
+		ret.push_back(series_t{sk.rf_path, sk.frequency, resolution});
+		bins.emplace_back();
+		return ret.size() - 1;
+	};
+
+	auto c = lmdb::cursor::open(rtxn, dbi);
+	ss::bytebuffer<64> k;
+	encode_series_prefix(k, level, sat_pos, pol);
+	int prefix_size = k.size();
+	encode_ascending(k, (int32_t)(frequency - tolerance));
+	lmdb::val lk{k.buffer(), (size_t)k.size()};
+	lmdb::val lv{};
+	std::vector<bucket_t> block;
+	/*
+		Blocks are sorted by frequency, rf_path and time. For each series we seek to first_block, and
+		after end_time to the next series. Data of different frequencies for the same rf_path are merged, which
+		is not a problem because they are normally in disjoint time ranges
+	*/
+	bool ok = c.get(lk, lv, MDB_SET_RANGE);
+	ss::bytebuffer<64> kb;
+	while (ok) {
+		kb.clear();
+		kb.append_raw((const uint8_t*)lk.data(), lk.size());
+		if (kb.size() < prefix_size || memcmp(kb.buffer(), k.buffer(), prefix_size) != 0)
+			break;
+		int level_;
+		series_key_t sk;
+		time_t block_start;
+		int series_prefix_size = decode_key(kb, level_, sk, block_start);
+		if (series_prefix_size < 0 || sk.frequency > frequency + tolerance)
+			break;
+		if (block_start < first_block || block_start > end_time) {
+			//skip to first_block of this series or to the next series
+			kb.resize(series_prefix_size);
+			encode_ascending(kb, block_start < first_block ? (int64_t)first_block : std::numeric_limits<int64_t>::max());
+			lk = lmdb::val{kb.buffer(), (size_t)kb.size()};
+			ok = c.get(lk, lv, MDB_SET_RANGE);
+			continue;
+		}
+		if (decode_block(block, (const uint8_t*)lv.data(), lv.size(), block_start, level_res) < 0) {
+			dterrorf("Corrupt signal history block at level {:d}", level);
+		} else {
+			int idx = find_series(sk);
+			auto& series = ret[idx];
+			auto& series_bins = bins[idx];
+			series.frequency = sk.frequency;
+			for (auto& b : block) {
+				if (b.time + level_res <= start_time || b.time >= end_time)
+					continue;
+				time_t bin_time = b.time - b.time % resolution;
+				if (series_bins.size() == 0 || series_bins.back().time != bin_time)
+					series_bins.push_back(bucket_t{bin_time});
+				series_bins.back().add(b);
+			}
+		}
+		ok = c.get(lk, lv, MDB_NEXT);
+	}
+	c.close();
+	//data for different frequencies of the same rf_path can overlap in time
+	for (int i = 0; i < (int)ret.size(); ++i) {
+		auto& series_bins = bins[i];
+		std::stable_sort(series_bins.begin(), series_bins.end(),
+										 [](const bucket_t& a, const bucket_t& b) { return a.time < b.time; });
+		for (int j = 0; j < (int)series_bins.size(); ++j) {
+			if (j + 1 < (int)series_bins.size() && series_bins[j + 1].time == series_bins[j].time) {
+				series_bins[j + 1].add(series_bins[j]);
+				continue;
+			}
+			ret[i].push_back(series_bins[j]);
+		}
+	}
+	return ret;
+}
+
+void signal_history::clean(db_txn& wtxn, time_t now) {
+	lmdb::dbi dbi{0};
+	if (!open_table(wtxn, dbi))
+		return;
+	int num_deleted = 0;
+	auto c = lmdb::cursor::open(wtxn, dbi);
+	for (int level = 0; level < num_levels; ++level) {
+		if (level_retention[level] == 0)
+			continue;
+		auto resolution = level_resolution[level];
+		time_t oldest = now - level_retention[level];
+		ss::bytebuffer<64> k;
+		encode_ascending(k, (uint8_t)level);
+		lmdb::val lk{k.buffer(), (size_t)k.size()};
+		lmdb::val lv{};
+		ss::bytebuffer<64> kb;
+		for (bool ok = c.get(lk, lv, MDB_SET_RANGE); ok; ok = c.get(lk, lv, MDB_NEXT)) {
+			kb.clear();
+			kb.append_raw((const uint8_t*)lk.data(), lk.size());
+			int level_;
+			series_key_t sk;
+			time_t block_start;
+			if (decode_key(kb, level_, sk, block_start) < 0 || level_ != level)
+				break;
+			if (block_start + resolution * (time_t)samples_per_block <= oldest) {
+				lmdb::cursor_del(c.handle(), 0);
+				num_deleted++;
+			}
+		}
+	}
+	c.close();
+	if (num_deleted > 0)
+		dtdebugf("Removed {:d} old signal history blocks", num_deleted);
+}
+
+void writer_t::flush(db_txn& wtxn) {
+	if (!have_key || !dirty)
+		return;
+	for (int l = 0; l < num_levels; ++l)
+		if (current[l].count > 0)
+			put_buckets(wtxn, key, l, &current[l], 1);
+	dirty = false;
+}
+
+/*
+	read the bucket of the series at the given level starting at time t into b, if it exists in the database.
+	This is needed when a writer starts a bucket which was (partially) written before, e.g., by an earlier
+	writer for the same series before a retune
+*/
+static void get_bucket(db_txn& rtxn, const series_key_t& key, int level, bucket_t& b) {
+	lmdb::dbi dbi{0};
+	if (!open_table(rtxn, dbi))
+		return;
+	auto resolution = level_resolution[level];
+	auto block_start = block_start_of(b.time, resolution);
+	ss::bytebuffer<64> k;
+	encode_key(k, level, key, block_start);
+	lmdb::val lk{k.buffer(), (size_t)k.size()};
+	lmdb::val lv{};
+	if (!dbi.get(rtxn, lk, lv))
+		return;
+	std::vector<bucket_t> block;
+	if (decode_block(block, (const uint8_t*)lv.data(), lv.size(), block_start, resolution) < 0)
+		return;
+	for (auto& stored : block) {
+		if (stored.time == b.time) {
+			b = stored;
+			return;
+		}
+	}
+}
+
+void writer_t::add(statdb_t& statdb, const series_key_t& key_, time_t t, const signal_stat_entry_t& e) {
+	if (have_key && !(key_ == key))
+		close(statdb);
+	if (!have_key) {
+		key = key_;
+		have_key = true;
+		for (auto& b : current)
+			b = bucket_t{};
+	}
+	/*
+		all coarser resolutions are multiples of the finest one, so buckets can only be completed when
+		a bucket of the finest level is completed
+	*/
+	auto& b0 = current[0];
+	if (b0.count > 0 && b0.time != t - t % level_resolution[0]) {
+		auto wtxn = statdb.wtxn();
+		flush(wtxn);
+		wtxn.commit();
+	}
+	std::optional<db_txn> rtxn;
+	for (int l = 0; l < num_levels; ++l) {
+		auto& b = current[l];
+		time_t bt = t - t % level_resolution[l];
+		if (b.time != bt) {
+			//continue from the stored version, because flush replaces it
+			b = bucket_t{bt};
+			if (!rtxn)
+				rtxn.emplace(statdb.rtxn());
+			get_bucket(*rtxn, key, l, b);
+		}
+		b.add(e);
+	}
+	if (rtxn)
+		rtxn->commit();
+	dirty = true;
+}
+
+void writer_t::close(statdb_t& statdb) {
+	if (have_key && dirty) {
+		auto wtxn = statdb.wtxn();
+		flush(wtxn);
+		wtxn.commit();
+	}
+	have_key = false;
+	dirty = false;
+}
@@ -0,0 +1,132 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include "neumodb/statdb/statdb_extra.h"
+#include <vector>
+
+/*
+	Long term signal history, for monitoring the health of dishes and lnbs over months.
+
+	signal_stat_t records keep at most 24 samples per tune and are read record by record. The signal
+	history instead stores, per (mux, rf_path), rollups (min, mean, max of signal strength, snr and ber and the
+	number of samples) at several fixed resolutions. Each resolution ("level") is stored in blocks of at most
+	samples_per_block consecutive buckets, aligned on multiples of samples_per_block*resolution seconds.
+
+	Blocks are stored in the raw lmdb table "signal_history" of statdb, with key
+	  level, sat_pos, pol, frequency, rf_path, block_start
+	(all encoded ascending) and a compressed value: bucket times are delta encoded, and each column of floats
+	is xor encoded against the previous bucket (as in Facebook's Gorilla), which usually needs only a few bits
+	per value because signal values change slowly.
+
+	Fine resolutions are removed after some time (see level_retention) by clean; coarse ones are kept.
+*/
+
+namespace statdb::signal_history {
+
+	enum metric_t : int { signal_strength = 0, snr, ber, num_metrics };
+
+	static constexpr int num_levels = 4;
+	static constexpr int level_resolution[num_levels] = {10, 300, 3600, 86400}; //seconds per bucket
+	static constexpr time_t level_retention[num_levels] = {7 * 86400, 90 * 86400, 0, 0}; //0: keep forever
+	static constexpr int samples_per_block = 256;
+
+	struct series_key_t {
+		int16_t sat_pos{sat_pos_none};
+		chdb::fe_polarisation_t pol{chdb::fe_polarisation_t::NONE};
+		int32_t frequency{0};
+		devdb::rf_path_t rf_path;
+
+		bool operator==(const series_key_t& other) const = default;
+	};
+
+	//statistics for all samples in [time, time + resolution[
+	struct bucket_t {
+		time_t time{0};
+		uint32_t count{0};
+		float min[num_metrics]{};
+		float mean[num_metrics]{};
+		float max[num_metrics]{};
+
+		void add(const signal_stat_entry_t& e);
+		void add(const bucket_t& other);
+	};
+
+	//result of a range query for one rf_path; all columns have the same size
+	struct series_t {
+		devdb::rf_path_t rf_path;
+		int32_t frequency{0}; //if data for several nearby frequencies was found, one of them
+		int resolution{0};
+		std::vector<int64_t> time;
+		std::vector<uint32_t> count;
+		std::vector<float> min[num_metrics];
+		std::vector<float> mean[num_metrics];
+		std::vector<float> max[num_metrics];
+
+		void push_back(const bucket_t& b);
+	};
+
+	/*
+		Accumulates samples of one (mux, rf_path) in memory and writes the rollups of all levels to the database.
+		Owned by a single thread (fe_monitor).
+	*/
+	class writer_t {
+		series_key_t key;
+		bucket_t current[num_levels];
+		bool have_key{false};
+		bool dirty{false};
+
+	public:
+		/*
+			add a sample; when a bucket of the finest level has been completed, all open buckets are written
+			to the database (in a transaction created on statdb)
+		*/
+		void add(statdb_t& statdb, const series_key_t& key, time_t t, const signal_stat_entry_t& e);
+
+		//write all open buckets and forget the current series
+		void close(statdb_t& statdb);
+
+		//write all open buckets
+		void flush(db_txn& wtxn);
+	};
+
+	/*
+		append buckets (sorted by time) to the series at the given level; a bucket with the same time as the last
+		bucket in the database replaces it
+	*/
+	void put_buckets(db_txn& wtxn, const series_key_t& key, int level, const bucket_t* buckets, int num_buckets);
+
+	/*
+		Return the history of a mux for all rf_paths between start_time and end_time at a resolution of
+		(approximately, at least) resolution seconds. Frequencies within tolerance kHz are considered the same mux.
+		Only buckets containing data are returned.
+	*/
+	std::vector<series_t> get_range(db_txn& rtxn, int16_t sat_pos, chdb::fe_polarisation_t pol,
+																	int frequency, time_t start_time, time_t end_time, int resolution,
+																	int tolerance = 500);
+
+	//remove fine grained data which is older than level_retention
+	void clean(db_txn& wtxn, time_t now);
+
+	//exposed for testing
+	void encode_block(ss::bytebuffer_& out, const bucket_t* buckets, int num_buckets, time_t block_start,
+										int resolution);
+	int decode_block(std::vector<bucket_t>& out, const uint8_t* data, size_t size, time_t block_start, int resolution);
+}
@@ -19,11 +19,13 @@
  *
  */
 #include "neumodb/statdb/statdb_extra.h"
+#include "neumodb/statdb/signal_history.h"
 #include "neumodb/chdb/chdb_extra.h"
 #include "util/identification.h"
 #include "stackstring/stackstring_pybind.h"
 #include "statdb_vector_pybind.h"
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
 #include <stdio.h>
 
 namespace py = pybind11;
@@ -45,6 +47,53 @@ static void export_statdb_extra(py::module& m) {
 		;
 }
 
+template<typename T>
+static py::array_t<T> to_numpy(const std::vector<T>& v) {
+	return py::array_t<T>(v.size(), v.data());
+}
+
+/*
+	returns a list of dicts, one per rf_path, with the rf_path, frequency and resolution, and numpy arrays
+	time, count, and {signal_strength,snr,ber}_{min,mean,max}
+*/
+static py::list signal_history_get_range(db_txn& rtxn, int16_t sat_pos, chdb::fe_polarisation_t pol,
+																				 int frequency, time_t start_time, time_t end_time, int resolution,
+																				 int tolerance) {
+	using namespace statdb::signal_history;
+	std::vector<series_t> result;
+	{
+		py::gil_scoped_release release;
+		result = get_range(rtxn, sat_pos, pol, frequency, start_time, end_time, resolution, tolerance);
+	}
+	static constexpr const char* metric_names[num_metrics] = {"signal_strength", "snr", "ber"};
+	py::list ret;
+	for (auto& series : result) {
+		py::dict d;
+		d["rf_path"] = series.rf_path;
+		d["frequency"] = series.frequency;
+		d["resolution"] = series.resolution;
+		d["time"] = to_numpy(series.time);
+		d["count"] = to_numpy(series.count);
+		for (int m = 0; m < num_metrics; ++m) {
+			d[fmt::format("{}_min", metric_names[m]).c_str()] = to_numpy(series.min[m]);
+			d[fmt::format("{}_mean", metric_names[m]).c_str()] = to_numpy(series.mean[m]);
+			d[fmt::format("{}_max", metric_names[m]).c_str()] = to_numpy(series.max[m]);
+		}
+		ret.append(d);
+	}
+	return ret;
+}
+
+static void export_signal_history(py::module& m) {
+	auto mm = m.def_submodule("signal_history");
+	mm.def("get_range", &signal_history_get_range,
+				 "Retrieve min/mean/max of signal strength, snr and ber for a mux between start_time and end_time, "
+				 "at a resolution of at least resolution seconds, as numpy arrays (one dict per rf_path)",
+				 py::arg("rtxn"), py::arg("sat_pos"), py::arg("pol"), py::arg("frequency"),
+				 py::arg("start_time"), py::arg("end_time"), py::arg("resolution")=300, py::arg("tolerance")=500)
+		;
+}
+
 PYBIND11_MODULE(pystatdb, m) {
 	m.doc() = R"pbdoc(
         Pybind11 stat database
@@ -61,6 +110,7 @@ PYBIND11_MODULE(pystatdb, m) {
 	export_neumodb(m);
 	export_statdb(m);
 	export_statdb_extra(m);
+	export_signal_history(m);
 	export_statdb_vectors(m);
 	export_ss_vector(m, signal_stat_entry_t);
 	statdb::export_enums(m);
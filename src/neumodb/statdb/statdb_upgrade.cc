@@ -21,4 +21,5 @@
 
 #include "neumodb/neumodb_upgrade_impl.h"
 template EXPORT int neumodb_upgrade<statdb::statdb_t>(const char* from_dbname, const char* to_dbname,
-																											bool force_overwrite, bool inplace_upgrade, bool dont_backup);
+																											bool force_overwrite, bool inplace_upgrade, bool dont_backup,
+																											int num_threads, bool compress);
@@ -0,0 +1,266 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "neumodb/string_compression.h"
+#include "neumodb/cursors.h"
+#include <map>
+#include <shared_mutex>
+#include <string.h>
+#ifdef HAVE_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+namespace string_compression {
+
+	thread_local uint32_t current_dict_id{0};
+
+	static constexpr int min_compressed_size = 24; //shorter strings do not compress well
+	static constexpr int max_string_size = 64 * 1024; //refuse to decompress larger strings (corrupt data)
+
+#ifdef HAVE_ZSTD
+	static constexpr int compression_level = 3;
+	static constexpr size_t max_dict_size = 64 * 1024;
+
+	namespace {
+		struct dict_t {
+			ZSTD_CDict* cdict{nullptr};
+			ZSTD_DDict* ddict{nullptr};
+			~dict_t() {
+				ZSTD_freeCDict(cdict);
+				ZSTD_freeDDict(ddict);
+			}
+		};
+
+		//dictionaries are never removed, so pointers to them remain valid
+		struct registry_t {
+			std::shared_mutex mutex;
+			std::map<uint32_t, std::unique_ptr<dict_t>> dicts;
+		};
+
+		registry_t registry;
+
+		struct thread_state_t {
+			ZSTD_CCtx* cctx{ZSTD_createCCtx()};
+			ZSTD_DCtx* dctx{ZSTD_createDCtx()};
+			std::vector<uint8_t> buffer;
+			//cache of the last used dictionary, to avoid locking the registry for each string
+			uint32_t last_dict_id{0};
+			const dict_t* last_dict{nullptr};
+
+			~thread_state_t() {
+				ZSTD_freeCCtx(cctx);
+				ZSTD_freeDCtx(dctx);
+			}
+		};
+
+		thread_local thread_state_t thread_state;
+	}; //namespace
+
+	static const dict_t* find_dict(uint32_t dict_id) {
+		auto& ts = thread_state;
+		if (ts.last_dict && ts.last_dict_id == dict_id)
+			return ts.last_dict;
+		std::shared_lock lck(registry.mutex);
+		auto it = registry.dicts.find(dict_id);
+		if (it == registry.dicts.end())
+			return nullptr;
+		ts.last_dict_id = dict_id;
+		ts.last_dict = it->second.get();
+		return ts.last_dict;
+	}
+
+	static void register_dict(uint32_t dict_id, const void* data, size_t size) {
+		std::unique_lock lck(registry.mutex);
+		if (registry.dicts.contains(dict_id))
+			return;
+		auto dict = std::make_unique<dict_t>();
+		dict->cdict = ZSTD_createCDict(data, size, compression_level);
+		dict->ddict = ZSTD_createDDict(data, size);
+		if (!dict->cdict || !dict->ddict) {
+			dterrorf("Could not load compression dictionary {:d}", dict_id);
+			return;
+		}
+		registry.dicts[dict_id] = std::move(dict);
+	}
+#else
+	static void register_dict(uint32_t dict_id, const void* data, size_t size) {
+	}
+#endif
+
+	bool available() {
+#ifdef HAVE_ZSTD
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void serialize_compressed(ss::bytebuffer_& ser, const ss::string_& str) {
+#ifdef HAVE_ZSTD
+		const dict_t* dict;
+		if (current_dict_id != 0 && str.size() >= min_compressed_size && (dict = find_dict(current_dict_id))) {
+			auto& ts = thread_state;
+			ts.buffer.resize(ZSTD_compressBound(str.size()));
+			auto n = ZSTD_compress_usingCDict(ts.cctx, ts.buffer.data(), ts.buffer.size(), str.buffer(), str.size(),
+																				dict->cdict);
+			if (!ZSTD_isError(n) && (int)n + 1 < str.size()) {
+				uint32_t size = n + 2; //0 marker and trailing 0
+				encode_ascending(ser, size);
+				uint8_t zero{0};
+				ser.append_raw(zero);
+				ser.append_raw(ts.buffer.data(), n);
+				ser.append_raw(zero);
+				return;
+			}
+		}
+#endif
+		serialize(ser, str);
+	}
+
+	bool decompress(ss::string_& str, const uint8_t* payload, int size) {
+		str.clear();
+#ifdef HAVE_ZSTD
+		auto* frame = payload + 1;
+		size_t frame_size = size - 1;
+		auto content_size = ZSTD_getFrameContentSize(frame, frame_size);
+		if (content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR ||
+				content_size > max_string_size)
+			return false;
+		auto* dict = find_dict(ZSTD_getDictID_fromFrame(frame, frame_size));
+		if (!dict)
+			return false;
+		str.resize_no_init(content_size);
+		auto n = ZSTD_decompress_usingDDict(thread_state.dctx, str.buffer(), content_size, frame, frame_size,
+																				dict->ddict);
+		if (ZSTD_isError(n) || n != content_size) {
+			str.clear();
+			return false;
+		}
+		str.buffer()[n] = 0;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	/*
+		call fn(dict_id, data) for all entries in the dictionary table of db, including
+		the entry with dict_id=0 which stores the active dictionary
+	 */
+	template <typename fn_t> static void for_each_dict(neumodb_t& db, fn_t fn) {
+		auto& dbi = db.aux_tables->dicts;
+		if (dbi.handle() == 0)
+			return;
+		auto txn = db.rtxn();
+		{
+			auto c = lmdb::cursor::open(txn, dbi);
+			lmdb::val k{};
+			lmdb::val v{};
+			for (bool ok = c.get(k, v, MDB_FIRST); ok; ok = c.get(k, v, MDB_NEXT)) {
+				auto key = ss::bytebuffer_::view((uint8_t*)k.data(), k.size(), k.size());
+				uint32_t dict_id;
+				if (decode_ascending(dict_id, key, 0) < 0)
+					continue;
+				fn(dict_id, v);
+			}
+		}
+		txn.commit();
+	}
+
+	static void store_dict(neumodb_t& db, uint32_t dict_id, const void* data, size_t size) {
+		auto& dbi = db.aux_tables->dicts;
+		if (dbi.handle() == 0) {
+			dterrorf("Cannot store compression dictionary {:d}", dict_id);
+			return;
+		}
+		auto txn = db.wtxn();
+		ss::bytebuffer<8> key;
+		encode_ascending(key, dict_id);
+		lmdb::val k{key.buffer(), (size_t)key.size()};
+		lmdb::val v{data, size};
+		dbi.put(txn, k, v);
+		txn.commit();
+	}
+
+	uint32_t train_dict(neumodb_t& db, const std::vector<std::string>& samples) {
+#ifdef HAVE_ZSTD
+		std::string all;
+		std::vector<size_t> sizes;
+		for (auto& sample : samples) {
+			if ((int)sample.size() < min_compressed_size)
+				continue;
+			all += sample;
+			sizes.push_back(sample.size());
+		}
+		if (sizes.size() < 100) {
+			dtdebugf("Too few samples ({:d}) to train a compression dictionary", sizes.size());
+			return 0;
+		}
+		std::vector<uint8_t> dict(max_dict_size);
+		auto n = ZDICT_trainFromBuffer(dict.data(), dict.size(), all.data(), sizes.data(), sizes.size());
+		if (ZDICT_isError(n)) {
+			dterrorf("Training compression dictionary failed: {}", ZDICT_getErrorName(n));
+			return 0;
+		}
+		auto dict_id = ZDICT_getDictID(dict.data(), n); //random id chosen by the trainer
+		if (dict_id == 0)
+			return 0;
+		store_dict(db, dict_id, dict.data(), n);
+		store_dict(db, 0, &dict_id, sizeof(dict_id));
+		register_dict(dict_id, dict.data(), n);
+		db.compression_dict_id = dict_id;
+		dtdebugf("Trained compression dictionary {:d}: {:d} bytes from {:d} samples", dict_id, n, sizes.size());
+		return dict_id;
+#else
+		dterrorf("neumodb was built without zstd: cannot train compression dictionary");
+		return 0;
+#endif
+	}
+
+	int load_dicts(neumodb_t& db) {
+		int count = 0;
+		uint32_t active_dict_id = 0;
+		for_each_dict(db, [&](uint32_t dict_id, const lmdb::val& v) {
+			if (dict_id == 0) {
+				if (v.size() == sizeof(active_dict_id))
+					memcpy(&active_dict_id, v.data(), sizeof(active_dict_id));
+				return;
+			}
+			register_dict(dict_id, v.data(), v.size());
+			count++;
+		});
+		if (count > 0 && !available())
+			dterrorf("Database contains compressed strings, but neumodb was built without zstd");
+		db.compression_dict_id = available() ? active_dict_id : 0;
+		return count;
+	}
+
+	int copy_dicts(neumodb_t& from_db, neumodb_t& to_db) {
+		std::vector<std::pair<uint32_t, std::string>> dicts;
+		for_each_dict(from_db, [&](uint32_t dict_id, const lmdb::val& v) {
+			dicts.emplace_back(dict_id, std::string((const char*)v.data(), v.size()));
+		});
+		for (auto& [dict_id, data] : dicts)
+			store_dict(to_db, dict_id, data.data(), data.size());
+		return load_dicts(to_db);
+	}
+
+}; //namespace string_compression
@@ -0,0 +1,90 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "stackstring.h"
+
+class neumodb_t;
+
+/*
+	Optional compression of string fields (compressed_fields in dbdefs.py) using zstd with a dictionary
+	trained from existing records.
+
+	A compressed string is serialized like any other string: a size, followed by "size" bytes of which the
+	last one is 0. The payload starts with a 0 byte, followed by a zstd frame which records the id of
+	the dictionary and the uncompressed size. Code which skips over string fields therefore does not need
+	to know about compression, and old code sees an empty string instead of crashing.
+
+	Dictionaries are stored in a separate lmdb table "compression_dicts" of the same environment, and are
+	registered in a process wide table when the database is opened. Strings compressed with a
+	dictionary remain readable as long as that dictionary is stored in the database. Only the
+	most recently trained dictionary (neumodb_t::compression_dict_id) is used for compressing new strings.
+	put_kv makes it the current dictionary of the calling thread while serializing a record (dict_scope_t).
+
+	If neumodb is built without zstd, strings are never compressed and compressed strings decode as empty strings.
+ */
+namespace string_compression {
+	//true if neumodb was built with zstd
+	bool available();
+
+	//dictionary used by serialize_compressed on this thread; 0 means: do not compress
+	extern thread_local uint32_t current_dict_id;
+
+	struct dict_scope_t {
+		uint32_t saved_dict_id;
+		dict_scope_t(uint32_t dict_id) : saved_dict_id(current_dict_id) {
+			current_dict_id = dict_id;
+		}
+		~dict_scope_t() {
+			current_dict_id = saved_dict_id;
+		}
+	};
+
+	//serialize str, compressing it with the current dictionary (if any)
+	void serialize_compressed(ss::bytebuffer_& ser, const ss::string_& str);
+
+	//true if the payload of a serialized string is compressed
+	inline bool is_compressed(const uint8_t* payload, int size) {
+		//0 marker followed by the zstd magic number 0xFD2FB528
+		return size > 5 && payload[0] == 0 && payload[1] == 0x28 && payload[2] == 0xb5 && payload[3] == 0x2f &&
+			payload[4] == 0xfd;
+	}
+
+	/*
+		decompress a payload for which is_compressed returned true (size excludes the trailing 0).
+		Returns false if the dictionary is unknown or the data is corrupt; str is then empty
+	 */
+	bool decompress(ss::string_& str, const uint8_t* payload, int size);
+
+	/*
+		train a dictionary on samples, store it in db and use it for compressing new strings in db.
+		Returns the id of the new dictionary or 0 on failure
+	 */
+	uint32_t train_dict(neumodb_t& db, const std::vector<std::string>& samples);
+
+	//register all dictionaries stored in db and activate the last trained one. Returns the number of dictionaries
+	int load_dicts(neumodb_t& db);
+
+	//copy all dictionaries from from_db to to_db, so that to_db compresses new strings in the same way
+	int copy_dicts(neumodb_t& from_db, neumodb_t& to_db);
+}; //namespace string_compression
@@ -68,7 +68,12 @@ namespace {{dbname}} {
 							{}
 
 		HIDDEN virtual int convert_record(db_cursor& from_cursor, db_txn& to_txn, uint32_t type_id, unsigned int put_flags=0);
+		HIDDEN virtual std::unique_ptr<converted_record_t> read_converted_record(db_cursor& from_cursor, uint32_t type_id);
 		HIDDEN virtual void store_schema(db_txn& txn, unsigned int put_flags=0);
+		HIDDEN virtual uint32_t train_compression_dict(neumodb_t& from_db, int max_samples=20000);
+		HIDDEN virtual bool serialize_for_replica(db_cursor& from_cursor, uint32_t type_id, ss::bytebuffer_& out);
+		HIDDEN virtual int put_from_replica(db_txn& to_txn, uint32_t type_id, const ss::bytebuffer_& primary_key,
+																				const ss::bytebuffer_& val);
 
 		static void clean_log(db_txn& txn, int to_keep=10000);
 	};
@@ -23,6 +23,7 @@
 #include "{{dbname}}_keys.h"
 #include "neumodb/cursors.h"
 #include "neumodb/dbdesc.h"
+#include "neumodb/string_compression.h"
 #include "neumodb/schema/schema_db.h"
 #include <uuid/uuid.h>
 
@@ -53,6 +54,98 @@ namespace {{dbname}} {
 		}
 		return -1;
   };
+
+	template<typename record_t>
+	struct converted_record_impl_t final : public converted_record_t {
+		record_t record;
+
+		virtual void put(db_txn& to_txn, std::string& last_key, unsigned int put_flags) final {
+			auto primary_key = record_t::make_key(record_t::keys_t::key, record_t::partial_keys_t::all, &record);
+			//same order as lmdb's default key comparison
+			auto key = std::string_view((const char*) primary_key.buffer(), primary_key.size());
+			if(key > last_key) {
+				put_record(to_txn, record, put_flags | MDB_APPEND);
+				last_key = key;
+			} else
+				put_record(to_txn, record, put_flags);
+		}
+	};
+
+	std::unique_ptr<converted_record_t> {{dbname}}_t::read_converted_record(db_cursor& from_cursor, uint32_t type_id)
+	{
+		switch(type_id) {
+    {%for struct in structs %}
+		{%if struct.is_table %}
+		case {{struct.type_id}}: { //
+			auto ret = std::make_unique<converted_record_impl_t<{{dbname}}::{{struct.class_name}}>>();
+			if(!from_cursor.get_value(ret->record))
+				return {}; // record not found
+			return ret;
+		}
+		break;
+		{%endif %}
+  {% endfor %}
+		default:
+			return {}; //unknown record
+		}
+		return {};
+  };
+}; //namespace {{dbname}}
+
+namespace {{dbname}} {
+/*
+		helper functions for replicas
+*/
+	bool {{dbname}}_t::serialize_for_replica(db_cursor& from_cursor, uint32_t type_id, ss::bytebuffer_& out)
+	{
+		switch(type_id) {
+    {%for struct in structs %}
+		{%if struct.is_table %}
+		case {{struct.type_id}}: { //
+			{{dbname}}::{{struct.class_name}} record;
+			if(!from_cursor.get_value(record))
+				return false;
+			string_compression::dict_scope_t scope(0); //never compress: the replica may not have the dictionary
+			serialize(out, record);
+			return true;
+		}
+		break;
+		{%endif %}
+  {% endfor %}
+		default:
+			return false; //unknown record
+		}
+		return false;
+	};
+
+	int {{dbname}}_t::put_from_replica(db_txn& to_txn, uint32_t type_id, const ss::bytebuffer_& primary_key,
+																		 const ss::bytebuffer_& val)
+	{
+		switch(type_id) {
+    {%for struct in structs %}
+		{%if struct.is_table %}
+		case {{struct.type_id}}: { //
+			auto c = to_txn.pdb->template tcursor<{{dbname}}::{{struct.class_name}}>(to_txn);
+			if(val.size() == 0) {
+				if(!c.find(primary_key))
+					return 0;
+				delete_record_at_cursor(c);
+				return 1;
+			}
+			{{dbname}}::{{struct.class_name}} record;
+			if(deserialize(val, record) < 0)
+				return -1;
+			put_record(c, record);
+			return 1;
+		}
+		break;
+		{%endif %}
+  {% endfor %}
+		default:
+			return -1; //unknown record
+		}
+		return -1;
+	};
 }; //namespace {{dbname}}
 
 namespace {{dbname}} {
@@ -72,6 +165,47 @@ namespace {{dbname}} {
 		}
 		put_record(txn, s, put_flags);
   };
+
+/*
+		train a dictionary for compressing string fields, using the records in from_db as samples
+*/
+	uint32_t {{dbname}}_t::train_compression_dict(neumodb_t& from_db, int max_samples)
+	{
+		{% if structs|selectattr('compressed_fields')|list|length %}
+		std::vector<std::string> samples;
+		int num_records = 0;
+		auto txn = from_db.rtxn();
+		for(auto c = from_db.generic_get_first(txn); c.is_valid() && num_records < max_samples; c.next()) {
+			ss::bytebuffer<32> key;
+			c.get_serialized_key(key);
+			uint32_t type_id;
+			if(decode_ascending(type_id, key, 0) < 0)
+				continue;
+			switch(type_id) {
+			{%for struct in structs %}
+			{%if struct.is_table and struct.compressed_fields|length %}
+			case {{struct.type_id}}: { //
+				{{dbname}}::{{struct.class_name}} record;
+				if(!c.get_value(record)) //safe, even if from_db has an older schema
+					break;
+				num_records++;
+				{%for f in struct.compressed_fields %}
+				samples.emplace_back(record.{{f}}.c_str(), record.{{f}}.size());
+				{%endfor %}
+			}
+				break;
+			{%endif %}
+			{% endfor %}
+			default:
+				break;
+			}
+		}
+		txn.commit();
+		return string_compression::train_dict(*this, samples);
+		{% else %}
+		return 0;
+		{% endif %}
+	};
 }; //namespace {{dbname}}
 
 
@@ -26,6 +26,7 @@
 #include "neumodb/{{dbname}}/{{dbname}}_db.h"
 #include "neumodb/db_keys_helper.h"
 #include "neumodb/screen_impl.h"
+#include "neumodb/filter_index_impl.h"
 #define todo(x)
 #define UNUSED __attribute__((unused))
 
@@ -146,6 +147,44 @@ namespace {{dbname}} {
 };
 {% endif %}
 
+{% if struct.is_table and struct.filter_fields|length %}
+namespace {{dbname}} {
+	void {{struct.class_name}}::filter_value(ss::bytebuffer_& out, int idx, const {{struct.class_name}}& record) {
+		out.clear();
+		switch(idx) {
+			{% for field in struct.filter_fields %}
+		case {{loop.index0}}: //{{field.name}}
+			{% for f in field.subfields %}
+			encode_ascending(out, record.{{f.name}});
+			{% endfor %}
+			break;
+			{% endfor %}
+		default:
+			assert(0);
+		}
+	}
+
+	bool {{struct.class_name}}::filter_field_is_matched(int idx, const ss::vector_<field_matcher_t>& field_matchers) {
+		auto has_eq = [&field_matchers](subfield_t subfield) {
+			for(const auto& fm: field_matchers) {
+				if(subfield_t(fm.field_id) == subfield && fm.match_type == field_matcher_t::match_type_t::EQ)
+					return true;
+			}
+			return false;
+		};
+		switch(idx) {
+			{% for field in struct.filter_fields %}
+		case {{loop.index0}}: //{{field.name}}
+			return {% for f in field.subfields %}has_eq(subfield_t::{{f.name.replace('.','_')}}){% if not loop.last %} &&
+				{% endif %}{% endfor %};
+			{% endfor %}
+		default:
+			return false;
+		}
+	}
+};
+{% endif %}
+
 {%if struct.is_table %}
 template<>
 bool screen_t<{{dbname}}::{{struct.class_name}}>::is_primary(const dynamic_key_t& order)
@@ -715,7 +754,9 @@ template<>
 	ss::bytebuffer_ &out, const {{dbname}}::{{struct.class_name}}& in)  {
 	using namespace {{dbname}};
 	{%for f in struct.fields %}
-	{%-if f['type'].startswith('ss::') %}
+	{%-if f.is_compressed %}
+	string_compression::serialize_compressed(out, in.{{f.name}});
+	{%elif f['type'].startswith('ss::') %}
 	serialize(out, in.{{f.name}});
 	{%elif f.is_variant%}
 	{
@@ -1395,6 +1436,73 @@ static void fill_list_db_(
 		monitor->state.list_size = n;
 	return;
 }
+
+{% if struct.filter_fields|length %}
+/*
+	same as fill_list_db_, but only visits the records with the given primary keys, which
+	are found using the bitmap indexes. Records which no longer exist or which are outside
+	the range defined by key_prefix, key_lower_limit and key_upper_limit (all keys for
+	index_for_key_prefix) are skipped.
+ */
+static void fill_list_db_from_keys_(
+	db_txn& txn,
+	function_view<bool (const {{struct.class_name}}&)> match_fn,
+	const ss::bytebuffer_& key_prefix,
+	const ss::bytebuffer_& key_lower_limit,
+#ifdef USE_END_TIME
+	const ss::bytebuffer_& key_upper_limit,
+#endif
+	{{struct.class_name}}::keys_t index_for_key_prefix,
+	const std::vector<std::string>& primary_keys,
+	db_txn& wtxn,
+	monitor_t* monitor = nullptr,
+	dynamic_key_t* sort_order = nullptr)
+	{
+	int n=0; //number of records
+	if(monitor) {
+		monitor->state.pos_top = -1; //position of top entry on screen, or -1 if screen is empty
+		monitor->state.list_size = 0;
+	}
+
+	auto cw = wtxn.pdb->tcursor<{{struct.class_name}}>(wtxn);
+	cw.drop(false);
+	auto cwi = wtxn.pdb->tcursor_index<{{struct.class_name}}>(wtxn);
+	cwi.drop(false);
+	auto cwl = wtxn.pdb->tcursor_log<{{struct.class_name}}>(wtxn);
+	cwl.drop(false);
+
+	auto c = txn.pdb->tcursor<{{struct.class_name}}>(txn);
+	ss::bytebuffer<32> primary_key;
+	for(const auto& k: primary_keys) {
+		primary_key.clear();
+		primary_key.append_raw(k.data(), k.size());
+		if(!c.find(primary_key))
+			continue; //deleted since the index was updated
+		auto x = c.current();
+		auto key = {{struct.class_name}}::make_key(index_for_key_prefix, {{struct.class_name}}::partial_keys_t::all, &x);
+		if(key.size() < key_prefix.size() || memcmp(key.buffer(), key_prefix.buffer(), key_prefix.size()) != 0)
+			continue;
+		if(cmp(key, key_lower_limit) < 0)
+			continue;
+#ifdef USE_END_TIME
+		if(key_upper_limit.size() > 0 && cmp(key, key_upper_limit) >= 0)
+			continue;
+#endif
+		if (!match_fn(x))
+			continue;
+		if(sort_order) {
+			const bool is_removal = false;
+			ss::bytebuffer<32> secondary_key;
+			make_secondary_key(secondary_key, *sort_order, x);
+			monitor->reference.update(secondary_key, primary_key, is_removal);
+		}
+		put_record(cw, x);
+		n++;
+	}
+	if(monitor)
+		monitor->state.list_size = n;
+}
+{% endif %}
 }; //end namespace  {{dbname}}::{{struct.name}}
 {% endif %}
 
@@ -1446,6 +1554,24 @@ void screen_t<{{dbname}}::{{struct.class_name}}>::fill_list_db
 	};
 
 
+	{% if struct.filter_fields|length %}
+	/*
+		if the matchers restrict some filter fields to a single value, only visit the records
+		selected by the bitmap indexes
+	*/
+	std::vector<std::string> candidates;
+	if(filter_index_candidates<{{struct.class_name}}>(txn, field_matchers, match_data, field_matchers2, match_data2,
+																									 candidates)) {
+		{{struct.name}}::fill_list_db_from_keys_(txn, some_match_fn, limits.key_prefix, start_key,
+#ifdef USE_END_TIME
+																						 end_key,
+#endif
+																						 limits.index_for_key_prefix,
+																						 candidates, wtxn, &monitor,
+																						 reference ? &this->sort_order : nullptr);
+		return;
+	}
+	{% endif %}
 
 	if(is_primary(dynamic_key_t((uint8_t)limits.index_for_key_prefix))) {
 		auto c = primary_key_t::find_by_serialized_key<{{struct.class_name}}>(txn, start_key,
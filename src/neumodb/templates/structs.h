@@ -96,7 +96,21 @@ namespace {{dbname}} {
 			{% endfor %}
 		};
 
+		/*
+			in-memory bitmap indexes are maintained for the filter fields (see filter_index.h).
+			filter_value computes the key of filter field idx in these indexes. filter_field_is_matched returns
+			true if field_matchers restrict filter field idx to a single value
+		*/
+		static constexpr int num_filter_fields = {{struct.filter_fields|length}};
+		static void filter_value(ss::bytebuffer_& out, int idx, const {{struct.class_name}}& record);
+		static bool filter_field_is_matched(int idx, const ss::vector_<field_matcher_t>& field_matchers);
+
 		{% endif %} {#struct.filter_fields|length#}
+		{% if struct.compressed_fields|length %}
+
+		//{% for f in struct.compressed_fields %}{{f}} {% endfor %}are compressed when stored (see string_compression.h)
+		static constexpr bool has_compressed_fields = true;
+		{% endif %}
 
 		/*
 			if a key starts with a specific subfield, then we can use this key
@@ -25,6 +25,7 @@ namespace py = pybind11;
 
 #include "neumodb/{{dbname}}/{{dbname}}_db.h"
 #include "neumodb/{{dbname}}/{{dbname}}_extra.h"
+#include "neumodb/screen_columns_pybind.h"
 
 #ifndef ISF_INCLUDED
 #define ISF_INCLUDED
@@ -148,6 +149,37 @@ namespace {{dbname}} {
 				)
 			.def("update", &s_t::update)
 			.def("record_at_row", &s_t::record_at_row, py::arg("row_number"))
+			.def("records_at_rows",
+					 [](s_t& self, int start_row, int end_row) {
+						 //returned as a list, because not all record types have a python vector type
+						 py::list ret;
+						 for(const auto& r: self.records_at_rows(start_row, end_row))
+							 ret.append(r);
+						 return ret;
+					 }, "records in rows [start_row, end_row[", py::arg("start_row"), py::arg("end_row"))
+			.def("columns_at_rows",
+					 [](s_t& self, int start_row, int end_row, const std::vector<std::string>& fields) {
+						 auto records = self.records_at_rows(start_row, end_row);
+						 py::dict ret;
+						 for(const auto& field: fields) {
+							 switch({{struct.class_name}}::subfield_t({{struct.class_name}}::subfield_from_name(field.c_str()))) {
+								 {% for f in struct.subfields -%}
+								 {%if not f.is_vector -%}
+							 case {{struct.class_name}}::subfield_t::{{f.name.replace('.','_')}}:
+								 ret[field.c_str()] = screen_column(records, [](const {{struct.class_name}}& r) -> const auto& {
+									 return r.{{f.name}};});
+								 break;
+								 {%endif%}
+								 {%- endfor %}
+							 default:
+								 throw std::runtime_error(fmt::format("Field {} cannot be retrieved as a column", field));
+							 }
+						 }
+						 return ret;
+					 },
+					 "values of fields in rows [start_row, end_row[ as a dict of numpy arrays (numbers, enums) "
+					 "or lists (strings)",
+					 py::arg("start_row"), py::arg("end_row"), py::arg("fields"))
 			.def("set_reference", py::overload_cast<const {{struct.class_name}}&>(&s_t::set_reference), py::arg("record"))
 			.def_readonly("pos_top", &s_t::pos_top)
 			.def_property_readonly("list_size", &s_t::list_size)
@@ -0,0 +1,180 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Test for change log consumers: checks that changes are reported once per record, that deleted
+	records are reported as such, and that clean_log keeps the changes a consumer has not yet seen.
+
+	Usage: testchangelog --dir /tmp/testchangelog
+*/
+
+#include "neumodb/epgdb/epgdb_extra.h"
+#include "neumodb/change_log_impl.h"
+#include "util/util.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <stdio.h>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+struct options_t {
+	std::string dir{"/tmp/testchangelog"};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB change log test");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for test database")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static epgdb::epg_record_t make_record(int i) {
+	epgdb::epg_record_t rec;
+	rec.k.service.mux.sat_pos = 1920;
+	rec.k.service.service_id = i % 10;
+	rec.k.start_time = 1700000000 + i * 1800;
+	rec.k.event_id = i;
+	rec.end_time = rec.k.start_time + 1800;
+	rec.event_name.format("event {:d}", i);
+	return rec;
+}
+
+static int num_errors{0};
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		printf("ERROR: %s\n", what);
+		num_errors++;
+	}
+}
+
+//process one batch; returns the number of upserts and deletes
+static std::pair<int, int> consume(epgdb::epgdb_t& db, const char* name, bool expect_full_scan = false) {
+	auto rtxn = db.rtxn();
+	change_consumer_t consumer(rtxn, name);
+	int upserts{0};
+	int deletes{0};
+	if (!consumer.begin_batch(rtxn)) {
+		check(expect_full_scan, "unexpected full scan");
+	} else {
+		check(!expect_full_scan, "full scan expected");
+		ss::vector<change_t<epgdb::epg_record_t>, 16> changes;
+		consumer.changes(rtxn, changes);
+		for (auto& change : changes) {
+			if (change.op == change_op_t::upsert)
+				upserts++;
+			else
+				deletes++;
+		}
+	}
+	check(consumer.up_to_date(rtxn), "batch does not reach end of snapshot");
+	rtxn.commit();
+	auto wtxn = db.wtxn();
+	consumer.ack(wtxn);
+	wtxn.commit();
+	return {upserts, deletes};
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	fs::remove_all(options.dir);
+	fs::create_directories(options.dir);
+
+	epgdb::epgdb_t db;
+	db.open(options.dir.c_str());
+
+	consume(db, "test", true); //new consumer: full scan
+	for (int t = 0; t < 3; ++t) { //each record is written 3 times
+		auto wtxn = db.wtxn();
+		for (int i = 0; i < 100; ++i)
+			put_record(wtxn, make_record(i));
+		wtxn.commit();
+	}
+	{
+		auto wtxn = db.wtxn();
+		for (int i = 0; i < 5; ++i)
+			delete_record(wtxn, make_record(i));
+		wtxn.commit();
+	}
+	auto [upserts, deletes] = consume(db, "test");
+	printf("batch 1: %d upserts %d deletes\n", upserts, deletes);
+	check(upserts == 95 && deletes == 5, "wrong changes in batch 1");
+
+	//clean_log must keep the changes of the next batch until they are acknowledged
+	{
+		auto wtxn = db.wtxn();
+		for (int i = 100; i < 110; ++i)
+			put_record(wtxn, make_record(i));
+		wtxn.commit();
+	}
+	{
+		auto wtxn = db.wtxn();
+		epgdb::epgdb_t::clean_log(wtxn, 0);
+		wtxn.commit();
+	}
+	std::tie(upserts, deletes) = consume(db, "test");
+	printf("batch 2: %d upserts %d deletes\n", upserts, deletes);
+	check(upserts == 10 && deletes == 0, "changes lost by clean_log");
+	std::tie(upserts, deletes) = consume(db, "test");
+	check(upserts == 0 && deletes == 0, "changes reported twice");
+
+	//once acknowledged, the log can be cleaned
+	{
+		auto wtxn = db.wtxn();
+		epgdb::epgdb_t::clean_log(wtxn, 0);
+		wtxn.commit();
+	}
+	{
+		auto rtxn = db.rtxn();
+		ss::vector<change_t<epgdb::epg_record_t>, 16> changes;
+		change_log::get_changes(rtxn, 1, rtxn.txn_id(), changes);
+		check(changes.size() == 0, "log not cleaned");
+		rtxn.commit();
+	}
+
+	db.close();
+	fs::remove_all(options.dir);
+	if (num_errors == 0)
+		printf("OK\n");
+	return num_errors == 0 ? 0 : -1;
+}
@@ -0,0 +1,204 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Benchmark for convert_db. A synthetic epgdb with many records is created, and then
+	converted using different numbers of threads. The converted databases must contain the same
+	number of records as the input. The conversion is also interrupted once and then resumed.
+
+	Usage: testconvertdb --records 1000000 --threads 8 --dir /tmp/testconvertdb
+*/
+
+#include "neumodb/epgdb/epgdb_extra.h"
+#include "util/util.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <stdio.h>
+#include <thread>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+struct options_t {
+	std::string dir{"/tmp/testconvertdb"};
+	int num_records{1000000};
+	int num_threads{0};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB database conversion benchmark");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for test databases")
+			("records,r", po::value<int>(&num_records)->default_value(num_records), "Number of epg records")
+			("threads,j", po::value<int>(&num_threads)->default_value(num_threads),
+			 "Number of threads (0: one per cpu)")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static constexpr size_t mapsize = 8 * 1024ul * 1024ul * 1024ul;
+
+static void make_db(const std::string& path, int num_records) {
+	fs::remove_all(path);
+	epgdb::epgdb_t db;
+	db.open_without_log(path.c_str(), false, nullptr, mapsize);
+	time_t start_time = 1700000000;
+	for (int i = 0; i < num_records;) {
+		auto txn = db.wtxn();
+		for (int j = 0; j < 10000 && i < num_records; ++j, ++i) {
+			epgdb::epg_record_t rec;
+			rec.k.service.mux.sat_pos = 1920;
+			rec.k.service.mux.mux_id = i % 100;
+			rec.k.service.service_id = i % 1000;
+			rec.k.start_time = start_time + (i / 1000) * 1800;
+			rec.k.event_id = i;
+			rec.end_time = rec.k.start_time + 1800;
+			rec.event_name.format("Event {:d}", i);
+			rec.story.format("Synthetic story for event {:d}, which is long enough to look like real epg data", i);
+			rec.service_name.format("Service {:d}", i % 1000);
+			put_record(txn, rec);
+		}
+		txn.commit();
+	}
+	auto txn = db.wtxn();
+	db.store_schema(txn, 0);
+	txn.commit();
+}
+
+static int count_records(epgdb::epgdb_t& db) {
+	auto txn = db.rtxn();
+	int count = 0;
+	auto c = epgdb::find_first<epgdb::epg_record_t>(txn);
+	for (auto rec : c.range()) {
+		(void)rec;
+		count++;
+	}
+	txn.commit();
+	return count;
+}
+
+static double convert(epgdb::epgdb_t& from_db, const std::string& to_path, const convert_db_options_t& convert_options,
+											int& num_converted) {
+	epgdb::epgdb_t to_db;
+	to_db.open_without_log(to_path.c_str(), false, nullptr, mapsize);
+	auto start = steady_clock_t::now();
+	auto ret = convert_db(from_db, to_db, 0, convert_options);
+	auto end = steady_clock_t::now();
+	num_converted = ret < 0 ? -1 : count_records(to_db);
+	return std::chrono::duration<double>(end - start).count();
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	fs::create_directories(options.dir);
+	auto from_path = options.dir + "/from.mdb";
+	auto start = steady_clock_t::now();
+	make_db(from_path, options.num_records);
+	printf("created %d records in %.1fs\n", options.num_records,
+				 std::chrono::duration<double>(steady_clock_t::now() - start).count());
+
+	epgdb::epgdb_t from_db;
+	from_db.open(from_path.c_str(), false, nullptr, false, mapsize);
+	int num_threads = options.num_threads > 0 ? options.num_threads : (int)std::thread::hardware_concurrency();
+	int ret = 0;
+	for (int threads : {1, num_threads}) {
+		auto to_path = options.dir + "/to" + std::to_string(threads) + ".mdb";
+		fs::remove_all(to_path);
+		convert_db_options_t convert_options;
+		convert_options.num_threads = threads;
+		convert_options.show_progress = false;
+		int num_converted{0};
+		auto secs = convert(from_db, to_path, convert_options, num_converted);
+		printf("threads=%2d: %.2fs %.0f records/s\n", threads, secs, options.num_records / secs);
+		if (num_converted != options.num_records) {
+			printf("ERROR: converted %d records instead of %d\n", num_converted, options.num_records);
+			ret = -1;
+		}
+		fs::remove_all(to_path);
+	}
+
+	/*
+		resume: convert the first part of the database and pretend that the upgrade was interrupted
+		at a chunk boundary by writing the resume file by hand
+	*/
+	auto to_path = options.dir + "/resumed.mdb";
+	fs::remove_all(to_path);
+	convert_db_options_t convert_options;
+	convert_options.num_threads = num_threads;
+	convert_options.show_progress = false;
+	convert_options.resume_file = options.dir + "/resumed.progress";
+	{
+		epgdb::epgdb_t to_db;
+		to_db.open_without_log(to_path.c_str(), false, nullptr, mapsize);
+		auto from_txn = from_db.rtxn();
+		auto to_txn = to_db.wtxn();
+		auto c = from_db.generic_get_first(from_txn);
+		FILE* fp = fopen(convert_options.resume_file.c_str(), "w");
+		for (int i = 0; c.is_valid(); c.next()) {
+			ss::bytebuffer<32> key;
+			c.get_serialized_key(key);
+			uint32_t type_id;
+			decode_ascending(type_id, key, 0);
+			if (type_id != data_types::data_type<epgdb::epg_record_t>())
+				continue;
+			if (i++ < options.num_records / 2) {
+				to_db.convert_record(c, to_txn, type_id);
+				continue;
+			}
+			for (int j = 0; j < key.size(); ++j)
+				fprintf(fp, "%02x", key[j]);
+			fprintf(fp, "\n");
+			break;
+		}
+		fclose(fp);
+		to_txn.commit();
+		from_txn.commit();
+	}
+	int num_converted{0};
+	auto secs = convert(from_db, to_path, convert_options, num_converted);
+	printf("resumed:    %.2fs\n", secs);
+	if (num_converted != options.num_records) {
+		printf("ERROR: resumed conversion has %d records instead of %d\n", num_converted, options.num_records);
+		ret = -1;
+	}
+	fs::remove_all(options.dir);
+	return ret;
+}
@@ -0,0 +1,190 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Benchmark for compressed epg strings. A synthetic epgdb is created and then converted
+	to a database with compressed strings, in the same way as "neumoupgrade --compress".
+	Reports the size of both databases and the time needed to look up random records,
+	and checks that all strings survive the compression.
+
+	Usage: testepgcompress --records 1000000 --dir /tmp/testepgcompress
+*/
+
+#include "neumodb/epgdb/epgdb_extra.h"
+#include "neumodb/string_compression.h"
+#include "util/util.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdio.h>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+struct options_t {
+	std::string dir{"/tmp/testepgcompress"};
+	int num_records{1000000};
+	int num_lookups{100000};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB epg compression benchmark");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for test databases")
+			("records,r", po::value<int>(&num_records)->default_value(num_records), "Number of epg records")
+			("lookups,l", po::value<int>(&num_lookups)->default_value(num_lookups), "Number of random lookups")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static constexpr size_t mapsize = 8 * 1024ul * 1024ul * 1024ul;
+
+static const char* words[] = {
+	"news", "weather", "the", "and", "documentary", "series", "episode", "season", "film", "drama", "comedy",
+	"football", "live", "from", "with", "presenter", "guests", "discuss", "latest", "world", "history", "nature",
+	"wildlife", "cooking", "travel", "music", "concert", "interview", "investigation", "family", "detective",
+	"murder", "mystery", "love", "story", "journey", "adventure", "science", "politics", "sport", "highlights"};
+
+static epgdb::epg_record_t make_record(int i) {
+	std::mt19937 rng(i);
+	auto word = [&]() { return words[rng() % (sizeof(words) / sizeof(words[0]))]; };
+	epgdb::epg_record_t rec;
+	rec.k.service.mux.sat_pos = 1920;
+	rec.k.service.mux.mux_id = i % 100;
+	rec.k.service.service_id = i % 1000;
+	rec.k.start_time = 1700000000 + (i / 1000) * 1800;
+	rec.k.event_id = i;
+	rec.end_time = rec.k.start_time + 1800;
+	rec.event_name.format("{} {} ({:d})", word(), word(), i % 50);
+	for (int j = 0; j < 30; ++j)
+		rec.story.format("{}{}", j == 0 ? "" : " ", word());
+	rec.service_name.format("Channel {:d} HD", i % 1000);
+	return rec;
+}
+
+static size_t db_size(const std::string& path) {
+	std::error_code err;
+	auto ret = fs::file_size(fs::path(path) / "data.mdb", err);
+	return err ? 0 : ret;
+}
+
+//look up random records and check their content
+static double lookups(epgdb::epgdb_t& db, int& num_errors) {
+	std::mt19937 rng(1);
+	auto txn = db.rtxn();
+	auto start = steady_clock_t::now();
+	for (int i = 0; i < options.num_lookups; ++i) {
+		auto expected = make_record(rng() % options.num_records);
+		auto c = epgdb::epg_record_t::find_by_key(txn, expected.k);
+		if (!c.is_valid()) {
+			num_errors++;
+			continue;
+		}
+		auto rec = c.current();
+		num_errors += (rec.event_name != expected.event_name || rec.story != expected.story ||
+									 rec.service_name != expected.service_name);
+	}
+	auto secs = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+	txn.commit();
+	return secs;
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	if (!string_compression::available()) {
+		printf("neumodb was built without zstd\n");
+		return 0;
+	}
+	fs::remove_all(options.dir);
+	fs::create_directories(options.dir);
+	auto from_path = options.dir + "/plain.mdb";
+	auto to_path = options.dir + "/compressed.mdb";
+
+	epgdb::epgdb_t from_db;
+	from_db.open_without_log(from_path.c_str(), false, nullptr, mapsize);
+	for (int i = 0; i < options.num_records;) {
+		auto txn = from_db.wtxn();
+		for (int j = 0; j < 10000 && i < options.num_records; ++j, ++i)
+			put_record(txn, make_record(i));
+		txn.commit();
+	}
+
+	epgdb::epgdb_t to_db;
+	to_db.open_without_log(to_path.c_str(), false, nullptr, mapsize);
+	auto start = steady_clock_t::now();
+	auto dict_id = to_db.train_compression_dict(from_db);
+	auto train_secs = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+	convert_db_options_t convert_options;
+	convert_options.show_progress = false;
+	start = steady_clock_t::now();
+	int ret = convert_db(from_db, to_db, 0, convert_options);
+	auto convert_secs = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+	printf("dictionary %u trained in %.2fs; converted in %.2fs\n", dict_id, train_secs, convert_secs);
+	if (dict_id == 0 || ret < 0) {
+		printf("ERROR: compression failed\n");
+		return -1;
+	}
+
+	int plain_errors{0};
+	int compressed_errors{0};
+	auto plain_secs = lookups(from_db, plain_errors);
+	auto compressed_secs = lookups(to_db, compressed_errors);
+	printf("plain:      %8.1f MB %6.2fus/lookup\n", db_size(from_path) / 1e6, plain_secs * 1e6 / options.num_lookups);
+	printf("compressed: %8.1f MB %6.2fus/lookup\n", db_size(to_path) / 1e6,
+				 compressed_secs * 1e6 / options.num_lookups);
+	if (plain_errors || compressed_errors) {
+		printf("ERROR: %d/%d lookups returned the wrong record\n", plain_errors, compressed_errors);
+		ret = -1;
+	}
+
+	//the dictionary must be found again after reopening the database
+	to_db.close();
+	epgdb::epgdb_t reopened_db;
+	reopened_db.open_without_log(to_path.c_str(), false, nullptr, mapsize);
+	int reopened_errors{0};
+	lookups(reopened_db, reopened_errors);
+	if (reopened_errors || reopened_db.compression_dict_id != dict_id) {
+		printf("ERROR: %d lookups failed after reopening\n", reopened_errors);
+		ret = -1;
+	}
+	fs::remove_all(options.dir);
+	return ret;
+}
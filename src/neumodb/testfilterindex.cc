@@ -0,0 +1,178 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Benchmark for the bitmap filter indexes. A synthetic chdb with many services on many satellites
+	is created. Then a list of "TV services on 19.2E sorted by name" is created, once using
+	equality matchers on sat_pos and media_mode (which can use the bitmap indexes), and once
+	using a range matcher on sat_pos (which requires a scan of the whole database).
+	Both lists must have the same size.
+
+	Usage: testfilterindex --services 100000 --dir /tmp/testfilterindex
+*/
+
+#include "neumodb/chdb/chdb_extra.h"
+#include "util/util.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <stdio.h>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+using namespace chdb;
+
+struct options_t {
+	std::string dir{"/tmp/testfilterindex"};
+	int num_services{100000};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB filter index benchmark");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for test database")
+			("services,s", po::value<int>(&num_services)->default_value(num_services), "Number of services")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static constexpr int num_sats = 40;
+
+static service_t make_service(int i) {
+	service_t s;
+	s.k.mux.sat_pos = 1920 + (i % num_sats) * 10 - (num_sats / 2) * 10;
+	s.k.mux.network_id = 1;
+	s.k.mux.ts_id = i / 100;
+	s.k.service_id = i;
+	s.media_mode = (i % 5 < 3) ? media_mode_t::TV : ((i % 5 == 3) ? media_mode_t::RADIO : media_mode_t::DATA);
+	s.name.format("Service {:d}", (i * 7919) % options.num_services);
+	return s;
+}
+
+static int count_expected(db_txn& txn, int16_t sat_pos) {
+	int count = 0;
+	auto c = find_first<service_t>(txn);
+	for (auto s : c.range())
+		count += (s.k.mux.sat_pos == sat_pos && s.media_mode == media_mode_t::TV);
+	return count;
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	fs::remove_all(options.dir);
+	fs::create_directories(options.dir);
+	chdb::chdb_t db;
+	db.open(options.dir.c_str(), false, nullptr, true, 1024 * 1024 * 1024ul);
+	{
+		auto wtxn = db.wtxn();
+		for (int i = 0; i < options.num_services; ++i)
+			put_record(wtxn, make_service(i));
+		wtxn.commit();
+	}
+
+	uint32_t sort_order = uint32_t(service_t::subfield_from_name("name")) << 24;
+	service_t match_data;
+	match_data.k.mux.sat_pos = 1920;
+	match_data.media_mode = media_mode_t::TV;
+	ss::vector<field_matcher_t, 2> eq_matchers;
+	eq_matchers.push_back(field_matcher_t{int8_t(service_t::subfield_from_name("k.mux.sat_pos")),
+			field_matcher_t::match_type_t::EQ});
+	eq_matchers.push_back(field_matcher_t{int8_t(service_t::subfield_from_name("media_mode")),
+			field_matcher_t::match_type_t::EQ});
+
+	//same selection, but with matchers which cannot use the bitmap indexes
+	ss::vector<field_matcher_t, 2> range_matchers;
+	range_matchers.push_back(field_matcher_t{int8_t(service_t::subfield_from_name("k.mux.sat_pos")),
+			field_matcher_t::match_type_t::GEQ});
+	range_matchers.push_back(field_matcher_t{int8_t(service_t::subfield_from_name("media_mode")),
+			field_matcher_t::match_type_t::EQ});
+	ss::vector<field_matcher_t, 1> range_matchers2;
+	range_matchers2.push_back(field_matcher_t{int8_t(service_t::subfield_from_name("k.mux.sat_pos")),
+			field_matcher_t::match_type_t::LEQ});
+
+	auto timed_screen = [&](const char* label, auto& matchers, auto* matchers2) {
+		auto txn = db.rtxn();
+		auto start = steady_clock_t::now();
+		screen_t<service_t> screen(txn, sort_order, service_t::partial_keys_t::none, nullptr, nullptr,
+															 &matchers, &match_data, matchers2, matchers2 ? &match_data : nullptr);
+		auto secs = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+		printf("%-32s %6d services in %8.2fms\n", label, screen.list_size(), secs * 1000);
+		txn.abort();
+		return screen.list_size();
+	};
+
+	int ret = 0;
+	int expected;
+	{
+		auto txn = db.rtxn();
+		expected = count_expected(txn, 1920);
+		txn.abort();
+	}
+	auto scan_count = timed_screen("scan:", range_matchers, &range_matchers2);
+	auto first_count = timed_screen("bitmap (build index):", eq_matchers, (decltype(eq_matchers)*)nullptr);
+	auto second_count = timed_screen("bitmap:", eq_matchers, (decltype(eq_matchers)*)nullptr);
+	if (scan_count != expected || first_count != expected || second_count != expected) {
+		printf("ERROR: expected %d services\n", expected);
+		ret = -1;
+	}
+
+	//change some services, so that the index must be updated from the log
+	{
+		auto wtxn = db.wtxn();
+		for (int i = 0; i < options.num_services; i += 1000) {
+			auto s = make_service(i);
+			s.media_mode = (s.media_mode == media_mode_t::TV) ? media_mode_t::RADIO : media_mode_t::TV;
+			put_record(wtxn, s);
+			if (i % 3000 == 0)
+				delete_record(wtxn, make_service(i + 1));
+		}
+		wtxn.commit();
+		auto txn = db.rtxn();
+		expected = count_expected(txn, 1920);
+		txn.abort();
+	}
+	auto updated_count = timed_screen("bitmap (after update):", eq_matchers, (decltype(eq_matchers)*)nullptr);
+	if (updated_count != expected) {
+		printf("ERROR: expected %d services after update\n", expected);
+		ret = -1;
+	}
+	fs::remove_all(options.dir);
+	return ret;
+}
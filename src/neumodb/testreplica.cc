@@ -0,0 +1,237 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Loopback test for database replicas: an epgdb is served on a local socket and replicated into
+	a second epgdb. Records are written on the server in many small transactions, as during an epg
+	harvest, and the time until the replica has caught up is measured. Finally the replica is
+	compared with the server.
+
+	Usage: testreplica --records 200000 --address unix:/tmp/testreplica.sock
+*/
+
+#include "neumodb/epgdb/epgdb_extra.h"
+#include "neumodb/replica.h"
+#include "util/util.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+struct options_t {
+	std::string dir{"/tmp/testreplica"};
+	std::string address{"unix:/tmp/testreplica.sock"};
+	int num_records{200000};
+	int records_per_txn{100};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB replica test");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for test databases")
+			("address,a", po::value<std::string>(&address)->default_value(address), "Address of replica server")
+			("records,r", po::value<int>(&num_records)->default_value(num_records), "Number of epg records")
+			("records-per-txn,t", po::value<int>(&records_per_txn)->default_value(records_per_txn),
+			 "Number of epg records per write transaction")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static constexpr size_t mapsize = 4 * 1024ul * 1024ul * 1024ul;
+
+static epgdb::epg_record_t make_record(int i, int version) {
+	epgdb::epg_record_t rec;
+	rec.k.service.mux.sat_pos = 1920;
+	rec.k.service.service_id = i % 1000;
+	rec.k.start_time = 1700000000 + (i / 1000) * 1800;
+	rec.k.event_id = i;
+	rec.end_time = rec.k.start_time + 1800;
+	rec.event_name.format("event {:d} version {:d}", i, version);
+	return rec;
+}
+
+static int count_records(epgdb::epgdb_t& db) {
+	int ret = 0;
+	auto txn = db.rtxn();
+	for (auto c = epgdb::find_first<epgdb::epg_record_t>(txn); c.is_valid(); c.next())
+		ret++;
+	txn.commit();
+	return ret;
+}
+
+//wait until the replica has received all transactions of the server; returns the time needed in seconds
+static double wait_for_replica(epgdb::epgdb_t& db, replica_client_t& client) {
+	auto txn = db.rtxn();
+	int64_t txn_id = txn.txn_id();
+	txn.commit();
+	auto start = steady_clock_t::now();
+	while (client.next_txn_id <= txn_id) {
+		if (steady_clock_t::now() - start > std::chrono::seconds(60))
+			return -1;
+		usleep(10000);
+	}
+	return std::chrono::duration<double>(steady_clock_t::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	fs::remove_all(options.dir);
+	fs::create_directories(options.dir);
+	int ret = 0;
+
+	epgdb::epgdb_t server_db;
+	server_db.open((options.dir + "/server.mdb").c_str(), false, nullptr, true, mapsize);
+	epgdb::epgdb_t replica_db;
+	replica_db.open((options.dir + "/replica.mdb").c_str(), false, nullptr, true, mapsize);
+
+	//records which exist before the replica connects are sent as a snapshot
+	{
+		auto wtxn = server_db.wtxn();
+		for (int i = 0; i < options.num_records / 10; ++i)
+			put_record(wtxn, make_record(i, 0));
+		wtxn.commit();
+	}
+
+	replica_server_t server(server_db, options.address);
+	if (server.start() < 0)
+		return -1;
+	replica_client_t client(replica_db, options.address, "test");
+	client.start();
+	auto secs = wait_for_replica(server_db, client);
+	printf("snapshot: %d records in %.2fs\n", count_records(replica_db), secs);
+
+	//harvest: many small write transactions; measure the lag after each second
+	auto start = steady_clock_t::now();
+	auto last_check = start;
+	double max_lag = 0;
+	for (int i = 0; i < options.num_records;) {
+		auto wtxn = server_db.wtxn();
+		for (int j = 0; j < options.records_per_txn && i < options.num_records; ++j, ++i)
+			put_record(wtxn, make_record(i, 1));
+		wtxn.commit();
+		auto now = steady_clock_t::now();
+		if (now - last_check > std::chrono::seconds(1)) {
+			auto rtxn = server_db.rtxn();
+			int64_t txn_id = rtxn.txn_id();
+			rtxn.commit();
+			//time at which the replica receives txn_id, measured from now
+			auto t0 = steady_clock_t::now();
+			while (client.next_txn_id <= txn_id && steady_clock_t::now() - t0 < std::chrono::seconds(10))
+				usleep(1000);
+			max_lag = std::max(max_lag, std::chrono::duration<double>(steady_clock_t::now() - t0).count());
+			last_check = steady_clock_t::now();
+		}
+	}
+	{
+		auto wtxn = server_db.wtxn();
+		for (int i = 0; i < options.num_records; i += 10)
+			delete_record(wtxn, make_record(i, 1));
+		wtxn.commit();
+	}
+	auto harvest_secs = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+	secs = wait_for_replica(server_db, client);
+	max_lag = std::max(max_lag, secs);
+	printf("harvest: %d records in %.2fs; max replica lag %.3fs; %ld batches\n", options.num_records, harvest_secs,
+				 max_lag, (long)client.num_batches);
+	if (secs < 0 || max_lag > 1.0) {
+		printf("ERROR: replica lags too much\n");
+		ret = -1;
+	}
+
+	//compare the replica with the server
+	int num_server = count_records(server_db);
+	int num_replica = count_records(replica_db);
+	int num_different = 0;
+	{
+		auto rtxn = replica_db.rtxn();
+		for (int i = 0; i < options.num_records; ++i) {
+			auto expected = make_record(i, 1);
+			auto c = epgdb::epg_record_t::find_by_key(rtxn, expected.k);
+			bool should_exist = i % 10 != 0;
+			if (c.is_valid() != should_exist || (should_exist && c.current().event_name != expected.event_name))
+				num_different++;
+		}
+		rtxn.commit();
+	}
+	printf("server: %d records; replica: %d records; %d different\n", num_server, num_replica, num_different);
+	if (num_server != num_replica || num_different > 0) {
+		printf("ERROR: replica differs from server\n");
+		ret = -1;
+	}
+
+	client.stop();
+	server.stop();
+
+	/*the replica's position refers to the old server database; a recreated server database
+		starts with lower txn ids, and must be sent as a snapshot*/
+	{
+		epgdb::epgdb_t new_server_db;
+		new_server_db.open((options.dir + "/new_server.mdb").c_str(), false, nullptr, true, mapsize);
+		{
+			auto wtxn = new_server_db.wtxn();
+			for (int i = 0; i < 100; ++i)
+				put_record(wtxn, make_record(i, 2));
+			wtxn.commit();
+		}
+		replica_server_t new_server(new_server_db, options.address);
+		if (new_server.start() < 0)
+			return -1;
+		client.start();
+		auto t0 = steady_clock_t::now();
+		while (count_records(replica_db) != 100 && steady_clock_t::now() - t0 < std::chrono::seconds(10))
+			usleep(10000);
+		int n = count_records(replica_db);
+		printf("recreated server: replica has %d records\n", n);
+		if (n != 100) {
+			printf("ERROR: replica not replaced after server database was recreated\n");
+			ret = -1;
+		}
+		client.stop();
+		new_server.stop();
+	}
+	fs::remove_all(options.dir);
+	if (ret == 0)
+		printf("OK\n");
+	return ret;
+}
@@ -0,0 +1,236 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Benchmark for chdb::service::bulk_upsert. Synthetic SDT sections (as received during a scan of
+	SDT other on a satellite with many muxes) are stored in a chdb, once with a lookup and put_record per
+	service (as active_si_stream_t used to do) and once with bulk_upsert. This is done for a first scan
+	(all services new), a rescan without changes, and a rescan in which some services were renamed.
+	Both databases must have identical contents after each step.
+
+	Usage: testsdtupsert --services 20000 --dir /tmp/testsdtupsert
+*/
+
+#include "neumodb/chdb/chdb_extra.h"
+#include "util/util.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdio.h>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+using namespace chdb;
+
+struct options_t {
+	std::string dir{"/tmp/testsdtupsert"};
+	int num_services{20000};
+	int services_per_mux{40};
+	int services_per_section{16};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB bulk service upsert benchmark");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for test databases")
+			("services,s", po::value<int>(&num_services)->default_value(num_services), "Number of services")
+			("services-per-mux,m", po::value<int>(&services_per_mux)->default_value(services_per_mux),
+			 "Number of services per mux")
+			("services-per-section", po::value<int>(&services_per_section)->default_value(services_per_section),
+			 "Number of services per SDT section")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+struct sdt_section_t {
+	mux_key_t mux_key;
+	ss::vector<service_t, 16> services;
+};
+
+//sections of SDT other for all muxes; services in a section are not necessarily sorted
+static std::vector<sdt_section_t> make_sections(int generation, std::mt19937& rng) {
+	std::vector<sdt_section_t> ret;
+	int num_muxes = (options.num_services + options.services_per_mux - 1) / options.services_per_mux;
+	for (int m = 0; m < num_muxes; ++m) {
+		mux_key_t mux_key;
+		mux_key.sat_pos = 130;
+		mux_key.mux_id = 1 + m;
+		std::vector<service_t> services;
+		for (int i = 0; i < options.services_per_mux && m * options.services_per_mux + i < options.num_services; ++i) {
+			service_t s;
+			s.k.mux = mux_key;
+			s.k.network_id = 318;
+			s.k.ts_id = 100 + m;
+			s.k.service_id = 1000 + m * 100 + i * 2;
+			s.frequency = 10700000 + m * 10000;
+			s.pol = (m % 2) ? fe_polarisation_t::V : fe_polarisation_t::H;
+			s.media_mode = (i % 5 == 4) ? media_mode_t::RADIO : media_mode_t::TV;
+			s.service_type = (i % 5 == 4) ? 2 : 1;
+			//in the rescan with changes, every 20th service is renamed
+			bool renamed = generation >= 2 && (m * options.services_per_mux + i) % 20 == 0;
+			s.name.format("Service {:d}{:s}", m * options.services_per_mux + i, renamed ? " HD" : "");
+			s.provider.format("Provider {:d}", m % 7);
+			services.push_back(s);
+		}
+		//services within a section are usually, but not always, sorted
+		for (int i = 0; i + 1 < (int)services.size(); i += 7)
+			std::swap(services[i], services[i + 1]);
+		for (int i = 0; i < (int)services.size(); i += options.services_per_section) {
+			sdt_section_t section;
+			section.mux_key = mux_key;
+			for (int j = i; j < std::min(i + options.services_per_section, (int)services.size()); ++j)
+				section.services.push_back(services[j]);
+			ret.push_back(section);
+		}
+	}
+	std::shuffle(ret.begin(), ret.end(), rng);
+	return ret;
+}
+
+//the part of the SDT processing in active_si_stream_t which decides if a record must be written
+static bool merge_service(service_t& service, const service_t* db_service, time_t now) {
+	if (!db_service) {
+		service.mtime = now;
+		return true;
+	}
+	auto ch = *db_service;
+	bool changed = ch.name != service.name || ch.provider != service.provider || ch.expired ||
+		ch.media_mode != service.media_mode || ch.service_type != service.service_type ||
+		ch.encrypted != service.encrypted || ch.frequency != service.frequency || ch.pol != service.pol;
+	if (changed) {
+		ch.name = service.name;
+		ch.provider = service.provider;
+		ch.expired = false;
+		ch.media_mode = service.media_mode;
+		ch.service_type = service.service_type;
+		ch.encrypted = service.encrypted;
+		ch.frequency = service.frequency;
+		ch.pol = service.pol;
+		ch.mtime = now;
+	}
+	service = ch;
+	return changed;
+}
+
+//returns number of records written
+static int store_per_service(chdb::chdb_t& db, const std::vector<sdt_section_t>& sections, time_t now) {
+	int num_written{0};
+	for (auto& section : sections) {
+		auto wtxn = db.wtxn(); //one transaction per section, as in active_si_stream_t
+		for (auto service : section.services) {
+			auto c = chdb::service::find_by_mux_key_sid(wtxn, section.mux_key, service.k.service_id);
+			std::optional<service_t> db_service;
+			if (c.is_valid())
+				db_service = c.current();
+			if (merge_service(service, db_service ? &*db_service : nullptr, now)) {
+				put_record(wtxn, service);
+				++num_written;
+			}
+		}
+		wtxn.commit();
+	}
+	return num_written;
+}
+
+static int store_bulk(chdb::chdb_t& db, const std::vector<sdt_section_t>& sections, time_t now) {
+	int num_written{0};
+	for (auto& section : sections) {
+		auto wtxn = db.wtxn();
+		ss::vector<service_t, 16> services = section.services;
+		num_written += chdb::service::bulk_upsert(wtxn, section.mux_key, services,
+																							[now](service_t& service, const service_t* db_service) {
+																								return merge_service(service, db_service, now);
+																							});
+		wtxn.commit();
+	}
+	return num_written;
+}
+
+static bool same_contents(chdb::chdb_t& db1, chdb::chdb_t& db2) {
+	auto txn1 = db1.rtxn();
+	auto txn2 = db2.rtxn();
+	auto c1 = find_first<service_t>(txn1);
+	auto c2 = find_first<service_t>(txn2);
+	std::vector<service_t> s1, s2;
+	for (auto s : c1.range())
+		s1.push_back(s);
+	for (auto s : c2.range())
+		s2.push_back(s);
+	txn1.abort();
+	txn2.abort();
+	return s1 == s2;
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	fs::remove_all(options.dir);
+	fs::create_directories(options.dir / fs::path("per_service"));
+	fs::create_directories(options.dir / fs::path("bulk"));
+	chdb::chdb_t db_per_service;
+	chdb::chdb_t db_bulk;
+	db_per_service.open((options.dir / fs::path("per_service")).c_str(), false, nullptr, true, 1024 * 1024 * 1024ul);
+	db_bulk.open((options.dir / fs::path("bulk")).c_str(), false, nullptr, true, 1024 * 1024 * 1024ul);
+
+	std::mt19937 rng(1);
+	int ret = 0;
+	const char* labels[] = {"first scan:", "rescan, unchanged:", "rescan, 5% renamed:"};
+	for (int generation = 0; generation < 3; ++generation) {
+		auto sections = make_sections(generation, rng);
+		time_t now = 1700000000 + generation;
+
+		auto start = steady_clock_t::now();
+		auto written1 = store_per_service(db_per_service, sections, now);
+		auto secs1 = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+
+		start = steady_clock_t::now();
+		auto written2 = store_bulk(db_bulk, sections, now);
+		auto secs2 = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+
+		printf("%-24s %5d sections: per service %8.2fms (%d written) bulk %8.2fms (%d written)\n",
+					 labels[generation], (int)sections.size(), secs1 * 1000, written1, secs2 * 1000, written2);
+		if (written1 != written2 || !same_contents(db_per_service, db_bulk)) {
+			printf("ERROR: databases differ\n");
+			ret = -1;
+		}
+	}
+	fs::remove_all(options.dir);
+	return ret;
+}
@@ -0,0 +1,201 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Test for the signal history: checks that blocks are decoded exactly as encoded, reports the compression
+	ratio, and checks that a range query at a coarse resolution returns the rollups of the samples written.
+
+	Usage: testsignalhistory --dir /tmp/testsignalhistory --days 2
+*/
+
+#include "neumodb/statdb/signal_history.h"
+#include "util/util.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <stdio.h>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+using namespace statdb::signal_history;
+
+struct options_t {
+	std::string dir{"/tmp/testsignalhistory"};
+	int days{2};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB signal history test");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for test database")
+			("days,n", po::value<int>(&days)->default_value(days), "Number of days of samples to write")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static int num_errors{0};
+
+static void check(bool ok, const char* what) {
+	if (!ok) {
+		printf("ERROR: %s\n", what);
+		num_errors++;
+	}
+}
+
+//slowly varying signal with some noise, as measured by a tuner once per second
+static statdb::signal_stat_entry_t make_sample(time_t t) {
+	statdb::signal_stat_entry_t e;
+	e.snr = 12000 + 100 * ((t / 600) % 7) + 10 * (t % 3);
+	e.signal_strength = -45000 - 10 * ((t / 3600) % 5);
+	e.ber = (t % 97) == 0 ? 1e-6 : 0;
+	return e;
+}
+
+static void test_encoding() {
+	std::vector<bucket_t> buckets;
+	time_t block_start = 1700000000 - 1700000000 % (300 * samples_per_block);
+	for (int i = 0; i < samples_per_block; i += 1 + (i % 5 == 0)) {
+		bucket_t b{block_start + i * 300};
+		for (int j = 0; j < 300; ++j)
+			b.add(make_sample(b.time + j));
+		buckets.push_back(b);
+	}
+	ss::bytebuffer<1024> encoded;
+	encode_block(encoded, buckets.data(), buckets.size(), block_start, 300);
+	std::vector<bucket_t> decoded;
+	int n = decode_block(decoded, (const uint8_t*)encoded.buffer(), encoded.size(), block_start, 300);
+	check(n == (int)buckets.size(), "wrong number of decoded buckets");
+	bool same = n == (int)buckets.size();
+	for (int i = 0; same && i < n; ++i)
+		same = memcmp(&decoded[i], &buckets[i], sizeof(bucket_t)) == 0;
+	check(same, "decoded block differs");
+	printf("encoding: %d buckets in %d bytes (%.1f bytes per bucket; uncompressed %d)\n", n, encoded.size(),
+				 encoded.size() / (double)n, (int)sizeof(bucket_t));
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	fs::remove_all(options.dir);
+	fs::create_directories(options.dir);
+	test_encoding();
+
+	statdb::statdb_t db;
+	db.open(options.dir.c_str());
+	series_key_t key{1920, chdb::fe_polarisation_t::H, 11538000};
+	key.rf_path.card_mac_address = 0x123456;
+	key.rf_path.rf_input = 1;
+	key.rf_path.lnb.dish_id = 0;
+	key.rf_path.lnb.lnb_id = 2;
+
+	time_t start = 1700000000 - 1700000000 % 86400;
+	time_t end = start + options.days * 86400;
+	auto t0 = steady_clock_t::now();
+	writer_t writer;
+	double snr_sum{0};
+	int count{0};
+	for (time_t t = start; t < end; ++t) {
+		auto e = make_sample(t);
+		writer.add(db, key, t, e);
+		snr_sum += e.snr;
+		count++;
+	}
+	writer.close(db);
+	printf("write: %d samples in %.2fs\n", count, std::chrono::duration<double>(steady_clock_t::now() - t0).count());
+
+	t0 = steady_clock_t::now();
+	auto rtxn = db.rtxn();
+	auto result = get_range(rtxn, key.sat_pos, key.pol, key.frequency + 200, start, end, 86400);
+	rtxn.commit();
+	printf("query: %.3fms\n", std::chrono::duration<double>(steady_clock_t::now() - t0).count() * 1e3);
+	check(result.size() == 1, "wrong number of series");
+	if (result.size() == 1) {
+		auto& series = result[0];
+		check((int)series.time.size() == options.days, "wrong number of daily buckets");
+		uint64_t total{0};
+		double snr{0};
+		for (int i = 0; i < (int)series.time.size(); ++i) {
+			total += series.count[i];
+			snr += series.mean[metric_t::snr][i] * series.count[i];
+		}
+		check(total == (uint64_t)count, "samples lost");
+		check(std::abs(snr / total - snr_sum / count) < 1., "wrong mean snr");
+	}
+
+	//after retuning away and back, samples are added to the buckets written before
+	{
+		auto key_a = key;
+		key_a.frequency = 11600000;
+		auto key_b = key;
+		key_b.frequency = 11700000;
+		time_t t = start;
+		writer_t writer;
+		for (; t < start + 1800; ++t)
+			writer.add(db, key_a, t, make_sample(t));
+		for (; t < start + 2400; ++t)
+			writer.add(db, key_b, t, make_sample(t));
+		for (; t < start + 3000; ++t)
+			writer.add(db, key_a, t, make_sample(t));
+		writer.close(db);
+		auto rtxn = db.rtxn();
+		auto result = get_range(rtxn, key_a.sat_pos, key_a.pol, key_a.frequency, start, start + 3600, 3600);
+		rtxn.commit();
+		check(result.size() == 1 && result[0].count.size() == 1 && result[0].count[0] == 2400,
+					"samples lost after retune");
+	}
+
+	//fine resolutions older than their retention time are removed
+	{
+		auto wtxn = db.wtxn();
+		clean(wtxn, end + level_retention[0] + 86400);
+		wtxn.commit();
+		auto rtxn = db.rtxn();
+		auto fine = get_range(rtxn, key.sat_pos, key.pol, key.frequency, start, end, level_resolution[0]);
+		auto coarse = get_range(rtxn, key.sat_pos, key.pol, key.frequency, start, end, level_resolution[2]);
+		rtxn.commit();
+		check(fine.size() == 0, "fine resolution not removed");
+		check(coarse.size() == 1, "coarse resolution removed");
+	}
+
+	db.close();
+	fs::remove_all(options.dir);
+	if (num_errors == 0)
+		printf("OK\n");
+	return num_errors == 0 ? 0 : -1;
+}
@@ -37,6 +37,7 @@
 #include "active_service.h"
 #include "receiver.h"
 #include "streamfilter.h"
+#include "vdvb.h"
 #include "util/neumovariant.h"
 #include "util/template_util.h"
 #include <algorithm>
@@ -491,7 +492,7 @@ int active_adapter_t::open_demux(int mode) const {
 	const int demux_no = 0; // are there any adapters on wwich demux_no!=0? If so how to associate them with frontends?
 	demux_fname.format("{:s}{:d}/demux{:d}", DVB_DEV_PATH, get_adapter_no(), demux_no);
 
-	int fd = ::open(demux_fname.c_str(), mode);
+	int fd = dvb_open(demux_fname.c_str(), mode);
 	return fd;
 }
 
@@ -1126,14 +1127,14 @@ devdb::stream_t active_adapter_t::add_stream
 	pesFilterParams.output = DMX_OUT_TSDEMUX_TAP;//DMX_OUT_TS_TAP;
 	pesFilterParams.pes_type = DMX_PES_OTHER;
 	pesFilterParams.flags = 0; //DMX_IMMEDIATE_START;
-	if(ioctl(fd, DMX_SET_BUFFER_SIZE, dmx_buffer_size)) {
+	if(dvb_ioctl(fd, DMX_SET_BUFFER_SIZE, dmx_buffer_size)) {
 		dterrorf("DMX_SET_BUFFER_SIZE failed: {}", strerror(errno));
 	}
-	if (ioctl(fd, DMX_SET_PES_FILTER, &pesFilterParams) < 0) {
+	if (dvb_ioctl(fd, DMX_SET_PES_FILTER, &pesFilterParams) < 0) {
 		dterrorf("DMX_SET_PES_FILTER  pid={} failed: {}", pid, strerror(errno));
 		return {};
 	}
-	if(ioctl (fd, DMX_START)<0) {
+	if(dvb_ioctl(fd, DMX_START)<0) {
 		dterrorf("DMX_START FAILED: {}", strerror(errno));
 	}
 
@@ -163,6 +163,7 @@ void active_service_t::save_pmt(system_time_t now_, const pmt_info_t& pmt_info)
 	{
 		auto mm = mpm.meta_marker.writeAccess();
 		mm->last_streams = current_streams;
+		mm->structure_changed();
 	}
 }
 
@@ -172,9 +173,10 @@ playback_info_t active_service_t::get_current_program_info() const {
 	ret.service = current_service;
 
 	auto mm = mpm.meta_marker.readAccess();
+	auto pos = mm->live_position.load();
 	ret.start_time = mm->livebuffer_start_time;
-	ret.end_time = mm->livebuffer_end_time;
-	ret.play_time = mm->livebuffer_end_time;
+	ret.end_time = pos.livebuffer_end_time;
+	ret.play_time = pos.livebuffer_end_time;
 	ret.is_recording= false;
 	return ret;
 }
@@ -400,11 +402,15 @@ int service_thread_t::run() {
 		return -1;
 	}
 	for (;;) {
-		auto n = epoll_wait(2000);
+		auto flush_timeout = active_service.mpm.filemap.flush_timeout_ms();
+		auto n = epoll_wait(flush_timeout >= 0 ? std::min(flush_timeout, 2000) : 2000);
 		if (n < 0) {
 			dterrorf("error in poll");
 			continue;
 		}
+		/*io_uring: submit the tail of the data when no more data arrives, e.g., for low bitrate services
+			or after moving data to a new file part*/
+		active_service.mpm.filemap.flush();
 		for (auto evt = next_event(); evt; evt = next_event()) {
 			if (is_event_fd(evt)) {
 				log4cxx::NDC ndc("-CMD");
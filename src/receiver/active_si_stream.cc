@@ -291,10 +291,11 @@ void active_si_stream_t::check_scan_mux_end()
   //note: scans_in_progress is copied (no call by reference)
 	chdbmgr.flush_wtxn();
 	auto scans_in_progress = this->scan_state.scans_in_progress;
+	epg_cache_stats_t epg_cache_stats{eit_service_cache.num_hits, eit_service_cache.num_misses};
 	for(auto& e: scans_in_progress) {
 			auto [scan_id, subscription_id ] = e;
 			assert((int)subscription_id >= 0);
-			receiver.on_scan_mux_end(dbfe, mux, scan_id, subscription_id);
+			receiver.on_scan_mux_end(dbfe, mux, scan_id, subscription_id, epg_cache_stats);
 	}
 	this->scan_state.scans_in_progress.clear();
 }
@@ -788,7 +789,12 @@ void active_si_stream_t::check_timeouts() {
 	out.format(" tuned_mux={}", reader->stream_mux());
 	if (delayed_print || last != out) {
 		if (timedout) {
-			dtdebugf("{}", out);
+			//the cache counters change all the time; they are printed, but not compared with last
+			ss::string<64> cache_stats;
+			if (eit_service_cache.num_hits + eit_service_cache.num_misses > 0)
+				cache_stats.format(" epg_service_cache={:d}(hit)/{:d}(miss)", eit_service_cache.num_hits,
+													 eit_service_cache.num_misses);
+			dtdebugf("{}{}", out, cache_stats);
 			delayed_print = false;
 			last_time = now;
 		} else
@@ -1157,6 +1163,7 @@ void active_si_stream_t::on_wrong_sat() {
 	sdt_data.reset();
 	bat_data.reset();
 	eit_data.reset();
+	eit_service_cache.reset();
 	init(scan_target); // locked=true in case dish is still moving
 	tune_confirmation = saved;
 }
@@ -1980,16 +1987,20 @@ bool nit_data_t::update_nit_completion(scan_state_t& scan_state, const subtable_
 	return done;
 }
 
+/*
+	Merge a service from the SDT with the existing database record db_service (nullptr if not in the database).
+	On return, service contains the record to save.
+	Returns {db_found, changed}; the record must be saved if it is new or changed
+ */
 std::tuple<bool, bool>
-active_si_stream_t::sdt_process_service(db_txn& wtxn, const chdb::service_t& service, mux_data_t* p_mux_data,
-																				bool donotsave, bool is_actual) {
+active_si_stream_t::sdt_process_service(chdb::service_t& service, const chdb::service_t* db_service,
+																				mux_data_t* p_mux_data, bool donotsave, bool is_actual) {
 	chdb::mux_key_t& mux_key = *mux_key_ptr(p_mux_data->mux);
-	auto c = chdb::service::find_by_mux_key_sid(wtxn, mux_key, service.k.service_id);
 	bool db_found{false};
 	bool changed{false};
-	if (c.is_valid()) {
+	if (db_service) {
 		db_found = true;
-		auto ch = c.current();
+		auto ch = *db_service;
 
 		if (service.name != ch.name) {
 			ch.name = service.name;
@@ -2020,13 +2031,12 @@ active_si_stream_t::sdt_process_service(db_txn& wtxn, const chdb::service_t& ser
 			ch.service_type = service.service_type;
 			ch.encrypted = service.encrypted;
 			ch.mtime = system_clock_t::to_time_t(now);
-			if (!donotsave) {
+			if (!donotsave)
 				dtdebugf("SAVING changed service {}", ch);
-				put_record(wtxn, ch);
-			}
 		}
+		service = ch;
 	} else { //no mux yet
-		auto ch = service;
+		auto& ch = service;
 		ch.mtime = system_clock_t::to_time_t(now);
 		ch.k.mux = mux_key;
 		std::visit([&](auto&mux) {
@@ -2035,10 +2045,8 @@ active_si_stream_t::sdt_process_service(db_txn& wtxn, const chdb::service_t& ser
 			ch.pol = pol;
 		}, p_mux_data->mux);
 
-		if (!donotsave) {
+		if (!donotsave)
 			dtdebugf("SAVING new service {}", ch);
-			put_record(wtxn, ch);
-		}
 		if(is_actual) {
 			auto& actual_services = sdt_data.actual_services;
 			actual_services.push_back(ch);
@@ -2062,6 +2070,7 @@ dtdemux::reset_type_t active_si_stream_t::sdt_section_cb_(txn_proxy_t<chdb::chdb
 		// record which services have been found
 		service_ids.clear();
 		sdt_data.actual_services.clear();
+		eit_service_cache.invalidate_mux(services.original_network_id, services.ts_id);
 		if (p_mux_data)
 			nit_data.reset_sdt_completion(scan_state, info, *p_mux_data);
 
@@ -2077,7 +2086,10 @@ dtdemux::reset_type_t active_si_stream_t::sdt_section_cb_(txn_proxy_t<chdb::chdb
 	}
 	int db_found{0};
 	int db_changed{0};
+	//eit uses a different mux key in this case; see eit_section_cb_
+	bool is_wrong_dvb_type = dvb_type(mux_key.sat_pos) != dvb_type(this->stream_mux_key().sat_pos);
 
+	ss::vector<chdb::service_t, 64> section_services;
 	for (auto& service : services.services) {
 		assert(mux_common.ts_id == service.k.ts_id);
 
@@ -2085,12 +2097,26 @@ dtdemux::reset_type_t active_si_stream_t::sdt_section_cb_(txn_proxy_t<chdb::chdb
 			continue;
 		}
 		service_ids.push_back(service.k.service_id);
-
-		auto [db_found_, changed] =
-			sdt_process_service(wtxn, service, p_mux_data, donotsave, is_actual);
-		db_found += db_found_;
-		db_changed += changed;
-	}
+		section_services.push_back(service);
+
+		if (!donotsave && !is_wrong_dvb_type) {
+			chdb::service_key_t service_key;
+			service_key.mux = mux_key;
+			service_key.network_id = services.original_network_id;
+			service_key.ts_id = services.ts_id;
+			service_key.service_id = service.k.service_id;
+			eit_service_cache.add(service_key, service.name);
+		}
+	}
+	//one cursor sweep over the existing services instead of a lookup per service
+	chdb::service::bulk_upsert(wtxn, mux_key, section_services,
+														 [&](chdb::service_t& service, const chdb::service_t* db_service) {
+															 auto [db_found_, changed] =
+																 sdt_process_service(service, db_service, p_mux_data, donotsave, is_actual);
+															 db_found += db_found_;
+															 db_changed += changed;
+															 return !donotsave && (!db_found_ || changed);
+														 });
 
 	if (services.has_freesat_home_epg)
 		p_mux_data->has_freesat_home_epg = true;
@@ -2106,6 +2132,7 @@ dtdemux::reset_type_t active_si_stream_t::sdt_section_cb_(txn_proxy_t<chdb::chdb
 			wtxn.abort();
 			service_ids.clear();
 			sdt_data.reset();
+			eit_service_cache.invalidate_mux(services.original_network_id, services.ts_id);
 			return dtdemux::reset_type_t::RESET;
 		}
 	}
@@ -2170,6 +2197,7 @@ dtdemux::reset_type_t active_si_stream_t::sdt_section_cb_(txn_proxy_t<chdb::chdb
 		wtxn.abort();
 		service_ids.clear();
 		sdt_data.actual_services.clear();
+		eit_service_cache.invalidate_mux(services.original_network_id, services.ts_id);
 	} else {
 		lmdb_hint();
 		wtxn.commit();
@@ -2220,42 +2248,47 @@ dtdemux::reset_type_t active_si_stream_t::eit_section_cb_(epg_t& epg, const subt
 		// service will be looked up later
 	}
 
-	std::optional<chdb::service_t> service;
-	chdb::mux_key_t* p_mux_key{};
-	/*
-		The following yields a child_txn in case we have created a chdb_txn and potentially
-		created some service, otherwise a chdb.rtxn()
-	 */
-	auto chdb_txn = chdbmgr.rtxn();
-	auto* p_mux_data = lookup_mux_data_from_sdt(chdb_txn, epg.service_key.network_id, epg.service_key.ts_id);
-	if(p_mux_data) {
-		epg.service_key.mux = *mux_key_ptr(p_mux_data->mux);
-		p_mux_key = & epg.service_key.mux;
-		bool is_wrong_dvb_type = (dvb_type(p_mux_key->sat_pos) != dvb_type(stream_mux_key->sat_pos));
-		if (is_wrong_dvb_type) {
-			auto done = tune_confirmation.sat_by != confirmed_by_t::NONE;
-			/*Hack: when the mux is for dvb-t and we are tuned to sat, assume that the
-				mux is on the current sat. This will do the right thing for the French multistreams
-				on 5.0W, but may  have unwanted consequences. We hope not...
-			*/
-			if (done)
-				epg.service_key.mux.sat_pos = stream_mux_key->sat_pos;
-			else {
-				dtdebugf("Cannot enter EPG_{:s} records ({:s}), because mux with network_id={:d} and ts_id={:d} has different "
-								 "dvb type and sat not yet confirmed (retrying)",
-								 epg.is_actual ? "ACTUAL" : "OTHER", to_str(epg_type),
-								 epg.service_key.network_id, epg.service_key.ts_id);
-				return done ? dtdemux::reset_type_t::NO_RESET : dtdemux::reset_type_t::RESET;
-			}
-		} else
-			epg.service_key.mux.sat_pos = p_mux_key->sat_pos;
+	auto* service = eit_service_cache.lookup(epg.service_key.network_id, epg.service_key.ts_id,
+																					 epg.service_key.service_id);
+	if (service)
+		epg.service_key = service->service_key;
+	else { //not cached; look up the mux and the service in the database
+		chdb::mux_key_t* p_mux_key{};
+		/*
+			The following yields a child_txn in case we have created a chdb_txn and potentially
+			created some service, otherwise a chdb.rtxn()
+		 */
+		auto chdb_txn = chdbmgr.rtxn();
+		auto* p_mux_data = lookup_mux_data_from_sdt(chdb_txn, epg.service_key.network_id, epg.service_key.ts_id);
+		if(p_mux_data) {
+			epg.service_key.mux = *mux_key_ptr(p_mux_data->mux);
+			p_mux_key = & epg.service_key.mux;
+			bool is_wrong_dvb_type = (dvb_type(p_mux_key->sat_pos) != dvb_type(stream_mux_key->sat_pos));
+			if (is_wrong_dvb_type) {
+				auto done = tune_confirmation.sat_by != confirmed_by_t::NONE;
+				/*Hack: when the mux is for dvb-t and we are tuned to sat, assume that the
+					mux is on the current sat. This will do the right thing for the French multistreams
+					on 5.0W, but may  have unwanted consequences. We hope not...
+				*/
+				if (done)
+					epg.service_key.mux.sat_pos = stream_mux_key->sat_pos;
+				else {
+					dtdebugf("Cannot enter EPG_{:s} records ({:s}), because mux with network_id={:d} and ts_id={:d} has different "
+									 "dvb type and sat not yet confirmed (retrying)",
+									 epg.is_actual ? "ACTUAL" : "OTHER", to_str(epg_type),
+									 epg.service_key.network_id, epg.service_key.ts_id);
+					return done ? dtdemux::reset_type_t::NO_RESET : dtdemux::reset_type_t::RESET;
+				}
+			} else
+				epg.service_key.mux.sat_pos = p_mux_key->sat_pos;
 
-		auto c = chdb::service_t::find_by_key(chdb_txn, epg.service_key.mux, epg.service_key.service_id);
-		if(c.is_valid())
-			service = c.current();
+			auto c = chdb::service_t::find_by_key(chdb_txn, epg.service_key.mux, epg.service_key.service_id);
+			if(c.is_valid())
+				service = eit_service_cache.add(epg.service_key, c.current().name);
 
+		}
+		chdb_txn.abort();
 	}
-	chdb_txn.abort();
 
 	if (!service) {
 		bool done = network_done(epg.service_key.network_id);
@@ -2267,16 +2300,16 @@ dtdemux::reset_type_t active_si_stream_t::eit_section_cb_(epg_t& epg, const subt
 		// assert(!epg.is_sky || p_mux_key->mux_key.network_id == epg_record.k.service.network_id);
 		// assert(!epg.is_sky || p_mux_key->mux_key.ts_id == epg_record.k.service.ts_id);
 		if(!(epg.is_sky || epg.is_mhw2)) {
-			if(epg_record.k.service.network_id != service->k.network_id)
+			if(epg_record.k.service.network_id != service->service_key.network_id)
 				dtdebug_nicef("Unexpected: network_id differs: {} and {}", epg_record.k.service.network_id,
-											service->k.network_id);
-			if(epg_record.k.service.ts_id != service->k.ts_id)
+											service->service_key.network_id);
+			if(epg_record.k.service.ts_id != service->service_key.ts_id)
 				dtdebug_nicef("Unexpected: ts_id differs: {} and {}", epg_record.k.service.ts_id,
-											service->k.ts_id);
-			assert(epg_record.k.service.service_id == service->k.service_id);
+											service->service_key.ts_id);
+			assert(epg_record.k.service.service_id == service->service_key.service_id);
 		}
 
-		epg_record.service_name = service->name;
+		epg_record.service_name = service->service_name;
 		epg_record.k.service = epg.service_key;
 		epg_record.source = epg_source;
 		epg_record.mtime = system_clock_t::to_time_t(now);
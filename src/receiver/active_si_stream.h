@@ -312,6 +312,47 @@ struct eit_data_t {
 
 };
 
+/*
+	Services referred to by eit sections, indexed by network_id, ts_id, service_id.
+	Filled by sdt processing and, on a miss, from chdb, so that eit processing does not need
+	a database lookup for every section. Entries for a mux are removed when its sdt version changes
+*/
+struct eit_service_cache_t {
+	struct entry_t {
+		chdb::service_key_t service_key; //includes the mux key of the service
+		ss::string<16> service_name;
+	};
+
+	std::map<std::tuple<uint16_t, uint16_t, uint16_t>, entry_t> by_service_id;
+	int num_hits{0};
+	int num_misses{0};
+
+	inline const entry_t* lookup(uint16_t network_id, uint16_t ts_id, uint16_t service_id) {
+		auto [it, found] = find_in_map(by_service_id, std::make_tuple(network_id, ts_id, service_id));
+		if (!found) {
+			num_misses++;
+			return nullptr;
+		}
+		num_hits++;
+		return &it->second;
+	}
+
+	inline const entry_t* add(const chdb::service_key_t& service_key, const ss::string_& service_name) {
+		auto& e = by_service_id[std::make_tuple(service_key.network_id, service_key.ts_id, service_key.service_id)];
+		e.service_key = service_key;
+		e.service_name = service_name;
+		return &e;
+	}
+
+	inline void invalidate_mux(uint16_t network_id, uint16_t ts_id) {
+		by_service_id.erase(by_service_id.lower_bound(std::make_tuple(network_id, ts_id, uint16_t{0})),
+												by_service_id.upper_bound(std::make_tuple(network_id, ts_id, uint16_t{0xffff})));
+	}
+
+	void reset() {
+		*this = eit_service_cache_t();
+	}
+};
 
 struct bat_data_t {
 	struct bouquet_data_t  {
@@ -364,6 +405,7 @@ struct active_si_data_t {
 	sdt_data_t sdt_data;
 	bat_data_t bat_data;
 	eit_data_t eit_data;
+	eit_service_cache_t eit_service_cache;
 
 	bool is_embedded_si{false};
 
@@ -595,7 +637,7 @@ class active_si_stream_t final : /*public std::enable_shared_from_this<active_st
 																									dtdemux::reset_type_t ret, bool is_actual,
 																									bool on_wrong_sat, bool done);
 	std::tuple<bool, bool>
-	sdt_process_service(db_txn& wtxn, const chdb::service_t& service, mux_data_t* p_mux_data,
+	sdt_process_service(chdb::service_t& service, const chdb::service_t* db_service, mux_data_t* p_mux_data,
 											bool donotsave, bool is_actual);
 
 	dtdemux::reset_type_t sdt_section_cb_(txn_proxy_t<chdb::chdb_t> & wtxn,
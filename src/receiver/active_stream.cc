@@ -54,6 +54,7 @@
 
 #include "active_adapter.h"
 #include "active_service.h"
+#include "vdvb.h"
 #include "neumo.h"
 #include "filemapper.h"
 #include "streamparser/packetstream.h"
@@ -116,14 +117,14 @@ int dvb_stream_reader_t::open(uint16_t initial_pid, epoll_t* epoll, int epoll_fl
 	pesFilterParams.output = DMX_OUT_TSDEMUX_TAP;//DMX_OUT_TS_TAP;
 	pesFilterParams.pes_type = DMX_PES_OTHER;
 	pesFilterParams.flags = 0; //DMX_IMMEDIATE_START;
-	if(ioctl(demux_fd, DMX_SET_BUFFER_SIZE, dmx_buffer_size)) {
+	if(dvb_ioctl(demux_fd, DMX_SET_BUFFER_SIZE, dmx_buffer_size)) {
 		dterrorf("DMX_SET_BUFFER_SIZE failed: {}", strerror(errno));
 	}
-	if (ioctl(demux_fd, DMX_SET_PES_FILTER, &pesFilterParams) < 0) {
+	if (dvb_ioctl(demux_fd, DMX_SET_PES_FILTER, &pesFilterParams) < 0) {
 		dterrorf("DMX_SET_PES_FILTER  pid={} failed: {}", pid, strerror(errno));
 		return -1;
 	}
-	if(ioctl (demux_fd, DMX_START)<0) {
+	if(dvb_ioctl(demux_fd, DMX_START)<0) {
 		dterrorf("DMX_START FAILED: {}", strerror(errno));
 	}
 
@@ -150,7 +151,7 @@ void dvb_stream_reader_t::close() {
 	}
 	dtdebugf("closing demux_fd={:d}", demux_fd);
 	epoll->remove_fd(demux_fd);
-	if(::close(demux_fd)<0) {
+	if(dvb_close(demux_fd)<0) {
 		dterrorf("Cannot close demux: {}", strerror(errno));
 	} else {
 		dtdebugf("Closed demux_fd");
@@ -318,7 +319,7 @@ void dvb_stream_reader_t::update_stream_mux_nit(const chdb::any_mux_t& stream_mu
 
 
 int dvb_stream_reader_t::add_pid(int pid) {
-	if(ioctl (demux_fd, DMX_ADD_PID, &pid)<0) {
+	if(dvb_ioctl(demux_fd, DMX_ADD_PID, &pid)<0) {
 		dterrorf("DMX_ADD_PID {} FAILED: ", pid, strerror(errno));
 		return -1;
 	}
@@ -327,7 +328,7 @@ int dvb_stream_reader_t::add_pid(int pid) {
 
 
 int dvb_stream_reader_t::remove_pid(int pid) {
-	if(ioctl (demux_fd, DMX_REMOVE_PID, &pid)<0) {
+	if(dvb_ioctl(demux_fd, DMX_REMOVE_PID, &pid)<0) {
 		dterrorf("DMX_REMOVE_PID {} FAILED: {}", pid, strerror(errno));
 		return -1;
 	} else
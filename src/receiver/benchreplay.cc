@@ -0,0 +1,620 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	End to end benchmark of the receiver without dvb hardware. A receiver is started with N virtual adapters
+	(see vdvb.h) replaying the captures in a directory, each of which is tuned to a different capture.
+	SI and EPG are processed as for any tuned mux. On each tuner, M services are viewed: they are written
+	to a livebuffer and read back by a thread, as a player would do.
+
+	Scrambled services are descrambled with static control words, provided by a minimal softcam built
+	into this benchmark. As the descrambler does not check the keys, the cost of descrambling is the same
+	as with the correct keys.
+
+	Reports the latency of tuning (until the first service of the mux is in the database) and of starting
+	a service (until the first data can be read from its livebuffer), throughput, the data dropped by the
+	virtual demuxes because the receiver could not keep up, cpu usage and the number of epg records.
+
+	Captures must be named as described in vdvb.h (e.g., 11538V.ts) and are assumed to be from sat_pos.
+	Usage: benchreplay --captures /data/captures --tuners 4 --services 2 --duration 60
+*/
+
+#include "receiver.h"
+#include "dvbapi.h"
+#include "subscriber.h"
+#include "vdvb.h"
+#include "neumodb/chdb/chdb_extra.h"
+#include "neumodb/devdb/devdb_extra.h"
+#include "neumodb/epgdb/epgdb_extra.h"
+#include "util/util.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <linux/dvb/dmx.h>
+#include <map>
+#include <netinet/in.h>
+#include <poll.h>
+#include <set>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+struct options_t {
+	std::string captures;
+	std::string dir{"/tmp/benchreplay"};
+	std::string logconfig{"neumo.xml"};
+	int num_tuners{4};
+	int num_services{2}; //services viewed per tuner
+	double speed{1.}; //0: as fast as possible
+	int duration{30}; //seconds
+	int sat_pos{1920};
+	int softcam_port{9999};
+	bool no_softcam{false};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB replay benchmark");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("captures,c", po::value<std::string>(&captures)->required(), "Directory containing the captures")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory for databases and livebuffers")
+			("logconfig", po::value<std::string>(&logconfig)->default_value(logconfig), "log4cxx configuration")
+			("tuners,n", po::value<int>(&num_tuners)->default_value(num_tuners),
+			 "Number of virtual tuners; at most one per capture")
+			("services,m", po::value<int>(&num_services)->default_value(num_services), "Number of services per tuner")
+			("speed,s", po::value<double>(&speed)->default_value(speed), "Replay speed (0: as fast as possible)")
+			("duration,t", po::value<int>(&duration)->default_value(duration), "Duration of test in seconds")
+			("sat-pos", po::value<int>(&sat_pos)->default_value(sat_pos), "Satellite of the captures (1/100 degree)")
+			("softcam-port", po::value<int>(&softcam_port)->default_value(softcam_port), "Port of the static softcam")
+			("no-softcam", po::bool_switch(&no_softcam), "Do not descramble")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static constexpr uint8_t static_cw[8] = {0x11, 0x22, 0x33, 0x66, 0x44, 0x55, 0x66, 0xff};
+
+/*
+	Minimal softcam speaking the dvbapi protocol (version 2) as used by scam_t. It requests the ecms of each
+	service in a ca pmt and answers each new ecm with static control words for both parities.
+*/
+class static_softcam_t {
+	struct filter_t {
+		uint8_t adapter_no{0};
+		uint16_t ecm_pid{0};
+		int32_t index{-1};
+		int last_table_id{-1};
+	};
+
+	int listen_fd{-1};
+	std::atomic<bool> must_exit{false};
+	std::thread thread;
+
+	bool read_all(int fd, uint8_t* p, size_t len);
+	void serve(int fd);
+	void run();
+
+public:
+	std::atomic<int64_t> num_ecms{0};
+
+	int start(int port);
+	~static_softcam_t();
+};
+
+static void put(std::vector<uint8_t>& msg, uint32_t val, int size) {
+	for (int i = size - 1; i >= 0; --i)
+		msg.push_back((val >> (8 * i)) & 0xff);
+}
+
+static bool write_all(int fd, const std::vector<uint8_t>& msg) {
+	for (size_t done = 0; done < msg.size();) {
+		auto ret = ::write(fd, msg.data() + done, msg.size() - done);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return false;
+		done += ret;
+	}
+	return true;
+}
+
+//returns false on end of file, error or exit
+bool static_softcam_t::read_all(int fd, uint8_t* p, size_t len) {
+	for (size_t done = 0; done < len;) {
+		pollfd pfd{fd, POLLIN, 0};
+		auto ret = ::poll(&pfd, 1, 100);
+		if (must_exit)
+			return false;
+		if (ret <= 0)
+			continue;
+		auto n = ::read(fd, p + done, len - done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		done += n;
+	}
+	return true;
+}
+
+void static_softcam_t::serve(int fd) {
+	std::map<uint8_t, filter_t> filters; //indexed by filter_no
+	std::map<std::tuple<int, int>, int32_t> indexes; //descrambler per (adapter_no, service_id)
+	uint8_t next_filter_no{0};
+	std::vector<uint8_t> data;
+	for (;;) {
+		uint8_t hdr[4];
+		if (!read_all(fd, hdr, sizeof(hdr)))
+			return;
+		uint32_t opcode = (hdr[0] << 24) | (hdr[1] << 16) | (hdr[2] << 8) | hdr[3];
+		std::vector<uint8_t> reply;
+		if (opcode == DVBAPI_CLIENT_INFO) {
+			uint8_t b[3];
+			if (!read_all(fd, b, sizeof(b)))
+				return;
+			data.resize(b[2]);
+			if (!read_all(fd, data.data(), data.size()))
+				return;
+			const char* name = "benchreplay";
+			put(reply, DVBAPI_SERVER_INFO, 4);
+			put(reply, DVBAPI_PROTOCOL_VERSION, 2);
+			put(reply, strlen(name), 1);
+			reply.insert(reply.end(), name, name + strlen(name));
+		} else if ((opcode & 0xffffff00) == DVBAPI_AOT_CA_PMT) {
+			size_t len = opcode & 0xff;
+			if (len & 0x80) { //length of the length field
+				uint8_t b[4];
+				int n = len & 0x7f;
+				if (n > 4 || !read_all(fd, b, n))
+					return;
+				len = 0;
+				for (int i = 0; i < n; ++i)
+					len = (len << 8) | b[i];
+			}
+			data.resize(len);
+			if (len < 7 || !read_all(fd, data.data(), len))
+				return;
+			auto* p = data.data();
+			int adapter_no{0};
+			int demux_no{0};
+			std::set<uint16_t> ecm_pids;
+			std::vector<uint16_t> es_pids;
+			auto parse_descriptors = [&](size_t start, size_t end) {
+				for (auto i = start; i + 2 <= end && i + 2 + p[i + 1] <= end; i += 2 + p[i + 1]) {
+					if (p[i] == 0x83)
+						adapter_no = p[i + 2];
+					else if (p[i] == 0x86)
+						demux_no = p[i + 2];
+					else if (p[i] == 0x09 && p[i + 1] >= 4) //ca descriptor
+						ecm_pids.insert(((p[i + 4] & 0x1f) << 8) | p[i + 5]);
+				}
+			};
+			int service_id = (p[1] << 8) | p[2];
+			size_t program_info_end = std::min(len, 6 + (((p[4] & 0x0f) << 8) | p[5]));
+			parse_descriptors(7, program_info_end); //skip ca_pmt_cmd_id
+			for (auto i = program_info_end; i + 5 <= len;) {
+				size_t es_info_len = ((p[i + 3] & 0x0f) << 8) | p[i + 4];
+				es_pids.push_back(((p[i + 1] & 0x1f) << 8) | p[i + 2]);
+				parse_descriptors(i + 5, std::min(len, i + 5 + es_info_len));
+				i += 5 + es_info_len;
+			}
+			if (ecm_pids.empty())
+				continue; //not scrambled
+			auto [it, inserted] = indexes.try_emplace(std::make_tuple(adapter_no, service_id), (int32_t)indexes.size());
+			auto index = it->second;
+			for (auto pid : es_pids) {
+				put(reply, DVBAPI_CA_SET_PID, 4);
+				put(reply, adapter_no, 1);
+				put(reply, pid, 4);
+				put(reply, index, 4);
+			}
+			for (auto ecm_pid : ecm_pids) {
+				bool found = std::find_if(filters.begin(), filters.end(), [&](auto& x) {
+					return x.second.adapter_no == adapter_no && x.second.ecm_pid == ecm_pid;
+				}) != filters.end();
+				if (found)
+					continue;
+				auto filter_no = next_filter_no++;
+				filters[filter_no] = filter_t{(uint8_t)adapter_no, ecm_pid, index};
+				put(reply, DVBAPI_DMX_SET_FILTER, 4);
+				put(reply, adapter_no, 1);
+				put(reply, demux_no, 1);
+				put(reply, filter_no, 1);
+				put(reply, ecm_pid, 2);
+				uint8_t filter[3 * DMX_FILTER_SIZE] = {}; //filter, mask and mode
+				filter[0] = 0x80; //ecm, either parity
+				filter[DMX_FILTER_SIZE] = 0xf0;
+				reply.insert(reply.end(), filter, filter + sizeof(filter));
+				put(reply, 0, 4); //timeout
+				put(reply, DMX_IMMEDIATE_START, 4);
+			}
+		} else if (opcode == DVBAPI_FILTER_DATA) {
+			uint8_t b[5]; //demux_no, filter_no and start of section
+			if (!read_all(fd, b, sizeof(b)))
+				return;
+			data.resize(((b[3] & 0x0f) << 8) | b[4]);
+			if (!read_all(fd, data.data(), data.size()))
+				return;
+			auto it = filters.find(b[1]);
+			if (it == filters.end() || it->second.last_table_id == b[2])
+				continue; //ecm was already answered
+			auto& f = it->second;
+			f.last_table_id = b[2];
+			num_ecms++;
+			for (int parity = 0; parity < 2; ++parity) {
+				put(reply, DVBAPI_CA_SET_DESCR, 4);
+				put(reply, f.adapter_no, 1);
+				put(reply, f.index, 4);
+				put(reply, parity, 4);
+				reply.insert(reply.end(), static_cw, static_cw + sizeof(static_cw));
+			}
+		} else if (opcode == DVBAPI_AOT_CA_STOP) {
+			uint8_t b[4];
+			if (!read_all(fd, b, sizeof(b)))
+				return;
+		} else {
+			printf("softcam: unexpected opcode 0x%x\n", opcode);
+			return;
+		}
+		if (!reply.empty() && !write_all(fd, reply))
+			return;
+	}
+}
+
+void static_softcam_t::run() {
+	while (!must_exit) {
+		pollfd pfd{listen_fd, POLLIN, 0};
+		if (::poll(&pfd, 1, 100) <= 0)
+			continue;
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd < 0)
+			continue;
+		serve(fd); //the receiver makes a single connection at a time
+		::close(fd);
+	}
+}
+
+int static_softcam_t::start(int port) {
+	listen_fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	int on = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	sockaddr_in addr{};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (listen_fd < 0 || ::bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || ::listen(listen_fd, 1) < 0) {
+		printf("Cannot start softcam on port %d: %s\n", port, strerror(errno));
+		return -1;
+	}
+	thread = std::thread([this]() { run(); });
+	return 0;
+}
+
+static_softcam_t::~static_softcam_t() {
+	must_exit = true;
+	if (thread.joinable())
+		thread.join();
+	if (listen_fd >= 0)
+		::close(listen_fd);
+}
+
+//a service which is viewed
+struct viewer_t {
+	chdb::service_t service;
+	std::shared_ptr<subscriber_t> subscriber;
+	std::unique_ptr<playback_mpm_t> mpm;
+	std::thread thread;
+	steady_time_t subscribe_time;
+	std::atomic<int64_t> num_bytes{0};
+	std::atomic<int64_t> start_latency{-1}; //ms until first data
+
+	void run() {
+		std::vector<char> buffer(188 * 1024);
+		for (;;) {
+			auto n = mpm->read_data(buffer.data(), buffer.size());
+			if (n < 0)
+				break;
+			if (n > 0 && start_latency < 0)
+				start_latency =
+					std::chrono::duration_cast<std::chrono::milliseconds>(steady_clock_t::now() - subscribe_time).count();
+			num_bytes += n;
+		}
+	}
+};
+
+struct tuner_t {
+	chdb::dvbs_mux_t mux;
+	std::shared_ptr<subscriber_t> subscriber;
+	int64_t tune_latency{-1}; //ms until first service is known
+	std::vector<chdb::service_t> services;
+};
+
+static std::vector<chdb::dvbs_mux_t> find_captures() {
+	std::vector<chdb::dvbs_mux_t> ret;
+	std::error_code ec;
+	for (auto& entry : fs::directory_iterator(options.captures, ec)) {
+		if (entry.path().extension() != ".ts")
+			continue;
+		unsigned int frequency{0};
+		char pol{0};
+		int stream_id{-1};
+		auto n = sscanf(entry.path().stem().c_str(), "%u%c-%d", &frequency, &pol, &stream_id);
+		if (n < 2 || (pol != 'H' && pol != 'V')) {
+			printf("Ignoring %s\n", entry.path().c_str()); //the virtual lnb only has linear polarisation
+			continue;
+		}
+		chdb::dvbs_mux_t mux;
+		mux.k.sat_pos = options.sat_pos;
+		mux.k.stream_id = n == 3 ? stream_id : -1;
+		mux.frequency = frequency < 100000 ? frequency * 1000 : frequency;
+		mux.pol = pol == 'H' ? chdb::fe_polarisation_t::H : chdb::fe_polarisation_t::V;
+		ret.push_back(mux);
+	}
+	std::sort(ret.begin(), ret.end(), [](auto& a, auto& b) { return a.frequency < b.frequency; });
+	return ret;
+}
+
+//waits until the receiver has discovered the virtual adapters
+static std::vector<devdb::fe_t> wait_for_frontends(receiver_t& receiver, int num_tuners) {
+	std::vector<devdb::fe_t> ret;
+	for (int i = 0; i < 100 && (int)ret.size() < num_tuners; ++i) {
+		std::this_thread::sleep_for(100ms);
+		ret.clear();
+		auto rtxn = receiver.devdb.rtxn();
+		auto c = devdb::find_first<devdb::fe_t>(rtxn);
+		for (const auto& fe : c.range()) {
+			if (fe.present && fe.adapter_no >= vdvb_options_t{}.first_adapter_no)
+				ret.push_back(fe);
+		}
+		rtxn.abort();
+	}
+	return ret;
+}
+
+//one universal lnb per virtual adapter, and a mux per capture
+static void setup_databases(receiver_t& receiver, const std::vector<devdb::fe_t>& fes, std::vector<tuner_t>& tuners) {
+	auto chdb_wtxn = receiver.chdb.wtxn();
+	chdb::sat_t sat;
+	sat.sat_pos = options.sat_pos;
+	sat.sat_band = chdb::sat_band_t::Ku;
+	sat.name.format("Replay {:d}", options.sat_pos);
+	put_record(chdb_wtxn, sat);
+	for (auto& t : tuners) {
+		t.mux.c.tune_src = chdb::tune_src_t::TEMPLATE;
+		chdb::make_unique_if_template(chdb_wtxn, t.mux);
+		t.mux.c.tune_src = chdb::tune_src_t::AUTO;
+		put_record(chdb_wtxn, t.mux);
+	}
+	chdb_wtxn.commit();
+
+	auto devdb_wtxn = receiver.devdb.wtxn();
+	for (auto& fe : fes) {
+		devdb::lnb_t lnb;
+		lnb.k.lnb_type = devdb::lnb_type_t::UNIV;
+		lnb.k.lnb_id = devdb::make_unique_id(devdb_wtxn, lnb.k);
+		lnb.usals_pos = options.sat_pos;
+		devdb::lnb_network_t network;
+		network.sat_pos = options.sat_pos;
+		network.usals_pos = options.sat_pos;
+		lnb.networks.push_back(network);
+		devdb::lnb_connection_t conn;
+		conn.card_mac_address = fe.card_mac_address;
+		conn.rf_input = 0;
+		conn.card_no = fe.card_no;
+		conn.connection_name.format("{:s}", fe.adapter_name);
+		lnb.connections.push_back(conn);
+		put_record(devdb_wtxn, lnb);
+	}
+	devdb_wtxn.commit();
+}
+
+//waits until the SI processing has found the services of the mux
+static void wait_for_services(receiver_t& receiver, tuner_t& t, steady_time_t start) {
+	for (int i = 0; i < 200 && (int)t.services.size() < options.num_services; ++i) {
+		std::this_thread::sleep_for(100ms);
+		t.services.clear();
+		auto rtxn = receiver.chdb.rtxn();
+		auto c = chdb::service::find_by_mux_key(rtxn, t.mux.k);
+		for (const auto& s : c.range()) {
+			if (s.k.mux != t.mux.k)
+				break;
+			if (s.expired || s.media_mode != chdb::media_mode_t::TV)
+				continue;
+			if (t.tune_latency < 0)
+				t.tune_latency = std::chrono::duration_cast<std::chrono::milliseconds>(steady_clock_t::now() - start).count();
+			if ((int)t.services.size() < options.num_services)
+				t.services.push_back(s);
+		}
+		rtxn.abort();
+	}
+}
+
+static int64_t percentile(std::vector<int64_t> v, double p) {
+	if (v.size() == 0)
+		return -1;
+	std::sort(v.begin(), v.end());
+	auto idx = std::min(v.size() - 1, (size_t)(p * v.size()));
+	return v[idx];
+}
+
+static double cpu_seconds() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	auto muxes = find_captures();
+	int num_tuners = std::min(options.num_tuners, (int)muxes.size());
+	if (num_tuners == 0) {
+		printf("No captures found in %s\n", options.captures.c_str());
+		return -1;
+	}
+	fs::remove_all(options.dir);
+	auto dir = fs::path(options.dir);
+	fs::create_directories(dir / "db");
+	fs::create_directories(dir / "live");
+
+	static_softcam_t softcam;
+	if (!options.no_softcam && softcam.start(options.softcam_port) < 0)
+		return -1;
+
+	neumo_options_t ro;
+	ro.db_dir = (dir / "db").string();
+	ro.devdb = (dir / "db" / "devdb.mdb").string();
+	ro.chdb = (dir / "db" / "chdb.mdb").string();
+	ro.statdb = (dir / "db" / "statdb.mdb").string();
+	ro.epgdb = (dir / "db" / "epgdb.mdb").string();
+	ro.recdb = (dir / "db" / "recdb.mdb").string();
+	ro.live_path = (dir / "live").string();
+	ro.recordings_path = (dir / "recordings").string();
+	ro.spectrum_path = (dir / "spectrum").string();
+	ro.logconfig = options.logconfig;
+	ro.softcam_server = "127.0.0.1";
+	ro.softcam_port = options.softcam_port;
+	ro.softcam_enabled = !options.no_softcam;
+	ro.virtual_dvb_dir = options.captures;
+	ro.virtual_dvb_num_adapters = num_tuners;
+	ro.virtual_dvb_speed = options.speed;
+	receiver_t receiver(&ro);
+
+	auto fes = wait_for_frontends(receiver, num_tuners);
+	if ((int)fes.size() < num_tuners) {
+		printf("Only %d of %d virtual adapters were found\n", (int)fes.size(), num_tuners);
+		return -1;
+	}
+	std::vector<tuner_t> tuners(num_tuners);
+	for (int i = 0; i < num_tuners; ++i)
+		tuners[i].mux = muxes[i];
+	setup_databases(receiver, fes, tuners);
+
+	//tune all tuners; each keeps processing SI and EPG as long as it is subscribed
+	auto start = steady_clock_t::now();
+	for (auto& t : tuners) {
+		t.subscriber = subscriber_t::make(&receiver, nullptr);
+		if (t.subscriber->subscribe_mux(t.mux, false) < 0)
+			printf("Could not tune to %dkHz\n", t.mux.frequency);
+	}
+	std::vector<std::unique_ptr<viewer_t>> viewers;
+	for (auto& t : tuners) {
+		wait_for_services(receiver, t, start);
+		for (auto& s : t.services) {
+			auto v = std::make_unique<viewer_t>();
+			v->service = s;
+			v->subscriber = subscriber_t::make(&receiver, nullptr);
+			v->subscribe_time = steady_clock_t::now();
+			v->mpm = v->subscriber->subscribe_service_for_viewing(s);
+			if (!v->mpm) {
+				printf("Could not view %s\n", s.name.c_str());
+				continue;
+			}
+			auto* p = v.get();
+			v->thread = std::thread([p]() { p->run(); });
+			viewers.push_back(std::move(v));
+		}
+	}
+
+	auto cpu_start = cpu_seconds();
+	auto stats_start = vdvb::get_stats();
+	auto alloc_stats_start = ss::get_alloc_stats();
+	int64_t bytes_start{0};
+	for (auto& v : viewers)
+		bytes_start += v->num_bytes;
+	start = steady_clock_t::now();
+	std::this_thread::sleep_for(std::chrono::seconds(options.duration));
+	auto wall = std::chrono::duration<double>(steady_clock_t::now() - start).count();
+	auto cpu = cpu_seconds() - cpu_start;
+	auto stats = vdvb::get_stats();
+	auto alloc_stats = ss::get_alloc_stats();
+	int64_t num_bytes_viewed{-bytes_start};
+	for (auto& v : viewers)
+		num_bytes_viewed += v->num_bytes;
+
+	std::vector<int64_t> tune_latencies;
+	std::vector<int64_t> start_latencies;
+	for (auto& t : tuners)
+		tune_latencies.push_back(t.tune_latency);
+	for (auto& v : viewers)
+		start_latencies.push_back(v->start_latency);
+	int64_t num_epg_records{0};
+	{
+		auto rtxn = receiver.epgdb.rtxn();
+		for (auto c = epgdb::find_first<epgdb::epg_record_t>(rtxn); c.is_valid(); c.next())
+			num_epg_records++;
+		rtxn.abort();
+	}
+
+	for (auto& v : viewers) {
+		v->mpm->force_abort();
+		v->thread.join();
+		v->mpm->close();
+		v->mpm.reset();
+		v->subscriber->unsubscribe();
+	}
+	for (auto& t : tuners)
+		t.subscriber->unsubscribe();
+
+	auto sent = stats.num_bytes_sent - stats_start.num_bytes_sent;
+	auto dropped = stats.num_bytes_dropped - stats_start.num_bytes_dropped;
+	printf("tuners=%d services=%d speed=%.1f softcam=%d\n", num_tuners, (int)viewers.size(), options.speed,
+				 !options.no_softcam);
+	printf("tune latency (ms): p50=%ld max=%ld (-1: no services found)\n", percentile(tune_latencies, 0.5),
+				 percentile(tune_latencies, 1.));
+	printf("service start latency (ms): p50=%ld p90=%ld max=%ld\n", percentile(start_latencies, 0.5),
+				 percentile(start_latencies, 0.9), percentile(start_latencies, 1.));
+	printf("replayed=%ldMB (%.1f MB/s) dropped=%ldkB viewed=%ldMB (%.1f MB/s)\n", sent / (1024 * 1024),
+				 sent / wall / (1024 * 1024), dropped / 1024, num_bytes_viewed / (1024 * 1024),
+				 num_bytes_viewed / wall / (1024 * 1024));
+	printf("cpu=%.1f%% of one core\n", 100. * cpu / wall);
+	printf("epg_records=%ld ecms=%ld\n", num_epg_records, (int64_t)softcam.num_ecms);
+	//overflow buffers of ss::string and ss::vector, in all receiver threads
+	printf("string/vector buffers: heap=%ld arena=%ld (%ldkB)\n",
+				 alloc_stats.num_heap_allocs - alloc_stats_start.num_heap_allocs,
+				 alloc_stats.num_arena_allocs - alloc_stats_start.num_arena_allocs,
+				 (alloc_stats.num_arena_bytes - alloc_stats_start.num_arena_bytes) / 1024);
+	return 0;
+}
@@ -0,0 +1,79 @@
+#!/usr/bin/python3
+# Benchmark for the pyspectrum helpers used by the spectrum dialog, on saved spectra
+# (<spectrum_path>/<sat>/..._spectrum.dat). Compares
+#  -find_annot_locations with the old O(n.w) per annotation window maxima and the O(n) sliding maxima
+#  -find_spectral_peaks called for each spectrum in turn and find_spectral_peaks_multi
+# and checks that the results are identical
+import sys
+import os
+import glob
+import time
+import argparse
+import numpy as np
+sys.path.insert(0, '../../x86_64/target/lib64/')
+sys.path.insert(0, '../../build/src/receiver')
+sys.path.insert(0, '../../build/src/stackstring/')
+sys.path.insert(0, '../../gui/')
+import pyspectrum
+
+parser = argparse.ArgumentParser(description='benchmark pyspectrum')
+parser.add_argument('--spectrum-path', default=None, help='directory with saved spectra')
+parser.add_argument('--max-spectra', type=int, default=16, help='maximum number of spectra to use')
+parser.add_argument('--annot-width', type=float, default=30., help='width of annotation box in MHz')
+parser.add_argument('--repeat', type=int, default=5, help='number of repetitions')
+parser.add_argument('--threads', type=int, default=0, help='threads for find_spectral_peaks_multi (0=all)')
+args = parser.parse_args()
+
+if args.spectrum_path is None:
+    from neumodvb.config import options
+    args.spectrum_path = options.spectrum_path
+
+fnames = sorted(glob.glob(f'{args.spectrum_path}/*/*_spectrum.dat'))[:args.max_spectra]
+if len(fnames) == 0:
+    print(f'No spectra found in {args.spectrum_path}')
+    sys.exit(-1)
+specs = [np.atleast_2d(np.loadtxt(fname)) for fname in fnames]
+freqs = [np.ascontiguousarray(spec[:,0], dtype=np.float32) for spec in specs]
+sigs = [np.ascontiguousarray(spec[:,1], dtype=np.float32) for spec in specs]
+print(f'{len(specs)} spectra; {sum(len(f) for f in freqs)} samples')
+
+def timeit(f):
+    best = None
+    for _ in range(args.repeat):
+        t = time.perf_counter()
+        ret = f()
+        t = time.perf_counter() - t
+        best = t if best is None else min(best, t)
+    return best, ret
+
+#peak detection
+def serial():
+    return [pyspectrum.find_spectral_peaks(f, s) for f, s in zip(freqs, sigs)]
+
+def parallel():
+    return pyspectrum.find_spectral_peaks_multi(freqs, sigs, args.threads)
+
+t_serial, peaks_serial = timeit(serial)
+t_parallel, peaks_parallel = timeit(parallel)
+same = all(np.array_equal(a[0], b[0]) and np.array_equal(a[1], b[1]) for a, b in zip(peaks_serial, peaks_parallel))
+print(f'find_spectral_peaks: serial={t_serial*1e3:.1f}ms parallel={t_parallel*1e3:.1f}ms '
+      f'speedup={t_serial/t_parallel:.2f} same={same}')
+
+#annotation placement, as in neumoplot.py
+def annots(use_sliding_max):
+    ret = []
+    for f, s, (peak_freq, peak_sr) in zip(freqs, sigs, peaks_serial):
+        xscale = (len(f) - 1) / (f[-1] - f[0])
+        idxs = np.searchsorted(f, peak_freq, side='left').astype(np.int32)
+        idxs = np.minimum(idxs, len(f) - 1)
+        h = 2.
+        ret.append(pyspectrum.find_annot_locations(s, idxs, peak_freq, int(args.annot_width * xscale),
+                                                   int(h * 2 * 1000), h * 1.5 * 1000,
+                                                   use_sliding_max=use_sliding_max))
+    return ret
+
+t_old, annot_old = timeit(lambda: annots(False))
+t_new, annot_new = timeit(lambda: annots(True))
+same = all(np.array_equal(a[0], b[0]) and np.array_equal(a[1], b[1]) for a, b in zip(annot_old, annot_new))
+print(f'find_annot_locations: windowed={t_old*1e3:.1f}ms sliding={t_new*1e3:.1f}ms '
+      f'speedup={t_old/t_new:.2f} same={same}')
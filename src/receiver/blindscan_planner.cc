@@ -0,0 +1,391 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "blindscan_planner.h"
+#include "util/dtassert.h"
+#include "util/logger.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <queue>
+
+blindscan_topology_t make_blindscan_topology(db_txn& devdb_rtxn, const std::vector<blindscan_band_t>& bands) {
+	blindscan_topology_t ret;
+	std::map<std::tuple<int64_t, int>, int> cable_ids; //(card_mac_address, rf_input) or (-1, rf_coupler_id)
+	std::map<int, int> dish_ids;
+
+	auto cl = devdb::find_first<devdb::lnb_t>(devdb_rtxn);
+	for (const auto& lnb : cl.range()) {
+		if (!lnb.enabled || !lnb.can_be_used)
+			continue;
+		for (const auto& conn : lnb.connections) {
+			if (!conn.enabled || !conn.can_be_used)
+				continue;
+			blindscan_path_t path;
+			path.rf_path = devdb::rf_path_for_connection(lnb.k, conn);
+			path.bands.resize(bands.size());
+			bool usable{false};
+			for (int i = 0; i < (int)bands.size(); ++i) {
+				auto& band = bands[i];
+				chdb::sat_t sat;
+				sat.sat_pos = band.sat_pos;
+				sat.sat_band = band.sat_band;
+				chdb::band_scan_t band_scan;
+				band_scan.pol = band.pol;
+				band_scan.sat_band = band.sat_band;
+				band_scan.sat_sub_band = band.sub_band;
+				path.bands[i] = devdb::lnb_can_scan_sat_band(lnb, sat, band_scan, false /*disregard_networks*/);
+				usable |= path.bands[i];
+			}
+			if (!usable)
+				continue;
+			auto cable_key = conn.rf_coupler_id >= 0 ? std::tuple<int64_t, int>{-1, conn.rf_coupler_id}
+				: std::tuple<int64_t, int>{conn.card_mac_address, conn.rf_input};
+			path.cable = cable_ids.try_emplace(cable_key, (int)cable_ids.size()).first->second;
+			if (lnb.on_positioner)
+				path.dish = dish_ids.try_emplace(lnb.k.dish_id, (int)dish_ids.size()).first->second;
+			ret.paths.push_back(path);
+		}
+	}
+
+	auto cf = devdb::find_first<devdb::fe_t>(devdb_rtxn);
+	for (const auto& fe : cf.range()) {
+		if (!fe.present || !fe.can_be_used || !fe.enable_dvbs)
+			continue;
+		blindscan_tuner_t tuner;
+		tuner.fe_key = fe.k;
+		tuner.adapter_no = fe.adapter_no;
+		tuner.can_sweep = fe.supports.spectrum_sweep || fe.supports.spectrum_fft;
+		for (int i = 0; i < (int)ret.paths.size(); ++i) {
+			auto& rf_path = ret.paths[i].rf_path;
+			if (rf_path.card_mac_address != fe.card_mac_address)
+				continue;
+			for (auto rf_input : fe.rf_inputs) {
+				if (rf_input == rf_path.rf_input) {
+					tuner.paths.push_back(i);
+					break;
+				}
+			}
+		}
+		if (!tuner.paths.empty())
+			ret.tuners.push_back(tuner);
+	}
+	return ret;
+}
+
+blindscan_planner_t::blindscan_planner_t(const blindscan_topology_t& topology,
+																				 const std::vector<blindscan_band_t>& bands_,
+																				 const blindscan_cost_model_t& cost_model)
+	: topology(topology)
+	, cost_model(cost_model)
+	, tuner_busy(topology.tuners.size(), false) {
+	int num_cables{0};
+	int num_dishes{0};
+	for (auto& path : topology.paths) {
+		assert((int)path.bands.size() == (int)bands_.size());
+		num_cables = std::max(num_cables, path.cable + 1);
+		num_dishes = std::max(num_dishes, path.dish + 1);
+	}
+	cables.resize(num_cables);
+	dishes.resize(num_dishes);
+	bands.reserve(bands_.size());
+	for (auto& band : bands_)
+		bands.push_back(band_state_t{band});
+}
+
+/*
+	Check if path can be used for band now, given the jobs in progress
+*/
+bool blindscan_planner_t::is_compatible(int path, const blindscan_band_t& band,
+																				bool& needs_switch, bool& needs_dish_move) const {
+	auto& p = topology.paths[path];
+	auto& c = cables[p.cable];
+	needs_switch = c.path != path || c.pol != band.pol || c.sub_band != band.sub_band || c.sat_pos != band.sat_pos;
+	if (c.users > 0 && needs_switch)
+		return false;
+	needs_dish_move = false;
+	if (p.dish >= 0) {
+		auto& d = dishes[p.dish];
+		needs_dish_move = d.sat_pos != band.sat_pos;
+		if (d.users > 0 && needs_dish_move)
+			return false;
+	}
+	return true;
+}
+
+/*
+	Check if tuning the cable of path to band_idx would delay queued peaks of another band using the same cable
+*/
+bool blindscan_planner_t::cable_has_other_peaks(int path, int band_idx) const {
+	auto cable = topology.paths[path].cable;
+	auto& band = bands[band_idx].band;
+	for (auto& other : bands) {
+		if (other.peaks.empty() || topology.paths[other.path].cable != cable)
+			continue;
+		if (other.path != path || other.band.pol != band.pol || other.band.sub_band != band.sub_band ||
+				other.band.sat_pos != band.sat_pos)
+			return true;
+	}
+	return false;
+}
+
+void blindscan_planner_t::acquire(const blindscan_job_t& job) {
+	auto& band = bands[job.band];
+	auto& p = topology.paths[job.path];
+	tuner_busy[job.tuner] = true;
+	auto& c = cables[p.cable];
+	c.users++;
+	c.path = job.path;
+	c.pol = band.band.pol;
+	c.sub_band = band.band.sub_band;
+	c.sat_pos = band.band.sat_pos;
+	if (p.dish >= 0) {
+		auto& d = dishes[p.dish];
+		d.users++;
+		d.sat_pos = band.band.sat_pos;
+	}
+	if (job.type == blindscan_job_t::type_t::SWEEP) {
+		band.sweeping = true;
+		band.path = job.path;
+	} else
+		band.active_peaks++;
+}
+
+void blindscan_planner_t::release(const blindscan_job_t& job) {
+	auto& p = topology.paths[job.path];
+	assert(tuner_busy[job.tuner]);
+	tuner_busy[job.tuner] = false;
+	cables[p.cable].users--;
+	if (p.dish >= 0)
+		dishes[p.dish].users--;
+}
+
+double blindscan_planner_t::expected_peaks_per_mhz() const {
+	//the initial estimate counts as much as a 100 MHz sweep
+	const double prior_mhz = 100.;
+	return (num_found_peaks + cost_model.peaks_per_mhz * prior_mhz) / (swept_mhz + prior_mhz);
+}
+
+/*
+	Number of queued peaks above which tuners which can sweep start tuning peaks instead of sweeping
+	more bands
+*/
+int blindscan_planner_t::max_peak_backlog() const {
+	return std::max(2, 2 * (int)topology.tuners.size());
+}
+
+std::optional<blindscan_job_t> blindscan_planner_t::next_job(int tuner_idx, double now) {
+	assert(!tuner_busy[tuner_idx]);
+	auto& tuner = topology.tuners[tuner_idx];
+	bool needs_switch{false};
+	bool needs_dish_move{false};
+
+	//peak which can be tuned with the least overhead; bands are considered in order
+	std::optional<blindscan_job_t> peak_job;
+	int peak_cost{std::numeric_limits<int>::max()};
+	for (int b = 0; b < (int)bands.size(); ++b) {
+		auto& band = bands[b];
+		if (band.peaks.empty() ||
+				std::find(tuner.paths.begin(), tuner.paths.end(), band.path) == tuner.paths.end())
+			continue;
+		if (!is_compatible(band.path, band.band, needs_switch, needs_dish_move))
+			continue;
+		int cost = 2 * needs_dish_move + needs_switch;
+		if (cost < peak_cost) {
+			peak_cost = cost;
+			peak_job = blindscan_job_t{blindscan_job_t::type_t::PEAK, tuner_idx, band.path, b, band.peaks.back(),
+				needs_switch, needs_dish_move, now};
+		}
+	}
+
+	//band which can be swept with the least overhead
+	std::optional<blindscan_job_t> sweep_job;
+	bool sweep_delays_peaks{false};
+	int sweep_cost{std::numeric_limits<int>::max()};
+	for (int b = 0; tuner.can_sweep && b < (int)bands.size(); ++b) {
+		auto& band = bands[b];
+		if (band.swept || band.sweeping)
+			continue;
+		for (auto path : tuner.paths) {
+			if (!topology.paths[path].bands[b] || !is_compatible(path, band.band, needs_switch, needs_dish_move))
+				continue;
+			bool delays_peaks = cable_has_other_peaks(path, b);
+			int cost = 4 * delays_peaks + 2 * needs_dish_move + needs_switch;
+			if (cost < sweep_cost) {
+				sweep_cost = cost;
+				sweep_delays_peaks = delays_peaks;
+				sweep_job = blindscan_job_t{blindscan_job_t::type_t::SWEEP, tuner_idx, path, b, {},
+					needs_switch, needs_dish_move, now};
+			}
+		}
+	}
+
+	/*
+		Sweeping produces work for the other tuners, so it is preferred unless it would block
+		the cable for queued peaks, or unless there is already plenty of work
+	*/
+	std::optional<blindscan_job_t> ret;
+	if (sweep_job && peak_job)
+		ret = (sweep_delays_peaks || num_queued_peaks >= max_peak_backlog()) ? peak_job : sweep_job;
+	else
+		ret = sweep_job ? sweep_job : peak_job;
+	if (!ret)
+		return ret;
+	if (ret->type == blindscan_job_t::type_t::PEAK) {
+		bands[ret->band].peaks.pop_back();
+		num_queued_peaks--;
+	}
+	acquire(*ret);
+	return ret;
+}
+
+void blindscan_planner_t::sweep_done(const blindscan_job_t& job, const std::vector<blindscan_peak_t>& peaks) {
+	assert(job.type == blindscan_job_t::type_t::SWEEP);
+	release(job);
+	auto& band = bands[job.band];
+	band.sweeping = false;
+	band.swept = true;
+	band.peaks = peaks;
+	//peaks are tuned from the back
+	std::reverse(band.peaks.begin(), band.peaks.end());
+	num_queued_peaks += peaks.size();
+	num_found_peaks += peaks.size();
+	swept_mhz += band.band.width_mhz();
+}
+
+void blindscan_planner_t::peak_done(const blindscan_job_t& job, bool locked) {
+	assert(job.type == blindscan_job_t::type_t::PEAK);
+	release(job);
+	bands[job.band].active_peaks--;
+}
+
+bool blindscan_planner_t::done() const {
+	if (num_queued_peaks > 0)
+		return false;
+	for (auto busy : tuner_busy)
+		if (busy)
+			return false;
+	for (int b = 0; b < (int)bands.size(); ++b) {
+		if (bands[b].swept)
+			continue;
+		for (auto& tuner : topology.tuners) {
+			if (!tuner.can_sweep)
+				continue;
+			for (auto path : tuner.paths)
+				if (topology.paths[path].bands[b])
+					return false;
+		}
+	}
+	return true;
+}
+
+blindscan_plan_stats_t blindscan_planner_t::project() const {
+	for (auto busy : tuner_busy) {
+		assert(!busy);
+	}
+	auto planner = *this;
+	blindscan_estimator_t estimator(cost_model, expected_peaks_per_mhz());
+	return run_blindscan_plan(planner, estimator);
+}
+
+double blindscan_estimator_t::overhead(const blindscan_job_t& job) const {
+	return (job.needs_switch ? cost_model.switch_seconds : 0.) +
+		(job.needs_dish_move ? cost_model.dish_move_seconds : 0.);
+}
+
+double blindscan_estimator_t::sweep(const blindscan_job_t& job, const blindscan_band_t& band,
+																		std::vector<blindscan_peak_t>& peaks) {
+	auto width = band.width_mhz();
+	int num_peaks = std::lround(width * peaks_per_mhz);
+	peaks.clear();
+	for (int i = 0; i < num_peaks; ++i)
+		peaks.push_back({band.start_freq + (int32_t)((i + 0.5) * (band.end_freq - band.start_freq) / num_peaks),
+				27500000});
+	return overhead(job) + width * cost_model.sweep_seconds_per_mhz;
+}
+
+double blindscan_estimator_t::tune_peak(const blindscan_job_t& job, const blindscan_band_t& band, bool& locked) {
+	locked = true;
+	return overhead(job) + cost_model.peak_seconds;
+}
+
+blindscan_plan_stats_t run_blindscan_plan(blindscan_planner_t& planner, blindscan_executor_t& executor,
+																					double start_time) {
+	struct event_t {
+		double end_time{0};
+		blindscan_job_t job;
+		std::vector<blindscan_peak_t> peaks; //result of a sweep
+		bool locked{false}; //result of tuning a peak
+	};
+	auto later = [](const event_t& a, const event_t& b) {
+		return a.end_time > b.end_time;
+	};
+	std::priority_queue<event_t, std::vector<event_t>, decltype(later)> events(later);
+
+	auto num_tuners = planner.get_topology().tuners.size();
+	std::vector<bool> busy(num_tuners, false);
+	blindscan_plan_stats_t stats;
+	stats.busy_time.resize(num_tuners);
+	stats.sweep_start_time.resize(planner.num_bands(), -1.);
+	stats.sweep_path.resize(planner.num_bands(), -1);
+	double now = start_time;
+	for (;;) {
+		for (int t = 0; t < (int)num_tuners; ++t) {
+			if (busy[t])
+				continue;
+			auto job = planner.next_job(t, now);
+			if (!job)
+				continue;
+			event_t e{now, *job};
+			auto& band = planner.get_band(job->band);
+			e.end_time += job->type == blindscan_job_t::type_t::SWEEP ? executor.sweep(*job, band, e.peaks)
+				: executor.tune_peak(*job, band, e.locked);
+			busy[t] = true;
+			stats.busy_time[t] += e.end_time - now;
+			stats.num_switches += job->needs_switch;
+			stats.num_dish_moves += job->needs_dish_move;
+			if (job->type == blindscan_job_t::type_t::SWEEP) {
+				stats.sweep_start_time[job->band] = now - start_time;
+				stats.sweep_path[job->band] = job->path;
+			}
+			events.push(std::move(e));
+		}
+		if (events.empty())
+			break;
+		auto e = events.top();
+		events.pop();
+		now = e.end_time;
+		busy[e.job.tuner] = false;
+		if (e.job.type == blindscan_job_t::type_t::SWEEP) {
+			stats.num_sweeps++;
+			planner.sweep_done(e.job, e.peaks);
+		} else {
+			stats.num_peaks++;
+			stats.num_locked_peaks += e.locked;
+			planner.peak_done(e.job, e.locked);
+		}
+	}
+	stats.num_unreachable_bands = planner.num_bands() - stats.num_sweeps;
+	stats.duration = now - start_time;
+	if (!planner.done())
+		dterrorf("Blindscan plan ended with work left");
+	return stats;
+}
@@ -0,0 +1,243 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include "neumodb/devdb/devdb_extra.h"
+#include <optional>
+#include <vector>
+
+/*
+	Planning of blindscans over multiple tuners.
+
+	A blindscan consists of spectrum sweeps of (sat, pol, band) combinations. Each sweep produces spectral
+	peaks, which must then be tuned on the rf_path on which the spectrum was acquired. The planner assigns
+	these jobs to tuners, taking into account which tuners can reach which lnbs and the restrictions
+	caused by sharing hardware:
+	-all tuners using the same cable (a card rf input, or a set of rf inputs on the same rf_coupler) must use
+	 the same lnb, sat, pol and band at the same time
+	-all lnbs on the same dish with a positioner must use the same sat at the same time
+
+	Spectrum acquisition is pipelined with peak tuning: tuners which can acquire spectra keep sweeping as long
+	as there are not too many peaks waiting to be tuned, while the other tuners tune the peaks found so far.
+
+	The planner does not perform any tuning itself. Jobs are executed by a blindscan_executor_t, which can
+	be an estimator (to compute the projected duration of a blindscan) or a simulated frontend (to test
+	the planner against recorded spectra).
+*/
+
+struct blindscan_peak_t {
+	int32_t frequency{0}; //kHz
+	int32_t symbol_rate{0}; //symbols per second
+};
+
+//one spectrum sweep
+struct blindscan_band_t {
+	int16_t sat_pos{sat_pos_none};
+	chdb::sat_band_t sat_band{chdb::sat_band_t::UNKNOWN};
+	chdb::sat_sub_band_t sub_band{chdb::sat_sub_band_t::NONE};
+	chdb::fe_polarisation_t pol{chdb::fe_polarisation_t::NONE};
+	int32_t start_freq{0}; //kHz
+	int32_t end_freq{0}; //kHz
+
+	inline double width_mhz() const {
+		return (end_freq - start_freq) * 1e-3;
+	}
+};
+
+//a way of reaching an lnb from a card input
+struct blindscan_path_t {
+	devdb::rf_path_t rf_path;
+	int cable{-1}; //paths with the same cable must be tuned to the same lnb, sat, pol and band
+	int dish{-1}; //paths on the same movable dish must be tuned to the same sat; -1 for a fixed dish
+	std::vector<bool> bands; //bands[i] is true if the path can be used to scan band i
+};
+
+struct blindscan_tuner_t {
+	devdb::fe_key_t fe_key;
+	int16_t adapter_no{-1};
+	bool can_sweep{false}; //can acquire spectra
+	std::vector<int> paths; //indices of the paths which the tuner can use
+};
+
+struct blindscan_topology_t {
+	std::vector<blindscan_path_t> paths;
+	std::vector<blindscan_tuner_t> tuners;
+};
+
+/*
+	Usable tuners and paths from devdb, for scanning the given bands
+*/
+blindscan_topology_t make_blindscan_topology(db_txn& devdb_rtxn, const std::vector<blindscan_band_t>& bands);
+
+/*
+	Expected durations, used for projecting the duration of a blindscan. The defaults are typical for
+	sweeping with a stid135 card
+*/
+struct blindscan_cost_model_t {
+	double sweep_seconds_per_mhz{0.01};
+	double peak_seconds{6.}; //tuning a peak and waiting for si data
+	double peaks_per_mhz{0.03}; //initial guess; updated from the sweeps performed so far
+	double switch_seconds{0.5}; //changing lnb, pol or band (diseqc, voltage, tone)
+	double dish_move_seconds{20.}; //moving a dish to another sat
+};
+
+struct blindscan_job_t {
+	enum class type_t : int8_t {
+		SWEEP, //acquire the spectrum of a band
+		PEAK //tune a peak found by a sweep
+	};
+	type_t type{type_t::SWEEP};
+	int tuner{-1};
+	int path{-1};
+	int band{-1};
+	blindscan_peak_t peak; //for PEAK jobs
+	bool needs_switch{false}; //the cable must switch to another lnb, pol or band first
+	bool needs_dish_move{false}; //the dish must move first
+	double start_time{0};
+};
+
+struct blindscan_plan_stats_t {
+	int num_sweeps{0};
+	int num_peaks{0};
+	int num_locked_peaks{0};
+	int num_switches{0};
+	int num_dish_moves{0};
+	int num_unreachable_bands{0}; //bands which no tuner can scan
+	double duration{0}; //seconds from start to end of the last job
+	std::vector<double> busy_time; //per tuner, seconds
+	std::vector<double> sweep_start_time; //per band, seconds from start; -1 if the band is not swept
+	std::vector<int> sweep_path; //per band, index in topology.paths of the path used for the sweep; -1 if not swept
+};
+
+class blindscan_planner_t {
+	struct band_state_t {
+		blindscan_band_t band;
+		bool swept{false};
+		bool sweeping{false};
+		int path{-1}; //path used for the sweep, on which the peaks must be tuned
+		std::vector<blindscan_peak_t> peaks; //peaks still to be tuned
+		int active_peaks{0}; //peaks being tuned
+	};
+
+	struct cable_state_t {
+		int users{0};
+		int path{-1}; //path (lnb) the cable is tuned to
+		chdb::fe_polarisation_t pol{chdb::fe_polarisation_t::NONE};
+		chdb::sat_sub_band_t sub_band{chdb::sat_sub_band_t::NONE};
+		int16_t sat_pos{sat_pos_none};
+	};
+
+	struct dish_state_t {
+		int users{0};
+		int16_t sat_pos{sat_pos_none};
+	};
+
+	blindscan_topology_t topology;
+	blindscan_cost_model_t cost_model;
+	std::vector<band_state_t> bands;
+	std::vector<cable_state_t> cables;
+	std::vector<dish_state_t> dishes;
+	std::vector<bool> tuner_busy;
+	int num_queued_peaks{0};
+	double swept_mhz{0}; //for updating the estimate of peaks_per_mhz
+	int num_found_peaks{0};
+
+	bool is_compatible(int path, const blindscan_band_t& band, bool& needs_switch, bool& needs_dish_move) const;
+	bool cable_has_other_peaks(int path, int band_idx) const;
+	void acquire(const blindscan_job_t& job);
+	void release(const blindscan_job_t& job);
+
+public:
+	blindscan_planner_t(const blindscan_topology_t& topology, const std::vector<blindscan_band_t>& bands,
+											const blindscan_cost_model_t& cost_model = {});
+
+	/*
+		Select the next job for an idle tuner and mark the resources it needs as in use.
+		Returns nothing if the tuner should remain idle until some other job ends
+	*/
+	std::optional<blindscan_job_t> next_job(int tuner, double now);
+
+	void sweep_done(const blindscan_job_t& job, const std::vector<blindscan_peak_t>& peaks);
+	void peak_done(const blindscan_job_t& job, bool locked);
+
+	//no more jobs can be started and none are in progress
+	bool done() const;
+
+	//estimate the duration of the remaining work; only valid when no jobs are in progress
+	blindscan_plan_stats_t project() const;
+
+	inline const blindscan_topology_t& get_topology() const {
+		return topology;
+	}
+
+	inline const blindscan_cost_model_t& get_cost_model() const {
+		return cost_model;
+	}
+
+	inline const blindscan_band_t& get_band(int idx) const {
+		return bands[idx].band;
+	}
+
+	inline int num_bands() const {
+		return bands.size();
+	}
+
+	//estimate based on the sweeps performed so far
+	double expected_peaks_per_mhz() const;
+
+	//number of queued peaks above which tuners which can sweep help tuning peaks
+	int max_peak_backlog() const;
+};
+
+/*
+	Performs the jobs selected by the planner, or simulates them
+*/
+struct blindscan_executor_t {
+	virtual ~blindscan_executor_t() {}
+	//returns the duration of the sweep in seconds and the peaks found
+	virtual double sweep(const blindscan_job_t& job, const blindscan_band_t& band,
+											 std::vector<blindscan_peak_t>& peaks) = 0;
+	//returns the duration of the tuning attempt in seconds
+	virtual double tune_peak(const blindscan_job_t& job, const blindscan_band_t& band, bool& locked) = 0;
+};
+
+/*
+	Executor which uses the cost model of the planner
+*/
+class blindscan_estimator_t : public blindscan_executor_t {
+	const blindscan_cost_model_t& cost_model;
+	double peaks_per_mhz{0};
+	double overhead(const blindscan_job_t& job) const;
+public:
+	blindscan_estimator_t(const blindscan_cost_model_t& cost_model, double peaks_per_mhz)
+		: cost_model(cost_model)
+		, peaks_per_mhz(peaks_per_mhz)
+		{}
+	virtual double sweep(const blindscan_job_t& job, const blindscan_band_t& band,
+											 std::vector<blindscan_peak_t>& peaks) override;
+	virtual double tune_peak(const blindscan_job_t& job, const blindscan_band_t& band, bool& locked) override;
+};
+
+/*
+	Run the planner until all work is done, letting executor perform each job (in simulated time,
+	starting at start_time)
+*/
+blindscan_plan_stats_t run_blindscan_plan(blindscan_planner_t& planner, blindscan_executor_t& executor,
+																					double start_time = 0);
@@ -20,6 +20,7 @@
 
 #include "devmanager.h"
 #include "receiver.h"
+#include "vdvb.h"
 #include "util/dtassert.h"
 #include "util/logger.h"
 #include "util/neumovariant.h"
@@ -144,6 +145,7 @@ class dvbdev_monitor_t : public adaptermgr_t {
 	bool adapter_no_exists(adapter_no_t adapter_no);
 
 	void on_new_frontend(adapter_no_t adapter_no, frontend_no_t frontend_no);
+	void on_new_frontend(const std::shared_ptr<dvb_frontend_t>& fe, infd_t wd);
 	void on_delete_frontend(struct inotify_event* event);
 	void discover_frontends(adapter_no_t adapter_no);
 	void on_new_adapter(int adapter_no);
@@ -294,6 +296,12 @@ void dvbdev_monitor_t::on_new_frontend(adapter_no_t adapter_no, frontend_no_t fr
 		dtdebugf("Frontend already exists!\n");
 		return;
 	}
+	if (vdvb::is_virtual((int)adapter_no)) {
+		//virtual frontends cannot be watched and never disappear; use a key which is not an inotify wd
+		auto fe = dvb_frontend_t::make(this, adapter_no, frontend_no, api_type_t::NEUMO, vdvb::api_version);
+		on_new_frontend(fe, -1 - (int)adapter_no * 32 - (int)frontend_no);
+		return;
+	}
 	ss::string<128> fname;
 	fname.format("/dev/dvb/adapter{:d}/frontend{:d}", (int)adapter_no, (int)frontend_no);
 	int wd = -1;
@@ -309,6 +317,12 @@ void dvbdev_monitor_t::on_new_frontend(adapter_no_t adapter_no, frontend_no_t fr
 		assert(0);
 	}
 	auto fe = dvb_frontend_t::make(this, adapter_no, frontend_no, api_type, api_version);
+	on_new_frontend(fe, wd);
+}
+
+void dvbdev_monitor_t::on_new_frontend(const std::shared_ptr<dvb_frontend_t>& fe, infd_t wd) {
+	auto adapter_no = fe->adapter_no;
+	auto frontend_no = fe->frontend_no;
 	{
 		auto w = fe->ts.writeAccess();
 		w->dbfe.present = true;
@@ -395,6 +409,9 @@ void dvbdev_monitor_t::discover_adapters() {
 
 	// scan /dev/dvb for all adapters
 	discover_helper("/dev/dvb", "adapter%d", 64, adapter_cb);
+
+	for (auto adapter_no: vdvb::adapter_nos())
+		on_new_frontend(adapter_no_t(adapter_no), frontend_no_t(0)); //virtual adapters have a single frontend
 }
 
 void dvbdev_monitor_t::on_new_dir(struct inotify_event* event) {
@@ -484,6 +501,18 @@ int dvbdev_monitor_t::start() {
 		wd_dev = inotify_add_watch(inotfd, "/dev", IN_CREATE);
 	}
 
+	{
+		auto r = receiver.options.readAccess();
+		if (!r->virtual_dvb_dir.empty() && r->virtual_dvb_num_adapters > 0) {
+			vdvb_options_t vo;
+			vo.dir = r->virtual_dvb_dir;
+			vo.num_adapters = r->virtual_dvb_num_adapters;
+			vo.speed = r->virtual_dvb_speed;
+			if (vdvb::start(vo) < 0)
+				user_errorf("Cannot start virtual dvb adapters replaying {}", vo.dir);
+		}
+	}
+
 	discover_adapters();
 	renumber_cards();
 	disable_missing_adapters();
@@ -502,6 +531,7 @@ int dvbdev_monitor_t::stop() {
 			fe->stop_frontend_monitor_and_wait();
 		}
 	}
+	vdvb::stop();
 	{ //mark all live stat_info_t records as none live
 		auto wtxn = receiver.statdb.wtxn();
 		statdb::clean_live(wtxn);
@@ -28,6 +28,8 @@
 #include "task.h"
 #include "util/safe/safe.h"
 #include "signal_info.h"
+#include "spectrum_algo.h"
+#include "neumodb/statdb/signal_history.h"
 #include "util/access.h"
 #include <boost/context/continuation_fcontext.hpp>
 
@@ -163,6 +165,9 @@ struct spectrum_scan_t {
 	ss::vector<uint32_t, max_num_freq> freq;
 	ss::vector<int32_t, max_num_freq> rf_level;
 	ss::vector<spectral_peak_t, max_num_peaks> peaks;
+	/*false: only a chunk of the band has been acquired; freq and rf_level contain that chunk
+		and peaks contains the peaks confirmed by that chunk (see dvb_frontend_t::get_spectrum)*/
+	bool band_complete{true};
 
 
 	~spectrum_scan_t() {
@@ -179,6 +184,7 @@ struct spectrum_scan_t {
 class signal_monitor_t {
 	friend class fe_monitor_thread_t;
 	statdb::signal_stat_t stat;
+	statdb::signal_history::writer_t history;
 
 	float snr_sum{0.};
 	float signal_strength_sum{0.};
@@ -224,6 +230,11 @@ public:
 	bool info_valid{false}; // true if we could retrieve device info; "false" indicates an error
 	int fefd{-1}; //file handle if open
 	int last_saved_freq{0}; //for spectrum scan: last frequency written to spectrum file
+	//for spectrum scan: the (sub)band is acquired in chunks [spectrum_chunk_start, spectrum_chunk_end)
+	int spectrum_chunk_start{0};
+	int spectrum_chunk_end{0};
+	int spectrum_band_start{0};
+	int spectrum_band_end{0};
 	devdb::tune_mode_t tune_mode{devdb::tune_mode_t::IDLE};
 	bool use_blind_tune{false};
 	fe_lock_status_t lock_status;
@@ -341,6 +352,13 @@ class dvb_frontend_t : public std::enable_shared_from_this<dvb_frontend_t>
 	chdb::delsys_type_t current_delsys_type { chdb::delsys_type_t::NONE };
 
 	int num_constellation_samples{0};
+
+	/*owned by monitor thread: the chunks of the band acquired so far, and peak detection on them
+		(see get_spectrum)*/
+	std::unique_ptr<spectrum_scan_t> band_spectrum;
+	spectrum_peak_stream_t peak_stream;
+	bool use_driver_peaks{false};
+
 	sec_status_t sec_status;
 	std::shared_ptr<fe_monitor_thread_t> monitor_thread;
 
@@ -351,6 +369,8 @@ public:
 	static constexpr uint32_t  lnb_slof = DEFAULT_SLOF;
 	static constexpr uint32_t lnb_lof_low = DEFAULT_LOF1_UNIVERSAL;
 	static constexpr uint32_t lnb_lof_high = DEFAULT_LOF2_UNIVERSAL;
+	//spectrum is acquired in chunks of this size (kHz), so that peaks can be scanned while the sweep continues
+	static constexpr int spectrum_chunk_size = 200000;
 
 	const adapter_no_t adapter_no;
 	const frontend_no_t frontend_no;
@@ -384,7 +404,7 @@ private:
 
 	void start_frontend_monitor();
 
-	int start_lnb_spectrum_scan(const devdb::rf_path_t& rf_path, const devdb::lnb_t& lnb);
+	int start_lnb_spectrum_scan(const devdb::rf_path_t& rf_path, const devdb::lnb_t& lnb, bool next_chunk=false);
 
 	bool wait_for_positioner(tuner_thread_t& tuner_thread);
 
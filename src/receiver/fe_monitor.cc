@@ -19,6 +19,7 @@
  */
 
 #include "devmanager.h"
+#include "vdvb.h"
 #include "neumodb/cursors.h"
 #include "neumodb/statdb/statdb_extra.h"
 #include "receiver.h"
@@ -83,7 +84,7 @@ void fe_monitor_thread_t::handle_frontend_event() {
 
 	struct dvb_frontend_event event {};
 	auto fefd = fe->ts.readAccess()->fefd;
-	int r = ioctl(fefd, FE_GET_EVENT, &event);
+	int r = dvb_ioctl(fefd, FE_GET_EVENT, &event);
 	if (r < 0) {
 		dtdebugf("FE_GET_EVENT stat=0x{:x} errno={:d} err={:s}\n", (int)event.status, errno, strerror(errno));
 		return;
@@ -123,14 +124,20 @@ void fe_monitor_thread_t::handle_frontend_event() {
 		}
 		ss::string<128> spectrum_path = receiver.options.readAccess()->spectrum_path.c_str();
 		auto scan = fe->get_spectrum(spectrum_path);
-		if (scan && scan->spectrum && fe->ts.readAccess()->tune_options.spectrum_scan_options.save_spectrum) {
+		if (!scan)
+			return;
+		if (!scan->band_complete) {
+			//the next chunk of the band is being acquired; start scanning the peaks found so far
+			receiver.on_spectrum_scan_peaks(*scan);
+			return;
+		}
+		if (scan->spectrum && fe->ts.readAccess()->tune_options.spectrum_scan_options.save_spectrum) {
 			auto txn = receiver.statdb.wtxn();
 			auto& spectrum = *scan->spectrum;
 			auto c = statdb::spectrum_t::find_by_key(txn, spectrum.k);
 			put_record(txn, spectrum);
 			txn.commit();
 		}
-		assert(scan);
 		auto finished_fe = fe->dbfe();
 		assert (scan->start_freq !=0);
 		assert (scan->end_freq !=0);
@@ -230,6 +237,11 @@ int fe_monitor_thread_t::exit() {
 
 void signal_monitor_t::update_stat(receiver_t& receiver, const signal_info_t& info) {
 	auto& update = info.stat;
+	if (update.stats.size() > 0) {
+		auto& k = update.k;
+		history.add(receiver.statdb, {k.sat_pos, k.pol, k.frequency, k.rf_path}, k.time,
+								update.stats[update.stats.size()-1]);
+	}
 	bool reset = tune_count!=info.tune_count;
 	tune_count = info.tune_count;
 	bool save_old =  stat.stats.size()>0 && reset;
@@ -293,6 +305,7 @@ void signal_monitor_t::update_stat(receiver_t& receiver, const signal_info_t& in
 
 void signal_monitor_t::end_stat(receiver_t& receiver) {
 	//it is possible that max_key changes without tuning
+	history.close(receiver.statdb);
 	auto wtxn = receiver.statdb.wtxn();
 	if(stat.stats.size() > 0 ) {
 		assert (stat.k.live);
@@ -31,6 +31,27 @@
 
 const int mmap_t::pagesize = sysconf(_SC_PAGESIZE);
 
+mmap_t::mmap_t(int map_len_, bool readonly_)
+	: readonly(readonly_),
+		map_len(map_len_ -map_len_ % pagesize) {
+}
+
+mmap_t::~mmap_t() {
+	unmap();
+	close();
+}
+
+bool mmap_t::enable_uring(const uring_writer_options_t& options) {
+	assert(!readonly);
+	assert(!buffer);
+	uring = uring_writer_t::make(options);
+	if (!uring) {
+		dterrorf("io_uring not available; using mmap for writing");
+		return false;
+	}
+	return true;
+}
+
 /*!
 	use other as a template, to create a non-mapped version
 */
@@ -84,6 +105,7 @@ mmap_t& mmap_t::operator=(mmap_t&& other) {
 	decrypt_pointer = other.decrypt_pointer;
 	other.decrypt_pointer = 0;
 
+	uring = std::move(other.uring);
 	return *this;
 }
 
@@ -97,6 +119,7 @@ mmap_t& mmap_t::operator=(mmap_t&& other) {
 int mmap_t::move_map(off_t start) {
 	assert(fd >= 0);
 	assert(start >= 0);
+	assert(!uring);
 
 	bool isfirst = !buffer;
 	if (buffer)
@@ -229,6 +252,22 @@ bool mmap_t::init(int fd_, off_t start_offset, off_t end_read_offset) {
 	auto page_offset = (start_offset / pagesize) * pagesize;
 
 	safe_read_len = -1;
+	if (uring) {
+		assert(!readonly);
+		offset = page_offset;
+		int valid_bytes = start_offset - page_offset;
+		if (uring->set_file(fd, page_offset, valid_bytes) < 0) {
+			dterrorf("set_file failed fd={:d}", fd);
+			return false;
+		}
+		buffer = uring->buffer;
+		map_len = uring->buffer_size;
+		write_pointer = valid_bytes;
+		decrypt_pointer = write_pointer;
+		read_pointer = 0;
+		safe_read_len = 0;
+		return true;
+	}
 	auto ret = move_map(page_offset) > 0;
 	if (!ret) {
 		dterrorf("move_map failed fd={:d} fd_={:d}", fd, fd_);
@@ -250,9 +289,27 @@ bool mmap_t::init(int fd_, off_t start_offset, off_t end_read_offset) {
 	return ret;
 }
 
+void mmap_t::willneed(int len) {
+	if (!buffer || !readonly)
+		return;
+	int start = (read_pointer / pagesize) * pagesize;
+	int end = std::min(read_pointer + len, safe_read_len);
+	if (end <= start)
+		return;
+	if (madvise(buffer + start, end - start, MADV_WILLNEED) < 0)
+		dtdebugf("madvise failed: {}", strerror(errno));
+}
+
 void mmap_t::unmap() {
 	if (!buffer)
 		return;
+	if (uring) {
+		//the buffer remains owned by uring; ensure all data ends up on file
+		uring->drain(write_pointer, true);
+		offset = -1;
+		buffer = nullptr;
+		return;
+	}
 	dtdebugf("UNMAP: {:p} {:d}", fmt::ptr(buffer), map_len);
 	if (buffer && munmap(buffer, map_len) < 0) {
 		dterrorf("Error while unmapping: {}", strerror(errno));
@@ -276,6 +333,21 @@ void mmap_t::close() {
 	Then move the mmap region  forward over the file as much as possible
 */
 int mmap_t::advance() {
+	if (uring) {
+		/*
+			Writes in flight read from the buffer, so they must complete before data is moved.
+			In normal operation, most data has already been written because flush is called
+			after every read, so the wait is short (bounded by max_inflight writes).
+		*/
+		assert(!readonly);
+		uring->drain(decrypt_pointer, false);
+		off_t extra = (std::min(decrypt_pointer, uring->persist_pointer) / pagesize) * pagesize;
+		uring->shift(extra, write_pointer);
+		offset += extra;
+		write_pointer -= extra;
+		decrypt_pointer -= extra;
+		return 1;
+	}
 	// decrypt_pointer must be within the mapped area
 	auto safe_to_discard = readonly ? read_pointer : std::min(decrypt_pointer, write_pointer);
 	off_t extra = (safe_to_discard / pagesize) * pagesize;
@@ -21,7 +21,10 @@
 #pragma once
 #include <stdint.h>
 #include <unistd.h>
+#include <algorithm>
+#include <memory>
 #include "util/dtassert.h"
+#include "uring_writer.h"
 
 
 struct mmap_t {
@@ -59,6 +62,9 @@ struct mmap_t {
 														valid range for decrypt_pointer: [0, write_pointer]
 													*/
 
+	std::unique_ptr<uring_writer_t> uring; /*if non null, then data is written using io_uring
+																					 instead of via a shared file mapping (writers only)
+																				*/
 	void init();
 
 	/*!
@@ -103,6 +109,12 @@ struct mmap_t {
 		assert(write_pointer<=map_len);
 	}
 
+	/*!
+		Ask the kernel to start reading (asynchronously) up to len bytes after read_pointer, limited to
+		the safe read range (readers only)
+	*/
+	void willneed(int len);
+
 	void advance_read_pointer(int extra) {
 		read_pointer += extra;
 		assert(read_pointer <= safe_read_len);
@@ -118,6 +130,50 @@ struct mmap_t {
 		write_pointer = decrypt_pointer;
 	}
 
+	/*!
+		Returns the total number of bytes which are on file and can be read through another file descriptor
+		or another mapping of the same file.
+	*/
+	off_t get_persisted_filesize() const {
+		return uring ? offset + std::min(uring->num_bytes_persisted(), decrypt_pointer) : offset + decrypt_pointer;
+	}
+
+	/*!
+		Use io_uring instead of a MAP_SHARED mapping to write data. Must be called before init.
+		Returns false if io_uring is not available, in which case mmap will be used.
+	 */
+	bool enable_uring(const uring_writer_options_t& options);
+
+	/*!
+		Same, but reuse a writer (and its buffer) released by another mmap_t for the next part of a file.
+		The buffer contents are preserved.
+	 */
+	void enable_uring(std::unique_ptr<uring_writer_t> writer) {
+		assert(!readonly);
+		assert(!buffer);
+		uring = std::move(writer);
+	}
+
+	/*!
+		Start writing decrypted data to file (io_uring only). Does not wait
+	 */
+	void flush() {
+		if (!uring || !buffer)
+			return;
+		uring->reap(false);
+		uring->submit(decrypt_pointer, false);
+	}
+
+	/*!
+		Time in ms within which flush must be called again if no new data arrives, so that decrypted data
+		which is too small for a write still reaches the file after max_tail_delay; -1 if there is no such data
+	 */
+	int flush_timeout_ms() const {
+		if (!uring || !buffer || std::max(uring->submit_pointer, uring->tail_pointer) >= decrypt_pointer)
+			return -1;
+		return (int)uring->options.max_tail_delay.count();
+	}
+
 	/*!
 		Move the mmaped range of the file to allow for more data
 		Grow the current file if needed
@@ -125,10 +181,7 @@ struct mmap_t {
 	int advance();
 
 
-mmap_t(int map_len_, bool readonly_)
-	: readonly(readonly_),
-		map_len(map_len_ -map_len_ % pagesize) {
-	}
+	mmap_t(int map_len_, bool readonly_);
 
 	EXPORT void unmap();
 
@@ -146,8 +199,5 @@ mmap_t(int map_len_, bool readonly_)
 	mmap_t& operator=(const mmap_t& other);
 	mmap_t& operator=(mmap_t&& other);
 
-	~mmap_t() {
-		unmap();
-		close();
-	}
+	~mmap_t();
 };
@@ -36,6 +36,7 @@
 #include "util/neumovariant.h"
 #include "spectrum_algo.h"
 #include "devmanager.h"
+#include "vdvb.h"
 #include "util/template_util.h"
 
 static inline constexpr int make_code(int pls_mode, int pls_code, int timeout = 0) {
@@ -91,7 +92,7 @@ void cmdseq_t::add_pls_range(int cmd, const pls_search_range_t& pls_search_range
 };
 
 int cmdseq_t::get_properties(int fefd) {
-	if ((ioctl(fefd, FE_GET_PROPERTY, &cmdseq)) == -1) {
+	if ((dvb_ioctl(fefd, FE_GET_PROPERTY, &cmdseq)) == -1) {
 		user_errorf("Error setting frontend property: {}", strerror(errno));
 		return -1;
 	}
@@ -102,7 +103,7 @@ int cmdseq_t::tune(int fefd, int heartbeat_interval) {
 	add(DTV_TUNE, 0);
 	if (heartbeat_interval > 0)
 		add(DTV_HEARTBEAT, heartbeat_interval);
-	if ((ioctl(fefd, FE_SET_PROPERTY, &cmdseq)) == -1) {
+	if ((dvb_ioctl(fefd, FE_SET_PROPERTY, &cmdseq)) == -1) {
 		user_errorf("Error setting frontend property: {}", strerror(errno));
 		return -1;
 	}
@@ -111,7 +112,7 @@ int cmdseq_t::tune(int fefd, int heartbeat_interval) {
 
 int cmdseq_t::scan(int fefd, bool init) {
 	add(DTV_SCAN, init);
-	if ((ioctl(fefd, FE_SET_PROPERTY, &cmdseq)) == -1) {
+	if ((dvb_ioctl(fefd, FE_SET_PROPERTY, &cmdseq)) == -1) {
 		dterrorf("FE_SET_PROPERTY failed: {:s}", strerror(errno));
 		return -1;
 	}
@@ -120,7 +121,7 @@ int cmdseq_t::scan(int fefd, bool init) {
 
 int cmdseq_t::spectrum(int fefd, dtv_fe_spectrum_method method) {
 	add(DTV_SPECTRUM, method);
-	if ((ioctl(fefd, FE_SET_PROPERTY, &cmdseq)) == -1) {
+	if ((dvb_ioctl(fefd, FE_SET_PROPERTY, &cmdseq)) == -1) {
 		dterrorf("FE_SET_PROPERTY failed: {:s}", strerror(errno));
 		return -1;
 	}
@@ -137,7 +138,7 @@ int dvb_frontend_t::open_device( bool rw) {
 	ss::string<PATH_MAX> frontend_fname;
 	frontend_fname.format("/dev/dvb/adapter{:d}/frontend{:d}", (int)adapter_no, (int)frontend_no);
 	int rw_flag = rw ? O_RDWR : O_RDONLY;
-	fe_state.fefd = ::open(frontend_fname.c_str(), rw_flag | O_NONBLOCK | O_CLOEXEC);
+	fe_state.fefd = dvb_open(frontend_fname.c_str(), rw_flag | O_NONBLOCK | O_CLOEXEC);
 	if (fe_state.fefd < 0) {
 		user_errorf("Error opening /dev/dvb/adapter{:d}/frontend{:d} in {:s} mode: {:s}", (int)adapter_no,
 								(int)frontend_no, rw ? "read-write" : "readonly", strerror(errno));
@@ -151,7 +152,7 @@ dvb_frontend_t::~dvb_frontend_t() {
 	auto w = ts.writeAccess();
 	if(w->fefd>=0) {
 		dtdebugf("closing fefd={:d}", w->fefd);
-		while (::close(w->fefd) != 0) {
+		while (dvb_close(w->fefd) != 0) {
 			if (errno != EINTR)
 				dterrorf("Error closing /dev/dvb/adapter{:d}/frontend{:d}: {:s}", (int)adapter_no, (int)frontend_no,
 								 strerror(errno));
@@ -166,7 +167,7 @@ void dvb_frontend_t::close_device() {
 	if (fe_state.fefd < 0)
 		return;
 	dtdebugf("closing fefd={:d}\n", fe_state.fefd);
-	while (::close(fe_state.fefd) != 0) {
+	while (dvb_close(fe_state.fefd) != 0) {
 		if (errno != EINTR)
 			dterrorf("Error closing /dev/dvb/adapter{:d}/frontend{:d}: {:s}", (int)adapter_no, (int)frontend_no,
 							 strerror(errno));
@@ -179,7 +180,7 @@ void dvb_frontend_t::close_device() {
 */
 static int get_frontend_names_dvapi(const adapter_no_t adapter_no, fe_state_t& t) {
 	struct dvb_frontend_info fe_info {}; // front_end_info
-	if (ioctl(t.fefd, FE_GET_INFO, &fe_info) < 0) {
+	if (dvb_ioctl(t.fefd, FE_GET_INFO, &fe_info) < 0) {
 		dterrorf("FE_GET_FRONTEND_INFO FAILED: {:s}", strerror(errno));
 		return -1;
 	}
@@ -212,7 +213,7 @@ static int get_frontend_names_dvapi(const adapter_no_t adapter_no, fe_state_t& t
 static int get_frontend_names(fe_state_t& t, int adapter_no, int api_version) {
 	struct dvb_frontend_extended_info fe_info {}; // front_end_info
 
-	if (ioctl(t.fefd, FE_GET_EXTENDED_INFO, &fe_info) < 0) {
+	if (dvb_ioctl(t.fefd, FE_GET_EXTENDED_INFO, &fe_info) < 0) {
 		dterrorf("FE_GET_FRONTEND_INFO FAILED: {:s}", strerror(errno));
 		return -1;
 	}
@@ -297,7 +298,7 @@ static int get_frontend_info(const adapter_no_t adapter_no, const frontend_no_t
 	properties[i++].cmd = DTV_DELIVERY_SYSTEM;
 	struct dtv_properties props = {.num = i, .props = properties};
 
-	if ((ioctl(t.fefd, FE_GET_PROPERTY, &props)) == -1) {
+	if ((dvb_ioctl(t.fefd, FE_GET_PROPERTY, &props)) == -1) {
 		dterrorf("FE_GET_PROPERTY failed: {}", strerror(errno));
 		return -1;
 	}
@@ -731,7 +732,7 @@ int dvb_frontend_t::stop() {
 		auto fefd = ts.readAccess()->fefd;
 		struct dtv_algo_ctrl algo_ctrl;
 		algo_ctrl.cmd = DTV_STOP;
-		if ((ioctl(fefd, FE_ALGO_CTRL, &algo_ctrl)) == -1) {
+		if ((dvb_ioctl(fefd, FE_ALGO_CTRL, &algo_ctrl)) == -1) {
 			dtdebugf("ALGO_CTRL: DTV STOP failed: {}", strerror(errno));
 		}
 
@@ -870,7 +871,7 @@ int dvb_frontend_t::send_diseqc_message(char switch_type, unsigned char port, un
 
 	int err;
 	auto fefd = ts.readAccess()->fefd;
-	if ((err = ioctl(fefd, FE_DISEQC_SEND_MASTER_CMD, &cmd))) {
+	if ((err = dvb_ioctl(fefd, FE_DISEQC_SEND_MASTER_CMD, &cmd))) {
 		dterrorf("problem sending the DiseqC message");
 		return -1;
 	}
@@ -949,7 +950,7 @@ int dvb_frontend_t::send_positioner_message(devdb::positioner_cmd_t command, int
 	if(tune_pars.move_dish) {
 		auto powerup_time_ms = tune_pars.dish->powerup_time;
 		sec_status.positioner_wait_after_powerup(powerup_time_ms);
-		if ((err = ioctl(fefd, FE_DISEQC_SEND_MASTER_CMD, &cmd))) {
+		if ((err = dvb_ioctl(fefd, FE_DISEQC_SEND_MASTER_CMD, &cmd))) {
 			dterrorf("problem sending the DiseqC message");
 			return -1;
 		}
@@ -1000,6 +1001,12 @@ inline void spectrum_scan_t::adjust_frequencies(const devdb::lnb_t& lnb, int hig
 	}
 }
 
+/*
+	Retrieve the chunk of the spectrum which has just been acquired (see start_lnb_spectrum_scan), and detect
+	peaks in it. While the band is incomplete, the next chunk is started, and the returned spectrum_scan_t
+	has band_complete=false and contains the newly confirmed peaks, so that they can be scanned immediately.
+	After the last chunk, the spectrum of the whole band is returned
+ */
 std::optional<spectrum_scan_t> dvb_frontend_t::get_spectrum(const ss::string_& spectrum_path) {
 	this->num_constellation_samples = 0;
 	this->clear_lock_status();
@@ -1021,7 +1028,7 @@ std::optional<spectrum_scan_t> dvb_frontend_t::get_spectrum(const ss::string_& s
 	spectrum.num_candidates = scan.max_num_peaks;
 	cmdseq.props[0].u.spectrum = spectrum;
 
-	if (ioctl(fefd, FE_GET_PROPERTY, &cmdseq) < 0) {
+	if (dvb_ioctl(fefd, FE_GET_PROPERTY, &cmdseq) < 0) {
 		dterrorf("ioctl failed: {:s}", strerror(errno));
 		assert(0); // todo: handle EINTR
 		return {};
@@ -1034,17 +1041,17 @@ std::optional<spectrum_scan_t> dvb_frontend_t::get_spectrum(const ss::string_& s
 	}
 	scan.resize(spectrum.num_freq, spectrum.num_candidates);
 
-	auto [dish, lnb, rf_path, options, start_time]  = [this](){
+	auto [dish, lnb, rf_path, options, start_time] = [this](){
 		const auto r = this->ts.readAccess();
 		return std::tuple(*r->tune_options.tune_pars->dish, r->reserved_lnb, r->reserved_rf_path,
 											r->tune_options.spectrum_scan_options,
 											r->start_time);
 	}();
-
-
-	if(options.recompute_peaks || spectrum.num_candidates == 0) {
-		find_tps(scan.peaks, scan.rf_level, scan.freq);
-	}
+	auto [band_start, band_end, chunk_start, chunk_end] = [this](){
+		const auto r = this->ts.readAccess();
+		return std::tuple(r->spectrum_band_start, r->spectrum_band_end, r->spectrum_chunk_start,
+											r->spectrum_chunk_end);
+	}();
 
 	bool append_now = false;
 	bool incomplete = false;
@@ -1067,6 +1074,75 @@ std::optional<spectrum_scan_t> dvb_frontend_t::get_spectrum(const ss::string_& s
 	auto* network = devdb::lnb::get_network(lnb, scan.sat.sat_pos);
 	scan.lof_offsets = lnb.lof_offsets;
 	assert(!network || network->sat_pos == scan.sat.sat_pos);
+
+	/*
+		Append the chunk to the band, in increasing frequency order (the driver returns decreasing frequencies
+		for an inverted spectrum, e.g., on C-band), skipping samples which overlap the previous chunk.
+		Peaks are found by the driver or by peak_stream; the choice is made on the first chunk so that all
+		peaks of a band are found in the same way
+	*/
+	bool first_chunk = !band_spectrum || chunk_start == band_start;
+	if (first_chunk) {
+		if (!band_spectrum)
+			band_spectrum = std::make_unique<spectrum_scan_t>();
+		band_spectrum->freq.clear();
+		band_spectrum->rf_level.clear();
+		band_spectrum->peaks.clear();
+		peak_stream.clear();
+		use_driver_peaks = !options.recompute_peaks && spectrum.num_candidates > 0;
+	}
+	auto& band = *band_spectrum;
+	bool last_chunk = chunk_end >= band_end;
+	int n = scan.freq.size();
+	bool descending = n > 1 && scan.freq[0] > scan.freq[n-1];
+	int num_old = band.freq.size();
+	for (int i = 0; i < n; ++i) {
+		int j = descending ? n - i - 1 : i;
+		if (band.freq.size() > 0 && scan.freq[j] <= band.freq[band.freq.size()-1])
+			continue;
+		if (!last_chunk && (int)scan.freq[j] >= chunk_end)
+			break;
+		band.freq.push_back(scan.freq[j]);
+		band.rf_level.push_back(scan.rf_level[j]);
+	}
+	ss::vector<spectral_peak_t, 32> confirmed_peaks;
+	if (use_driver_peaks) {
+		for (int i = 0; i < (int) scan.peaks.size(); ++i) {
+			auto& peak = scan.peaks[descending ? scan.peaks.size() - i - 1 : i];
+			if ((int)peak.freq < chunk_start || (!last_chunk && (int)peak.freq >= chunk_end))
+				continue;
+			band.peaks.push_back(peak);
+			confirmed_peaks.push_back(peak);
+		}
+	} else if ((int) band.freq.size() > num_old)
+		peak_stream.add(&band.rf_level[num_old], &band.freq[num_old], band.freq.size() - num_old, confirmed_peaks);
+
+	if (!last_chunk) {
+		{
+			auto w = this->ts.writeAccess();
+			w->spectrum_chunk_start = chunk_end;
+		}
+		this->start_lnb_spectrum_scan(rf_path, lnb, true /*next_chunk*/);
+		scan.freq.clear();
+		scan.rf_level.clear();
+		scan.peaks.clear();
+		for (auto& peak : confirmed_peaks)
+			scan.peaks.push_back(peak);
+		scan.band_complete = false;
+		return ret;
+	}
+
+	//the whole band has been acquired
+	scan.freq = band.freq;
+	scan.rf_level = band.rf_level;
+	if (use_driver_peaks)
+		scan.peaks = band.peaks;
+	else
+		peak_stream.finish(scan.peaks);
+	dtdebugf("Spectrum band complete: {:d} samples {:d} peaks ({:d} confirmed early, {:d} retracted)",
+					 scan.freq.size(), scan.peaks.size(), use_driver_peaks ? (int) band.peaks.size() :
+					 peak_stream.num_reported(), peak_stream.num_retracted());
+
 	append_now = options.append;
 	// we will need to call start_lnb_spectrum again later to retrieve (part of) the high band)
 	incomplete =
@@ -1673,7 +1749,12 @@ int dvb_frontend_t::tune(const mux_t& mux, const subscription_options_t& tune_op
 	return 0;
 }
 
-int dvb_frontend_t::start_lnb_spectrum_scan(const devdb::rf_path_t& rf_path, const devdb::lnb_t& lnb) {
+/*
+	start acquiring the first chunk of the band (next_chunk=false), or the next chunk,
+	which get_spectrum has set in spectrum_chunk_start
+ */
+int dvb_frontend_t::start_lnb_spectrum_scan(const devdb::rf_path_t& rf_path, const devdb::lnb_t& lnb,
+																						bool next_chunk) {
 	this->num_constellation_samples = 0;
 	using namespace chdb;
 	using namespace devdb;
@@ -1705,6 +1786,19 @@ int dvb_frontend_t::start_lnb_spectrum_scan(const devdb::rf_path_t& rf_path, con
 		assert(0);
 	}
 	assert(start_freq <= end_freq);
+	{
+		auto w = ts.writeAccess();
+		if (!next_chunk) {
+			w->spectrum_band_start = start_freq;
+			w->spectrum_band_end = end_freq;
+			w->spectrum_chunk_start = start_freq;
+		}
+		start_freq = w->spectrum_chunk_start;
+		end_freq = w->spectrum_band_end;
+		if (end_freq - start_freq > spectrum_chunk_size + spectrum_chunk_size / 4)
+			end_freq = start_freq + spectrum_chunk_size; //avoid a very short last chunk
+		w->spectrum_chunk_end = end_freq;
+	}
 
 	dtdebugf("Spectrum acquisition on lnb {} diseqc={} range=[{}, {}] pol={}",
 					 lnb, conn->tune_string, start_freq, end_freq, options.band_pol.pol);
@@ -1733,7 +1827,7 @@ int dvb_frontend_t::start_lnb_spectrum_scan(const devdb::rf_path_t& rf_path, con
 
 	while (1) {
 		struct dvb_frontend_event event {};
-		if (ioctl(fefd, FE_GET_EVENT, &event) < 0)
+		if (dvb_ioctl(fefd, FE_GET_EVENT, &event) < 0)
 			break;
 	}
 	auto ret = cmdseq.spectrum(fefd, options.use_fft_scan ? SPECTRUM_METHOD_FFT: SPECTRUM_METHOD_SWEEP);
@@ -1929,7 +2023,7 @@ dvb_frontend_t::diseqc(int16_t sat_pos, chdb::sat_sub_band_t sat_sub_band,
 				They allow switching between two satelites only
 			*/
 			auto b = std::min(lnb_connection.diseqc_mini, (uint8_t)1);
-			ret = ioctl(fefd, FE_DISEQC_SEND_BURST, b);
+			ret = dvb_ioctl(fefd, FE_DISEQC_SEND_BURST, b);
 			if (ret < 0) {
 				dterrorf("problem sending the Tone Burst");
 			}
@@ -2083,7 +2177,7 @@ int sec_status_t::set_tone(int fefd, fe_sec_tone_mode mode) {
 	}
 	tone = mode;
 	dtdebugf("Setting tone: v={:d}", (int) mode);
-	if (ioctl(fefd, FE_SET_TONE, mode) < 0 ) {
+	if (dvb_ioctl(fefd, FE_SET_TONE, mode) < 0 ) {
 		dterrorf("problem setting tone={:d}", (int) mode);
 		return -1;
 	}
@@ -2125,7 +2219,7 @@ int sec_status_t::set_voltage(int fefd, fe_sec_voltage v) {
 		TODO: replace msleep with sleep_until. This would take into account driver sleep
 	 */
 	if (must_sleep_extra  && v == SEC_VOLTAGE_18) {
-		if (ioctl(fefd, FE_SET_VOLTAGE, SEC_VOLTAGE_13) < 0) {
+		if (dvb_ioctl(fefd, FE_SET_VOLTAGE, SEC_VOLTAGE_13) < 0) {
 			dterrorf("problem setting voltage {:d}", voltage);
 			return -1;
 		}
@@ -2136,7 +2230,7 @@ int sec_status_t::set_voltage(int fefd, fe_sec_voltage v) {
 
 	voltage = v;
 
-	if (ioctl(fefd, FE_SET_VOLTAGE, voltage) < 0) {
+	if (dvb_ioctl(fefd, FE_SET_VOLTAGE, voltage) < 0) {
 		dterrorf("problem setting voltage {:d}", voltage);
 		return -1;
 	}
@@ -2170,7 +2264,7 @@ int sec_status_t::set_rf_input(int fefd, int new_rf_input, const tune_pars_t& tu
 		dtdebugf("No RF_INPUT change needed but new config: rf_input={:d}/{:d} mode={:d}", ic.rf_in, ic.config_id, (int)ic.mode);
 	}
 
-	auto ret = (fe_reservation_result) ioctl(fefd, FE_SET_RF_INPUT, &ic);
+	auto ret = (fe_reservation_result) dvb_ioctl(fefd, FE_SET_RF_INPUT, &ic);
 	switch(ret) {
 	case FE_RESERVATION_NOT_SUPPORTED:
 		assert(tune_pars.send_lnb_commands);
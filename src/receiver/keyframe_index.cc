@@ -0,0 +1,54 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "keyframe_index.h"
+#include <algorithm>
+
+int keyframe_index_t::update(db_txn& idxdb_txn) {
+	using namespace recdb;
+	auto start_time = markers.empty() ? milliseconds_t(std::numeric_limits<int64_t>::min())
+		: markers.back().k.time + milliseconds_t(1);
+	auto c = marker_t::find_by_key(idxdb_txn, marker_key_t(start_time), find_geq);
+	int count{0};
+	for (const auto& m : c.range()) {
+		markers.push_back(m);
+		++count;
+	}
+	return count;
+}
+
+int keyframe_index_t::find_geq(milliseconds_t t) const {
+	auto it = std::lower_bound(markers.begin(), markers.end(), t,
+														 [](const recdb::marker_t& m, milliseconds_t t) { return m.k.time < t; });
+	return it == markers.end() ? -1 : it - markers.begin();
+}
+
+int keyframe_index_t::find_leq(milliseconds_t t) const {
+	auto it = std::upper_bound(markers.begin(), markers.end(), t,
+														 [](milliseconds_t t, const recdb::marker_t& m) { return t < m.k.time; });
+	return it == markers.begin() ? -1 : (it - markers.begin()) - 1;
+}
+
+int keyframe_index_t::find_by_packetno(int64_t packetno) const {
+	auto it = std::upper_bound(markers.begin(), markers.end(), packetno,
+														 [](int64_t packetno, const recdb::marker_t& m) {
+															 return packetno < (int64_t)m.packetno_start; });
+	return it == markers.begin() ? -1 : (it - markers.begin()) - 1;
+}
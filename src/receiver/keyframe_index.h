@@ -0,0 +1,70 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include "neumodb/recdb/recdb_extra.h"
+#include <vector>
+
+/*
+	In memory copy of the marker records of a recording or live buffer.
+
+	Each marker describes a block of packets containing a pat, a pmt and an i-frame (see event_handler_t::index_event),
+	so the markers form a keyframe index. Markers are only ever appended (in order of increasing time and packetno),
+	so the index is loaded once and then extended with the markers written since the last update.
+
+	Lookups are binary searches and do not need a database transaction. This makes seeking and trick play
+	in long recordings cheap.
+*/
+class keyframe_index_t {
+	std::vector<recdb::marker_t> markers;
+
+public:
+	//load the markers written since the last call; returns the number of new markers
+	int update(db_txn& idxdb_txn);
+
+	void clear() {
+		markers.clear();
+	}
+
+	int size() const {
+		return markers.size();
+	}
+
+	bool empty() const {
+		return markers.empty();
+	}
+
+	const recdb::marker_t& operator[](int idx) const {
+		return markers[idx];
+	}
+
+	const recdb::marker_t& back() const {
+		return markers.back();
+	}
+
+	//index of the first marker with time >= t, or -1
+	int find_geq(milliseconds_t t) const;
+
+	//index of the last marker with time <= t, or -1
+	int find_leq(milliseconds_t t) const;
+
+	//index of the last marker starting at or before packetno, or -1
+	int find_by_packetno(int64_t packetno) const;
+};
@@ -61,6 +61,7 @@ void meta_marker_t::init(system_time_t now) {
 	current_marker.packetno_start = std::numeric_limits<uint32_t>::max();
 	livebuffer_start_time = now;
 	livebuffer_end_time = now;
+	live_position.store({num_bytes_safe_to_read, current_marker, livebuffer_end_time});
 }
 
 void meta_marker_t::register_playback_client(playback_mpm_t* client) {
@@ -91,40 +92,91 @@ int meta_marker_t::playback_clients_newest_fileno() const {
 	return fileno;
 }
 
+void live_position_seqlock_t::store(const live_position_t& pos) {
+	auto s = seq.load(std::memory_order_relaxed);
+	seq.store(s + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	num_bytes_safe_to_read.store(pos.num_bytes_safe_to_read, std::memory_order_relaxed);
+	marker_time.store(pos.current_marker.k.time.count(), std::memory_order_relaxed);
+	marker_packetnos.store((uint64_t(pos.current_marker.packetno_start) << 32) | pos.current_marker.packetno_end,
+												 std::memory_order_relaxed);
+	livebuffer_end_time.store(pos.livebuffer_end_time.time_since_epoch().count(), std::memory_order_relaxed);
+	seq.store(s + 2, std::memory_order_release);
+}
+
+live_position_t live_position_seqlock_t::load() const {
+	live_position_t ret;
+	for (;;) {
+		auto s1 = seq.load(std::memory_order_acquire);
+		ret.num_bytes_safe_to_read = num_bytes_safe_to_read.load(std::memory_order_relaxed);
+		auto t = marker_time.load(std::memory_order_relaxed);
+		auto packetnos = marker_packetnos.load(std::memory_order_relaxed);
+		auto end_time = livebuffer_end_time.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		auto s2 = seq.load(std::memory_order_relaxed);
+		if (s1 != s2 || (s1 & 1))
+			continue; //writer was active
+		ret.current_marker.k.time = milliseconds_t(t);
+		ret.current_marker.packetno_start = packetnos >> 32;
+		ret.current_marker.packetno_end = packetnos & 0xffffffff;
+		ret.livebuffer_end_time = system_time_t(system_time_t::duration(end_time));
+		return ret;
+	}
+}
+
+void meta_marker_t::notify_update() {
+	update_count.fetch_add(1);
+	if (num_waiters.load() > 0) //avoid a system call when no playback client is blocked
+		update_count.notify_all();
+}
+
+void meta_marker_t::publish_live_position() {
+	live_position.store({num_bytes_safe_to_read, current_marker, livebuffer_end_time});
+	notify_update();
+}
+
 /*
 	waits for a change in this meta_marker compared to "other" and then
-	updates other; mutex and other_mutex should be locked before calling
+	updates other.
+
+	The frequently changing fields are read from live_position. The mutex is only locked when structural
+	fields have changed since the last call. structure_version is incremented before live_position is published,
+	so a snapshot in which e.g., num_bytes_safe_to_read already refers to a new file is always detected.
 */
 void meta_marker_t::wait_for_update(meta_marker_t& other, std::mutex& mutex) {
 	dttime_init();
-
-	// lk is now locked
-	std::unique_lock<std::mutex> lk(mutex, std::adopt_lock);
-	assert(other.num_bytes_safe_to_read <= num_bytes_safe_to_read);
-
-	cv.wait(lk, [this, &other] {
-		// relock lk
-		auto ret = was_interrupted ||
-			(num_bytes_safe_to_read > other.num_bytes_safe_to_read && //data is available
-			 last_streams.packetno_start>=0); //pmt was received
-		if (!other.started) {
-			if (ret) {
-				dtdebugf("metamarker WAIT safe_to_read={:d} ret={:d}", num_bytes_safe_to_read, ret);
+	for (;;) {
+		auto count = update_count.load();
+		auto pos = live_position.load();
+		if (!other.started || structure_version.load() != other.structure_version.load()) {
+			std::scoped_lock lk(mutex);
+			other.structure_version = structure_version.load();
+			other.current_file_record = current_file_record;
+			other.last_streams = last_streams;
+			other.livebuffer_start_time = livebuffer_start_time;
+			pos = live_position.load();
+		}
+		assert(other.num_bytes_safe_to_read <= pos.num_bytes_safe_to_read);
+		auto interrupted = was_interrupted.exchange(false);
+		auto ret = interrupted ||
+			(pos.num_bytes_safe_to_read > other.num_bytes_safe_to_read && //data is available
+			 other.last_streams.packetno_start>=0); //pmt was received
+		if (ret) {
+			if (!other.started && !interrupted) {
+				dtdebugf("metamarker WAIT safe_to_read={:d} ret={:d}", pos.num_bytes_safe_to_read, ret);
 				other.started = true;
 			}
+			other.current_marker = pos.current_marker;
+			other.livebuffer_end_time = pos.livebuffer_end_time;
+			other.num_bytes_safe_to_read = pos.num_bytes_safe_to_read;
+			break;
 		}
-		return ret;
-	});
+		//num_waiters must be incremented before update_count is checked, or notify_update could skip the wakeup
+		num_waiters.fetch_add(1);
+		update_count.wait(count);
+		num_waiters.fetch_sub(1);
+	}
 	dttime(2000);
-
-	was_interrupted = false;
-	other.current_marker = current_marker;
-	other.livebuffer_start_time = livebuffer_start_time;
-	other.livebuffer_end_time = livebuffer_end_time;
-	other.num_bytes_safe_to_read = num_bytes_safe_to_read;
-	other.current_file_record = current_file_record;
-	other.last_streams = last_streams;
-	lk.release(); // needed because caller expects both mutexes to remain locked
 }
 
 /*
@@ -133,7 +185,8 @@ void meta_marker_t::wait_for_update(meta_marker_t& other, std::mutex& mutex) {
 	"this" is the live stream (active_mpm), other is the playback stream (playback_mpm)
 */
 void active_mpm_t::wait_for_update(meta_marker_t& other) {
-	meta_marker.writeAccess()->wait_for_update(other, meta_marker.mutex());
+	//only accesses structural fields with the mutex locked
+	meta_marker.unsafe().wait_for_update(other, meta_marker.mutex());
 }
 
 /*
@@ -221,7 +274,15 @@ active_mpm_t::active_mpm_t(active_service_t* parent_, system_time_t now)
 {
 	using namespace dtdemux;
 	dirname = make_dirname(parent_, now);
-	file_time_limit = active_service->receiver.options.readAccess()->livebuffer_mpm_part_duration;
+	{
+		auto r = active_service->receiver.options.readAccess();
+		file_time_limit = r->livebuffer_mpm_part_duration;
+		if (r->livebuffer_use_io_uring) {
+			uring_writer_options_t o;
+			o.use_o_direct = r->livebuffer_use_o_direct;
+			filemap.enable_uring(o);
+		}
+	}
 	active_service->pat_parser = stream_parser.register_pat_pid();
 	active_service->pat_parser->section_cb = [this](const pat_services_t& pat_services, const subtable_info_t& i) {
 		assert(!i.timedout);
@@ -299,36 +360,47 @@ void active_mpm_t::destroy() {
 */
 
 void active_mpm_t::transfer_filemap(int fd, int64_t new_num_bytes_safe_to_read) {
-	mmap_t newfilemap(filemap.map_len, false);
-	// fd will be owned by filemap
-	newfilemap.init(fd, 0);
 	// num_bytes_processed number of bytes proccessed in the current filemap
 	auto num_bytes_processed =
 		new_num_bytes_safe_to_read - current_file_stream_packetno_start * (int64_t)ts_packet_t::size - filemap.offset;
 	assert(num_bytes_processed <= filemap.decrypt_pointer);
 	assert(filemap.decrypt_pointer <= filemap.write_pointer);
-	if (num_bytes_processed < filemap.write_pointer) {
-		auto* start = filemap.buffer + num_bytes_processed;
-		auto num_bytes_to_move = filemap.write_pointer - num_bytes_processed;
-		assert(num_bytes_processed == filemap.write_pointer - num_bytes_to_move);
-		dtdebugf("Moving {:d} bytes to new file", num_bytes_to_move);
-		memcpy(newfilemap.buffer, start, num_bytes_to_move);
-		newfilemap.decrypt_pointer = filemap.decrypt_pointer - num_bytes_processed;
-		newfilemap.write_pointer = filemap.write_pointer - num_bytes_processed;
-		assert(newfilemap.write_pointer == num_bytes_to_move);
-	} else {
-		assert(num_bytes_processed == filemap.write_pointer);
+	auto num_bytes_to_move = filemap.write_pointer - num_bytes_processed;
+	auto decrypt_pointer = filemap.decrypt_pointer - num_bytes_processed;
+	mmap_t newfilemap(filemap.map_len, false);
+	if (!filemap.uring) {
+		// fd will be owned by filemap
+		newfilemap.init(fd, 0);
+		if (num_bytes_to_move > 0) {
+			dtdebugf("Moving {:d} bytes to new file", num_bytes_to_move);
+			memcpy(newfilemap.buffer, filemap.buffer + num_bytes_processed, num_bytes_to_move);
+		}
 	}
 	if (filemap.fd >= 0) {
 		dtdebugf("TRUNCATE from ={:d} to {:d} new_num_bytes_safe_to_read={:d}", filesize_fd(filemap.fd),
 						 num_bytes_processed + filemap.offset, new_num_bytes_safe_to_read);
 		// assert(new_num_bytes_safe_to_read<= num_bytes_processed +filemap.offset);
-		if (ftruncate(filemap.fd, num_bytes_processed + filemap.offset) < 0) {
+		auto new_size = num_bytes_processed + filemap.offset;
+		/*unmap first: with io_uring, this waits for pending writes, which could otherwise
+			extend the file after truncation*/
+		filemap.unmap();
+		if (ftruncate(filemap.fd, new_size) < 0) {
 			dterrorf("Error while truncating {}", strerror(errno));
 		}
-		filemap.unmap();
 		filemap.close();
 	}
+	if (filemap.uring) {
+		/*reuse the writer and its buffer, which still contains the data to move, instead of
+			setting up a new ring and buffer for each file part*/
+		newfilemap.enable_uring(std::move(filemap.uring));
+		newfilemap.init(fd, 0);
+		if (num_bytes_to_move > 0) {
+			dtdebugf("Moving {:d} bytes to new file", num_bytes_to_move);
+			memmove(newfilemap.buffer, newfilemap.buffer + num_bytes_processed, num_bytes_to_move);
+		}
+	}
+	newfilemap.decrypt_pointer = decrypt_pointer;
+	newfilemap.write_pointer = num_bytes_to_move;
 	filemap = std::move(newfilemap); // transfer resources from newfilemap
 }
 
@@ -386,7 +458,6 @@ void mpm_copylist_t::run() {
 }
 
 void mpm_copylist_t::run(db_txn& txn) {
-	std::error_code ec;
 	auto dbdir = dst_dir / "index.mdb"; // location of the recording's database
 	// open the recording database in the mpm
 	using namespace recdb;
@@ -400,14 +471,10 @@ void mpm_copylist_t::run(db_txn& txn) {
 		auto srcfname = ::relfilename(f);
 		auto src = src_dir / srcfname.c_str();
 		auto dst = dst_dir / dstfname.c_str();
-		fs::create_hard_link(src, dst, ec); /*
-																					TODO: tis part could be too slow in some cases (especially if link is replaced
-																					by copy) In that case, the linking can be done in another thread provided the
-																					rec_t record is not deleted in the livebuffer yet. This prevents the
-																					recording's data from being deleted before it is linked/copied*/
-		if (ec) {
-			dterrorf("Error hardlinking {} to {}: {}", src.c_str(), dst.c_str(), ec.message());
-		}
+		/*if live buffer and recording are on different filesystems, the data is kept on the live buffer's
+			filesystem until it has been copied; the live buffer itself may be removed before that*/
+		if (link_or_stage_file(src, dst, staging_dir) > 0)
+			needs_copy = true;
 	}
 }
 
@@ -647,7 +714,9 @@ void active_mpm_t::update_recordings(db_txn& parent_txn, system_time_t now) {
 }
 
 void active_mpm_t::self_check(meta_marker_t& m) {
-	assert(m.num_bytes_safe_to_read >= stream_parser.event_handler.last_saved_marker.packetno_end * ts_packet_t::size);
+	//with io_uring, the last marker may refer to data which is not yet on file
+	assert((filemap.uring ? num_bytes_decrypted : m.num_bytes_safe_to_read) >=
+				 stream_parser.event_handler.last_saved_marker.packetno_end * ts_packet_t::size);
 }
 
 /*
@@ -802,7 +871,8 @@ int active_mpm_t::next_data_file(system_time_t now, int64_t new_num_bytes_safe_t
 	put_record(cfile, mm->current_file_record);
 	idx_txn.commit();
 
-	mm->cv.notify_all();
+	mm->structure_changed();
+	mm->publish_live_position();
 
 	current_file_stream_packetno_start = new_file_stream_packetno_start;
 	return 1;
@@ -940,6 +1010,7 @@ void active_mpm_t::process_channel_data() {
 			dttime(500);
 
 			filemap.advance_decrypt_pointer(num_bytes_decrypted_now);
+			filemap.flush();
 
 			if (stream_parser.event_handler.last_saved_marker.packetno_start != old_packetno_start) {
 				may_start_new_file = true;
@@ -991,19 +1062,26 @@ void active_mpm_t::process_channel_data() {
 				 fixing the problem also means moving more data
 			*/
 			next_data_file(now, num_bytes_decrypted);
-		} else if (num_bytes_decrypted_now) {
-			auto mm = meta_marker.writeAccess();
-			mm->livebuffer_end_time = now;
-			mm->current_marker = stream_parser.event_handler.last_saved_marker;
-			assert(mm->num_bytes_safe_to_read <= num_bytes_decrypted); // KNOWN PROBLEM: we may not go back!!
-			mm->num_bytes_safe_to_read = num_bytes_decrypted;
-			if (!mm->started && mm->num_bytes_safe_to_read > 0) {
-				mm->started = true;
-				dtdebugf("notifying metamarker: safe_to_read={:d}", mm->num_bytes_safe_to_read);
+		} else if (num_bytes_decrypted_now || filemap.uring) {
+			/*with io_uring, readers can only access data after it has been written, which
+				can happen later than decryption*/
+			auto num_bytes_safe_to_read = filemap.uring ? num_bytes_persisted() : num_bytes_decrypted;
+			/*no locking needed: these fields are only accessed by this thread; other threads
+				read them from mm.live_position*/
+			auto& mm = meta_marker.unsafe();
+			if (num_bytes_safe_to_read <= mm.num_bytes_safe_to_read && !num_bytes_decrypted_now)
+				continue;
+			mm.livebuffer_end_time = now;
+			mm.current_marker = stream_parser.event_handler.last_saved_marker;
+			assert(mm.num_bytes_safe_to_read <= num_bytes_decrypted); // KNOWN PROBLEM: we may not go back!!
+			mm.num_bytes_safe_to_read = std::max(mm.num_bytes_safe_to_read, num_bytes_safe_to_read);
+			if (!mm.started && mm.num_bytes_safe_to_read > 0) {
+				mm.started = true;
+				dtdebugf("notifying metamarker: safe_to_read={:d}", mm.num_bytes_safe_to_read);
 			}
-			self_check(*mm);
+			self_check(mm);
 			//		TODO: add num_bytes_decrypted??? How to save time at start? e.g., first minute alway safe to read?
-			mm->cv.notify_all();
+			mm.publish_live_position();
 		}
 		if (num_bytes_read % dtdemux::ts_packet_t::size != 0) {
 			dtdebugf("Read partial packet: num_bytes_read={:d} num_bytes_read%%188={:d}", num_bytes_read,
@@ -1073,4 +1151,5 @@ void active_mpm_t::delete_old_data(db_txn& parent_txn, system_time_t now) {
 	auto mm = meta_marker.writeAccess();
 	mm->livebuffer_start_time = std::max(new_data_start_time, mm->livebuffer_start_time);
 	mm->livebuffer_stream_time_start = std::max(new_data_stream_time_start, mm->livebuffer_stream_time_start);
+	mm->structure_changed();
 }
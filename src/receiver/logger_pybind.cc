@@ -47,6 +47,26 @@ static void logger_log(bool is_error, const char* file, const char* func, int li
 	}
 }
 
+static void set_async_logging(bool on) {
+	if (on)
+		dtlog::start_async_logging();
+	else
+		dtlog::stop_async_logging();
+}
+
+static py::dict async_logging_stats() {
+	auto stats = dtlog::get_stats();
+	py::dict ret;
+	ret["deferred"] = stats.num_deferred;
+	ret["preformatted"] = stats.num_preformatted;
+	ret["dropped"] = stats.num_dropped;
+	ret["sync"] = stats.num_sync;
+	return ret;
+}
+
 void export_logger(py::module& m) {
 	m.def("log", &logger_log);
+	m.def("set_async_logging", &set_async_logging, "Write log messages from a background thread",
+				py::arg("on") = true);
+	m.def("async_logging_stats", &async_logging_stats, "Statistics of the asynchronous logger");
 }
@@ -19,12 +19,17 @@
  */
 
 #pragma once
+#include <atomic>
 #include <filesystem>
 #include "filemapper.h"
+#include "readahead.h"
+#include "reccopy.h"
+#include "keyframe_index.h"
 #include "streamparser/packetstream.h"
 #include "neumodb/chdb/chdb_extra.h"
 #include "neumodb/epgdb/epgdb_extra.h"
 #include "util/safe/safe.h"
+#include "util/time_util.h"
 #include "recmgr.h"
 
 #include "dvbcsa.h"
@@ -58,6 +63,9 @@ namespace epgdb
 /*
 	returns a todo list for the tuner thread, to be executed by the recmgr thread
 
+	run() makes the parts of the live buffer available in the recording directory by reflinking or hard linking
+	them. Parts which can only be copied (live buffer and recording on different filesystems) are hard linked into
+	staging_dir instead; needs_copy is then set and the recmgr thread copies them in the background
 */
 struct mpm_copylist_t {
 	fs::path src_dir;
@@ -65,11 +73,14 @@ struct mpm_copylist_t {
 	//ss::vector<ss::string<128>, 32> filenames;
 	recdb::rec_t rec;
 	int fileno_offset{0};
+	fs::path staging_dir;
+	bool needs_copy{false};
 	mpm_copylist_t() = default;
 	mpm_copylist_t(const fs::path& src_dir_, const fs::path& dst_dir_, const recdb::rec_t& rec_)
 		: src_dir(src_dir_)
 		, dst_dir(dst_dir_)
 		, rec(rec_)
+		, staging_dir(recording_staging_dir(src_dir_.parent_path(), rec_))
 		{}
 
 	void run(db_txn& txn);
@@ -97,14 +108,48 @@ public:
 
 class playback_mpm_t;
 
+/*
+	Snapshot of the fields of meta_marker_t which active_mpm_t changes after every read batch
+*/
+struct live_position_t {
+	int64_t num_bytes_safe_to_read{0};
+	recdb::marker_t current_marker{};
+	system_time_t livebuffer_end_time{};
+};
+
+/*
+	Sequence lock through which a single writer (the thread running active_mpm_t::process_channel_data)
+	publishes live_position_t without taking the meta_marker mutex. Readers retry when the writer
+	was active while they copied the data. The data is kept in atomics, so that reading it while it is
+	being overwritten is not a data race.
+*/
+class live_position_seqlock_t {
+	std::atomic<uint32_t> seq{0}; //odd while an update is in progress
+	std::atomic<int64_t> num_bytes_safe_to_read{0};
+	std::atomic<int64_t> marker_time{0}; //milliseconds
+	std::atomic<uint64_t> marker_packetnos{0}; //packetno_start << 32 | packetno_end
+	std::atomic<int64_t> livebuffer_end_time{0}; //ticks of system_time_t since epoch
+public:
+	void store(const live_position_t& pos);
+	live_position_t load() const;
+};
+
 /*!Records the current state of playback or livebuffer recording
 
+	In an active_mpm, num_bytes_safe_to_read, current_marker and livebuffer_end_time change after every read batch.
+	They are only accessed by the thread running process_channel_data, which publishes them in live_position
+	without locking the mutex. Other threads must read them from live_position.
+	The other fields change rarely and are protected by the mutex. Whenever current_file_record, last_streams or
+	livebuffer_start_time change, structure_changed must be called.
  */
 class meta_marker_t {
-	bool was_interrupted = false;
+	std::atomic<bool> was_interrupted = false;
+	std::atomic<uint32_t> structure_version{0};
+	std::atomic<uint32_t> update_count{0}; //futex on which playback clients wait for updates
+	std::atomic<int> num_waiters{0}; //number of playback clients waiting on update_count
+	void notify_update();
 public:
 	bool started = false;
-	mutable std::condition_variable cv;
 	int last_seen_txn_id =-1;
 	int64_t num_bytes_safe_to_read = 0; //counted from the start of tuning to service (active_mpm only)
  	recdb::file_t current_file_record{}; //file being played back or modified (active_mpm only)
@@ -117,6 +162,7 @@ public:
 	system_time_t livebuffer_end_time{};
 	milliseconds_t livebuffer_stream_time_start{};
 	recdb::stream_descriptor_t last_streams; //points to database record containing newest current pmt and such
+	live_position_seqlock_t live_position; //active_mpm only
 
 	std::vector<playback_mpm_t*> playback_clients; /*for an active_mpm_t: filenos currently being played back
 																									by any passive mpms coupled to it
@@ -135,12 +181,22 @@ public:
 
 /*
 	waits for a change in this meta_marker compared to "other" and then
-	updates other; mutex should be locked prior to calling this function
+	updates other; mutex is only locked when structural fields have changed
 */
 	void wait_for_update(meta_marker_t& other, std::mutex& mutex);
+
+	//publish num_bytes_safe_to_read, current_marker and livebuffer_end_time and wake up waiting playback clients
+	void publish_live_position();
+
+	//call with mutex locked, after changing current_file_record, last_streams or livebuffer_start_time
+	void structure_changed() {
+		structure_version.fetch_add(1);
+		notify_update();
+	}
+
 	void interrupt() {
 		was_interrupted = true;
-		cv.notify_all();
+		notify_update();
 	}
 	/*
 		first and last record from database (for non live).
@@ -222,6 +278,21 @@ class playback_mpm_t : public mpm_t {
 																		-1 means: need initialisation
 																 */
 	meta_marker_t last_seen_live_meta_marker; //only used when playing a live buffer
+	std::unique_ptr<readahead_t> readahead; //null if disabled
+	safe::Safe<keyframe_index_t, std::mutex> keyframe_index;
+
+	/*
+		trick play: instead of the full stream, only the blocks containing an i-frame (see keyframe_index_t)
+		are sent, trick_play_fps times per second; successive blocks are speed/trick_play_fps seconds apart
+		in the recording. speed<0 means rewind. |speed| <= 1 means normal playback
+	*/
+	static constexpr int trick_play_fps = 4;
+	std::atomic<float> trick_play_speed{0};
+	struct {
+		int64_t end_byte_pos{-1}; //end of the i-frame block currently being sent; -1 if trick play is not active
+		milliseconds_t keyframe_time{}; //time of that block
+		steady_clock_t::time_point keyframe_send_time{}; //when we started sending it
+	} trick_play;
 
 	bool is_timeshifted{false};
 	recdb::rec_t currently_playing_recording{};
@@ -243,7 +314,7 @@ public:
 private:
 	void find_current_pmts(int64_t bytepos);
 	int get_end_marker_from_db(db_txn& txn, recdb::marker_t& end_marker);
-	int get_marker_for_time_from_db(db_txn& idxdb_txn, recdb::marker_t& current_marker, milliseconds_t start_play_time);
+	int get_marker_for_time(db_txn& idxdb_txn, recdb::marker_t& current_marker, milliseconds_t start_play_time);
 
 	//int refresh_markers_(db_txn& txn);
 	//int refresh_markers_(db_txn& txn, milliseconds_t milliseconds);
@@ -253,6 +324,9 @@ private:
 	int open_file_containing_time(db_txn& recdb_txn, milliseconds_t start_time);
 
 	int open_next_file();
+	void init_readahead();
+	void update_readahead(db_txn& idxdb_txn, const recdb::marker_t& end_marker, bool seek);
+	int trick_play_step();
 	int64_t copy_filtered_packets(char* outbuffer, uint8_t* inbuffer, int64_t numbytes);
 	std::tuple<int,int> copy_filtered_packets(char* outbuffer, uint8_t* inbuffer, int outbytes, int inbytes);
 	int64_t read_pmt_data(char* outbuffer, uint64_t numbytes);
@@ -282,6 +356,10 @@ public:
 	EXPORT int64_t read_data(char* buffer, uint64_t numbytes);
 	EXPORT int move_to_time(milliseconds_t start_play_time);
 	EXPORT int move_to_live();
+	EXPORT void set_trick_play_speed(float speed);
+	float get_trick_play_speed() const {
+		return trick_play_speed;
+	}
 	//int open(int fileno=0); //find and open file
 	EXPORT void close();
 	EXPORT milliseconds_t get_current_play_time() const;
@@ -290,6 +368,7 @@ public:
 		return currently_playing_file.readAccess()->fileno;
 	}
 	EXPORT playback_info_t get_current_program_info() const;
+	EXPORT readahead_stats_t get_readahead_stats() const;
 	EXPORT int set_language_pref(int idx, bool for_subtitles);
 	inline int set_audio_language(int audio_idx) {
 		return set_language_pref(audio_idx, false);
@@ -347,6 +426,15 @@ private:
 	bool next_key(int parity);
 	void transfer_filemap(int fd, int64_t new_num_bytes_safe_to_read); //helper
 
+	/*!
+		number of bytes (since tuning) which have been decrypted and are on file; with mmap
+		this is the same as num_bytes_decrypted
+	*/
+	int64_t num_bytes_persisted() const {
+		auto ret = current_file_stream_packetno_start * (int64_t)dtdemux::ts_packet_t::size + filemap.get_persisted_filesize();
+		return std::min(ret - ret % dtdemux::ts_packet_t::size, num_bytes_decrypted);
+	}
+
   /*!
 		create the directory structure, including the database
 		opens the index database
@@ -51,6 +51,10 @@ void neumo_options_t::load_from_db(db_txn& devdb_wtxn, int32_t user_id)
 		this->timeshift_duration = std::chrono::seconds(u.timeshift_duration);
 		this->livebuffer_retention_time = std::chrono::seconds(u.livebuffer_retention_time);
 		this->livebuffer_mpm_part_duration = std::chrono::seconds(u.livebuffer_mpm_part_duration);
+		this->livebuffer_use_io_uring = u.livebuffer_use_io_uring;
+		this->livebuffer_use_o_direct = u.livebuffer_use_o_direct;
+		this->playback_readahead_seconds = u.playback_readahead_seconds;
+		this->recording_copy_max_mb_per_second = u.recording_copy_max_mb_per_second;
 
 	} else {
 		save_to_db(devdb_wtxn, user_id);
@@ -91,6 +95,10 @@ void neumo_options_t::save_to_db(db_txn& devdb_wtxn, int32_t user_id)
 	u.timeshift_duration = this->timeshift_duration.count();
 	u.livebuffer_retention_time = this->livebuffer_retention_time.count();
 	u.livebuffer_mpm_part_duration = this->livebuffer_mpm_part_duration.count();
+	u.livebuffer_use_io_uring = this->livebuffer_use_io_uring;
+	u.livebuffer_use_o_direct = this->livebuffer_use_o_direct;
+	u.playback_readahead_seconds = this->playback_readahead_seconds;
+	u.recording_copy_max_mb_per_second = this->recording_copy_max_mb_per_second;
 
 	put_record(devdb_wtxn, u);
 }
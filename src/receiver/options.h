@@ -47,6 +47,10 @@ struct neumo_options_t {
 	std::string statdb{"~/neumo/db/statdb.mdb"};
 	std::string epgdb{"~/neumo/db/epgdb.mdb"};
 	std::string recdb{"~/neumo/db/recdb.mdb"};
+	std::string replica_address{}; //if set, serve read-only replicas of chdb, epgdb and recdb (see neumodb/replica.h)
+	std::string virtual_dvb_dir{}; //if set, add virtual adapters which replay the captures in this dir (see vdvb.h)
+	int virtual_dvb_num_adapters{0};
+	double virtual_dvb_speed{1.}; //replay speed of virtual adapters; 0 means: as fast as possible
 	std::string radiobg_svg{"radiobg.svg"};
 	std::string mpvconfig{"mpv"};
 
@@ -75,6 +79,11 @@ struct neumo_options_t {
 	std::chrono::seconds livebuffer_retention_time{5min}; //how soon is an inactive timehsift buffer removed
 
 	std::chrono::seconds livebuffer_mpm_part_duration{300s}; //duration of an mpm part
+	bool livebuffer_use_io_uring{false}; //write livebuffers using io_uring instead of a shared mmap
+	bool livebuffer_use_o_direct{false}; //with io_uring: bypass the page cache when writing livebuffers
+	int32_t playback_readahead_seconds{10}; //playback time to read ahead from recordings and livebuffers; 0: disable
+	int32_t recording_copy_max_mb_per_second{100}; /*speed limit for copying finished recordings when livebuffers and
+																									 recordings are on different filesystems; 0: unlimited*/
 
 	std::chrono::seconds scan_max_duration{180s}; /*after this time, scan will be forcefull ended*/
 
@@ -36,6 +36,10 @@ void export_options(py::module& m) {
 		.def("save_to_db", &neumo_options_t::save_to_db, py::arg("devdb_wtxn"), py::arg("user_id")=0)
 		.def_readwrite("upgrade_dir", &neumo_options_t::upgrade_dir)
 		.def_readwrite("db_dir", &neumo_options_t::db_dir)
+		.def_readwrite("replica_address", &neumo_options_t::replica_address)
+		.def_readwrite("virtual_dvb_dir", &neumo_options_t::virtual_dvb_dir)
+		.def_readwrite("virtual_dvb_num_adapters", &neumo_options_t::virtual_dvb_num_adapters)
+		.def_readwrite("virtual_dvb_speed", &neumo_options_t::virtual_dvb_speed)
 		.def_readwrite("live_path", &neumo_options_t::live_path)
 		.def_readwrite("recordings_path", &neumo_options_t::recordings_path)
 		.def_readwrite("spectrum_path", &neumo_options_t::spectrum_path)
@@ -64,6 +68,14 @@ void export_options(py::module& m) {
 									 "how soon is an inactive timehsift buffer removed")
 		.def_readwrite("livebuffer_mpm_part_duration", &neumo_options_t::livebuffer_mpm_part_duration,
 									 "how quickly live buffers are deleted after they become inactive")
+		.def_readwrite("livebuffer_use_io_uring", &neumo_options_t::livebuffer_use_io_uring,
+									 "write live buffers using io_uring instead of a shared memory map")
+		.def_readwrite("livebuffer_use_o_direct", &neumo_options_t::livebuffer_use_o_direct,
+									 "bypass the page cache when writing live buffers with io_uring")
+		.def_readwrite("playback_readahead_seconds", &neumo_options_t::playback_readahead_seconds,
+									 "playback time (in seconds) to read ahead from recordings and live buffers; 0 disables readahead")
+		.def_readwrite("recording_copy_max_mb_per_second", &neumo_options_t::recording_copy_max_mb_per_second,
+									 "speed limit (MB/s) for copying finished recordings to another filesystem; 0 means unlimited")
 		.def_readwrite("tune_use_blind_tune", &neumo_options_t::tune_use_blind_tune)
 		.def_readwrite("tune_may_move_dish", &neumo_options_t::tune_may_move_dish)
 		.def_readwrite("dish_move_penalty", &neumo_options_t::dish_move_penalty)
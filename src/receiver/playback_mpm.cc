@@ -31,6 +31,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <thread>
 #include <unistd.h>
 #include "util/dtassert.h"
 
@@ -39,6 +40,7 @@ playback_mpm_t::playback_mpm_t(receiver_t& receiver_, subscription_id_t subscrip
 	, receiver(receiver_)
 	, subscription_id(subscription_id_) {
 	error = true;
+	init_readahead();
 };
 
 playback_mpm_t::playback_mpm_t(active_mpm_t& other,
@@ -55,6 +57,54 @@ playback_mpm_t::playback_mpm_t(active_mpm_t& other,
 	ls->next_streams = {};
 	ls->audio_pref = live_service.audio_pref;
 	ls->subtitle_pref = live_service.subtitle_pref;
+	init_readahead();
+}
+
+void playback_mpm_t::init_readahead() {
+	auto r = receiver.options.readAccess();
+	if (r->playback_readahead_seconds <= 0)
+		return;
+	readahead_options_t o;
+	o.window_seconds = r->playback_readahead_seconds;
+	readahead = std::make_unique<readahead_t>(o);
+}
+
+/*
+	Inform the readahead worker about the file which was just opened (or the new position in it),
+	the bitrate of the recording and the next part of the recording
+*/
+void playback_mpm_t::update_readahead(db_txn& idxdb_txn, const recdb::marker_t& end_marker, bool seek) {
+	if (!readahead)
+		return;
+	if (std::abs(trick_play_speed.load()) > 1) {
+		readahead->clear_file(); //trick play only needs a few blocks per second; do not read the data in between
+		return;
+	}
+	auto f = currently_playing_file.readAccess();
+	bool is_growing = f->stream_packetno_end == std::numeric_limits<int64_t>::max() ||
+		f->stream_time_end == std::numeric_limits<milliseconds_t>::max();
+	//bitrate of the current part; for a growing part, of the part written so far
+	auto packetno_end = is_growing ? end_marker.packetno_end : f->stream_packetno_end;
+	auto time_end = is_growing ? end_marker.k.time : f->stream_time_end;
+	auto duration_ms = (int64_t)time_end - (int64_t)f->k.stream_time_start;
+	if (duration_ms > 0 && packetno_end > f->stream_packetno_start)
+		readahead->set_bitrate((packetno_end - f->stream_packetno_start) * (double)dtdemux::ts_packet_t::size * 1000. / duration_ms);
+
+	ss::string<128> next_filename;
+	if (!is_growing) {
+		using namespace recdb;
+		auto c = file_t::find_by_key(idxdb_txn, file_key_t(f->stream_time_end), find_eq);
+		if (c.is_valid())
+			next_filename.format("{:s}/{:s}", dirname, c.current().filename);
+	}
+	readahead->set_file(filemap.fd, filemap.offset + filemap.read_pointer, filemap.offset + filemap.safe_read_len,
+											next_filename.c_str(), seek);
+	//start reading the first data right away; the worker will take over
+	filemap.willneed(readahead->options.min_window_bytes);
+}
+
+readahead_stats_t playback_mpm_t::get_readahead_stats() const {
+	return readahead ? readahead->get_stats() : readahead_stats_t{};
 }
 
 /*
@@ -115,6 +165,7 @@ void playback_mpm_t::open_recording(const char* dirname_) {
 	current_byte_pos = 0;
 	recdb::file_t empty{};
 	currently_playing_file.assign(empty);
+	keyframe_index.writeAccess()->clear();
 	auto txn = db->mpm_rec.recdb.rtxn();
 	using namespace recdb;
 	auto c = find_first<recdb::rec_t>(txn);
@@ -140,6 +191,13 @@ void playback_mpm_t::open_recording(const char* dirname_) {
 */
 
 void playback_mpm_t::close() {
+	if (readahead) {
+		readahead->clear_file();
+		auto s = readahead->get_stats();
+		dtdebugf("readahead: {:d} prefetches ({:d} MB) {:d} next parts {:d} seeks; {:d} stalls, max {:d}ms total {:d}ms",
+						 s.num_prefetches, s.num_bytes_prefetched / (1024 * 1024), s.num_next_part_prefetches, s.num_seeks,
+						 s.num_stalls, s.max_stall_time.count() / 1000, s.total_stall_time.count() / 1000);
+	}
 	if (live_mpm)
 		live_mpm->meta_marker.writeAccess()->unregister_playback_client(this);
 	if (filemap.buffer) {
@@ -339,12 +397,90 @@ int playback_mpm_t::move_to_time(milliseconds_t start_play_time) {
 	if (start_play_time < milliseconds_t(0))
 		start_play_time = milliseconds_t(0);
 	dtdebugf("Starting move_to_time");
+	trick_play.end_byte_pos = -1; //trick play, if active, continues from the new position
 	auto idxdb_txn = db->mpm_rec.idxdb.rtxn();
 	auto ret = open_(idxdb_txn, start_play_time);
 	idxdb_txn.abort();
 	return ret;
 }
 
+void playback_mpm_t::set_trick_play_speed(float speed) {
+	dtdebugf("trick play speed={}", speed);
+	trick_play_speed = speed;
+}
+
+/*
+	Called before every read. In trick play mode, when the current i-frame block has been sent,
+	wait until it is time to show the next i-frame and move to the block which is speed/trick_play_fps
+	seconds further. When trick play ends, normal playback continues at the last i-frame shown.
+	Returns -1 on error
+*/
+int playback_mpm_t::trick_play_step() {
+	float speed = trick_play_speed;
+	if (std::abs(speed) <= 1) {
+		if (trick_play.end_byte_pos < 0)
+			return 0;
+		auto t = trick_play.keyframe_time;
+		return move_to_time(t) < 0 ? -1 : 0;
+	}
+	if (trick_play.end_byte_pos >= 0 && current_byte_pos < trick_play.end_byte_pos)
+		return 0; //still sending the current block
+
+	milliseconds_t from;
+	if (trick_play.end_byte_pos >= 0) {
+		auto due = trick_play.keyframe_send_time + std::chrono::milliseconds(1000 / trick_play_fps);
+		auto now = steady_clock_t::now();
+		if (now < due)
+			std::this_thread::sleep_for(due - now);
+		if (must_exit)
+			return -1;
+		from = trick_play.keyframe_time;
+	} else
+		from = get_current_play_time();
+	milliseconds_t step((int64_t)(std::abs(speed) * 1000 / trick_play_fps));
+
+	recdb::marker_t next;
+	bool found{false};
+	{
+		auto idxdb_txn = db->mpm_rec.idxdb.rtxn();
+		auto idx = keyframe_index.writeAccess();
+		idx->update(idxdb_txn);
+		idxdb_txn.abort();
+		int i{-1};
+		if (speed > 0) {
+			i = idx->find_geq(from + step);
+			if (i + 1 >= idx->size())
+				i = -1; //the last marker is the end of the stream, at which playback cannot start
+		} else {
+			i = idx->find_leq(from - step);
+			if (i < 0 && !idx->empty() && (*idx)[0].k.time < from)
+				i = 0;
+		}
+		if (i >= 0) {
+			next = (*idx)[i];
+			found = true;
+		}
+	}
+
+	if (!found) {
+		dtdebugf("trick play reached {} of stream", speed > 0 ? "end" : "start");
+		trick_play_speed = 0;
+		trick_play.end_byte_pos = -1;
+		//forward: continue playing from the current position; rewind: play from the start
+		return (speed > 0 || move_to_time(milliseconds_t(0)) >= 0) ? 0 : -1;
+	}
+
+	trick_play.keyframe_send_time = steady_clock_t::now();
+	if (move_to_time(next.k.time) < 0)
+		return -1;
+	trick_play.keyframe_time = next.k.time;
+	auto block_len = (int64_t)(next.packetno_end + 1 - next.packetno_start) * ts_packet_t::size;
+	//open_ starts at the beginning of the file if the block starts in a deleted part of a live buffer
+	trick_play.end_byte_pos = std::max((int64_t)(next.packetno_end + 1) * ts_packet_t::size,
+																		 current_byte_pos + block_len);
+	return 0;
+}
+
 int playback_mpm_t::move_to_live() {
 	assert(live_mpm);
 	milliseconds_t start_play_time{0};
@@ -398,14 +534,14 @@ int playback_mpm_t::open_(db_txn& idxdb_txn, milliseconds_t start_time) {
 	*/
 	recdb::marker_t current_marker;
 	get_end_marker_from_db(idxdb_txn, end_marker);
-	if (start_time >= end_marker.k.time || get_marker_for_time_from_db(idxdb_txn, current_marker, start_time) < 0) {
+	if (start_time >= end_marker.k.time || get_marker_for_time(idxdb_txn, current_marker, start_time) < 0) {
 		dtdebugf("Requested start_play_time is beyond last logged packet");
 		if (live_mpm) {
-			auto mm = live_mpm->meta_marker.readAccess();
-			if (start_time >= mm->current_marker.k.time) {
+			auto live_marker = live_mpm->meta_marker.unsafe().live_position.load().current_marker;
+			if (start_time >= live_marker.k.time) {
 				is_timeshifted = false; //handles the case where a user jumps forward past current time
-				current_marker = mm->current_marker;
-				start_time = mm->current_marker.k.time;
+				current_marker = live_marker;
+				start_time = live_marker.k.time;
 			}
 		} else {
 			start_time = end_marker.k.time;
@@ -473,10 +609,12 @@ int playback_mpm_t::open_(db_txn& idxdb_txn, milliseconds_t start_time) {
 	// by setting bytepos to zero
 
 	auto start_byte_pos = start_packet * dtdemux::ts_packet_t::size;
+	bool seek = current_byte_pos != start_byte_pos;
 	if (!(current_byte_pos == start_byte_pos || current_byte_pos == 0)) {
 		dtdebugf("current_byte_pos={:d} start_byte_pos={:d}", current_byte_pos, start_byte_pos);
 	}
 	current_byte_pos = start_byte_pos;
+	update_readahead(idxdb_txn, end_marker, seek);
 
 	return 1;
 }
@@ -660,8 +798,12 @@ std::tuple<int, int> playback_mpm_t::read_data_(char* outbuffer, int outbytes, i
 			}
 
 		bool still_not_open = (int64_t)end_time == std::numeric_limits<int64_t>::max();
+		auto t_open = steady_clock_t::now();
 		auto ret = still_not_open ? -1 : open_(idxdb_txn, end_time);
 		idxdb_txn.abort();
+		if (readahead && ret > 0)
+			readahead->record_access_time(
+				std::chrono::duration_cast<std::chrono::microseconds>(steady_clock_t::now() - t_open));
 		if(ret == 0 && live_mpm)
 			continue;
 		if (ret <= 0) { // end time of current file is start time of new one
@@ -679,9 +821,18 @@ std::tuple<int, int> playback_mpm_t::read_data_(char* outbuffer, int outbytes, i
 		return {-1, -1};
 	}
 	inbytes = std::min(inbytes, remaining_space);
+	if (trick_play.end_byte_pos >= 0) //only send the current i-frame block
+		inbytes = std::min(inbytes, (int)(trick_play.end_byte_pos - current_byte_pos));
+	auto t_copy = steady_clock_t::now();
 	auto [num_bytes_out, num_bytes_in] = copy_filtered_packets(outbuffer, buffer, outbytes, inbytes);
 	dttime(100);
 	filemap.advance_read_pointer(num_bytes_in);
+	if (readahead) {
+		//copying from the file mapping only takes long if pages were not in the cache
+		readahead->record_access_time(
+			std::chrono::duration_cast<std::chrono::microseconds>(steady_clock_t::now() - t_copy));
+		readahead->set_read_position(filemap.offset + filemap.read_pointer, filemap.offset + filemap.safe_read_len);
+	}
 	dttime(100);
 	current_byte_pos += num_bytes_in;
 	return {num_bytes_out, num_bytes_in};
@@ -707,6 +858,8 @@ int64_t playback_mpm_t::read_data(char* outbuffer, uint64_t num_bytes) {
 			The loop is therefore needed, to retry the read.
 		 */
 
+		if (trick_play_step() < 0)
+			return -1;
 		auto max_bytes = next_stream_change(); /* max_bytes byte at which is the number of bytes to read before
 																							new pmt becomes active (coincides with end of old pmt);
 																							we may never read past that point without calling next_stream_change
@@ -831,9 +984,16 @@ int64_t playback_mpm_t::read_data_from_current_file(uint8_t*& buffer) {
 
 
 milliseconds_t playback_mpm_t::get_current_play_time() const {
+	auto packetno = current_byte_pos / ts_packet_t::size;
+	{
+		auto idx = keyframe_index.readAccess();
+		auto i = idx->find_by_packetno(packetno);
+		if (i >= 0 && i + 1 < idx->size()) //otherwise newer markers may exist in the database
+			return (*idx)[i].k.time;
+	}
 	auto txn = db->mpm_rec.idxdb.rtxn();
 	{
-		auto c = recdb::marker_t::find_by_packetno(txn, current_byte_pos / ts_packet_t::size, find_leq);
+		auto c = recdb::marker_t::find_by_packetno(txn, packetno, find_leq);
 		if (!c.is_valid())
 			return milliseconds_t(0);
 		auto m = c.current();
@@ -916,16 +1076,21 @@ int playback_mpm_t::get_end_marker_from_db(db_txn& txn, recdb::marker_t& end_mar
 	return 0;
 }
 
-int playback_mpm_t::get_marker_for_time_from_db(db_txn& idxdb_txn, recdb::marker_t& current_marker,
-																								milliseconds_t start_play_time) {
-
-	auto c = recdb::marker_t::find_by_key(idxdb_txn, recdb::marker_key_t(start_play_time), find_geq);
-	if (!c.is_valid()) {
+/*
+	find the first marker at or after start_play_time, using the keyframe index.
+	Markers written since the index was last updated (live buffers, ongoing recordings) are loaded as needed
+*/
+int playback_mpm_t::get_marker_for_time(db_txn& idxdb_txn, recdb::marker_t& current_marker,
+																				milliseconds_t start_play_time) {
+	auto idx = keyframe_index.writeAccess();
+	if (idx->empty() || idx->back().k.time < start_play_time)
+		idx->update(idxdb_txn);
+	auto i = idx->find_geq(start_play_time);
+	if (i < 0) {
 		dtdebugf("Could not obtain marker for time {}", start_play_time);
 		return -1;
 	}
-	current_marker = c.current();
-
+	current_marker = (*idx)[i];
 	return 0;
 }
 
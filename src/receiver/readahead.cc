@@ -0,0 +1,189 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "readahead.h"
+#include "util/logger.h"
+#include "util/util.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+struct readahead_t::file_t {
+	int fd{-1};
+	file_t(int fd) : fd(fd) {}
+	~file_t() {
+		if (fd >= 0)
+			::close(fd);
+	}
+};
+
+readahead_t::readahead_t(const readahead_options_t& options_)
+	: options(options_) {
+	thread = std::thread([this]() { run(); });
+}
+
+readahead_t::~readahead_t() {
+	{
+		std::scoped_lock lck(mutex);
+		must_exit = true;
+	}
+	cv.notify_one();
+	thread.join();
+}
+
+int64_t readahead_t::window_bytes() const {
+	int64_t ret = stats.bitrate * options.window_seconds;
+	return std::clamp(ret, options.min_window_bytes, options.max_window_bytes);
+}
+
+//mutex must be locked
+bool readahead_t::has_work() const {
+	if (!file)
+		return false;
+	auto target = std::min(read_pos + window_bytes(), end_pos);
+	if (prefetched_until < target)
+		return true;
+	return !next_part_done && !next_filename.empty() && read_pos + window_bytes() >= end_pos;
+}
+
+void readahead_t::set_file(int fd, int64_t read_pos_, int64_t end_pos_, const char* next_filename_, bool seek) {
+	int newfd = fd >= 0 ? ::dup(fd) : -1;
+	if (fd >= 0 && newfd < 0)
+		dterrorf("readahead: could not duplicate fd: {}", strerror(errno));
+	{
+		std::scoped_lock lck(mutex);
+		file = newfd >= 0 ? std::make_shared<file_t>(newfd) : nullptr; //old file is closed when worker releases it
+		read_pos = read_pos_;
+		end_pos = end_pos_;
+		prefetched_until = read_pos;
+		if (next_filename != next_filename_) {
+			next_filename = next_filename_;
+			next_part_done = false;
+		}
+		if (seek)
+			stats.num_seeks++;
+	}
+	cv.notify_one();
+}
+
+void readahead_t::clear_file() {
+	std::scoped_lock lck(mutex);
+	file.reset();
+	next_filename.clear();
+}
+
+void readahead_t::set_read_position(int64_t read_pos_, int64_t end_pos_) {
+	bool wakeup{false};
+	{
+		std::scoped_lock lck(mutex);
+		read_pos = read_pos_;
+		end_pos = std::max(end_pos, end_pos_);
+		if (prefetched_until < read_pos)
+			prefetched_until = read_pos; //worker is behind; skip data already read
+		//wake up the worker when less than half of the window is left, to avoid many small reads
+		wakeup = file && (prefetched_until - read_pos < window_bytes() / 2) && has_work();
+	}
+	if (wakeup)
+		cv.notify_one();
+}
+
+void readahead_t::set_bitrate(double bitrate) {
+	std::scoped_lock lck(mutex);
+	stats.bitrate = bitrate;
+}
+
+void readahead_t::record_access_time(std::chrono::microseconds duration) {
+	if (duration < options.stall_threshold)
+		return;
+	std::scoped_lock lck(mutex);
+	stats.num_stalls++;
+	stats.total_stall_time += duration;
+	stats.max_stall_time = std::max(stats.max_stall_time, duration);
+}
+
+readahead_stats_t readahead_t::get_stats() {
+	std::scoped_lock lck(mutex);
+	return stats;
+}
+
+void readahead_t::prefetch_next_part(const std::string& filename) {
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		dtdebugf("readahead: cannot open {}: {}", filename, strerror(errno));
+		return;
+	}
+	posix_fadvise(fd, 0, options.next_part_bytes, POSIX_FADV_WILLNEED);
+	::close(fd);
+	std::scoped_lock lck(mutex);
+	stats.num_next_part_prefetches++;
+}
+
+void readahead_t::run() {
+	pthread_setname_np(pthread_self(), "readahead");
+	std::vector<uint8_t> scratch(options.chunk_size);
+	std::unique_lock<std::mutex> lck(mutex);
+	for (;;) {
+		cv.wait(lck, [this]() { return must_exit || has_work(); });
+		if (must_exit)
+			break;
+		auto target = std::min(read_pos + window_bytes(), end_pos);
+		if (prefetched_until < target) {
+			auto f = file;
+			auto start = prefetched_until;
+			auto len = std::min((int64_t)options.chunk_size, target - start);
+			lck.unlock();
+			/*
+				posix_fadvise only starts asynchronous reads (and only when the kernel agrees); pread makes sure
+				the data is really in the page cache when the player accesses it, also on network file systems
+			*/
+			posix_fadvise(f->fd, start, len, POSIX_FADV_WILLNEED);
+			auto ret = ::pread(f->fd, scratch.data(), len, start);
+			auto err = errno;
+			lck.lock();
+			if (ret < 0) {
+				if (err != EINTR && file == f) {
+					dtdebugf("readahead: read failed: {}", strerror(err));
+					file.reset(); //give up on this file
+				}
+				continue;
+			}
+			if (file != f)
+				continue; //file or position changed while reading
+			if (ret > 0) {
+				stats.num_prefetches++;
+				stats.num_bytes_prefetched += ret;
+				prefetched_until = std::max(prefetched_until, start + ret);
+			}
+			if (ret < len)
+				end_pos = std::min(end_pos, start + ret); //end of file
+			continue;
+		}
+		//the end of the current part is within the window: prefetch the start of the next part
+		auto filename = next_filename;
+		next_part_done = true;
+		lck.unlock();
+		prefetch_next_part(filename);
+		lck.lock();
+	}
+}
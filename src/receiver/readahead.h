@@ -0,0 +1,111 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <stdint.h>
+#include <sys/types.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct readahead_options_t {
+	int window_seconds{10}; //prefetch this much playback time ahead of the read position
+	int64_t min_window_bytes{4 * 1024 * 1024};
+	int64_t max_window_bytes{256 * 1024 * 1024};
+	int chunk_size{2 * 1024 * 1024}; //size of a single read issued by the worker
+	int64_t next_part_bytes{16 * 1024 * 1024}; //prefetched from the start of the next mpm part
+	std::chrono::milliseconds stall_threshold{40}; //reads taking longer than this are counted as stalls
+};
+
+struct readahead_stats_t {
+	int64_t num_prefetches{0};
+	int64_t num_bytes_prefetched{0};
+	int64_t num_next_part_prefetches{0};
+	int64_t num_seeks{0};
+	int64_t num_stalls{0}; //reads from the file mapping or part transitions which took too long
+	std::chrono::microseconds total_stall_time{};
+	std::chrono::microseconds max_stall_time{};
+	double bitrate{0}; //bytes per second, as last estimated from the marker index
+};
+
+/*
+	Asynchronous readahead for playback of recordings and live buffers (playback_mpm_t).
+
+	playback_mpm_t reads from a file mapping, so every page which is not in the page cache causes a blocking
+	page fault in mpv's read callback. On slow storage (e.g., a NAS with spinning disks) this causes
+	hiccups, especially after seeks and when playback continues in the next part of the recording.
+
+	A worker thread therefore reads the file ahead of the current read position, so that the data is in the
+	page cache when the mapping is accessed. The amount of data read ahead is window_seconds of playback time,
+	computed from the bitrate of the recording, and limited by the part of the file which is known to contain
+	valid data. Near the end of a part, the start of the next part is read as well.
+
+	All public functions are called from the playback thread; the worker only touches the page cache.
+*/
+class readahead_t {
+	struct file_t; //file descriptor owned by readahead_t
+	std::mutex mutex; //protects everything below
+	std::condition_variable cv;
+	std::shared_ptr<file_t> file;
+	std::string next_filename;
+	int64_t read_pos{0}; //file offset of the next byte the player will read
+	int64_t end_pos{0}; //end of the data in file which is known to be valid
+	int64_t prefetched_until{0}; //data in [read_pos, prefetched_until) has been prefetched
+	bool next_part_done{false};
+	bool must_exit{false};
+	readahead_stats_t stats;
+	std::thread thread;
+
+	int64_t window_bytes() const;
+	bool has_work() const;
+	void run();
+	void prefetch_next_part(const std::string& filename);
+
+public:
+	const readahead_options_t options;
+
+	readahead_t(const readahead_options_t& options);
+	~readahead_t();
+
+	/*
+		start prefetching from a new file (fd is duplicated; the caller keeps ownership) or from a new position
+		in the same file. read_pos and end_pos are file offsets.
+		next_filename: the next part of the recording, if known; otherwise empty
+		seek: the position change is caused by a user action
+	*/
+	void set_file(int fd, int64_t read_pos, int64_t end_pos, const char* next_filename, bool seek);
+
+	//stop prefetching (e.g., playback ended)
+	void clear_file();
+
+	//called after every read; wakes up the worker when it needs to prefetch more data
+	void set_read_position(int64_t read_pos, int64_t end_pos);
+
+	//bytes per second
+	void set_bitrate(double bitrate);
+
+	//register the time needed to access data (a read from the mapping or opening of a new part)
+	void record_access_time(std::chrono::microseconds duration);
+
+	readahead_stats_t get_stats();
+};
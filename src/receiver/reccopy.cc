@@ -0,0 +1,352 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "reccopy.h"
+#include "util/logger.h"
+#include "util/util.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <optional>
+#include <pthread.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+int clone_or_link_file(const fs::path& src, const fs::path& dst) {
+	int src_fd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+	if (src_fd < 0)
+		return -1;
+	int dst_fd = ::open(dst.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+	if (dst_fd < 0) {
+		auto err = errno;
+		::close(src_fd);
+		errno = err;
+		return -1;
+	}
+	auto ret = ::ioctl(dst_fd, FICLONE, src_fd);
+	auto err = errno;
+	::close(dst_fd);
+	::close(src_fd);
+	if (ret == 0)
+		return 0;
+	::unlink(dst.c_str());
+	if (err == EXDEV) {
+		errno = err;
+		return -1;
+	}
+	//filesystem does not support reflinks
+	return ::link(src.c_str(), dst.c_str());
+}
+
+fs::path recording_staging_root(const fs::path& live_path) {
+	return live_path / ".finalize";
+}
+
+fs::path recording_staging_dir(const fs::path& live_path, const recdb::rec_t& rec) {
+	return recording_staging_root(live_path) / rec.filename.c_str();
+}
+
+int link_or_stage_file(const fs::path& src, const fs::path& dst, const fs::path& staging_dir) {
+	if (clone_or_link_file(src, dst) == 0)
+		return 0;
+	if (errno != EXDEV) {
+		dterrorf("Error linking {} to {}: {}", src.c_str(), dst.c_str(), strerror(errno));
+		return -1;
+	}
+	std::error_code ec;
+	fs::create_directories(staging_dir, ec);
+	if (ec) {
+		dterrorf("Could not create dir {}: {}", staging_dir.c_str(), ec.message());
+		return -1;
+	}
+	auto staged = staging_dir / dst.filename();
+	fs::create_hard_link(src, staged, ec);
+	if (ec) {
+		dterrorf("Error hardlinking {} to {}: {}", src.c_str(), staged.c_str(), ec.message());
+		return -1;
+	}
+	return 1;
+}
+
+recording_copier_t::recording_copier_t(int64_t max_bytes_per_second, done_cb_t done_cb)
+	: max_bytes_per_second(max_bytes_per_second)
+	, done_cb(done_cb) {
+	thread = std::thread([this]() { run(); });
+}
+
+recording_copier_t::~recording_copier_t() {
+	{
+		std::scoped_lock lck(mutex);
+		must_exit = true;
+	}
+	cv.notify_one();
+	thread.join();
+}
+
+void recording_copier_t::add_job(const recording_copy_job_t& job) {
+	{
+		std::scoped_lock lck(mutex);
+		if (current_staging_dir == job.staging_dir)
+			return;
+		for (auto& j : jobs) {
+			if (j.staging_dir == job.staging_dir)
+				return;
+		}
+		jobs.push_back(job);
+	}
+	cv.notify_one();
+}
+
+void recording_copier_t::cancel_job(const fs::path& staging_dir) {
+	std::optional<recording_copy_job_t> cancelled;
+	{
+		std::scoped_lock lck(mutex);
+		if (current_staging_dir == staging_dir) {
+			cancel_current = true; //run() removes the files when copy_job returns
+		} else {
+			auto it = std::find_if(jobs.begin(), jobs.end(),
+														 [&staging_dir](const auto& j) { return j.staging_dir == staging_dir; });
+			if (it == jobs.end())
+				return;
+			cancelled = *it;
+			jobs.erase(it);
+		}
+	}
+	cv.notify_one();
+	if (cancelled) {
+		dtdebugf("Cancelled copy of recording {}", cancelled->dst_dir.c_str());
+		remove_job_files(*cancelled);
+	}
+}
+
+std::vector<recdb::rec_t> recording_copier_t::pending_recordings() {
+	std::vector<recdb::rec_t> ret;
+	std::scoped_lock lck(mutex);
+	for (auto& j : jobs)
+		ret.push_back(j.rec);
+	if (!current_staging_dir.empty())
+		ret.push_back(current_rec);
+	return ret;
+}
+
+int recording_copier_t::num_pending_jobs() {
+	std::scoped_lock lck(mutex);
+	return jobs.size() + !current_staging_dir.empty();
+}
+
+/*
+	removes the staged files of a job which will not be copied, and the partial copies of those files
+*/
+void recording_copier_t::remove_job_files(const recording_copy_job_t& job) {
+	std::error_code ec;
+	for (auto& entry : fs::directory_iterator(job.staging_dir, ec)) {
+		auto part = job.dst_dir / entry.path().filename();
+		part += ".part";
+		fs::remove(part, ec);
+	}
+	fs::remove_all(job.staging_dir, ec);
+	if (ec)
+		dterrorf("Cannot remove {}: {}", job.staging_dir.c_str(), ec.message());
+}
+
+/*
+	sleeps as long as needed to copy num_bytes since start at no more than max_bytes_per_second.
+	Returns false if the copier must exit
+*/
+bool recording_copier_t::throttle(int64_t num_bytes, std::chrono::steady_clock::time_point start) {
+	std::unique_lock<std::mutex> lck(mutex);
+	if (max_bytes_per_second > 0) {
+		auto until = start + std::chrono::microseconds(num_bytes * 1000000 / max_bytes_per_second);
+		cv.wait_until(lck, until, [this]() { return must_exit || cancel_current; });
+	}
+	return !must_exit && !cancel_current;
+}
+
+int recording_copier_t::copy_file(const fs::path& src, const fs::path& dst) {
+	auto part = dst;
+	part += ".part";
+	int src_fd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+	if (src_fd < 0) {
+		dterrorf("Cannot open {}: {}", src.c_str(), strerror(errno));
+		return -1;
+	}
+	int dst_fd = ::open(part.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+	if (dst_fd < 0) {
+		dterrorf("Cannot open {}: {}", part.c_str(), strerror(errno));
+		::close(src_fd);
+		return -1;
+	}
+	struct stat st;
+	int ret = ::fstat(src_fd, &st);
+	off_t offset = ::lseek(dst_fd, 0, SEEK_END); //continue an interrupted copy
+	if (ret < 0 || offset < 0 || offset > st.st_size) {
+		offset = 0;
+		ret = ::ftruncate(dst_fd, 0);
+	}
+	if (offset > 0)
+		dtdebugf("Resuming copy of {} at {:d}/{:d}", src.c_str(), (int64_t)offset, (int64_t)st.st_size);
+
+	bool use_copy_file_range{true};
+	std::vector<uint8_t> buffer;
+	auto start = std::chrono::steady_clock::now();
+	int64_t num_bytes_copied{0};
+	ret = 0;
+	while (offset < st.st_size) {
+		size_t len = std::min((off_t)chunk_size, st.st_size - offset);
+		ssize_t n{-1};
+		if (use_copy_file_range) {
+			loff_t in_offset = offset;
+			loff_t out_offset = offset;
+			n = ::copy_file_range(src_fd, &in_offset, dst_fd, &out_offset, len, 0);
+			if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+				//not supported between these filesystems
+				use_copy_file_range = false;
+				continue;
+			}
+		} else {
+			buffer.resize(chunk_size);
+			n = ::pread(src_fd, buffer.data(), len, offset);
+			for (ssize_t done = 0; n > 0 && done < n;) {
+				auto w = ::pwrite(dst_fd, buffer.data() + done, n - done, offset + done);
+				if (w < 0) {
+					if (errno == EINTR)
+						continue;
+					n = -1;
+					break;
+				}
+				done += w;
+			}
+		}
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			dterrorf("Error copying {} to {}: {}", src.c_str(), part.c_str(), strerror(errno));
+			ret = -1;
+			break;
+		}
+		if (n == 0)
+			break; //source was truncated
+		//the copied data will not be read again soon
+		posix_fadvise(src_fd, offset, n, POSIX_FADV_DONTNEED);
+		offset += n;
+		num_bytes_copied += n;
+		if (!throttle(num_bytes_copied, start)) {
+			ret = -1;
+			break;
+		}
+	}
+	if (ret >= 0 && ::fdatasync(dst_fd) < 0) {
+		dterrorf("Error syncing {}: {}", part.c_str(), strerror(errno));
+		ret = -1;
+	}
+	::close(dst_fd);
+	::close(src_fd);
+	if (ret < 0)
+		return ret;
+	if (::rename(part.c_str(), dst.c_str()) < 0) {
+		dterrorf("Error renaming {}: {}", part.c_str(), strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+int recording_copier_t::copy_job(const recording_copy_job_t& job) {
+	std::error_code ec;
+	std::vector<fs::path> files;
+	for (auto& entry : fs::directory_iterator(job.staging_dir, ec)) {
+		if (entry.is_regular_file())
+			files.push_back(entry.path());
+	}
+	if (ec) {
+		dterrorf("Cannot read {}: {}", job.staging_dir.c_str(), ec.message());
+		return -1;
+	}
+	std::sort(files.begin(), files.end());
+	dtdebugf("Copying {:d} files from {} to {}", (int)files.size(), job.staging_dir.c_str(), job.dst_dir.c_str());
+	for (auto& src : files) {
+		auto dst = job.dst_dir / src.filename();
+		if (copy_file(src, dst) < 0)
+			return -1;
+		fs::remove(src, ec);
+	}
+	fs::remove(job.staging_dir, ec);
+	if (ec) {
+		dterrorf("Cannot remove {}: {}", job.staging_dir.c_str(), ec.message());
+	}
+	return 0;
+}
+
+void recording_copier_t::run() {
+	pthread_setname_np(pthread_self(), "reccopy");
+	std::unique_lock<std::mutex> lck(mutex);
+	for (;;) {
+		if (must_exit)
+			break;
+		auto it = std::min_element(jobs.begin(), jobs.end(),
+															 [](const auto& a, const auto& b) { return a.next_attempt < b.next_attempt; });
+		if (it == jobs.end()) {
+			cv.wait(lck);
+			continue;
+		}
+		if (it->next_attempt > std::chrono::steady_clock::now()) {
+			cv.wait_until(lck, it->next_attempt);
+			continue;
+		}
+		auto job = *it;
+		jobs.erase(it);
+		current_staging_dir = job.staging_dir;
+		current_rec = job.rec;
+		cancel_current = false;
+		lck.unlock();
+		auto ret = copy_job(job);
+		lck.lock();
+		current_staging_dir.clear();
+		if (must_exit)
+			break; //staging_dir remains; copy will be resumed at next startup
+		if (cancel_current) {
+			cancel_current = false;
+			lck.unlock();
+			dtdebugf("Cancelled copy of recording {}", job.dst_dir.c_str());
+			remove_job_files(job);
+			lck.lock();
+			continue;
+		}
+		if (ret < 0 && ++job.num_failures < max_failures) {
+			auto delay = std::min(retry_delay * (1 << (job.num_failures - 1)), max_retry_delay);
+			dterrorf("Copy of recording {} failed; retrying in {:d}s", job.dst_dir.c_str(), (int)delay.count());
+			job.next_attempt = std::chrono::steady_clock::now() + delay;
+			jobs.push_back(job);
+			continue;
+		}
+		lck.unlock();
+		if (ret < 0) {
+			dterrorf("Copy of recording {} failed {:d} times; giving up", job.dst_dir.c_str(), job.num_failures);
+			remove_job_files(job);
+		} else
+			dtdebugf("Copy of recording {} done", job.dst_dir.c_str());
+		if (done_cb)
+			done_cb(job.rec, ret >= 0);
+		lck.lock();
+	}
+}
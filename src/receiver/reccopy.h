@@ -0,0 +1,119 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include "neumodb/recdb/recdb_extra.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/*
+	Make dst share the data of src without copying it: first try a reflink (FICLONE, supported by e.g. btrfs and xfs),
+	then a hard link. Returns 0 on success; otherwise -1 with errno set (EXDEV if src and dst are on different
+	filesystems)
+*/
+int clone_or_link_file(const fs::path& src, const fs::path& dst);
+
+/*
+	Directory in which the parts of a recording which must still be copied to the recordings directory are kept.
+	It is on the same filesystem as the live buffers, so that the parts can be hard linked into it and the
+	live buffer can be removed before the copy has finished.
+*/
+fs::path recording_staging_dir(const fs::path& live_path, const recdb::rec_t& rec);
+
+//parent directory of all staging directories
+fs::path recording_staging_root(const fs::path& live_path);
+
+/*
+	Make src available as dst using clone_or_link_file. If src and dst are on different filesystems, src is hard
+	linked into staging_dir instead (which is created if needed), from which it must be copied later.
+	Returns 0 if dst was created, 1 if src was staged and -1 on error
+*/
+int link_or_stage_file(const fs::path& src, const fs::path& dst, const fs::path& staging_dir);
+
+struct recording_copy_job_t {
+	recdb::rec_t rec; //kept in FINISHING status until the copy has finished
+	fs::path staging_dir;
+	fs::path dst_dir;
+	int num_failures{0};
+	std::chrono::steady_clock::time_point next_attempt{};
+};
+
+/*
+	Copies recordings from the live buffer filesystem to the recordings filesystem in a background thread.
+
+	All files in staging_dir are copied to dst_dir using copy_file_range (with a fallback to read/write),
+	in chunks and at most max_bytes_per_second. A file is first copied to "<name>.part", which is renamed
+	when complete, after which the staged file is removed. An interrupted copy continues where it stopped,
+	so jobs for which staging_dir still exists can be resumed at startup.
+
+	A job which fails is retried after retry_delay, which doubles after each failure up to max_retry_delay.
+	After max_failures, the job is abandoned: staging_dir and partially copied files are removed, and done_cb
+	is called (from the copy thread) with success=false. done_cb is also called when a job has finished.
+	A cancelled job is removed in the same way, but without calling done_cb
+*/
+class recording_copier_t {
+public:
+	using done_cb_t = std::function<void(const recdb::rec_t& rec, bool success)>;
+
+private:
+	std::mutex mutex; //protects everything below
+	std::condition_variable cv;
+	std::deque<recording_copy_job_t> jobs; //not including the job being copied
+	fs::path current_staging_dir; //job being copied
+	recdb::rec_t current_rec;
+	bool cancel_current{false};
+	bool must_exit{false};
+	int64_t max_bytes_per_second{0};
+	std::thread thread;
+	done_cb_t done_cb;
+
+	void run();
+	int copy_job(const recording_copy_job_t& job);
+	bool throttle(int64_t num_bytes, std::chrono::steady_clock::time_point start);
+	static void remove_job_files(const recording_copy_job_t& job);
+
+public:
+	static constexpr int chunk_size{8 * 1024 * 1024};
+	static constexpr int max_failures{8};
+	static constexpr std::chrono::seconds retry_delay{30};
+	static constexpr std::chrono::seconds max_retry_delay{3600};
+
+	//max_bytes_per_second <= 0: unlimited
+	recording_copier_t(int64_t max_bytes_per_second, done_cb_t done_cb);
+	~recording_copier_t();
+
+	void add_job(const recording_copy_job_t& job);
+	//removes the job and its staged files; a copy in progress is interrupted
+	void cancel_job(const fs::path& staging_dir);
+	//recordings of all jobs which have not yet finished
+	std::vector<recdb::rec_t> pending_recordings();
+	int num_pending_jobs();
+
+	//copies src to dst via "<dst>.part", continuing from the size of an existing "<dst>.part"
+	int copy_file(const fs::path& src, const fs::path& dst);
+};
@@ -458,7 +458,8 @@ void receiver_thread_t::cb_t::abort_scan() {
 void receiver_thread_t::cb_t::send_scan_mux_end_to_scanner(const devdb::fe_t& finished_fe,
 																													 const chdb::any_mux_t& finished_mux,
 																													 const chdb::scan_id_t& scan_id,
-																													 ssptr_t ssptr)
+																													 ssptr_t ssptr,
+																													 const epg_cache_stats_t& epg_cache_stats)
 {
 	auto scanner = get_scanner();
 	if (!scanner.get()) {
@@ -471,7 +472,7 @@ void receiver_thread_t::cb_t::send_scan_mux_end_to_scanner(const devdb::fe_t& fi
 		which will pass the message to the GUI
 	*/
 	assert(ssptr);
-	auto remove_scanner = scanner->on_scan_mux_end(finished_fe, finished_mux, scan_id, ssptr);
+	auto remove_scanner = scanner->on_scan_mux_end(finished_fe, finished_mux, scan_id, ssptr, epg_cache_stats);
 	if (remove_scanner) {
 		reset_scanner();
 	}
@@ -489,18 +490,19 @@ ssptr_t receiver_t::get_ssptr(subscription_id_t subscription_id) {
 
 void receiver_t::on_scan_mux_end(const devdb::fe_t& finished_fe,
 																 const chdb::any_mux_t& finished_mux,
-																 const chdb::scan_id_t& scan_id, subscription_id_t subscription_id) {
+																 const chdb::scan_id_t& scan_id, subscription_id_t subscription_id,
+																 const epg_cache_stats_t& epg_cache_stats) {
 
 	bool has_scanning_subscribers{true};
 	auto& receiver_thread = this->receiver_thread;
 	if(has_scanning_subscribers) {
 		//capturing by value is essential
 		receiver_thread.push_task([&receiver_thread, finished_fe, finished_mux,
-															 scan_id, subscription_id]() {
+															 scan_id, subscription_id, epg_cache_stats]() {
 			auto ssptr = receiver_thread.receiver.get_ssptr(subscription_id);
 			if(ssptr)
 				cb(receiver_thread).send_scan_mux_end_to_scanner(finished_fe, finished_mux,
-																												 scan_id, ssptr);
+																												 scan_id, ssptr, epg_cache_stats);
 			return 0;
 		});
 	}
@@ -1536,6 +1538,17 @@ bool receiver_t::init() {
 		options.load_from_db(devdb_wtxn);
 		devdb_wtxn.commit();
 	}
+	{
+		auto r = this->options.readAccess();
+		if(!r->replica_address.empty()) {
+			int idx = 0;
+			for(neumodb_t* db: {(neumodb_t*)&chdb, (neumodb_t*)&epgdb, (neumodb_t*)&recdb}) {
+				auto address = replica_address_for_db(r->replica_address, db->db_type.c_str(), idx++);
+				replica_servers.push_back(std::make_unique<replica_server_t>(*db, address));
+				replica_servers.back()->start();
+			}
+		}
+	}
 	browse_history.init();
 	rec_browse_history.init();
 	start();
@@ -1860,6 +1873,65 @@ void receiver_thread_t::cb_t::send_spectrum_to_scanner(const devdb::fe_t& finish
 		}
 }
 
+void receiver_thread_t::cb_t::send_spectrum_peaks_to_scanner(const statdb::spectrum_key_t& spectrum_key,
+																														 const ss::vector_<spectral_peak_t>& peaks,
+																														 const chdb::scan_id_t& scan_id) {
+	auto scanner = this->get_scanner();
+	if (!scanner.get())
+		return;
+	auto remove_scanner = scanner->on_spectrum_scan_peaks(spectrum_key, peaks, scan_id);
+	if (remove_scanner) {
+		reset_scanner();
+	}
+}
+
+/*
+	returns the id of the scan for which a spectrum is being acquired in the given range,
+	without changing the band scan status
+ */
+static chdb::scan_id_t active_spectrum_scan_id(chdb::chdb_t&chdb, const chdb::sat_t& sat, chdb::fe_polarisation_t pol,
+																							 int start_freq, int end_freq) {
+	using namespace chdb;
+	auto chdb_rtxn = chdb.rtxn();
+	auto c = chdb::sat_t::find_by_key(chdb_rtxn, sat.sat_pos, sat.sat_band, find_type_t::find_eq);
+	if(!c.is_valid()) {
+		chdb_rtxn.abort();
+		return {};
+	}
+	auto db_sat = c.current();
+	chdb_rtxn.abort();
+	for(auto & band_scan : db_sat.band_scans) {
+		if(!scanner_t::is_our_scan(band_scan.scan_id) || band_scan.pol != pol ||
+			 band_scan.scan_status != scan_status_t::ACTIVE)
+			continue;
+		auto [l, h] =sat_band_freq_bounds(band_scan.sat_band, band_scan.sat_sub_band);
+		if(std::max(l, start_freq) < std::min(h, end_freq))
+			return band_scan.scan_id;
+	}
+	return {};
+}
+
+//called from fe_monitor code
+void receiver_t::on_spectrum_scan_peaks(const spectrum_scan_t& partial_scan) {
+	auto& peaks = partial_scan.peaks;
+	if(peaks.size() == 0)
+		return;
+	auto scan_id = active_spectrum_scan_id(chdb, partial_scan.sat, partial_scan.band_pol.pol, partial_scan.start_freq,
+																				 partial_scan.end_freq);
+	if(!scanner_t::is_our_scan(scan_id))
+		return;
+	//same key as the spectrum which will be made when the band is complete
+	statdb::spectrum_key_t spectrum_key{devdb::rf_path_t{partial_scan.rf_path}, partial_scan.sat.sat_pos,
+		partial_scan.band_pol.pol, system_clock_t::to_time_t(partial_scan.start_time)};
+	auto& receiver_thread = this->receiver_thread;
+	ss::vector<spectral_peak_t, 32> peaks_copy = peaks;
+	//capturing by value is essential
+	receiver_thread.push_task([&receiver_thread, spectrum_key, peaks_copy, scan_id]() {
+		cb(receiver_thread).send_spectrum_peaks_to_scanner(spectrum_key, peaks_copy, scan_id);
+		return 0;
+	});
+}
+
 //called from fe_monitor code
 void receiver_t::on_spectrum_scan_end(const devdb::fe_t& finished_fe, const spectrum_scan_t& spectrum_scan,
 																			const ss::vector_<subscription_id_t>& subscription_ids) {
@@ -33,6 +33,7 @@
 #include "devmanager.h"
 #include "streamparser/packetstream.h"
 #include "streamparser/psi.h"
+#include "neumodb/replica.h"
 #include "util/safe/safe.h"
 
 #define DVB_DEV_PATH "/dev/dvb/adapter"
@@ -58,6 +59,7 @@ struct subscription_options_t;
 struct tune_pars_t;
 struct spectrum_scan_t;
 struct scan_mux_end_report_t;
+struct epg_cache_stats_t;
 struct sdt_data_t;
 
 class active_adapter_t;
@@ -464,8 +466,12 @@ public:
 	void send_spectrum_to_scanner(const devdb::fe_t& finished_fe, const spectrum_scan_t& scan,
 																const chdb::scan_id_t& scan_id,
 																const ss::vector_<subscription_id_t>& subscription_ids);
+	void send_spectrum_peaks_to_scanner(const statdb::spectrum_key_t& spectrum_key,
+																			const ss::vector_<spectral_peak_t>& peaks,
+																			const chdb::scan_id_t& scan_id);
 	void send_scan_mux_end_to_scanner(const devdb::fe_t& finished_fe, const chdb::any_mux_t& mux,
-																		const chdb::scan_id_t& scan_id, ssptr_t ssptr);
+																		const chdb::scan_id_t& scan_id, ssptr_t ssptr,
+																		const epg_cache_stats_t& epg_cache_stats);
 
 	int scan_now();
 	void renumber_card(int old_number, int new_number);
@@ -509,6 +515,7 @@ public:
 	//safe to access from other threads
 	epgdb::epgdb_t epgdb;
 	recdb::recdb_t recdb;
+	std::vector<std::unique_ptr<replica_server_t>> replica_servers; //destroyed before the databases
 
 	using subscriber_map = safe::Safe<std::map<void*, ssptr_t>, std::recursive_mutex>;
 	subscriber_map subscribers;//indexed by address
@@ -631,6 +638,10 @@ public:
 	void on_spectrum_scan_end(const devdb::fe_t& finished_fe, const spectrum_scan_t& scan,
 														const ss::vector_<subscription_id_t>& subscription_ids);
 
+	/*thread safe; called from fe_monitor after acquiring a chunk of a band (partial_scan.band_complete is false),
+		with the peaks confirmed so far in partial_scan.peaks; notify scanner asynchronously*/
+	void on_spectrum_scan_peaks(const spectrum_scan_t& partial_scan);
+
 	//thread safe; called from fe_monitor; notify python subscribers synschronously and scanner asynchronously
 	void on_signal_info(const signal_info_t& info, const ss::vector_<subscription_id_t>& subscription_ids);
 
@@ -639,7 +650,8 @@ public:
 
 	//thread-safe; called from tuner; notify scanner asynchronously
 	void on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_mux_t& mux,
-											 const chdb::scan_id_t& scan_id, subscription_id_t subscription_id);
+											 const chdb::scan_id_t& scan_id, subscription_id_t subscription_id,
+											 const epg_cache_stats_t& epg_cache_stats);
 
 	void notify_spectrum_scan_band_end(subscription_id_t scan_subscription_id, const statdb::spectrum_t& spectrum);
 
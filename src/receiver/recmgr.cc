@@ -20,8 +20,11 @@
 
 #include "recmgr.h"
 #include "active_service.h"
+#include "reccopy.h"
 #include "receiver.h"
 #include "neumodb/chdb/chdb_extra.h"
+#include "neumodb/statdb/signal_history.h"
+#include <algorithm>
 #include <filesystem>
 #include <signal.h>
 #include "fmt/chrono.h"
@@ -39,6 +42,7 @@ void recmgr_thread_t::remove_old_livebuffers() {
 
 	auto r = receiver.options.readAccess();
 	auto& options = *r;
+	std::vector<mpm_copylist_t> background_copies; //cannot be started while txn is open
 	for (auto live_service: c.range()) {
 		//do not remove livebuffers from other processes
 		bool active = (live_service.owner >=0 && !kill((pid_t)live_service.owner, 0));
@@ -63,6 +67,8 @@ void recmgr_thread_t::remove_old_livebuffers() {
 			}
 			rec_txn.commit();
 			copy_command.run();
+			if (copy_command.needs_copy)
+				background_copies.push_back(copy_command);
 		} else
 			rec_txn.abort();
 		std::error_code ec;
@@ -76,6 +82,61 @@ void recmgr_thread_t::remove_old_livebuffers() {
 	c.destroy();
 	txn.commit();
 	recdbmgr.flush_wtxn();
+	for (auto& copy_list : background_copies) {
+		copy_list.rec.subscription_id = -1;
+		copy_list.rec.owner = -1;
+		copy_recording_in_background(copy_list);
+	}
+}
+
+/*
+	Keep the recording in FINISHING status until its data has been copied from the staging directory
+*/
+void recmgr_thread_t::copy_recording_in_background(mpm_copylist_t& copy_list) {
+	dtdebugf("Copying recording in background: {}", copy_list.rec);
+	copy_list.rec.epg.rec_status = epgdb::rec_status_t::FINISHING;
+	update_recording(copy_list.rec);
+	copier->add_job({copy_list.rec, copy_list.staging_dir, copy_list.dst_dir});
+}
+
+/*
+	called from the copier thread, when a copy has finished or has been abandoned after repeated failures
+*/
+void recmgr_thread_t::on_recording_copied(const recdb::rec_t& rec, bool success) {
+	if (!success)
+		dterrorf("Could not copy recording: {}", rec);
+	push_task([this, rec, success]() {
+		auto txn = receiver.recdb.rtxn();
+		auto c = recdb::rec_t::find_by_key(txn, rec.epg.k, find_eq);
+		if (!c.is_valid()) {
+			txn.abort();
+			return 0; //recording was deleted in the mean time
+		}
+		auto r = c.current();
+		txn.abort();
+		if (r.epg.rec_status == epgdb::rec_status_t::FINISHING) {
+			r.epg.rec_status = success ? epgdb::rec_status_t::FINISHED : epgdb::rec_status_t::FAILED;
+			update_recording(r);
+		}
+		return 0;
+	});
+}
+
+/*
+	Cancel background copies of recordings which have been deleted or changed status, e.g., by the gui
+*/
+void recmgr_thread_t::check_copy_jobs() {
+	if (!copier)
+		return;
+	auto txn = receiver.recdb.rtxn();
+	for (auto& rec : copier->pending_recordings()) {
+		auto c = recdb::rec_t::find_by_key(txn, rec.epg.k, find_eq);
+		if (c.is_valid() && c.current().epg.rec_status == epgdb::rec_status_t::FINISHING)
+			continue;
+		dtdebugf("Recording no longer needs to be copied: {}", rec);
+		copier->cancel_job(recording_staging_dir(live_path, rec));
+	}
+	txn.abort();
 }
 
 void recmgr_thread_t::update_recording(const recdb::rec_t& rec_in) {
@@ -95,6 +156,8 @@ void recmgr_thread_t::delete_recording(const recdb::rec_t& rec) {
 	using namespace recdb;
 	using namespace recdb::rec;
 
+	if (copier)
+		copier->cancel_job(recording_staging_dir(live_path, rec));
 	auto parent_txn = receiver.recdb.wtxn();
 	delete_record(parent_txn, rec);
 	parent_txn.commit
@@ -292,6 +355,15 @@ void recmgr_thread_t::startup(system_time_t now_) {
 	*/
 	using namespace recdb;
 	using namespace epgdb;
+	fs::path recordings_path;
+	{
+		auto r = receiver.options.readAccess();
+		live_path = r->live_path.c_str();
+		recordings_path = r->recordings_path.c_str();
+		copier = std::make_unique<recording_copier_t>(
+			int64_t(r->recording_copy_max_mb_per_second) * 1024 * 1024,
+			[this](const recdb::rec_t& rec, bool success) { on_recording_copied(rec, success); });
+	}
 	auto parent_txn = receiver.recdb.wtxn();
 	/*
 		clean recording status of epg records, which may not be uptodate after a crash
@@ -354,8 +426,15 @@ void recmgr_thread_t::startup(system_time_t now_) {
 
 	cr = rec_t::find_by_status_start_time(parent_txn, rec_status_t::FINISHING, find_type_t::find_geq,
 																				rec_t::partial_keys_t::rec_status);
+	std::vector<recording_copy_job_t> interrupted_copies;
 	for (auto rec : cr.range()) {
 		assert(rec.epg.rec_status == rec_status_t::FINISHING);
+		auto staging_dir = recording_staging_dir(live_path, rec);
+		if (fs::exists(staging_dir)) {
+			dtdebugf("Resuming copy of recording: {}", rec);
+			interrupted_copies.push_back({rec, staging_dir, recordings_path / rec.filename.c_str()});
+			continue;
+		}
 		if (rec.epg.end_time + rec.post_record_time < now) {
 			dtdebugf("Finalising unfinised recording: at start up: {}", rec);
 			rec.epg.rec_status = rec_status_t::FINISHED;
@@ -372,6 +451,23 @@ void recmgr_thread_t::startup(system_time_t now_) {
 		}
 	}
 	parent_txn.commit();
+
+	//remove staged data of recordings which were deleted or finalized while the copy was not running
+	std::error_code ec;
+	for (auto& entry : fs::directory_iterator(recording_staging_root(live_path), ec)) {
+		bool used = std::find_if(interrupted_copies.begin(), interrupted_copies.end(), [&entry](const auto& job) {
+			return job.staging_dir == entry.path();
+		}) != interrupted_copies.end();
+		if (used)
+			continue;
+		dtdebugf("Removing orphaned staging dir {}", entry.path().c_str());
+		fs::remove_all(entry.path(), ec);
+		if (ec)
+			dterrorf("Cannot remove {}: {}", entry.path().c_str(), ec.message());
+	}
+
+	for (auto& job : interrupted_copies)
+		copier->add_job(job);
 	remove_old_livebuffers();
 }
 
@@ -734,6 +830,7 @@ void recmgr_thread_t::clean_dbs(system_time_t now, bool at_start) {
 	{
 		auto wtxn = receiver.statdb.wtxn();
 		statdb::statdb_t::clean_log(wtxn);
+		statdb::signal_history::clean(wtxn, system_clock_t::to_time_t(now));
 		wtxn.commit();
 	}
 
@@ -772,7 +869,10 @@ void recmgr_thread_t::stop_recording(const recdb::rec_t& rec) // important that
 	}
 	copy_list.rec.subscription_id = -1;
 	copy_list.rec.owner = -1;
-	update_recording(copy_list.rec);
+	if (ret >= 0 && copy_list.needs_copy)
+		copy_recording_in_background(copy_list);
+	else
+		update_recording(copy_list.rec);
 
 	auto& receiver_thread = receiver.receiver_thread;
 	receiver_thread.push_task([&receiver_thread, subscription_id]() {
@@ -822,6 +922,7 @@ int recmgr_thread_t::run() {
 				dttime(100);
 				livebuffer_db_update.run([this](system_time_t now) { livebuffer_db_update_(now); }, now);
 				dttime(100);
+				copy_jobs_check.run([this](system_time_t now) { check_copy_jobs(); }, now);
 				auto delay = dttime(-1);
 				if (delay >= 500)
 					dterrorf("clean cycle took too long delay={:d}", delay);
@@ -861,6 +962,7 @@ recmgr_thread_t::~recmgr_thread_t() {
 
 int recmgr_thread_t::exit() {
 	dtdebugf("recmgr exit");
+	copier.reset(); //an unfinished copy is resumed at the next start
 	return 0;
 }
 
@@ -24,11 +24,14 @@
 #include "neumodb/epgdb/epgdb_extra.h"
 #include "neumodb/recdb/recdb_extra.h"
 #include "txnmgr.h"
+#include <filesystem>
 
 class receiver_t;
 class active_service_t;
 class recmgr_thread_t;
 class rec_manager_t;
+class recording_copier_t;
+struct mpm_copylist_t;
 
 class mpm_recordings_t {
 
@@ -64,12 +67,18 @@ class recmgr_thread_t : public task_queue_t {
 	rec_manager_t& recmgr;
 	txnmgr_t<recdb::recdb_t> recdbmgr; //one object per thread, so not a reference
 	time_t next_recording_event_time = std::numeric_limits<time_t>::min();
+	std::unique_ptr<recording_copier_t> copier; //copies recordings to another filesystem in the background
+	periodic_t copy_jobs_check{30};
+	std::filesystem::path live_path; //contains the staging dirs of the copier
 
 	virtual int run() final;
 	virtual int exit();
 
 
 	void stop_recording(const recdb::rec_t& rec); // important that this is not a reference (async called)
+	void copy_recording_in_background(mpm_copylist_t& copy_list);
+	void on_recording_copied(const recdb::rec_t& rec, bool success);
+	void check_copy_jobs();
 	void update_recording(const recdb::rec_t& rec_in);
 	void start_recordings(db_txn& rtxn, system_time_t now);
 	void stop_recordings(db_txn& rtxn, system_time_t now);
@@ -19,6 +19,7 @@
  */
 
 #include "scan.h"
+#include "blindscan_planner.h"
 #include "subscriber.h"
 #include "active_adapter.h"
 #include "neumodb/chdb/chdb_extra.h"
@@ -45,6 +46,8 @@ static inline devdb::scan_stats_t operator+(const devdb::scan_stats_t& a, const
 	ret.failed_muxes += b.failed_muxes;
 	ret.locked_muxes += b.locked_muxes;
 	ret.si_muxes += b.si_muxes;
+	ret.band_reuses += b.band_reuses;
+	ret.band_switches += b.band_switches;
 	return ret;
 }
 
@@ -63,6 +66,21 @@ inline devdb::scan_stats_t& scan_t::get_scan_stats_ref(const mux_t& mux) {
 	return scan_stats_dvbs;
 }
 
+template<>
+inline mux_scan_queue_t<chdb::dvbs_mux_t>& scan_t::get_mux_queue<chdb::dvbs_mux_t>() {
+	return mux_queue_dvbs;
+}
+
+template<>
+inline mux_scan_queue_t<chdb::dvbc_mux_t>& scan_t::get_mux_queue<chdb::dvbc_mux_t>() {
+	return mux_queue_dvbc;
+}
+
+template<>
+inline mux_scan_queue_t<chdb::dvbt_mux_t>& scan_t::get_mux_queue<chdb::dvbt_mux_t>() {
+	return mux_queue_dvbt;
+}
+
 inline devdb::scan_stats_t& scan_t::get_scan_stats_ref(int16_t sat_pos) {
 	if(sat_pos == sat_pos_dvbc)
 		return scan_stats_dvbc;
@@ -326,6 +344,85 @@ static inline bool& skip_helper_band(std::map<blindscan_key_t,bool>& skip_map, i
 	return skip_map[blindscan_key_t{sat_pos, band_to_scan}]; //band_to_scan is translated to band
 }
 
+static inline std::string to_string(const ss::bytebuffer_& key) {
+	return std::string((const char*)key.buffer(), key.size());
+}
+
+template<typename mux_t>
+void mux_scan_queue_t<mux_t>::erase(const std::string& primary_key) {
+	auto it = entries.find(primary_key);
+	if(it == entries.end())
+		return;
+	auto& entry = it->second;
+	auto bit = buckets.find(entry.blindscan_key);
+	if(bit != buckets.end()) {
+		auto& bucket = bit->second;
+		(entry.scan_status == chdb::scan_status_t::RETRY ? bucket.retry : bucket.pending).erase(primary_key);
+		if(bucket.retry.empty() && bucket.pending.empty())
+			buckets.erase(bit);
+	}
+	entries.erase(it);
+}
+
+template<typename mux_t>
+void mux_scan_queue_t<mux_t>::update(const std::string& primary_key, const mux_t& mux,
+																		 subscription_id_t scan_subscription_id) {
+	using namespace chdb;
+	erase(primary_key); //mux may have moved to another bucket
+	bool must_scan = (mux.c.scan_status == scan_status_t::PENDING || mux.c.scan_status == scan_status_t::RETRY) &&
+		scanner_t::is_our_scan(mux.c.scan_id) && mux.c.scan_id.subscription_id == (int) scan_subscription_id;
+	if(!must_scan)
+		return;
+	auto pol = get_member(mux, pol, chdb::fe_polarisation_t::NONE);
+	blindscan_key_t blindscan_key{mux.k.sat_pos, pol, mux.frequency}; //frequency is translated to band
+	auto& bucket = buckets[blindscan_key];
+	(mux.c.scan_status == scan_status_t::RETRY ? bucket.retry : bucket.pending).insert(primary_key);
+	entries.insert_or_assign(primary_key, entry_t{blindscan_key, mux.c.scan_status, mux});
+}
+
+/*
+	Bring the queue up to date with the database. The first time, all PENDING and RETRY muxes
+	are read from the scan_status index. Later, only the muxes changed in transactions
+	committed after the previous call are examined.
+ */
+template<typename mux_t>
+void mux_scan_queue_t<mux_t>::sync(db_txn& chdb_rtxn, subscription_id_t scan_subscription_id) {
+	using namespace chdb;
+	auto to_txn_id = chdb_rtxn.txn_id();
+	if(txn_id >= 0 && to_txn_id - txn_id > max_txn_lag)
+		txn_id = -1;
+	if(txn_id < 0) {
+		buckets.clear();
+		entries.clear();
+		for(auto scan_status: {scan_status_t::RETRY, scan_status_t::PENDING}) {
+			auto c = mux_t::find_by_scan_status(chdb_rtxn, scan_status, find_type_t::find_geq,
+																					mux_t::partial_keys_t::scan_status);
+			for(bool done = !c.is_valid(); !done; done = !c.next())
+				update(to_string(c.current_serialized_primary_key()), c.current(), scan_subscription_id);
+		}
+	} else if(to_txn_id > txn_id) {
+		//make a key containing (type_id, txn_id) as its value; this is a key in the log table
+		auto start_logkey = mux_t::make_log_key(txn_id + 1);
+		ss::bytebuffer<32> key_prefix;
+		encode_ascending(key_prefix, data_types::data_type<mux_t>());
+		auto c = chdb_rtxn.pdb->template tcursor_log<mux_t>(chdb_rtxn, key_prefix);
+		find_by_serialized_secondary_key(c, start_logkey, key_prefix, find_type_t::find_geq);
+
+		/*we cannot use c.range() because some secondary keys in
+			log may point to deleted records and my not have a primary record
+		*/
+		for(bool done = !c.is_valid(); !done; done = !c.next()) {
+			auto primary_key = to_string(c.current_serialized_primary_key());
+			mux_t mux;
+			if(c.maincursor.is_valid() && c.get_value(mux))
+				update(primary_key, mux, scan_subscription_id);
+			else
+				erase(primary_key);
+		}
+	}
+	txn_id = to_txn_id;
+}
+
 
 /*check if a finished mux belongs to the current scan_t (it could belong to another scan_t
  */
@@ -340,7 +437,8 @@ subscription_id_t scanner_t::scan_subscription_id_for_scan_id(const chdb::scan_i
 	returns true if scanner is empty and should be removed
 */
 bool scanner_t::on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_mux_t& finished_mux,
-																const chdb::scan_id_t& scan_id, ssptr_t ssptr)
+																const chdb::scan_id_t& scan_id, ssptr_t ssptr,
+																const epg_cache_stats_t& epg_cache_stats)
 {
 
 	if (must_end) {
@@ -354,7 +452,7 @@ bool scanner_t::on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_
 			last_house_keeping_time = steady_clock_t::now();
 			assert(scan.scan_subscription_id == scan_subscription_id);
 
-			scan.on_scan_mux_end(finished_fe, finished_mux, ssptr);
+			scan.on_scan_mux_end(finished_fe, finished_mux, ssptr, epg_cache_stats);
 		} catch(std::runtime_error) {
 			dtdebugf("Detected exit condition");
 			must_end = true;
@@ -375,6 +473,31 @@ bool scanner_t::on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_
 	return false; //this scan must be from another running instance of neumoDVB
 }
 
+bool scanner_t::on_spectrum_scan_peaks(const statdb::spectrum_key_t& spectrum_key,
+																			 const ss::vector_<spectral_peak_t>& peaks,
+																			 const chdb::scan_id_t& scan_id)
+{
+	if (must_end) {
+		dtdebugf("must_end");
+		return true;
+	}
+	auto scan_subscription_id = scan_subscription_id_for_scan_id(scan_id);
+	if((int)scan_subscription_id < 0)
+		return false; //this scan must be from another running instance of neumoDVB
+	auto& scan = scans.at(scan_subscription_id);
+	auto& tune_options = scan.tune_options_for_scan_id(scan_id);
+	auto scan_ssptr = receiver.get_ssptr(scan_subscription_id);
+	dtdebugf("Adding {} peaks from partial spectrum", peaks.size());
+	add_spectral_peaks(spectrum_key.rf_path, spectrum_key, peaks, scan_ssptr, &tune_options, true /*streamed*/);
+	try {
+		scan.housekeeping(true); //start tuning the peaks on idle tuners
+	} catch(std::runtime_error) {
+		dtdebugf("Detected exit condition");
+		must_end = true;
+	}
+	return must_end;
+}
+
 bool scanner_t::on_spectrum_scan_band_end(
 	const devdb::fe_t& finished_fe, const spectrum_scan_t& spectrum_scan,
 	const chdb::scan_id_t& scan_id, const ss::vector_<subscription_id_t>& fe_subscription_ids)
@@ -734,6 +857,9 @@ scan_t::scan_next_peaks(db_txn& chdb_rtxn,
 /*
 	returns the number of pending  muxes to scan, and number of skipped muxes
 	and subscription to erase, and the new value of reusable_subscription_id
+
+	Muxes are taken from the in memory queue, one (sat_pos, pol, band) bucket at a time. When
+	a subscription can be reused, muxes in the band/pol to which its lnb is tuned are tried first.
  */
 template<typename mux_t>
 ssptr_t
@@ -743,6 +869,21 @@ scan_t::scan_next_muxes(db_txn& chdb_rtxn,
 {
 	// start as many subscriptions as possible
 	using namespace chdb;
+	auto& queue = get_mux_queue<mux_t>();
+	queue.sync(chdb_rtxn, scan_subscription_id);
+
+	//band/pol to which the lnb of the reusable subscription is tuned
+	std::optional<blindscan_key_t> tuned_key;
+	if(reusable_ssptr) {
+		auto [it, found] = find_in_map(subscriptions, reusable_ssptr->get_subscription_id());
+		if(found)
+			tuned_key = it->second.blindscan_key;
+	}
+	auto is_tuned_key = [&tuned_key](const blindscan_key_t& key) {
+		return tuned_key && !(key < *tuned_key) && !(*tuned_key < key);
+	};
+
+	std::vector<std::string> done; //muxes to remove from the queue
 	for(int pass=0; pass < 2; ++pass) {
 		/*
 			Now scan any si muxes. If such scans match our scan_id then they must have been added
@@ -758,62 +899,85 @@ scan_t::scan_next_muxes(db_txn& chdb_rtxn,
 			continue;
 		}
 
-		auto c = mux_t::find_by_scan_status(chdb_rtxn, pass ==0
-																				? scan_status_t::RETRY :
-																				scan_status_t::PENDING, find_type_t::find_geq,
-																				mux_t::partial_keys_t::scan_status);
-		for(auto mux_to_scan: c.range()) {
-
-			assert(mux_to_scan.c.scan_status == scan_status_t::PENDING ||
-						 mux_to_scan.c.scan_status == scan_status_t::RETRY);
-			if(!scanner_t::is_our_scan(mux_to_scan.c.scan_id))
-				continue;
-
-			if ((int)subscriptions.size() >=
-					(!reusable_ssptr ? scanner.max_num_subscriptions : scanner.max_num_subscriptions + 1)) {
-				scan_stats.pending_muxes++;
-				continue; // to have accurate num_pending count
-			}
-
-			bool& skip_mux = skip_helper(skip_map, mux_to_scan);
-			if(skip_mux) {
-				scan_stats.pending_muxes++;
-				continue;
-			}
-			if(receiver_thread.must_exit())
-				throw std::runtime_error("Exit requested");
-			auto pol = get_member(mux_to_scan, pol, chdb::fe_polarisation_t::NONE);
-			blindscan_key_t blindscan_key =
-				{mux_to_scan.k.sat_pos, pol, mux_to_scan.frequency}; //frequency is translated to band
-			if(mux_is_being_scanned(mux_to_scan)) {
-				dtdebugf("Skipping mux already in progress: {}", mux_to_scan);
-				continue;
-			}
+		auto scan_bucket = [&](const blindscan_key_t& blindscan_key, typename mux_scan_queue_t<mux_t>::bucket_t& bucket) {
+			auto& muxes = pass == 0 ? bucket.retry : bucket.pending;
+			int num_left = muxes.size();
+			for(auto& primary_key: muxes) {
+				auto& mux_to_scan = queue.entries.at(primary_key).mux;
+				assert(mux_to_scan.c.scan_status == scan_status_t::PENDING ||
+							 mux_to_scan.c.scan_status == scan_status_t::RETRY);
+
+				if ((int)subscriptions.size() >=
+						(!reusable_ssptr ? scanner.max_num_subscriptions : scanner.max_num_subscriptions + 1)) {
+					scan_stats.pending_muxes += num_left;
+					return; // to have accurate num_pending count
+				}
 
-			const bool use_blind_tune = false;
-			scan_subscription_t* ss_ptr{nullptr};
-			bool failed_permanently{false};
-			std::tie(reusable_ssptr, ss_ptr, failed_permanently) =
-				scan_try_mux(reusable_ssptr, mux_to_scan, use_blind_tune, blindscan_key);
+				bool& skip_mux = skip_helper(skip_map, mux_to_scan);
+				if(skip_mux) {
+					//all muxes in the bucket share the same sat, pol, band
+					scan_stats.pending_muxes += num_left;
+					return;
+				}
+				--num_left;
+				if(receiver_thread.must_exit())
+					throw std::runtime_error("Exit requested");
+				if(mux_is_being_scanned(mux_to_scan)) {
+					dtdebugf("Skipping mux already in progress: {}", mux_to_scan);
+					continue;
+				}
 
-			if (!ss_ptr) {
-				// we cannot subscribe the mux right now
-				if(failed_permanently) {
-					skip_mux = false;
-					auto& blindscan = blindscans[blindscan_key];
-					scan_mux_end_report_t report;
-					report.spectrum_key = *blindscan.spectrum_key;
-					report.mux = mux_to_scan;
-					receiver.notify_scan_mux_end(scan_subscription_id, report); //we tried but failed immediately
-				} else {
-					scan_stats.pending_muxes++;
-					skip_mux = true; //ensure that we do not even try muxes on the same sat, pol, band in this run
+				const bool use_blind_tune = false;
+				const bool reusing = !!reusable_ssptr;
+				scan_subscription_t* ss_ptr{nullptr};
+				bool failed_permanently{false};
+				std::tie(reusable_ssptr, ss_ptr, failed_permanently) =
+					scan_try_mux(reusable_ssptr, mux_to_scan, use_blind_tune, blindscan_key);
+
+				if (!ss_ptr) {
+					// we cannot subscribe the mux right now
+					if(failed_permanently) {
+						//scan_try_mux has set the mux to IDLE with scan_result BAD in the database
+						skip_mux = false;
+						done.push_back(primary_key);
+						auto& blindscan = blindscans[blindscan_key];
+						scan_mux_end_report_t report;
+						report.spectrum_key = *blindscan.spectrum_key;
+						report.mux = mux_to_scan;
+						receiver.notify_scan_mux_end(scan_subscription_id, report); //we tried but failed immediately
+					} else {
+						scan_stats.pending_muxes++;
+						skip_mux = true; //ensure that we do not even try muxes on the same sat, pol, band in this run
+					}
+					continue;
+				}
+				done.push_back(primary_key);
+				if(reusing) {
+					if(is_tuned_key(blindscan_key))
+						scan_stats.band_reuses++;
+					else
+						scan_stats.band_switches++;
 				}
-				continue;
 			}
+		};
+
+		if(tuned_key) {
+			auto [it, found] = find_in_map(queue.buckets, *tuned_key);
+			if(found)
+				scan_bucket(it->first, it->second);
+		}
+		for(auto& [blindscan_key, bucket]: queue.buckets) {
+			if(!is_tuned_key(blindscan_key))
+				scan_bucket(blindscan_key, bucket);
 		}
 	}
 
+	/*subscribed muxes will be marked ACTIVE in the database by the tuner thread, but
+		that change may not yet be visible in chdb_rtxn*/
+	for(auto& primary_key: done)
+		queue.erase(primary_key);
+	dtdebugf("mux queue: {:d} muxes in {:d} bands; band_reuses={:d} band_switches={:d}",
+					 (int)queue.entries.size(), (int)queue.buckets.size(), scan_stats.band_reuses, scan_stats.band_switches);
 	return reusable_ssptr;
 }
 /*
@@ -828,50 +992,71 @@ scan_t::scan_next_bands(db_txn& chdb_rtxn,
 {
 	// start as many subscriptions as possible
 	using namespace chdb;
+	/*
+		try bands in the order in which blindscan_planner_t scheduled their sweeps, so that tuners on different
+		cables and dishes sweep at the same time, and dishes move as little as possible. Bands which were not
+		planned come last, in database order
+	*/
+	std::vector<sat_t> sats;
+	std::vector<std::tuple<double, int, int>> bands_to_scan; //planned start, index in sats, index in band_scans
 	auto c = find_first<sat_t>(chdb_rtxn);
-	for(auto sat_to_scan: c.range()) {
-		for(auto& band_scan: sat_to_scan.band_scans) {
+	for(auto sat: c.range()) {
+		bool found{false};
+		for(int i = 0; i < (int) sat.band_scans.size(); ++i) {
+			auto& band_scan = sat.band_scans[i];
 			if(!scanner_t::is_our_scan(band_scan.scan_id))
 				continue;
+			auto it = planned_sweeps.find(blindscan_key_t{sat.sat_pos, band_scan});
+			bands_to_scan.push_back({it == planned_sweeps.end() ? std::numeric_limits<double>::max() : it->second.start_time,
+					(int) sats.size(), i});
+			found = true;
+		}
+		if(found)
+			sats.push_back(sat);
+	}
+	std::stable_sort(bands_to_scan.begin(), bands_to_scan.end(),
+									 [](const auto& a, const auto& b) { return std::get<0>(a) < std::get<0>(b); });
+	for(auto [planned_start, sat_idx, band_idx]: bands_to_scan) {
+		auto& sat_to_scan = sats[sat_idx];
+		auto& band_scan = sat_to_scan.band_scans[band_idx];
+
+		if ((int)subscriptions.size() >=
+				(!reusable_ssptr ? scanner.max_num_subscriptions : scanner.max_num_subscriptions + 1)) {
+			scan_stats.pending_bands++;
+			continue; // to have accurate num_pending count
+		}
 
-			if ((int)subscriptions.size() >=
-					(!reusable_ssptr ? scanner.max_num_subscriptions : scanner.max_num_subscriptions + 1)) {
-				scan_stats.pending_bands++;
-				continue; // to have accurate num_pending count
-			}
+		bool& skip_band = skip_helper_band(skip_map, sat_to_scan.sat_pos, band_scan);
+		if(skip_band) {
+			scan_stats.pending_bands++;
+			continue;
+		}
+		if(receiver_thread.must_exit())
+			throw std::runtime_error("Exit requested");
 
-			bool& skip_band = skip_helper_band(skip_map, sat_to_scan.sat_pos, band_scan);
-			if(skip_band) {
+		blindscan_key_t blindscan_key = {sat_to_scan.sat_pos, band_scan}; //band_scan is translated to band
+		if(band_is_being_scanned(band_scan)) {
+			dtdebugf("Skipping sat band already in progress: {}", band_scan);
+			continue;
+		}
+		bool failed_permanently{false};
+		scan_subscription_t* ss_ptr{nullptr};
+		std::tie(reusable_ssptr, ss_ptr, failed_permanently)
+			= scan_try_band(reusable_ssptr, sat_to_scan, band_scan, blindscan_key, scan_stats);
+
+		if (!ss_ptr) {
+			// we cannot subscribe the mux right now
+			if(failed_permanently) {
+				skip_band = false;
+				auto& blindscan = blindscans[blindscan_key];
+				statdb::spectrum_t spectrum;
+				spectrum.k = *blindscan.spectrum_key;
+				receiver.notify_spectrum_scan_band_end(scan_subscription_id, spectrum); //we tried but failed immediately
+			} else {
 				scan_stats.pending_bands++;
-				continue;
-			}
-			if(receiver_thread.must_exit())
-				throw std::runtime_error("Exit requested");
-
-			blindscan_key_t blindscan_key = {sat_to_scan.sat_pos, band_scan}; //band_scan is translated to band
-			if(band_is_being_scanned(band_scan)) {
-				dtdebugf("Skipping sat band already in progress: {}", band_scan);
-				continue;
-			}
-			bool failed_permanently{false};
-			scan_subscription_t* ss_ptr{nullptr};
-			std::tie(reusable_ssptr, ss_ptr, failed_permanently)
-				= scan_try_band(reusable_ssptr, sat_to_scan, band_scan, blindscan_key, scan_stats);
-
-			if (!ss_ptr) {
-				// we cannot subscribe the mux right now
-				if(failed_permanently) {
-					skip_band = false;
-					auto& blindscan = blindscans[blindscan_key];
-					statdb::spectrum_t spectrum;
-					spectrum.k = *blindscan.spectrum_key;
-					receiver.notify_spectrum_scan_band_end(scan_subscription_id, spectrum); //we tried but failed immediately
-				} else {
-					scan_stats.pending_bands++;
-					skip_band = true; //ensure that we do not even try muxes on the same sat, pol, band in this run
-				}
-				continue;
+				skip_band = true; //ensure that we do not even try muxes on the same sat, pol, band in this run
 			}
+			continue;
 		}
 	}
 	return reusable_ssptr;
@@ -971,7 +1156,7 @@ void scan_t::scan_loop(db_txn& chdb_rtxn, scan_subscription_t& subscription,
 }
 
 void scan_t::on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_mux_t& finished_mux,
-														 ssptr_t finished_ssptr) {
+														 ssptr_t finished_ssptr, const epg_cache_stats_t& epg_cache_stats) {
 	auto scan_stats_before = get_scan_stats();
 	assert(finished_ssptr);
 	auto finished_subscription_id = finished_ssptr->get_subscription_id();
@@ -1023,6 +1208,7 @@ void scan_t::on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_mux
 	if (finished) {
 		assert(subscription.subscription_id == finished_ssptr->get_subscription_id());
 		scan_mux_end_report_t report{subscription, *blindscan.spectrum_key};
+		report.epg_cache_stats = epg_cache_stats;
 		receiver.notify_scan_mux_end(scan_subscription_id, report);
 
 		scan_loop(chdb_rtxn, subscription, finished_fe, finished_mux);
@@ -1223,13 +1409,22 @@ scan_t::scan_try_mux(ssptr_t reusable_ssptr,
 			*/
 			auto chdb_wtxn = receiver.chdb.wtxn();
 			mux_t mux = mux_to_scan; //create copy
-			dtdebugf("SET IDLE ", mux);
+			dtdebugf("SET IDLE {}", mux);
 			mux.c.scan_status = chdb::scan_status_t::IDLE;
-			mux.c.scan_result = chdb::scan_result_t::BAD;
 			mux.c.scan_id = {};
 			namespace m = chdb::update_mux_preserve_t;
+			/*this is the final status of the mux for this scan: the caller stops tracking it.
+				scan_result is part of the preserved scan data, so it is set in the callback. Muxes which
+				meanwhile were taken over by another scan are left alone*/
 			chdb::update_mux(chdb_wtxn, mux, now,
-											 m::flags{(m::MUX_COMMON|m::MUX_KEY)& ~m::SCAN_STATUS}, /*false ignore_key,*/
+											 m::flags{(m::MUX_COMMON|m::MUX_KEY)& ~m::SCAN_STATUS},
+											 [scan_id](chdb::mux_common_t* c, chdb::mux_key_t* key,
+																 const chdb::mux_common_t* db_c, const chdb::mux_key_t* db_key) {
+												 if(db_c && db_c->scan_id != scan_id)
+													 return false;
+												 c->scan_result = chdb::scan_result_t::BAD;
+												 return true;
+											 },
 											 false /*ignore_t2mi_pid*/,
 											 true /*must_exist*/);
 			chdb_wtxn.commit();
@@ -1285,9 +1480,22 @@ scan_t::scan_try_band(ssptr_t reusable_ssptr,
 	assert(scanner_t::is_our_scan(scan_id));
 	if(!reusable_ssptr)
 		reusable_ssptr = subscriber_t::make(&receiver, nullptr /*window*/);
-	ret =
-		receiver_thread.subscribe_spectrum(futures, wtxn, sat, band_scan, reusable_ssptr, tune_options,
-																			 scan_id, true /*do_not_unsubscribe_on_failure*/);
+	/*first try the rf_path (and thus the card input and lnb) which blindscan_planner_t assigned to this band;
+		if it is not available, e.g., because it is still in use by some other band, then fall back
+		to any allowed rf_path*/
+	auto [planned_it, planned_found] = find_in_map(planned_sweeps, blindscan_key);
+	if(planned_found && planned_it->second.rf_path && tune_options.rf_path_is_allowed(*planned_it->second.rf_path)) {
+		auto planned_options = tune_options;
+		planned_options.allowed_rf_paths = {*planned_it->second.rf_path};
+		ret = receiver_thread.subscribe_spectrum(futures, wtxn, sat, band_scan, reusable_ssptr, planned_options,
+																						 scan_id, true /*do_not_unsubscribe_on_failure*/);
+		if((int)ret < 0)
+			dtdebugf("Could not subscribe {}:{} on planned lnb {} rf_in={:d}; trying other rf_paths",
+							 sat, band_scan, planned_it->second.rf_path->lnb, (int)planned_it->second.rf_path->rf_input);
+	}
+	if((int)ret < 0)
+		ret = receiver_thread.subscribe_spectrum(futures, wtxn, sat, band_scan, reusable_ssptr, tune_options,
+																						 scan_id, true /*do_not_unsubscribe_on_failure*/);
 	wtxn.commit();
 	wait_for_all(futures); //remove later
 
@@ -1404,6 +1612,12 @@ bool scanner_t::unsubscribe_scan(std::vector<task_queue_t::future_t>& futures,
 	auto& scan = scans.at(scan_subscription_id);
 	assert(scan.scan_subscription_id == scan_subscription_id);
 	end_scans(scan_subscription_id);
+	if (scan.blindscan_start_time != steady_time_t{}) {
+		using namespace std::chrono;
+		auto actual = duration_cast<seconds>(steady_clock_t::now() - scan.blindscan_start_time).count();
+		auto projected = duration_cast<seconds>(scan.projected_blindscan_end_time - scan.blindscan_start_time).count();
+		dtinfof("Blindscan ended after {:d}s; projected duration was {:d}s", (int)actual, (int)projected);
+	}
 	auto ss = scan.get_scan_stats();
 	scan_stats_abort(ss);
 	ss.finished = true;
@@ -1489,7 +1703,7 @@ int scanner_t::add_spectral_peaks(const devdb::rf_path_t& rf_path,
 																	const statdb::spectrum_key_t& spectrum_key,
 																	const ss::vector_<peak_t>& peaks,
 																	ssptr_t scan_ssptr,
-																	subscription_options_t* options) {
+																	subscription_options_t* options, bool streamed) {
 	auto scan_subscription_id = scan_ssptr->get_subscription_id();
 	assert((int) scan_subscription_id >=0);
 	auto so = options ? *options:
@@ -1523,6 +1737,10 @@ int scanner_t::add_spectral_peaks(const devdb::rf_path_t& rf_path,
 		}  else {
 			assert(blindscan.spectrum_key == spectrum_key);
 		}
+		if(streamed)
+			blindscan.streamed_frequencies.push_back(peak.frequency);
+		else if(blindscan.streamed_frequencies.contains(peak.frequency))
+			continue; //already added while the spectrum was being acquired
 		blindscan.peaks.push_back(peak_to_scan_t(peak, scan_id));
 	}
 
@@ -1551,7 +1769,8 @@ int scanner_t::add_bands(const ss::vector_<chdb::sat_t>& sats,
 		Overwrite old data if needed to avoid ever increasing lists
 		@todo: if a user removes a band from a satellite, it is not possible to remove the old scan record
 	 */
-	auto push_bands = [&pols, &devdb_rtxn, &scan, &tune_options, scan_subscription_id](
+	std::vector<blindscan_band_t> planned_bands;
+	auto push_bands = [&pols, &devdb_rtxn, &scan, &tune_options, &planned_bands, scan_subscription_id](
 		sat_t& sat, auto band_sub_band_tuple )
 		-> std::tuple<int,int> {
 		auto [ sat_band, sat_sub_band] = band_sub_band_tuple;
@@ -1584,6 +1803,7 @@ int scanner_t::add_bands(const ss::vector_<chdb::sat_t>& sats,
 				band_scan = saved;
 				continue;
 		}
+			planned_bands.push_back({sat.sat_pos, sat_band, sat_sub_band, pol, so.start_freq, so.end_freq});
 			num_added++;
 		}
 		return {num_added, num_considered};
@@ -1625,6 +1845,37 @@ int scanner_t::add_bands(const ss::vector_<chdb::sat_t>& sats,
 
 	if(num_added_bands==0) {
 		user_errorf("Could not add any of the {} satellite bands", num_bands);
+	} else {
+		/*
+			Estimate how long the blindscan will take when all usable tuners are used;
+			the estimate is reported again when the scan ends
+		*/
+		blindscan_planner_t planner(make_blindscan_topology(devdb_rtxn, planned_bands), planned_bands);
+		auto projection = planner.project();
+		auto now = steady_clock_t::now();
+		auto end_time = now + std::chrono::duration_cast<steady_clock_t::duration>(
+			std::chrono::duration<double>(projection.duration));
+		if(scan.blindscan_start_time == steady_time_t{})
+			scan.blindscan_start_time = now;
+		scan.projected_blindscan_end_time = std::max(scan.projected_blindscan_end_time, end_time);
+		auto offset = std::chrono::duration<double>(now - scan.blindscan_start_time).count();
+		for(int i = 0; i < (int) planned_bands.size(); ++i) {
+			auto& b = planned_bands[i];
+			blindscan_key_t key;
+			key.sat_pos = b.sat_pos;
+			key.band = {b.sat_band, b.sub_band};
+			key.pol = b.pol;
+			auto t = projection.sweep_start_time[i];
+			auto& planned = scan.planned_sweeps[key];
+			planned = {};
+			if(t >= 0) {
+				planned.start_time = offset + t;
+				planned.rf_path = planner.get_topology().paths[projection.sweep_path[i]].rf_path;
+			}
+		}
+		dtinfof("Blindscan of {:d} bands on {:d} tuners: projected duration {:.0f}s; {:d} bands cannot be swept",
+						num_added_bands, (int)planner.get_topology().tuners.size(), projection.duration,
+						projection.num_unreachable_bands);
 	}
 
 	return num_added_bands;
@@ -1756,8 +2007,8 @@ template ssptr_t scan_t::scan_next<chdb::dvbt_mux_t>(db_txn& chdb_rtxn,
 template int scanner_t::add_spectral_peaks(const devdb::rf_path_t& rf_path,
 																					 const statdb::spectrum_key_t& spectrum_key,
 																					 const ss::vector_<chdb::spectral_peak_t>& peaks,
-																					 ssptr_t scan_ssptr, subscription_options_t*options);
+																					 ssptr_t scan_ssptr, subscription_options_t*options, bool streamed);
 template int scanner_t::add_spectral_peaks(const devdb::rf_path_t& rf_path,
 																					 const statdb::spectrum_key_t& spectrum_key,
 																					 const ss::vector_<spectral_peak_t>& peaks,
-																					 ssptr_t scan_ssptr, subscription_options_t*options);
+																					 ssptr_t scan_ssptr, subscription_options_t*options, bool streamed);
@@ -26,6 +26,7 @@
 #include "neumodb/devdb/tune_options.h"
 
 #include <set>
+#include <string>
 
 class receiver_thread_t;
 class tuner_thread_t;
@@ -279,6 +280,7 @@ struct blindscan_t {
 	*/
 	std::optional<statdb::spectrum_key_t> spectrum_key; //set after peaks to scan have been added to provide correct sat_pos
 	ss::vector_<peak_to_scan_t> peaks;
+	ss::vector<uint32_t, 8> streamed_frequencies; //peaks added while the spectrum was still being acquired
 	bool operator<(const blindscan_key_t& other) const;
 
 	bool spectrum_acquired() const {
@@ -313,15 +315,58 @@ inline void scan_stats_abort(devdb::scan_stats_t& ss) {
 		ss.active_bands = 0;
 }
 
+//hits and misses of the epg service cache while the mux was being scanned
+struct epg_cache_stats_t {
+	int num_hits{0};
+	int num_misses{0};
+};
+
 struct scan_mux_end_report_t {
 	statdb::spectrum_key_t spectrum_key;
 	peak_to_scan_t peak;
 	std::optional<chdb::any_mux_t> mux;
 	devdb::fe_key_t fe_key;
+	epg_cache_stats_t epg_cache_stats;
 	scan_mux_end_report_t() = default;
 	scan_mux_end_report_t(const scan_subscription_t& subscription, const statdb::spectrum_key_t spectrum_key);
 };
 
+/*
+	Muxes of one scan which still need to be scanned (scan_status PENDING or RETRY), grouped
+	per (sat_pos, pol, band). This avoids walking the scan_status index of the database each
+	time a subscription becomes available, and allows picking muxes in the band/pol to which
+	an lnb is already tuned.
+
+	The queue is kept in sync with the database by processing the change log of mux_t (as screen_t does),
+	so that it also sees muxes added or changed by tuner threads (e.g., muxes found in the nit)
+*/
+template<typename mux_t>
+struct mux_scan_queue_t {
+	using mux_set_t = std::set<std::string>; //serialized primary keys, in database order
+
+	struct bucket_t {
+		mux_set_t retry;
+		mux_set_t pending;
+	};
+
+	struct entry_t {
+		blindscan_key_t blindscan_key;
+		chdb::scan_status_t scan_status;
+		mux_t mux;
+	};
+
+	//rebuild from scratch if the change log may have been cleaned since the last sync
+	static constexpr int max_txn_lag = 5000;
+
+	int txn_id{-1}; //last chdb transaction which was processed; -1 means: rebuild the queue
+	std::map<blindscan_key_t, bucket_t> buckets;
+	std::map<std::string, entry_t> entries;
+
+	void sync(db_txn& chdb_rtxn, subscription_id_t scan_subscription_id);
+	void update(const std::string& primary_key, const mux_t& mux, subscription_id_t scan_subscription_id);
+	void erase(const std::string& primary_key);
+};
+
 #ifdef TODO //not needed?
 struct scan_band_end_report_t {
 	statdb::spectrum_key_t spectrum_key;
@@ -359,8 +404,23 @@ class scan_t {
 	devdb::scan_stats_t scan_stats_dvbs;
 	devdb::scan_stats_t scan_stats_dvbc;
 	devdb::scan_stats_t scan_stats_dvbt;
+	mux_scan_queue_t<chdb::dvbs_mux_t> mux_queue_dvbs;
+	mux_scan_queue_t<chdb::dvbc_mux_t> mux_queue_dvbc;
+	mux_scan_queue_t<chdb::dvbt_mux_t> mux_queue_dvbt;
+	steady_time_t blindscan_start_time{}; //time at which bands were first added
+	steady_time_t projected_blindscan_end_time{}; //as computed by blindscan_planner_t when bands were added
+	/*sweeps as scheduled by blindscan_planner_t: scan_next_bands tries bands in the order of start_time
+		and scan_try_band first tries to subscribe them on the planned rf_path*/
+	struct planned_sweep_t {
+		double start_time{std::numeric_limits<double>::max()}; //seconds after blindscan_start_time
+		std::optional<devdb::rf_path_t> rf_path;
+	};
+	std::map<blindscan_key_t, planned_sweep_t> planned_sweeps;
 	inline devdb::scan_stats_t get_scan_stats() const;
 
+	template<typename mux_t>
+	inline mux_scan_queue_t<mux_t>& get_mux_queue();
+
 	template<typename mux_t>
 	requires (! is_same_type_v<chdb::sat_t, mux_t>)
 	inline devdb::scan_stats_t& get_scan_stats_ref(const mux_t& mux);
@@ -403,7 +463,7 @@ private:
 
 
 	void on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_mux_t& finished_mux,
-											 const ssptr_t finished_ssptr);
+											 const ssptr_t finished_ssptr, const epg_cache_stats_t& epg_cache_stats);
 
 	void on_spectrum_scan_band_end(const devdb::fe_t& finished_fe, const spectrum_scan_t& spectrum_scan,
 																 const ssptr_t finished_ssptr);
@@ -489,7 +549,7 @@ class scanner_t {
 	template<typename peak_t>
 	int add_spectral_peaks(const devdb::rf_path_t& rf_path,
 												 const statdb::spectrum_key_t& spectrum_key, const ss::vector_<peak_t>& peaks,
-												 ssptr_t ssptr, subscription_options_t* options=nullptr);
+												 ssptr_t ssptr, subscription_options_t* options=nullptr, bool streamed=false);
 
 	int add_bands(const ss::vector_<chdb::sat_t>& sats,
 								const ss::vector_<chdb::fe_polarisation_t>& pols,
@@ -500,11 +560,18 @@ class scanner_t {
 												db_txn& devdb_wtxn, ssptr_t scan_ssptr);
 
 	bool on_scan_mux_end(const devdb::fe_t& finished_fe, const chdb::any_mux_t& mux,
-											 const chdb::scan_id_t& scan_id, const ssptr_t finished_ssptr);
+											 const chdb::scan_id_t& scan_id, const ssptr_t finished_ssptr,
+											 const epg_cache_stats_t& epg_cache_stats);
 
 	bool on_spectrum_scan_band_end(const devdb::fe_t& finished_fe, const spectrum_scan_t& spectrum_scan,
 																 const chdb::scan_id_t& scan_id,
 																 const ss::vector_<subscription_id_t>& subscription_ids);
+	/*
+		peaks confirmed by spectrum_peak_stream_t while the spectrum is still being acquired. They are tuned
+		immediately (on tuners which are not busy with the sweep) and are not added again when the sweep ends
+	*/
+	bool on_spectrum_scan_peaks(const statdb::spectrum_key_t& spectrum_key,
+															const ss::vector_<spectral_peak_t>& peaks, const chdb::scan_id_t& scan_id);
 	bool housekeeping(bool force);
 	subscription_id_t scan_subscription_id_for_scan_id(const chdb::scan_id_t& scan_id);
 
@@ -22,5 +22,57 @@
 #pragma once
 #include "stackstring/stackstring.h"
 #include "neumofrontend.h"
+#include <vector>
 
 void find_tps(ss::vector_<spectral_peak_t>& res,	ss::vector_<int32_t>& sig, ss::vector_<uint32_t>& freq);
+
+/*
+	Streaming version of find_tps, for use while a spectrum is still being acquired.
+
+	Spectrum samples are added in chunks (in increasing frequency order). A peak is reported by add() as soon
+	as the samples beyond its right edge plus the reach of the widest detection window are known, because from
+	then on later samples can no longer create a competing candidate overlapping it. Only the part of the
+	spectrum which can still influence unreported peaks is analysed again, so the cost per chunk is bounded.
+
+	finish() returns exactly the same peaks as find_tps on the complete spectrum. Peaks reported early but
+	rejected by the full analysis (rare: only caused by long chains of overlapping candidates) are counted
+	in num_retracted()
+*/
+class spectrum_peak_stream_t {
+	std::vector<int32_t> sig;
+	std::vector<uint32_t> freq;
+	std::vector<spectral_peak_t> reported;
+	int committed_idx{0}; //all peaks with right edge below this index have been reported
+	int analysed_len{0}; //number of samples available at the last analysis
+	int num_retracted_{0};
+	int min_step{0}; //minimum number of new samples before analysing again
+
+public:
+	spectrum_peak_stream_t();
+
+	//reach of the widest detection window, in samples
+	static int guard_size();
+
+	void clear();
+
+	/*
+		Add n new samples and append the peaks which are now confirmed to confirmed_peaks
+		returns the number of peaks appended
+	 */
+	int add(const int32_t* sig, const uint32_t* freq, int n, ss::vector_<spectral_peak_t>& confirmed_peaks);
+
+	//all peaks in the complete spectrum, identical to find_tps
+	void finish(ss::vector_<spectral_peak_t>& res);
+
+	inline int num_samples() const {
+		return sig.size();
+	}
+
+	inline int num_reported() const {
+		return reported.size();
+	}
+
+	inline int num_retracted() const {
+		return num_retracted_;
+	}
+};
@@ -544,6 +544,13 @@ int stid135_spectral_scan_init(struct spectrum_scan_state_t* ss, struct scan_int
 	return 0;
 }
 
+void stid135_spectral_scan_free(struct scan_internal_t* si) {
+	free(si->peak_marks);
+	free(si->peaks);
+	free(si->rs);
+	free(si->noise);
+}
+
 static int scan_level(struct spectrum_scan_state_t *ss, struct scan_internal_t *si,
 											s32* spectrum, u32* freq, int spectrum_len, int w) {
 	int fall_idx;
@@ -588,25 +595,126 @@ static int cmp_fn(const void* pa, const void* pb) {
 	return a->freq - b->freq;
 }
 
-void find_tps(ss::vector_<spectral_peak_t>& res,	ss::vector_<int32_t>& sig, ss::vector_<uint32_t>& freq) {
+/*
+	runs the complete algorithm on spectrum[0...len-1] and leaves the peaks, sorted by frequency,
+	in si->peaks; the caller must call stid135_spectral_scan_free
+*/
+static void find_tps_(struct scan_internal_t* si, s32* sig, u32* freq, int len) {
 	struct spectrum_scan_state_t ss;
-	struct scan_internal_t si;
 	ss.threshold = 3000;
 	ss.threshold2 = 3000;
 	ss.mincount = 1;
+
+	scan_all(&ss, si, sig, freq, len);
+
+	qsort(&si->peaks[0], si->num_peaks, sizeof(si->peaks[0]), cmp_fn);
+}
+
+static inline spectral_peak_t make_spectral_peak(const spectrum_peak_internal_t& peak) {
+	spectral_peak_t p;
+	p.freq= peak.freq;
+	p.symbol_rate = peak.bw*1000; //top plateau approx SR. 10% underestimation
+	p.snr = peak.mean_snr;
+	p.level = peak.mean_level;
+	return p;
+}
+
+void find_tps(ss::vector_<spectral_peak_t>& res,	ss::vector_<int32_t>& sig, ss::vector_<uint32_t>& freq) {
+	struct scan_internal_t si;
 	assert(freq.size() == sig.size());
 	int j = 0;
 
-	scan_all(&ss, &si, sig.buffer(), freq.buffer(), sig.size());
+	find_tps_(&si, sig.buffer(), freq.buffer(), sig.size());
 
-	qsort(&si.peaks[0], si.num_peaks, sizeof(si.peaks[0]), cmp_fn);
 	res.clear();
-	for (j = 0; j < si.num_peaks; ++j) {
-		spectral_peak_t p;
-		p.freq= si.peaks[j].freq;
-		p.symbol_rate = si.peaks[j].bw*1000; //top plateau approx SR. 10% underestimation
-		p.snr = si.peaks[j].mean_snr;
-		p.level = si.peaks[j].mean_level;
-		res.push_back(p);
+	for (j = 0; j < si.num_peaks; ++j)
+		res.push_back(make_spectral_peak(si.peaks[j]));
+	stid135_spectral_scan_free(&si);
+}
+
+/*
+	A candidate transponder spans at most 1.5 times the window size between its rising and falling edge,
+	extended by 16% of the window size on both sides to find the lowest levels; the kernels look another 16%
+	further. So data more than twice the widest window to the right of a peak cannot lead to a candidate
+	overlapping it
+*/
+int spectrum_peak_stream_t::guard_size() {
+	return 2 * windows[sizeof(windows) / sizeof(windows[0]) - 1];
+}
+
+spectrum_peak_stream_t::spectrum_peak_stream_t()
+	: min_step(guard_size()/4)
+{}
+
+void spectrum_peak_stream_t::clear() {
+	sig.clear();
+	freq.clear();
+	reported.clear();
+	committed_idx = 0;
+	analysed_len = 0;
+	num_retracted_ = 0;
+}
+
+int spectrum_peak_stream_t::add(const int32_t* sig_, const uint32_t* freq_, int n,
+																ss::vector_<spectral_peak_t>& confirmed_peaks) {
+	sig.insert(sig.end(), sig_, sig_ + n);
+	freq.insert(freq.end(), freq_, freq_ + n);
+	const int len = sig.size();
+	const int guard = guard_size();
+	const int end_idx = len - guard; //peaks with their right edge below end_idx are confirmed
+	if (len - analysed_len < min_step || end_idx <= committed_idx)
+		return 0;
+	analysed_len = len;
+
+	/*
+		Peaks with right edge below committed_idx have already been reported. Peaks to be reported now extend
+		at most guard samples to the left of committed_idx, and are only influenced by candidates starting at
+		most guard samples further to the left
+	*/
+	const int start = std::max(0, committed_idx - 2 * guard);
+	struct scan_internal_t si;
+	find_tps_(&si, &sig[start], &freq[start], len - start);
+
+	int count = 0;
+	for (int j = 0; j < si.num_peaks; ++j) {
+		auto& peak = si.peaks[j];
+		int left = start + peak.lowest_left_idx;
+		int right = start + peak.lowest_right_idx;
+		if (right < committed_idx || right >= end_idx)
+			continue;
+		if (start > 0 && left < start + guard)
+			continue; //too close to start of analysed region; was reported already
+		auto p = make_spectral_peak(peak);
+		confirmed_peaks.push_back(p);
+		reported.push_back(p);
+		++count;
+	}
+	stid135_spectral_scan_free(&si);
+	committed_idx = end_idx;
+	return count;
+}
+
+void spectrum_peak_stream_t::finish(ss::vector_<spectral_peak_t>& res) {
+	assert(freq.size() == sig.size());
+	res.clear();
+	if (sig.size() < 2)
+		return;
+	struct scan_internal_t si;
+	find_tps_(&si, sig.data(), freq.data(), sig.size());
+	for (int j = 0; j < si.num_peaks; ++j)
+		res.push_back(make_spectral_peak(si.peaks[j]));
+	stid135_spectral_scan_free(&si);
+
+	num_retracted_ = 0;
+	for (auto& p: reported) {
+		bool found{false};
+		for (auto& q: res) {
+			if (q.freq == p.freq && q.symbol_rate == p.symbol_rate) {
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			num_retracted_++;
 	}
 }
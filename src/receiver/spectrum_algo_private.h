@@ -117,6 +117,9 @@ enum slope_t
 int stid135_spectral_scan_init(struct spectrum_scan_state_t* ss, struct scan_internal_t* si, s32* spectrum,
 															 u32* freq, int len);
 
+//release the buffers allocated by stid135_spectral_scan_init
+void stid135_spectral_scan_free(struct scan_internal_t* si);
+
 void stid135_spectral_init_level(struct spectrum_scan_state_t* ss,
 																 struct scan_internal_t* si,
 																 float* falling_response_ret=nullptr,
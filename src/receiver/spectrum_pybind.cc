@@ -23,6 +23,8 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h> //for std::optional
 #include <pybind11/stl_bind.h>
+#include <atomic>
+#include <thread>
 namespace py = pybind11;
 
 
@@ -33,6 +35,50 @@ static float windowed_max(float* p, int starti, int endi) {
 	return res;
 }
 
+/*
+	res[k] = max (or min) of p[x-w+1...x] (trailing window) or of p[x...x+w-1] (leading window) for x=xs[k],
+	with the windows clipped to [0,n). xs must be sorted in increasing order.
+
+	Computed with a monotonic deque of indices of values which can still become the extremum of a later
+	window. Each sample covered by at least one window is pushed once, so the cost is at most O(n), and
+	less when the windows do not cover the whole signal
+*/
+template<bool is_max>
+static void sliding_extremum(std::vector<float>& res, const float* p, int n, const int* xs, int num_xs,
+														 int w, bool leading) {
+	res.resize(num_xs);
+	if (w <= 0) {
+		std::fill(res.begin(), res.end(),
+							is_max ? std::numeric_limits<float>::lowest() : std::numeric_limits<float>::max());
+		return;
+	}
+	auto dominates = [](float a, float b) {
+		return is_max ? a >= b : a <= b;
+	};
+	std::vector<int> deque(n); //each index is pushed at most once, so no wrap around is needed
+	int head = 0;
+	int tail = 0;
+	int next = -1; //next index to push
+	for (int k = 0; k < num_xs; ++k) {
+		int q = leading ? num_xs - 1 - k : k; //leading windows are processed from right to left
+		int x = xs[q];
+		int first = leading ? std::min(n - 1, x + w - 1) : std::max(0, x - w + 1); //start of window
+		if (next < 0 || (leading ? next > first : next < first)) {
+			//no overlap with previous window
+			head = tail = 0;
+			next = first;
+		}
+		for (; leading ? next >= x : next <= x; next += leading ? -1 : 1) {
+			while (tail > head && dominates(p[next], p[deque[tail - 1]]))
+				--tail;
+			deque[tail++] = next;
+		}
+		while (leading ? deque[head] > first : deque[head] < first)
+			++head; //left the window
+		res[q] = p[deque[head]];
+	}
+}
+
 /*
 	overlapping when both left aligned
 
@@ -138,10 +184,12 @@ inline bool debug_matches(float f)
 	annotx: list of annotation  x coordinates
 	w/h=width/height of annotation box
 	offset = vertical offset of annotation box
+	use_sliding_max: compute the maxima below the annotation boxes with a sliding window (at most O(n)) instead
+	  of O(w) per annotation. The result is the same; the slow method is kept for benchmarking
 */
 static py::object find_annot_locations(py::array_t<float> sig, py::array_t<int> annotx,
 																			 py::array_t<float> freq,
-																			 int w, float h, float offset) {
+																			 int w, float h, float offset, bool use_sliding_max) {
 	py::buffer_info infosig = sig.request();
 	if (infosig.ndim != 1)
 		throw std::runtime_error("Bad number of dimensions");
@@ -183,6 +231,30 @@ static py::object find_annot_locations(py::array_t<float> sig, py::array_t<int>
 	righty.resize(na); /* labels left aligned, vertical position increases from right to left
 												lefty[i] is the height of the label whose left side has x-coordinate px[i]
 										 */
+	/*
+		maximum of the signal below a box of width w or w2 left aligned at x (right_max)
+		or right aligned at x (left_max)
+	*/
+	std::vector<float> left_max_w, left_max_w2, right_max_w, right_max_w2;
+	if (use_sliding_max && na > 0) {
+		sliding_extremum<true>(left_max_w, psig, n, px, na, w, false);
+		sliding_extremum<true>(left_max_w2, psig, n, px, na, w2, false);
+		sliding_extremum<true>(right_max_w, psig, n, px, na, w, true);
+		sliding_extremum<true>(right_max_w2, psig, n, px, na, w2, true);
+	}
+	auto left_max = [&](int i, bool wide) {
+		auto x = px[i];
+		if (!use_sliding_max)
+			return windowed_max(psig, std::max(0, x + 1 - (wide ? w2 : w)), x + 1);
+		return wide ? left_max_w2[i] : left_max_w[i];
+	};
+	auto right_max = [&](int i, bool wide) {
+		auto x = px[i];
+		if (!use_sliding_max)
+			return windowed_max(psig, x, std::min(n, x + (wide ? w2 : w)));
+		return wide ? right_max_w2[i] : right_max_w[i];
+	};
+
 	float initial_maxy = std::numeric_limits<float>::lowest();
 	float initial_miny = std::numeric_limits<float>::max();
 	for (int i = 0; i < n; ++i) {
@@ -220,15 +292,15 @@ static py::object find_annot_locations(py::array_t<float> sig, py::array_t<int>
 		if (i > 0) {
 			auto [overlap, worst ] = left_overlapping(i);
 			if(overlap) {
-				lefty[i] = windowed_max(psig, std::max(0, x + 1 - w2), x+1) + offset;
+				lefty[i] = left_max(i, true) + offset;
 				lefty[i] = std::max(lefty[i], worst) +
 					((plr_left[i-1] & SINGLE_LINE) ? h : h)*1.5;
 			} else {
-				lefty[i] = windowed_max(psig, std::max(0, x + 1 - w), x+1) + offset;
+				lefty[i] = left_max(i, false) + offset;
 			}
 			plr_left[i] = (overlap ? SINGLE_LINE : DOUBLE_LINE) | STICK_OUT_LEFT;
 		} else {
-			lefty[i] = windowed_max(psig, std::max(0, x + 1 - w), x+1) + offset;
+			lefty[i] = left_max(i, false) + offset;
 			plr_left[i] = DOUBLE_LINE | STICK_OUT_LEFT;
 		}
 	}
@@ -266,15 +338,15 @@ static py::object find_annot_locations(py::array_t<float> sig, py::array_t<int>
 		if (i < na - 1) {
 			auto [overlap, worst ] = right_overlapping(i);
 			if(overlap) {
-				righty[i] = windowed_max(psig, x, std::min(n, x + w2)) + offset;
+				righty[i] = right_max(i, true) + offset;
 				righty[i] = std::max(righty[i], worst) +
 					((plr_right[i+1] & SINGLE_LINE) ? h2 : h)*1.5;
 			} else {
-				righty[i] = windowed_max(psig, x, std::min(n, x + w)) + offset;
+				righty[i] = right_max(i, false) + offset;
 			}
 			plr_right[i] = (overlap ? SINGLE_LINE : DOUBLE_LINE) | STICK_OUT_RIGHT;
 		} else {
-			righty[i] = windowed_max(psig, x, std::min(n, x + w)) + offset;
+			righty[i] = right_max(i, false) + offset;
 			plr_right[i] = DOUBLE_LINE | STICK_OUT_RIGHT;
 		}
 	}
@@ -364,8 +436,12 @@ static py::object find_annot_locations(py::array_t<float> sig, py::array_t<int>
 	return py::make_tuple(annoty, leftrightflag);
 }
 
-static py::object make_kernels(py::array_t<float> freq, py::array_t<float> spectrum, int w) {
-
+/*
+	convert a spectrum from python (frequencies in MHz) to the format used by the peak detection code
+	(frequencies in kHz)
+*/
+static void copy_spectrum(ss::vector_<int32_t>& spectrum_, ss::vector_<uint32_t>& freq_,
+													py::array_t<float> freq, py::array_t<float> spectrum) {
 	py::buffer_info infospec = spectrum.request();
 	if (infospec.ndim != 1)
 		throw std::runtime_error("Bad number of dimensions");
@@ -382,8 +458,6 @@ static py::object make_kernels(py::array_t<float> freq, py::array_t<float> spect
 	if (n!= infospec.shape[0])
 		throw std::runtime_error("Bad Spectrum and freq need to have same size");
 
-	ss::vector_<int32_t> spectrum_;
-	ss::vector_<uint32_t> freq_;
 	spectrum_.reserve(n);
 	freq_.reserve(n);
 
@@ -391,7 +465,12 @@ static py::object make_kernels(py::array_t<float> freq, py::array_t<float> spect
 		freq_.push_back(pfreq[i*stridefreq]*1e3);
 		spectrum_.push_back(pspec[i*stridespec]);
 	}
+}
 
+static py::object make_kernels(py::array_t<float> freq, py::array_t<float> spectrum, int w) {
+	ss::vector_<int32_t> spectrum_;
+	ss::vector_<uint32_t> freq_;
+	copy_spectrum(spectrum_, freq_, freq, spectrum);
 
 	struct spectrum_scan_state_t ss;
 	struct scan_internal_t si;
@@ -399,10 +478,6 @@ static py::object make_kernels(py::array_t<float> freq, py::array_t<float> spect
 	ss.threshold2 = 3000;
 	ss.mincount = 1;
 
-
-	stid135_spectral_scan_init(&ss, &si, spectrum_.buffer(), freq_.buffer(), freq_.size());
-	si.w = w;
-
 	auto ret = py::array_t<int, py::array::c_style>({2, freq_.size()});
 	py::buffer_info ret_info = ret.request();
 	int ret_stride0 = ret_info.strides[0] / sizeof(int);
@@ -413,46 +488,23 @@ static py::object make_kernels(py::array_t<float> freq, py::array_t<float> spect
 	py::buffer_info response_ret_info = response_ret.request();
 	auto* p_response_ret = (float*)response_ret_info.ptr;
 
-	stid135_spectral_init_level(&ss, &si, p_response_ret, p_response_ret+ret_stride0);
+	{
+		py::gil_scoped_release release;
+		stid135_spectral_scan_init(&ss, &si, spectrum_.buffer(), freq_.buffer(), freq_.size());
+		si.w = w;
 
-	for(int i=0; i < freq_.size(); ++i) {
-		p_ret[i*ret_stride1] = !!(si.peak_marks[i] & FALLING);
-		p_ret[i*ret_stride1+ret_stride0] = !!(si.peak_marks[i] & RISING);
+		stid135_spectral_init_level(&ss, &si, p_response_ret, p_response_ret+ret_stride0);
+
+		for(int i=0; i < freq_.size(); ++i) {
+			p_ret[i*ret_stride1] = !!(si.peak_marks[i] & FALLING);
+			p_ret[i*ret_stride1+ret_stride0] = !!(si.peak_marks[i] & RISING);
+		}
+		stid135_spectral_scan_free(&si);
 	}
 	return py::make_tuple(ret, response_ret);
 }
 
-static py::object find_spectral_peaks(py::array_t<float> freq, py::array_t<float> spectrum) {
-
-	py::buffer_info infospec = spectrum.request();
-	if (infospec.ndim != 1)
-		throw std::runtime_error("Bad number of dimensions");
-	auto* pspec = (float*)infospec.ptr;
-	int stridespec = infospec.strides[0] / sizeof(float);
-
-	py::buffer_info infofreq = freq.request();
-	if (infofreq.ndim != 1)
-		throw std::runtime_error("Bad number of dimensions");
-	auto* pfreq = (float*)infofreq.ptr;
-	int stridefreq = infofreq.strides[0] / sizeof(float);
-
-	int n = infofreq.shape[0];
-	if (n!= infospec.shape[0])
-		throw std::runtime_error("Bad Spectrum and freq need to have same size");
-
-	ss::vector_<int32_t> spectrum_;
-	ss::vector_<uint32_t> freq_;
-	spectrum_.reserve(n);
-	freq_.reserve(n);
-
-	for(int i =0 ; i< n; ++i) {
-		freq_.push_back(pfreq[i*stridefreq]*1e3);
-		spectrum_.push_back(pspec[i*stridespec]);
-	}
-
-	ss::vector_<spectral_peak_t> res;
-	find_tps(res,	spectrum_, freq_);
-
+static py::object peaks_to_python(const ss::vector_<spectral_peak_t>& res) {
 	py::array_t<float, py::array::c_style> peak_freq(res.size());
 	py::buffer_info peak_freq_info = peak_freq.request();
 	int peak_freq_stride = peak_freq_info.strides[0] / sizeof(float);
@@ -472,16 +524,80 @@ static py::object find_spectral_peaks(py::array_t<float> freq, py::array_t<float
 	return py::make_tuple(peak_freq, peak_sr);
 }
 
+static py::object find_spectral_peaks(py::array_t<float> freq, py::array_t<float> spectrum) {
+	ss::vector_<int32_t> spectrum_;
+	ss::vector_<uint32_t> freq_;
+	copy_spectrum(spectrum_, freq_, freq, spectrum);
+
+	ss::vector_<spectral_peak_t> res;
+	{
+		py::gil_scoped_release release;
+		find_tps(res,	spectrum_, freq_);
+	}
+	return peaks_to_python(res);
+}
+
+/*
+	Same as find_spectral_peaks, but for multiple spectra (e.g., the spectra of multiple lnbs shown in the
+	spectrum dialog), which are processed in parallel by num_threads threads (0 means: one per cpu core)
+	without holding the GIL
+*/
+static py::list find_spectral_peaks_multi(py::list freqs, py::list spectra, int num_threads) {
+	int num_spectra = freqs.size();
+	if (num_spectra != (int) spectra.size())
+		throw std::runtime_error("Bad number of spectra and freqs need to be the same");
+	struct job_t {
+		ss::vector_<int32_t> spectrum;
+		ss::vector_<uint32_t> freq;
+		ss::vector_<spectral_peak_t> res;
+	};
+	std::vector<job_t> jobs(num_spectra);
+	for(int i = 0; i < num_spectra; ++i)
+		copy_spectrum(jobs[i].spectrum, jobs[i].freq,
+									freqs[i].cast<py::array_t<float>>(), spectra[i].cast<py::array_t<float>>());
+
+	if (num_threads <= 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	num_threads = std::min(num_threads, num_spectra);
+	{
+		py::gil_scoped_release release;
+		std::atomic<int> next_job{0};
+		auto worker = [&]() {
+			for(int i = next_job++; i < num_spectra; i = next_job++)
+				find_tps(jobs[i].res, jobs[i].spectrum, jobs[i].freq);
+		};
+		std::vector<std::thread> threads;
+		for(int t = 1; t < num_threads; ++t)
+			threads.emplace_back(worker);
+		worker();
+		for(auto& t: threads)
+			t.join();
+	}
+
+	py::list ret;
+	for(auto& job: jobs)
+		ret.append(peaks_to_python(job.res));
+	return ret;
+}
+
 PYBIND11_MODULE(pyspectrum, m) {
 	m.doc() = R"pbdoc(
 
 	)pbdoc";
 	;
-	m.def("find_annot_locations", &find_annot_locations)
+	m.def("find_annot_locations", &find_annot_locations,
+				"compute vertical positions of annotations and whether they stick out to the left or right",
+				py::arg("sig"), py::arg("annotx"), py::arg("freq"), py::arg("w"), py::arg("h"), py::arg("offset"),
+				py::arg("use_sliding_max") = true
+		)
 		.def("find_spectral_peaks", &find_spectral_peaks,
 				 "detect peaks in the spectrum and return their center frequencies and symbol rate",
 				 py::arg("freq"), py::arg("spectrum")
 			)
+		.def("find_spectral_peaks_multi", &find_spectral_peaks_multi,
+				 "find_spectral_peaks for a list of spectra, processed in parallel; returns a list of results",
+				 py::arg("freqs"), py::arg("spectra"), py::arg("num_threads") = 0
+			)
 		.def("make_kernels", &make_kernels,
 				 "make kernels", py::arg("freq"), py::arg("spectrum"), py::arg("w")
 			)
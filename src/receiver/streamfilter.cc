@@ -19,6 +19,7 @@
  */
 #include "streamfilter.h"
 #include "active_stream.h"
+#include "vdvb.h"
 #include "util/logger.h"
 #include "util/util.h"
 #include "util/dtassert.h"
@@ -543,7 +544,7 @@ pid_t streamer_t::start() {
 		dterrorf("Could not start command");
 		return -1;
 	}
-	::close(fd);
+	dvb_close(fd);
 	fd = -1;
 	return command_pid;
 }
@@ -27,6 +27,7 @@
 #include <iostream>
 
 #include "packetstream.h"
+#include "startcode.h"
 using namespace dtdemux;
 
 using namespace boost;
@@ -167,28 +168,24 @@ uint8_t ts_substream_t::get_start_code() {
 }
 
 /*
-	Scan forward until start_code is reached
+	Scan forward until start_code is reached.
+	Scanning is done on the contiguous payload of each ts packet, without copying
+	the data; prefixes split across ts packets are handled by remembering trailing zero bytes
 */
 uint8_t ts_substream_t::next_start_code() {
-	uint32_t code = get<uint32_t>();
+	int zeros = 0; // number of zero bytes (at most 2) immediately preceding the current position
 	for (;;) {
-		if ((code & 0xffffff00) == 0x00000100) { /*00 00 01 XX*/
-			return code & 0xff;
-		} else if ((code & 0x00ffffff) == 0x00000001) { /*YY 00 00 01 */
-			auto temp = get<uint8_t>();
-			code = (code << 8) | temp;
-		} else if ((code & 0xffff) == 0) { /*YY YY 00 00 */
-			auto temp = get<uint16_t>();
-			code = (code << 16) | temp;
-		} else if ((code & 0xff) == 0) { /*YY YY YY 00 */
-			auto temp = get<uint16_t>();
-			code = (code << 16) | temp;
-			auto temp1 = get<uint8_t>();
-			code = (code << 8) | temp1;
-		} else {
-			code = get<uint32_t>();
+		auto& range = current_ts_packet->range;
+		int len = range.available();
+		if (len > 0) {
+			auto pos = find_start_code(range.current_pointer(0), len, zeros);
+			if (pos >= 0) {
+				skip(pos);
+				return get<uint8_t>(); // may be in the next packet
+			}
+			skip(len);
 		}
-		if (has_error())
+		if (get_next_packet() < 0 || has_error())
 			return 0xff;
 	}
 	assert(0); // above loop never ends, except by throwing
@@ -210,6 +207,16 @@ uint8_t ts_substream_t::next_start_code() {
 	0x00 00 01
 */
 uint8_t ts_substream_t::get_nalu_start_code() {
+	auto& range = current_ts_packet->range;
+	if (range.available() >= 5) {
+		//fast path: start code is not split over ts packets; avoid get<>
+		auto* p = range.current_pointer(0);
+		int len = (p[2] == 0) ? 4 : 3; // 00 00 00 01 or 00 00 01
+		if (p[0] == 0 && p[1] == 0 && p[len - 1] == 1 && !(p[len] & 0x80)) {
+			skip(len + 1);
+			return p[len];
+		}
+	}
 	uint32_t code = get<uint32_t>();
 	if (code == 1) {								 // 00 00 00 01
 		uint8_t code = get<uint8_t>(); // first byte of nal unit
@@ -552,6 +552,7 @@ void eit_parser_t::parse_payload_unit() {
 	assert(!(must_process && badversion));
 	if (completed_now)
 		dtdebugf("Parser: table completed");
+	arena.reset(); //the records of the previous section no longer exist
 	epg_t epg;
 	std::tie(epg.num_subtables_completed, epg.num_subtables_known) = parser_status.get_counts();
 
@@ -568,6 +569,11 @@ void eit_parser_t::parse_payload_unit() {
 #endif
 		section.skip(hdr.header_len); // already parsed
 		log4cxx::NDC::push(" EIT");
+		/*
+			titles and descriptions mostly exceed the inline capacity of the records; only the parser
+			writes to the arena; section_cb copies what it needs to keep
+		*/
+		ss::arena_scope_t arena_scope(arena);
 		if (epg.is_sky)  {
 			success = parse_sky_section(section, epg);
 #ifdef PRINTTIME
@@ -443,6 +443,7 @@ namespace dtdemux {
 #endif
 		parser_status_t  parser_status;
 		chdb::epg_type_t epg_type{chdb::epg_type_t::UNKNOWN};
+		ss::arena_t arena; //overflow buffers of the epg records of the section being parsed
 		std::function<reset_type_t(epg_t&, const subtable_info_t&)>
 		section_cb = [](epg_t& epg, const subtable_info_t& subtable_info)
 			{return reset_type_t::NO_RESET;};
@@ -0,0 +1,125 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace dtdemux {
+
+	/*
+		Search for a start code prefix (00 00 01) in the contiguous range [p, p+len).
+		zeros is the number of zero bytes (at most 2) immediately preceding p, which may have been
+		seen in an earlier range (e.g., the payload of a previous ts packet). On return,
+		zeros is updated for the next range.
+
+		Returns the offset of the byte following the prefix (the start code value itself),
+		which can be equal to len if the prefix ends at the end of the range, or -1 if no prefix was found.
+	*/
+	inline int find_start_code_scalar(const uint8_t* p, int len, int& zeros) {
+		int z = zeros;
+		for (int i = 0; i < len; ++i) {
+			auto c = p[i];
+			if (c == 0)
+				z = z < 2 ? z + 1 : 2;
+			else {
+				if (c == 1 && z == 2) {
+					zeros = 0;
+					return i + 1;
+				}
+				z = 0;
+			}
+		}
+		zeros = z;
+		return -1;
+	}
+
+	inline int find_start_code(const uint8_t* p, int len, int& zeros) {
+		//a prefix which started in an earlier range
+		if (zeros > 0 && len >= 1) {
+			if (zeros == 2 && p[0] == 1) {
+				zeros = 0;
+				return 1;
+			}
+			if (len >= 2 && p[0] == 0 && p[1] == 1) {
+				zeros = 0;
+				return 2;
+			}
+		}
+		int i = 0;
+#ifdef __SSE2__
+		/*
+			compare 16 positions at once: a prefix starts at position j if
+			p[j]==0 && p[j+1]==0 && p[j+2]==1
+		*/
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi8(1);
+		for (; i + 18 <= len; i += 16) {
+			auto v0 = _mm_loadu_si128((const __m128i*)(p + i));
+			auto v1 = _mm_loadu_si128((const __m128i*)(p + i + 1));
+			auto v2 = _mm_loadu_si128((const __m128i*)(p + i + 2));
+			auto m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(v0, zero), _mm_cmpeq_epi8(v1, zero)),
+														 _mm_cmpeq_epi8(v2, one));
+			auto mask = _mm_movemask_epi8(m);
+			if (mask) {
+				zeros = 0;
+				return i + __builtin_ctz(mask) + 3;
+			}
+		}
+#else
+		/*
+			memchr is vectorized in libc; look for the 01 byte and check the two bytes before it
+		*/
+		for (;;) {
+			if (i + 2 >= len)
+				break;
+			auto* q = (const uint8_t*)memchr(p + i + 2, 1, len - i - 2);
+			if (!q) {
+				i = len - 2;
+				break;
+			}
+			int j = q - p;
+			if (p[j - 1] == 0 && p[j - 2] == 0) {
+				zeros = 0;
+				return j + 1;
+			}
+			i = j - 1;
+		}
+#endif
+		/*
+			tail, and any prefix which straddles the vectorized part and the tail.
+			No prefix starts before i, so at most 2 trailing zero bytes before i matter
+		*/
+		int z = 0;
+		if (i >= 2)
+			z = (p[i - 1] == 0) ? ((p[i - 2] == 0) ? 2 : 1) : 0;
+		else if (i == 1)
+			z = (p[0] == 0) ? (zeros >= 1 ? 2 : 1) : 0;
+		else
+			z = zeros;
+		auto ret = find_start_code_scalar(p + i, len - i, z);
+		zeros = z;
+		return ret < 0 ? -1 : ret + i;
+	}
+
+}; //namespace dtdemux
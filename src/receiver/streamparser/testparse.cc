@@ -0,0 +1,157 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Benchmark for the cost of logging in the stream parser. A captured transport stream is parsed
+	in the same way as active_mpm_t::process_channel_data does, with the log level set to INFO,
+	and with the log level set to DEBUG, using synchronous and asynchronous logging.
+	All output is sent to /dev/null.
+
+	Usage: testparse --pid 0x100 --type h264 capture.ts
+*/
+
+#include "streamparser.h"
+#include "packetstream.h"
+#include "util/logger.h"
+#include <boost/program_options.hpp>
+#include <iostream>
+#include <stdio.h>
+#include <vector>
+
+using namespace boost;
+namespace po = boost::program_options;
+using namespace dtdemux;
+
+struct options_t {
+	std::string filename;
+	int pid{-1};
+	std::string type{"h264"};
+	int repeats{5};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB stream parser logging benchmark");
+	po::positional_options_description pd;
+	pd.add("file", 1);
+	std::string pid_str;
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("file,f", po::value<std::string>(&filename)->required(), "Transport stream file")
+			("pid,p", po::value<std::string>(&pid_str)->required(), "Video pid (decimal or 0x...)")
+			("type,t", po::value<std::string>(&type)->default_value(type), "Video type: mpeg2, h264 or hevc")
+			("repeats,r", po::value<int>(&repeats)->default_value(repeats), "Number of repetitions")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(pd).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+		pid = std::stoi(pid_str, nullptr, 0);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static double bench(std::vector<uint8_t>& data, stream_type::stream_type_t stream_type) {
+	constexpr int chunk_size = 188 * 1024;
+	auto start = steady_clock_t::now();
+	for (int r = 0; r < options.repeats; ++r) {
+		ts_stream_t stream_parser;
+		stream_parser.register_video_pids(1, options.pid, options.pid, stream_type);
+		for (int64_t offset = 0; offset < (int64_t)data.size(); offset += chunk_size) {
+			auto len = std::min((int64_t)chunk_size, (int64_t)data.size() - offset);
+			stream_parser.set_buffer(data.data() + offset, len);
+			stream_parser.parse();
+		}
+	}
+	auto end = steady_clock_t::now();
+	auto secs = std::chrono::duration<double>(end - start).count();
+	return data.size() * (double)options.repeats / secs / (1024 * 1024);
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	stream_type::stream_type_t stream_type;
+	if (options.type == "mpeg2")
+		stream_type = stream_type::stream_type_t::MPEG2_VIDEO;
+	else if (options.type == "h264")
+		stream_type = stream_type::stream_type_t::AVC_VIDEO;
+	else if (options.type == "hevc")
+		stream_type = stream_type::stream_type_t::HEVC_VIDEO;
+	else {
+		printf("Unknown type: %s\n", options.type.c_str());
+		return -1;
+	}
+
+	auto* fp = fopen(options.filename.c_str(), "rb");
+	if (!fp) {
+		printf("Could not open %s\n", options.filename.c_str());
+		return -1;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buffer[188 * 1024];
+	for (;;) {
+		auto n = fread(buffer, 1, sizeof(buffer), fp);
+		if (n == 0)
+			break;
+		data.insert(data.end(), buffer, buffer + n);
+	}
+	fclose(fp);
+	//the parser expects complete packets
+	size_t sync = 0;
+	while (sync < data.size() && data[sync] != 0x47)
+		sync++;
+	data.erase(data.begin(), data.begin() + sync);
+	data.resize(data.size() - data.size() % 188);
+
+	auto root = Logger::getRootLogger();
+	root->removeAllAppenders();
+	root->addAppender(AppenderPtr(new FileAppender(LayoutPtr(new PatternLayout(LOG4CXX_STR("%d %.40F:%L\n  %m %n"))),
+																								 LOG4CXX_STR("/dev/null"), false)));
+
+	logger->setLevel(Level::getInfo());
+	auto info_rate = bench(data, stream_type);
+
+	logger->setLevel(Level::getDebug());
+	auto debug_rate = bench(data, stream_type);
+
+	dtlog::start_async_logging();
+	auto async_rate = bench(data, stream_type);
+	dtlog::stop_async_logging();
+	auto stats = dtlog::get_stats();
+
+	printf("%s: pid=0x%x size=%ldMB\n", options.filename.c_str(), options.pid, data.size() / (1024 * 1024));
+	printf("INFO:         %8.1f MB/s\n", info_rate);
+	printf("DEBUG:        %8.1f MB/s\n", debug_rate);
+	printf("DEBUG async:  %8.1f MB/s (deferred=%ld preformatted=%ld dropped=%ld sync=%ld)\n", async_rate,
+				 stats.num_deferred, stats.num_preformatted, stats.num_dropped, stats.num_sync);
+	return 0;
+}
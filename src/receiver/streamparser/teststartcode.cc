@@ -0,0 +1,282 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Benchmark for start code scanning on captured H.264/HEVC/MPEG-2 transport streams.
+	The payloads of all packets of one pid are scanned packet by packet, as ts_substream_t does,
+	once with the scalar scanner and once with the vectorized one. As a baseline, they are also scanned
+	with the earlier implementation of ts_substream_t::next_start_code, which reads the stream with get<>.
+	All must find the same codes.
+
+	Usage: teststartcode --pid 0x100 capture.ts
+*/
+
+#include "startcode.h"
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace boost;
+namespace po = boost::program_options;
+using namespace dtdemux;
+
+struct options_t {
+	std::string filename;
+	int pid{-1};
+	int repeats{20};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB start code benchmark");
+	po::positional_options_description pd;
+	pd.add("file", 1);
+	std::string pid_str;
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("file,f", po::value<std::string>(&filename)->required(), "Transport stream file")
+			("pid,p", po::value<std::string>(&pid_str)->required(), "Video pid (decimal or 0x...)")
+			("repeats,r", po::value<int>(&repeats)->default_value(repeats), "Number of repetitions")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).positional(pd).run(), vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+		po::notify(vm);
+		pid = std::stoi(pid_str, nullptr, 0);
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+struct span_t {
+	int offset;
+	int len;
+};
+
+/*
+	returns the payload ranges of all packets with the requested pid
+*/
+static std::vector<span_t> payload_spans(const std::vector<uint8_t>& data, int pid) {
+	std::vector<span_t> ret;
+	for (size_t i = 0; i + 188 <= data.size(); i += 188) {
+		auto* p = &data[i];
+		if (p[0] != 0x47)
+			continue;
+		int packet_pid = ((p[1] & 0x1f) << 8) | p[2];
+		if (packet_pid != pid || (p[3] & 0xc0) /*encrypted*/ || !(p[3] & 0x10) /*no payload*/)
+			continue;
+		int start = 4;
+		if (p[3] & 0x20)
+			start += 1 + p[4];
+		if (start < 188)
+			ret.push_back(span_t{int(i) + start, 188 - start});
+	}
+	return ret;
+}
+
+/*
+	returns the offsets of the start code values; like ts_substream_t::next_start_code, the start code
+	value is consumed before scanning continues
+*/
+template <typename fn_t>
+static std::vector<int64_t> scan(const std::vector<uint8_t>& data, const std::vector<span_t>& spans, fn_t fn) {
+	std::vector<int64_t> ret;
+	int zeros = 0;
+	bool value_in_next_packet = false; //a prefix ended at the end of the previous packet
+	for (auto& s : spans) {
+		int done = 0;
+		if (value_in_next_packet) {
+			ret.push_back(s.offset);
+			done = 1;
+			value_in_next_packet = false;
+		}
+		for (;;) {
+			auto pos = fn(data.data() + s.offset + done, s.len - done, zeros);
+			if (pos < 0)
+				break;
+			if (done + pos == s.len) {
+				value_in_next_packet = true;
+				break;
+			}
+			ret.push_back(s.offset + done + pos);
+			done += pos + 1;
+		}
+	}
+	return ret;
+}
+
+/*
+	Reads the payloads as a single stream, in the same way as ts_substream_t::get<>:
+	each value is copied into a buffer, possibly from two packets, and then converted to native byte order
+*/
+struct legacy_reader_t {
+	const std::vector<uint8_t>& data;
+	const std::vector<span_t>& spans;
+	size_t idx{0}; //current span
+	int pos{0}; //position in current span
+	bool error{false}; //end of data
+
+	legacy_reader_t(const std::vector<uint8_t>& data, const std::vector<span_t>& spans)
+		: data(data)
+		, spans(spans) {}
+
+	int64_t offset() const {
+		return spans[idx].offset + pos;
+	}
+
+	void get_buffer(uint8_t* buffer, int len) {
+		while (len > 0) {
+			if (idx >= spans.size()) {
+				error = true;
+				memset(buffer, 0, len);
+				return;
+			}
+			int n = std::min(len, spans[idx].len - pos);
+			memcpy(buffer, data.data() + spans[idx].offset + pos, n);
+			buffer += n;
+			len -= n;
+			pos += n;
+			if (pos == spans[idx].len) {
+				idx++;
+				pos = 0;
+			}
+		}
+	}
+
+	template <typename T> T get() {
+		T ret;
+		get_buffer((uint8_t*)&ret, sizeof(T));
+		if constexpr (sizeof(T) == 4)
+			return __builtin_bswap32(ret);
+		else if constexpr (sizeof(T) == 2)
+			return __builtin_bswap16(ret);
+		else
+			return ret;
+	}
+
+	//the earlier implementation of ts_substream_t::next_start_code
+	uint8_t next_start_code() {
+		uint32_t code = get<uint32_t>();
+		for (;;) {
+			if ((code & 0xffffff00) == 0x00000100) { /*00 00 01 XX*/
+				return code & 0xff;
+			} else if ((code & 0x00ffffff) == 0x00000001) { /*YY 00 00 01 */
+				auto temp = get<uint8_t>();
+				code = (code << 8) | temp;
+			} else if ((code & 0xffff) == 0) { /*YY YY 00 00 */
+				auto temp = get<uint16_t>();
+				code = (code << 16) | temp;
+			} else if ((code & 0xff) == 0) { /*YY YY YY 00 */
+				auto temp = get<uint16_t>();
+				code = (code << 16) | temp;
+				auto temp1 = get<uint8_t>();
+				code = (code << 8) | temp1;
+			} else {
+				code = get<uint32_t>();
+			}
+			if (error)
+				return 0xff;
+		}
+	}
+};
+
+static std::vector<int64_t> scan_legacy(const std::vector<uint8_t>& data, const std::vector<span_t>& spans) {
+	std::vector<int64_t> ret;
+	legacy_reader_t reader(data, spans);
+	for (;;) {
+		reader.next_start_code();
+		if (reader.error)
+			break;
+		//the start code value was the last byte read
+		if (reader.pos > 0)
+			ret.push_back(reader.offset() - 1);
+		else
+			ret.push_back(spans[reader.idx - 1].offset + spans[reader.idx - 1].len - 1);
+	}
+	return ret;
+}
+
+template <typename fn_t>
+static double bench(const std::vector<uint8_t>& data, const std::vector<span_t>& spans, fn_t fn, int64_t num_bytes,
+										std::vector<int64_t>& found) {
+	auto start = std::chrono::steady_clock::now();
+	for (int r = 0; r < options.repeats; ++r)
+		found = fn(data, spans);
+	auto end = std::chrono::steady_clock::now();
+	auto secs = std::chrono::duration<double>(end - start).count();
+	return num_bytes * (double)options.repeats / secs / (1024 * 1024);
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	auto* fp = fopen(options.filename.c_str(), "rb");
+	if (!fp) {
+		printf("Could not open %s\n", options.filename.c_str());
+		return -1;
+	}
+	std::vector<uint8_t> data;
+	uint8_t buffer[188 * 1024];
+	for (;;) {
+		auto n = fread(buffer, 1, sizeof(buffer), fp);
+		if (n == 0)
+			break;
+		data.insert(data.end(), buffer, buffer + n);
+	}
+	fclose(fp);
+	auto spans = payload_spans(data, options.pid);
+	int64_t num_bytes = 0;
+	for (auto& s : spans)
+		num_bytes += s.len;
+	printf("%s: pid=0x%x packets=%ld payload=%ldMB\n", options.filename.c_str(), options.pid, spans.size(),
+				 num_bytes / (1024 * 1024));
+
+	std::vector<int64_t> found_legacy;
+	std::vector<int64_t> found_scalar;
+	std::vector<int64_t> found_simd;
+	auto legacy_rate = bench(data, spans, scan_legacy, num_bytes, found_legacy);
+	auto scalar_rate = bench(
+		data, spans, [](auto& data, auto& spans) { return scan(data, spans, find_start_code_scalar); }, num_bytes,
+		found_scalar);
+	auto simd_rate = bench(
+		data, spans, [](auto& data, auto& spans) { return scan(data, spans, find_start_code); }, num_bytes,
+		found_simd);
+	printf("get<>:      %8.1f MB/s  codes=%ld\n", legacy_rate, found_legacy.size());
+	printf("scalar:     %8.1f MB/s  codes=%ld\n", scalar_rate, found_scalar.size());
+	printf("vectorized: %8.1f MB/s  codes=%ld\n", simd_rate, found_simd.size());
+	if (found_scalar != found_simd || found_legacy != found_simd) {
+		printf("ERROR: results differ\n");
+		return -1;
+	}
+	return 0;
+}
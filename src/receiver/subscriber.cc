@@ -30,6 +30,7 @@
 subscriber_t::subscriber_t(receiver_t* receiver_, wxWindow* window_)
 	: receiver(receiver_)
 	, window(window_)
+	, notification_queue(make_notification_queue())
 {
 	owner = getpid();
 }
@@ -43,6 +44,9 @@ std::shared_ptr<subscriber_t> subscriber_t::make(receiver_t* receiver, wxWindow*
 subscriber_t::~subscriber_t() {
 	if ((int) get_subscription_id() >= 0)
 		unsubscribe();
+	auto stats = get_notification_stats();
+	dtdebugf("notifications={:d} events={:d} coalesced={:d} dropped={:d}", stats.num_notifications,
+					 stats.num_events, stats.num_coalesced, stats.num_dropped);
 }
 
 std::unique_ptr<playback_mpm_t> subscriber_t::subscribe_service_for_viewing(const chdb::service_t& service) {
@@ -46,11 +46,13 @@ struct spectrum_scan_t;
 
 namespace pybind11 {
 	class object;
+	class list;
 };
 
 struct blindscan_t;
 struct sdt_data_t;
 struct player_cb_t;
+struct notification_queue_t;
 
 class subscriber_t : public std::enable_shared_from_this<subscriber_t>
 {
@@ -71,6 +73,7 @@ class subscriber_t : public std::enable_shared_from_this<subscriber_t>
 												thread_safe_t> ts{"receiver", thread_group_t::receiver, {}};
 	receiver_t *receiver;
 	wxWindow* window{nullptr}; //window which will receive notifications
+	std::shared_ptr<notification_queue_t> notification_queue; //notifications not yet retrieved by window
 	std::atomic<bool> scanning_{false}; //subscriber is scanning
 	std::atomic<int> stream_id_{-1}; //subscriber is streaming
 
@@ -176,8 +179,17 @@ public:
 	//thread safe but is only allowed to be called from receiver_thread
 	void remove_ssptr();
 
+	struct notification_stats_t {
+		int64_t num_notifications{0}; //number of calls to notify
+		int64_t num_events{0}; //number of wake-up events sent to window
+		int64_t num_coalesced{0}; //notifications replaced by a later one before being retrieved
+		int64_t num_dropped{0}; //sdt_data notifications discarded because too many were pending
+	};
+
 	template<typename T> void notify(const T& data) const;
-	EXPORT static pybind11::object handle_to_py_object(int64_t handlle);
+	EXPORT static pybind11::list handle_to_py_objects(int64_t handle);
+	EXPORT notification_stats_t get_notification_stats() const;
+	static std::shared_ptr<notification_queue_t> make_notification_queue();
 
 	void notify_error(const ss::string_& errmsg);
 	void notify_scan_progress(const devdb::scan_stats_t& scan_stats);
@@ -24,10 +24,12 @@
 #include "receiver/scan.h"
 #include "receiver/subscriber.h"
 #include "util/neumovariant.h"
+#include <mutex>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h> //for std::optional
 #include "viewer/wxpy_api.h"
 #include <sip.h>
+#include <unordered_map>
 #include <wx/window.h>
 
 namespace py = pybind11;
@@ -70,27 +72,177 @@ typedef std::unique_ptr<statdb::spectrum_t> spectrum_ptr_t;
 typedef std::variant<signal_info_ptr_t, sdt_data_ptr_t, scan_stats_ptr_t, scan_mux_end_report_ptr_t,
 										 positioner_motion_report_ptr_t, spectrum_ptr_t, string_ptr_t> notification_ptr_t;
 
-py::object subscriber_t::handle_to_py_object(int64_t handle) {
-	auto& ptr = *(notification_ptr_t*)handle;
-	auto x = std::visit([](auto& ptr) { return py::cast(std::move(*ptr)); }, ptr);
-	delete &ptr;
-	return x;
+/*
+	Notifications from receiver threads to a window. Only a single wake-up event is sent to the window
+	for all notifications which are queued before the window retrieves them. For signal_info and scan_stats,
+	only the most recent value matters, and for sdt_data the most recent value for each mux. When such a
+	value is queued, a pending older value is cleared and the new one is appended, so that the window receives
+	the latest value at the position at which it was notified, i.e., in the correct order with respect to
+	other notifications such as scan start/end reports. Clearing instead of removing the older value keeps
+	queuing O(1); cleared entries are skipped when retrieving and compacted away when they pile up.
+
+	Receiver threads hold mutex only for the few operations needed to queue a notification.
+*/
+struct notification_queue_t {
+	static constexpr int max_pending = 1024; //sdt_data for muxes not yet pending is dropped beyond this
+
+	std::mutex mutex; //protects everything up to wakeup_pending
+	std::vector<notification_ptr_t> pending; //oldest first; contains cleared entries
+	int num_live{0}; //number of entries in pending which are not cleared
+	int signal_info_idx{-1}; //index in pending of the latest signal_info, or -1
+	int scan_stats_idx{-1};
+	std::unordered_map<uint64_t, int> sdt_data_idxs; //index in pending of the latest sdt_data, per mux
+
+	std::atomic<bool> wakeup_pending{false};
+
+	std::atomic<int64_t> num_notifications{0};
+	std::atomic<int64_t> num_events{0};
+	std::atomic<int64_t> num_coalesced{0};
+	std::atomic<int64_t> num_dropped{0};
+
+	//mux_key_t cannot be hashed, but its fields fit in 64 bits
+	static inline uint64_t packed_key(const chdb::mux_key_t& k) {
+		return (uint64_t(uint16_t(k.sat_pos)) << 48) | (uint64_t(uint16_t(k.stream_id)) << 32) |
+			(uint64_t(uint16_t(k.t2mi_pid)) << 16) | uint64_t(k.mux_id);
+	}
+
+	static inline bool is_cleared(const notification_ptr_t& n) {
+		return std::visit([](auto& ptr) { return !ptr; }, n);
+	}
+
+	/*
+		remove cleared entries and update the indices of the remaining ones; as this is only done
+		when at least half of the entries are cleared, the amortized cost per notification is O(1).
+		Called with mutex locked
+	*/
+	void compact() {
+		size_t j = 0;
+		for (size_t i = 0; i < pending.size(); ++i) {
+			auto& n = pending[i];
+			if (is_cleared(n))
+				continue;
+			std::visit([this, j](auto& ptr) {
+				using T = typename std::decay_t<decltype(ptr)>::element_type;
+				if constexpr (std::is_same_v<T, signal_info_t>)
+					signal_info_idx = j;
+				else if constexpr (std::is_same_v<T, devdb::scan_stats_t>)
+					scan_stats_idx = j;
+				else if constexpr (std::is_same_v<T, sdt_data_t>)
+					sdt_data_idxs[packed_key(ptr->mux_key)] = j;
+			}, n);
+			if (i != j)
+				pending[j] = std::move(n);
+			++j;
+		}
+		pending.resize(j);
+	}
+
+	//clears the notification at idx (if any) and appends value; called with mutex locked
+	void replace(int& idx, notification_ptr_t&& value) {
+		if (idx >= 0) {
+			std::visit([](auto& ptr) { ptr.reset(); }, pending[idx]);
+			num_coalesced++;
+		} else
+			num_live++;
+		pending.push_back(std::move(value));
+		idx = pending.size() - 1;
+		if (pending.size() > 2 * (size_t)num_live + 64)
+			compact();
+	}
+
+	//called from receiver threads
+	template <typename T> void push(std::unique_ptr<T> value) {
+		std::scoped_lock lck(mutex);
+		if constexpr (std::is_same_v<T, signal_info_t>)
+			replace(signal_info_idx, std::move(value));
+		else if constexpr (std::is_same_v<T, devdb::scan_stats_t>)
+			replace(scan_stats_idx, std::move(value));
+		else if constexpr (std::is_same_v<T, sdt_data_t>) {
+			auto key = packed_key(value->mux_key);
+			auto it = sdt_data_idxs.find(key);
+			if (it == sdt_data_idxs.end()) {
+				if (num_live >= max_pending) {
+					num_dropped++;
+					return;
+				}
+				it = sdt_data_idxs.emplace(key, -1).first;
+			}
+			replace(it->second, std::move(value));
+		} else {
+			num_live++;
+			pending.push_back(std::move(value));
+		}
+	}
+
+	//called from receiver threads
+	void wake_up(wxWindow* window, const std::shared_ptr<notification_queue_t>& self) {
+		if (wakeup_pending.exchange(true))
+			return; //window has not yet processed the previous event
+		num_events++;
+		wxCommandEvent event(wxEVT_COMMAND_ENTER);
+		//keeps the queue alive until the window processes the event
+		auto* handle = new std::shared_ptr<notification_queue_t>(self);
+		static_assert(sizeof(handle) <= sizeof(long));
+		event.SetExtraLong((intptr_t)handle);
+		wxQueueEvent(window, event.Clone());
+	}
+
+	//called from gui thread; returns all notifications in the order in which they were made
+	std::vector<notification_ptr_t> take_all() {
+		/*must be cleared before retrieving the notifications: notifications added while
+			we are retrieving will then cause a new wake-up event*/
+		wakeup_pending.exchange(false);
+		std::vector<notification_ptr_t> all;
+		{
+			std::scoped_lock lck(mutex);
+			std::swap(all, pending);
+			num_live = 0;
+			signal_info_idx = -1;
+			scan_stats_idx = -1;
+			sdt_data_idxs.clear();
+		}
+		std::vector<notification_ptr_t> ret;
+		ret.reserve(all.size());
+		for (auto& n : all)
+			if (!is_cleared(n))
+				ret.push_back(std::move(n));
+		return ret;
+	}
+};
+
+std::shared_ptr<notification_queue_t> subscriber_t::make_notification_queue() {
+	return std::make_shared<notification_queue_t>();
 }
 
-template <typename T> inline static intptr_t make_object(const T& obj) {
-	auto* x = new notification_ptr_t(std::move(std::make_unique<T>(obj)));
-	return (intptr_t)x;
+subscriber_t::notification_stats_t subscriber_t::get_notification_stats() const {
+	notification_stats_t ret;
+	auto& q = *notification_queue;
+	ret.num_notifications = q.num_notifications;
+	ret.num_events = q.num_events;
+	ret.num_coalesced = q.num_coalesced;
+	ret.num_dropped = q.num_dropped;
+	return ret;
+}
+
+//called from gui thread
+py::list subscriber_t::handle_to_py_objects(int64_t handle) {
+	auto* q = (std::shared_ptr<notification_queue_t>*)handle;
+	auto notifications = (*q)->take_all();
+	delete q;
+	py::list ret;
+	for (auto& ptr : notifications)
+		ret.append(std::visit([](auto& ptr) { return py::cast(std::move(*ptr)); }, ptr));
+	return ret;
 }
 
 //called from receiver thread
 template <typename T> void subscriber_t::notify(const T& data) const {
-	wxCommandEvent event(wxEVT_COMMAND_ENTER);
-	auto p = make_object(data);
-	static_assert(sizeof(p) <= sizeof(long));
-	event.SetExtraLong(p);
-	auto* newevent = event.Clone();
-	if(window)
-		wxQueueEvent(window, newevent);
+	if (!window)
+		return;
+	auto& q = *notification_queue;
+	q.num_notifications++;
+	q.push(std::make_unique<T>(data));
+	q.wake_up(window, notification_queue);
 }
 
 #endif
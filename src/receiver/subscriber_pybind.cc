@@ -124,8 +124,8 @@ static std::shared_ptr<subscriber_t> get_global_subscriber(receiver_t* receiver,
 	return receiver->global_subscriber;
 }
 
-static py::object get_object(long x) {
-	return subscriber_t::handle_to_py_object(x);
+static py::list get_objects(long x) {
+	return subscriber_t::handle_to_py_objects(x);
 }
 
 void export_pls_search_range(py::module& m) {
@@ -253,7 +253,7 @@ void export_subscriber(py::module& m) {
 		return;
 	called = true;
 	export_pls_search_range(m);
-	m.def("get_object", &get_object)
+	m.def("get_objects", &get_objects, "Retrieve all notifications signalled by a subscriber event")
 		.def("set_gtk_window_name", &set_gtk_window_name
 				, "Set a gtk widget name for a wx window (needed for css styling)"
 				, py::arg("window")
@@ -325,6 +325,14 @@ void export_subscriber(py::module& m) {
 			)
 		.def_property_readonly("error_message", [](subscriber_t* self) {
 			return get_error().c_str(); })
+		.def_property_readonly("notification_stats", [](subscriber_t* self) {
+			auto stats = self->get_notification_stats();
+			py::dict ret;
+			ret["notifications"] = stats.num_notifications;
+			ret["events"] = stats.num_events;
+			ret["coalesced"] = stats.num_coalesced;
+			ret["dropped"] = stats.num_dropped;
+			return ret; })
 		.def("unsubscribe"
 				 , &subscriber_t::unsubscribe
 				 , "End tuning")
@@ -525,6 +533,12 @@ void export_scan_report(py::module& m) {
 		.def_readwrite("peak", &scan_mux_end_report_t::peak)
 		.def_readwrite("mux", &scan_mux_end_report_t::mux)
 		.def_readwrite("fe_key", &scan_mux_end_report_t::fe_key)
+		.def_readwrite("epg_cache_stats", &scan_mux_end_report_t::epg_cache_stats)
+		;
+	py::class_<epg_cache_stats_t>(m, "epg_cache_stats_t")
+		.def(py::init())
+		.def_readwrite("num_hits", &epg_cache_stats_t::num_hits)
+		.def_readwrite("num_misses", &epg_cache_stats_t::num_misses)
 		;
 	py::class_<peak_to_scan_t>(m, "peak_to_scan_t")
 		.def(py::init())
@@ -160,6 +160,7 @@ protected:
 	void set_name(const char*name) {
 		pthread_setname_np(pthread_self(), name);
 		log4cxx::MDC::put( "thread_name", name);
+		dtlog::set_thread_name(name);
 	}
 
 	inline bool is_timer_fd(const epoll_event* event) const {
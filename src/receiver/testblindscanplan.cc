@@ -0,0 +1,340 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Test for blindscan_planner_t: plans a blindscan over simulated tuners and executes it using a simulated
+	frontend which returns the peaks from recorded spectra (as saved in spectrum_path by neumoDVB, i.e.,
+	<sat>/<date>_<time>_<pol>_..._peaks.dat). Without recorded spectra, random peaks are generated.
+
+	Checks that the planner never uses a cable or dish in two incompatible ways at the same time and that
+	all peaks are tuned, and reports the projected and (simulated) actual duration.
+*/
+
+#include "blindscan_planner.h"
+#include "util/logger.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <random>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+struct options_t {
+	std::string spectrum_path;
+	int num_tuners{8};
+	int num_sweepers{2}; //number of tuners which can acquire spectra
+	int num_rf_inputs{4};
+	bool positioner{false}; //all lnbs are on the same dish with a positioner
+	int seed{1};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB blindscan planner test");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("spectrum-path,s", po::value<std::string>(&spectrum_path), "Directory with recorded spectra")
+			("tuners,n", po::value<int>(&num_tuners)->default_value(num_tuners), "Number of tuners")
+			("sweepers,w", po::value<int>(&num_sweepers)->default_value(num_sweepers),
+			 "Number of tuners which can acquire spectra")
+			("rf-inputs,r", po::value<int>(&num_rf_inputs)->default_value(num_rf_inputs), "Number of card rf inputs")
+			("positioner,p", po::bool_switch(&positioner), "Put all lnbs on one dish with a positioner")
+			("seed", po::value<int>(&seed)->default_value(seed), "Seed for random numbers")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		po::notify(vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+//recorded or generated peaks for one band
+struct recorded_band_t {
+	blindscan_band_t band;
+	std::vector<blindscan_peak_t> peaks;
+};
+
+//28.2E -> 2820; 30.0W -> -3000
+static std::optional<int16_t> parse_sat_pos(const std::string& s) {
+	char* end{nullptr};
+	auto val = strtod(s.c_str(), &end);
+	if (end == s.c_str() || (*end != 'E' && *end != 'W'))
+		return {};
+	return (int16_t)std::lround(val * (*end == 'W' ? -100 : 100));
+}
+
+static std::optional<chdb::fe_polarisation_t> parse_pol(const std::string& s) {
+	using namespace chdb;
+	if (s == "H")
+		return fe_polarisation_t::H;
+	if (s == "V")
+		return fe_polarisation_t::V;
+	if (s == "L")
+		return fe_polarisation_t::L;
+	if (s == "R")
+		return fe_polarisation_t::R;
+	return {};
+}
+
+/*
+	Each peaks file contains lines "frequency(MHz) symbol_rate" for one sat and pol, covering all bands.
+	If a sat/pol was recorded more than once, the last recording is used
+*/
+static std::vector<recorded_band_t> load_recorded_spectra(const std::string& spectrum_path) {
+	std::map<std::tuple<int16_t, chdb::fe_polarisation_t>, fs::path> files;
+	std::error_code ec;
+	for (auto& entry : fs::recursive_directory_iterator(spectrum_path, ec)) {
+		auto name = entry.path().filename().string();
+		const std::string suffix{"_peaks.dat"};
+		if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+		//name is <date>_<time>_<pol>_...
+		auto p1 = name.find('_');
+		auto p2 = p1 == std::string::npos ? p1 : name.find('_', p1 + 1);
+		auto p3 = p2 == std::string::npos ? p2 : name.find('_', p2 + 1);
+		if (p3 == std::string::npos)
+			continue;
+		auto sat_pos = parse_sat_pos(entry.path().parent_path().filename().string());
+		auto pol = parse_pol(name.substr(p2 + 1, p3 - p2 - 1));
+		if (!sat_pos || !pol)
+			continue;
+		auto& f = files[{*sat_pos, *pol}];
+		if (f.empty() || f.filename() < entry.path().filename())
+			f = entry.path();
+	}
+
+	std::map<std::tuple<int16_t, chdb::fe_polarisation_t, chdb::sat_band_t, chdb::sat_sub_band_t>,
+					 recorded_band_t> bands;
+	for (auto& [k, path] : files) {
+		auto [sat_pos, pol] = k;
+		FILE* fp = fopen(path.c_str(), "r");
+		if (!fp)
+			continue;
+		double freq_mhz{0};
+		int symbol_rate{0};
+		while (fscanf(fp, "%lf %d", &freq_mhz, &symbol_rate) == 2) {
+			int32_t freq = std::lround(freq_mhz * 1000);
+			auto [sat_band, sub_band] = chdb::sat_band_for_freq(freq);
+			auto& b = bands[{sat_pos, pol, sat_band, sub_band}];
+			if (b.band.sat_pos == sat_pos_none) {
+				auto [l, h] = chdb::sat_band_freq_bounds(sat_band, sub_band);
+				b.band = {sat_pos, sat_band, sub_band, pol, l, h};
+			}
+			b.peaks.push_back({freq, symbol_rate});
+		}
+		fclose(fp);
+	}
+	std::vector<recorded_band_t> ret;
+	for (auto& [k, b] : bands)
+		ret.push_back(b);
+	return ret;
+}
+
+static std::vector<recorded_band_t> make_random_spectra(std::mt19937& rng) {
+	using namespace chdb;
+	std::vector<recorded_band_t> ret;
+	std::uniform_int_distribution<int> num_peaks(10, 40);
+	std::uniform_int_distribution<int> symbol_rate(1000000, 45000000);
+	for (int16_t sat_pos : {-3000, 130, 1920, 2820}) {
+		for (auto pol : {fe_polarisation_t::H, fe_polarisation_t::V}) {
+			for (auto sub_band : {sat_sub_band_t::LOW, sat_sub_band_t::HIGH}) {
+				recorded_band_t b;
+				auto [l, h] = sat_band_freq_bounds(sat_band_t::Ku, sub_band);
+				b.band = {sat_pos, sat_band_t::Ku, sub_band, pol, l, h};
+				std::uniform_int_distribution<int> freq(l, h - 1);
+				for (int n = num_peaks(rng); n > 0; --n)
+					b.peaks.push_back({freq(rng), symbol_rate(rng)});
+				std::sort(b.peaks.begin(), b.peaks.end(), [](auto& a, auto& b) { return a.frequency < b.frequency; });
+				ret.push_back(b);
+			}
+		}
+	}
+	return ret;
+}
+
+/*
+	one card with num_rf_inputs inputs and num_tuners demodulators which can all use each input.
+	There is one lnb per sat, connected to rf inputs in a round robin fashion (via a diseqc switch)
+*/
+static blindscan_topology_t make_topology(const std::vector<recorded_band_t>& recorded, int num_tuners,
+																					int num_sweepers) {
+	blindscan_topology_t ret;
+	std::map<int16_t, int> paths; //per sat
+	for (int b = 0; b < (int)recorded.size(); ++b) {
+		auto sat_pos = recorded[b].band.sat_pos;
+		auto [it, inserted] = paths.try_emplace(sat_pos, (int)ret.paths.size());
+		if (inserted) {
+			blindscan_path_t path;
+			path.rf_path.card_mac_address = 0x1234;
+			path.rf_path.rf_input = it->second % options.num_rf_inputs;
+			path.rf_path.lnb.lnb_id = sat_pos;
+			path.cable = path.rf_path.rf_input;
+			path.dish = options.positioner ? 0 : -1;
+			path.bands.resize(recorded.size());
+			ret.paths.push_back(path);
+		}
+		ret.paths[it->second].bands[b] = true;
+	}
+	for (int t = 0; t < num_tuners; ++t) {
+		blindscan_tuner_t tuner;
+		tuner.fe_key.frontend_no = t;
+		tuner.adapter_no = t;
+		tuner.can_sweep = t < num_sweepers;
+		for (int p = 0; p < (int)ret.paths.size(); ++p)
+			tuner.paths.push_back(p);
+		ret.tuners.push_back(tuner);
+	}
+	return ret;
+}
+
+/*
+	Frontend which returns the recorded peaks, with random durations, and which checks that concurrent
+	jobs do not require incompatible cable or dish settings
+*/
+class simulated_frontend_t : public blindscan_executor_t {
+	struct active_t {
+		double end_time{0};
+		blindscan_job_t job;
+	};
+	const blindscan_planner_t& planner;
+	const std::vector<recorded_band_t>& recorded;
+	std::mt19937& rng;
+	std::vector<active_t> active;
+
+	double start(const blindscan_job_t& job, double duration);
+
+public:
+	int num_violations{0};
+
+	simulated_frontend_t(const blindscan_planner_t& planner, const std::vector<recorded_band_t>& recorded,
+											 std::mt19937& rng)
+		: planner(planner)
+		, recorded(recorded)
+		, rng(rng)
+		{}
+
+	virtual double sweep(const blindscan_job_t& job, const blindscan_band_t& band,
+											 std::vector<blindscan_peak_t>& peaks) override {
+		peaks = recorded[job.band].peaks;
+		std::uniform_real_distribution<double> jitter(0.8, 1.2);
+		return start(job, band.width_mhz() * planner.get_cost_model().sweep_seconds_per_mhz * jitter(rng));
+	}
+
+	virtual double tune_peak(const blindscan_job_t& job, const blindscan_band_t& band, bool& locked) override {
+		//low symbol rate muxes fail more often
+		std::uniform_real_distribution<double> p(0., 1.);
+		locked = p(rng) < (job.peak.symbol_rate < 2000000 ? 0.5 : 0.9);
+		std::uniform_real_distribution<double> si_time(2., 10.);
+		return start(job, locked ? si_time(rng) : 4.);
+	}
+};
+
+double simulated_frontend_t::start(const blindscan_job_t& job, double duration) {
+	auto& cost_model = planner.get_cost_model();
+	duration += (job.needs_switch ? cost_model.switch_seconds : 0.) +
+		(job.needs_dish_move ? cost_model.dish_move_seconds : 0.);
+	auto& topology = planner.get_topology();
+	auto& band = planner.get_band(job.band);
+	auto& path = topology.paths[job.path];
+	std::erase_if(active, [&job](const active_t& a) { return a.end_time <= job.start_time; });
+	for (auto& a : active) {
+		auto& other_band = planner.get_band(a.job.band);
+		auto& other_path = topology.paths[a.job.path];
+		if (a.job.tuner == job.tuner) {
+			printf("tuner %d used twice\n", job.tuner);
+			num_violations++;
+		}
+		if (other_path.cable == path.cable &&
+				(a.job.path != job.path || other_band.pol != band.pol || other_band.sub_band != band.sub_band ||
+				 other_band.sat_pos != band.sat_pos)) {
+			printf("cable %d used for two different bands\n", path.cable);
+			num_violations++;
+		}
+		if (path.dish >= 0 && other_path.dish == path.dish && other_band.sat_pos != band.sat_pos) {
+			printf("dish %d used for two different sats\n", path.dish);
+			num_violations++;
+		}
+	}
+	active.push_back({job.start_time + duration, job});
+	return duration;
+}
+
+static std::vector<blindscan_band_t> bands_of(const std::vector<recorded_band_t>& recorded) {
+	std::vector<blindscan_band_t> ret;
+	for (auto& r : recorded)
+		ret.push_back(r.band);
+	return ret;
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	logger->setLevel(Level::getInfo());
+	std::mt19937 rng(options.seed);
+	auto recorded = options.spectrum_path.empty() ? make_random_spectra(rng)
+		: load_recorded_spectra(options.spectrum_path);
+	if (recorded.empty()) {
+		printf("No spectra found in %s\n", options.spectrum_path.c_str());
+		return -1;
+	}
+	int num_recorded_peaks{0};
+	for (auto& r : recorded)
+		num_recorded_peaks += r.peaks.size();
+	auto bands = bands_of(recorded);
+
+	blindscan_planner_t single(make_topology(recorded, 1, 1), bands);
+	auto baseline = single.project();
+
+	blindscan_planner_t planner(make_topology(recorded, options.num_tuners, options.num_sweepers), bands);
+	auto projected = planner.project();
+	simulated_frontend_t frontend(planner, recorded, rng);
+	auto actual = run_blindscan_plan(planner, frontend);
+
+	printf("bands=%d peaks=%d tuners=%d sweepers=%d rf_inputs=%d positioner=%d\n",
+				 (int)bands.size(), num_recorded_peaks, options.num_tuners, options.num_sweepers,
+				 options.num_rf_inputs, options.positioner);
+	printf("projected: %.0fs (single tuner: %.0fs)\n", projected.duration, baseline.duration);
+	printf("actual:    %.0fs sweeps=%d peaks=%d locked=%d switches=%d dish_moves=%d\n",
+				 actual.duration, actual.num_sweeps, actual.num_peaks, actual.num_locked_peaks, actual.num_switches,
+				 actual.num_dish_moves);
+	for (int t = 0; t < (int)actual.busy_time.size(); ++t)
+		printf("tuner %d: busy %.0f%%\n", t, actual.duration > 0 ? 100. * actual.busy_time[t] / actual.duration : 0.);
+
+	bool ok = frontend.num_violations == 0 && planner.done() && actual.num_unreachable_bands == 0 &&
+		actual.num_sweeps == (int)bands.size() && actual.num_peaks == num_recorded_peaks;
+	printf("%s\n", ok ? "Test passed" : "Test failed");
+	return ok ? 0 : -1;
+}
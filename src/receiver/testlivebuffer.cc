@@ -0,0 +1,197 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Stress test for livebuffer writing: N threads each write a synthetic transport stream
+	into a livebuffer file, in the same way as active_mpm_t::process_channel_data,
+	using either a shared mmap or io_uring. Reports latency percentiles of a single iteration.
+*/
+
+#include "filemapper.h"
+#include "util/logger.h"
+#include "util/util.h"
+#include <algorithm>
+#include <boost/program_options.hpp>
+#include <fcntl.h>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace boost;
+namespace po = boost::program_options;
+
+struct options_t {
+	std::string dir{"/tmp/testlivebuffer"};
+	int num_streams{8};
+	int duration{30}; //seconds
+	int rate{40}; //Mbit/s per stream
+	int interval{10}; //ms between reads
+	bool use_uring{false};
+	bool use_o_direct{false};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB livebuffer stress test");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("dir,d", po::value<std::string>(&dir)->default_value(dir), "Directory in which to create files")
+			("streams,n", po::value<int>(&num_streams)->default_value(num_streams), "Number of concurrent streams")
+			("duration,t", po::value<int>(&duration)->default_value(duration), "Duration of test in seconds")
+			("rate,r", po::value<int>(&rate)->default_value(rate), "Bit rate per stream in Mbit/s")
+			("interval,i", po::value<int>(&interval)->default_value(interval), "Milliseconds between reads")
+			("uring", po::bool_switch(&use_uring), "Use io_uring instead of mmap")
+			("direct", po::bool_switch(&use_o_direct), "Use O_DIRECT (with io_uring)")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		po::notify(vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static constexpr int packet_size = 188;
+static constexpr size_t initial_file_size = 127827968; //same as active_mpm_t
+
+struct stream_result_t {
+	std::vector<int64_t> latencies; //in microseconds
+	int64_t num_bytes{0};
+	bool error{false};
+};
+
+static void fill_packets(uint8_t* p, int num_packets, int pid, uint8_t& cc) {
+	for (int i = 0; i < num_packets; ++i, p += packet_size) {
+		p[0] = 0x47;
+		p[1] = (pid >> 8) & 0x1f;
+		p[2] = pid & 0xff;
+		p[3] = 0x10 | (cc++ & 0xf);
+		memset(p + 4, i & 0xff, packet_size - 4);
+	}
+}
+
+static void run_stream(int idx, stream_result_t& result) {
+	ss::string<256> filename;
+	filename.format("{}/stream{:02d}.ts", options.dir, idx);
+	int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0 || ftruncate(fd, initial_file_size) < 0) {
+		printf("Could not create %s: %s\n", filename.c_str(), strerror(errno));
+		if (fd >= 0)
+			::close(fd);
+		result.error = true;
+		return;
+	}
+	mmap_t filemap(initial_file_size, false);
+	if (options.use_uring) {
+		uring_writer_options_t o;
+		o.use_o_direct = options.use_o_direct;
+		if (!filemap.enable_uring(o)) {
+			::close(fd);
+			result.error = true;
+			return;
+		}
+	}
+	filemap.init(fd, 0);
+	const int64_t bytes_per_interval = int64_t(options.rate) * 1000000 / 8 * options.interval / 1000;
+	const int packets_per_interval = std::max((int64_t)1, bytes_per_interval / packet_size);
+	uint8_t cc = 0;
+	auto start = steady_clock_t::now();
+	auto next = start;
+	while (steady_clock_t::now() - start < std::chrono::seconds(options.duration)) {
+		next += std::chrono::milliseconds(options.interval);
+		auto s = steady_clock_t::now();
+		//this loop mimics active_mpm_t::process_channel_data
+		for (int todo = packets_per_interval; todo > 0;) {
+			uint8_t* buffer = nullptr;
+			auto remaining_space = filemap.get_write_buffer(buffer);
+			if (remaining_space < 1024) {
+				filemap.advance();
+				remaining_space = filemap.get_write_buffer(buffer);
+			}
+			int n = std::min(todo, std::min(1024, remaining_space / packet_size));
+			fill_packets(buffer, n, 0x100 + idx, cc);
+			filemap.advance_write_pointer(n * packet_size);
+			filemap.advance_decrypt_pointer(n * packet_size);
+			filemap.flush();
+			todo -= n;
+			result.num_bytes += n * packet_size;
+		}
+		auto e = steady_clock_t::now();
+		result.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(e - s).count());
+		std::this_thread::sleep_until(next);
+	}
+	filemap.unmap();
+	filemap.close();
+	std::filesystem::remove(filename.c_str());
+}
+
+static int64_t percentile(const std::vector<int64_t>& sorted, double p) {
+	if (sorted.size() == 0)
+		return 0;
+	auto idx = std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+	return sorted[idx];
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	logger->setLevel(Level::getInfo());
+	if (!mkpath(options.dir)) {
+		printf("Could not create %s\n", options.dir.c_str());
+		return -1;
+	}
+	std::vector<stream_result_t> results(options.num_streams);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < options.num_streams; ++i)
+		threads.emplace_back(run_stream, i, std::ref(results[i]));
+	for (auto& t : threads)
+		t.join();
+
+	std::vector<int64_t> all;
+	int64_t num_bytes{0};
+	for (auto& r : results) {
+		if (r.error) {
+			printf("Test failed\n");
+			return -1;
+		}
+		all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+		num_bytes += r.num_bytes;
+	}
+	std::sort(all.begin(), all.end());
+	printf("backend=%s streams=%d rate=%dMbit/s iterations=%ld written=%ldMB\n",
+				 options.use_uring ? (options.use_o_direct ? "io_uring+O_DIRECT" : "io_uring") : "mmap",
+				 options.num_streams, options.rate, all.size(), num_bytes / (1024 * 1024));
+	printf("iteration latency (us): p50=%ld p90=%ld p99=%ld p99.9=%ld max=%ld\n",
+				 percentile(all, 0.5), percentile(all, 0.9), percentile(all, 0.99), percentile(all, 0.999),
+				 all.size() ? all.back() : 0);
+	return 0;
+}
@@ -0,0 +1,168 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Test for the background copy of recordings (reccopy.h):
+	- copy_file resumes from an existing "<name>.part" file, and restarts if that file is too large
+	- link_or_stage_file stages a file when source and destination are on different filesystems
+	  (e.g., --live-dir on disk and --recordings-dir on tmpfs), after which recording_copier_t copies it
+	  and removes the staging directory
+*/
+
+#include "reccopy.h"
+#include "util/logger.h"
+#include <boost/program_options.hpp>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace po = boost::program_options;
+
+struct options_t {
+	std::string live_dir{"/tmp"};
+	std::string recordings_dir{"/dev/shm"};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB recording copy test");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("live-dir,l", po::value<std::string>(&live_dir)->default_value(live_dir),
+			 "Directory on the live buffer filesystem")
+			("recordings-dir,r", po::value<std::string>(&recordings_dir)->default_value(recordings_dir),
+			 "Directory on another filesystem")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		po::notify(vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+static std::string make_data(size_t size) {
+	std::string ret(size, '\0');
+	for (size_t i = 0; i < size; ++i)
+		ret[i] = (i * 7 + i / 4096) & 0xff;
+	return ret;
+}
+
+static void write_file(const fs::path& path, const std::string& data) {
+	std::ofstream f(path, std::ios::binary);
+	f.write(data.data(), data.size());
+}
+
+static std::string read_file(const fs::path& path) {
+	std::ifstream f(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static bool same_filesystem(const fs::path& a, const fs::path& b) {
+	struct stat sa, sb;
+	return ::stat(a.c_str(), &sa) == 0 && ::stat(b.c_str(), &sb) == 0 && sa.st_dev == sb.st_dev;
+}
+
+static int check(bool ok, const char* what) {
+	printf("%s: %s\n", what, ok ? "ok" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+static int test_resume(const fs::path& dir) {
+	int errors{0};
+	recording_copier_t copier(0, nullptr);
+	auto data = make_data(2 * recording_copier_t::chunk_size + 12345);
+	auto src = dir / "src.ts";
+	auto dst = dir / "dst.ts";
+	auto part = dir / "dst.ts.part";
+	write_file(src, data);
+
+	//interrupted copy: the first part of the data is already present
+	write_file(part, data.substr(0, recording_copier_t::chunk_size + 17));
+	errors += check(copier.copy_file(src, dst) == 0 && read_file(dst) == data && !fs::exists(part),
+									"resume from .part file");
+
+	//a .part file larger than the source cannot be the start of the copy
+	fs::remove(dst);
+	write_file(part, data + "garbage");
+	errors += check(copier.copy_file(src, dst) == 0 && read_file(dst) == data && !fs::exists(part),
+									"restart with oversized .part file");
+	return errors;
+}
+
+static int test_staging(const fs::path& live_dir, const fs::path& recordings_dir) {
+	int errors{0};
+	auto data = make_data(recording_copier_t::chunk_size / 2 + 999);
+	auto src = live_dir / "00001.ts";
+	auto dst_dir = recordings_dir / "recording";
+	auto staging_dir = live_dir / ".finalize" / "recording";
+	fs::create_directories(dst_dir);
+	write_file(src, data);
+
+	auto ret = link_or_stage_file(src, dst_dir / "00001.ts", staging_dir);
+	if (same_filesystem(live_dir, recordings_dir)) {
+		printf("%s and %s are on the same filesystem; staging not tested\n", live_dir.c_str(),
+					 recordings_dir.c_str());
+		return check(ret == 0 && read_file(dst_dir / "00001.ts") == data, "link on same filesystem");
+	}
+	errors += check(ret == 1 && fs::exists(staging_dir / "00001.ts") && !fs::exists(dst_dir / "00001.ts"),
+									"stage on other filesystem");
+	fs::remove(src); //as when the live buffer is removed
+
+	std::promise<bool> done;
+	recording_copier_t copier(0, [&done](const recdb::rec_t& rec, bool success) { done.set_value(success); });
+	copier.add_job({recdb::rec_t(), staging_dir, dst_dir});
+	auto fut = done.get_future();
+	bool finished = fut.wait_for(std::chrono::seconds(10)) == std::future_status::ready;
+	errors += check(finished && fut.get() && read_file(dst_dir / "00001.ts") == data && !fs::exists(staging_dir),
+									"copy staged file");
+	return errors;
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	auto name = "testreccopy-" + std::to_string(getpid());
+	auto live_dir = fs::path(options.live_dir) / name;
+	auto recordings_dir = fs::path(options.recordings_dir) / name;
+	fs::create_directories(live_dir);
+	fs::create_directories(recordings_dir);
+	int errors{0};
+	errors += test_resume(live_dir);
+	errors += test_staging(live_dir, recordings_dir);
+	fs::remove_all(live_dir);
+	fs::remove_all(recordings_dir);
+	printf("%s\n", errors ? "FAILED" : "all tests passed");
+	return errors ? 1 : 0;
+}
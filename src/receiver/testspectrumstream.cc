@@ -0,0 +1,206 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+/*
+	Test for spectrum_peak_stream_t: feeds spectra in chunks, as they would arrive during a sweep, and checks
+	that the final result is identical to find_tps on the complete spectrum. Also reports how early peaks
+	were confirmed and how many early peaks were later retracted.
+
+	Spectra are read from files saved in spectrum_path by neumoDVB (<sat>/..._spectrum.dat). Without
+	recorded spectra, random spectra are generated.
+*/
+
+#include "spectrum_algo.h"
+#include <boost/program_options.hpp>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+using namespace boost;
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+struct options_t {
+	std::string spectrum_path;
+	int chunk_size{512}; //number of samples per chunk
+	int num_random{20}; //number of random spectra to generate without spectrum_path
+	int seed{1};
+	int parse_options(int argc, char** argv);
+};
+
+options_t options;
+
+int options_t::parse_options(int argc, char** argv) {
+	po::options_description desc("NeumoDVB streaming spectrum peak detection test");
+	try {
+		desc.add_options()
+			("usage,u", "show usage")
+			("spectrum-path,s", po::value<std::string>(&spectrum_path), "Directory with recorded spectra")
+			("chunk-size,c", po::value<int>(&chunk_size)->default_value(chunk_size), "Samples per chunk")
+			("random,r", po::value<int>(&num_random)->default_value(num_random), "Number of random spectra")
+			("seed", po::value<int>(&seed)->default_value(seed), "Seed for random numbers")
+			;
+
+		po::variables_map vm;
+		po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+		po::notify(vm);
+		if (vm.count("usage")) {
+			std::cerr << desc << "\n";
+			return -1;
+		}
+
+	} catch (std::exception& e) {
+		std::cerr << e.what() << "\n";
+		std::cerr << desc << "\n";
+		return -1;
+	}
+	return 0;
+}
+
+struct test_spectrum_t {
+	std::string name;
+	ss::vector<uint32_t, 65536> freq; //kHz
+	ss::vector<int32_t, 65536> rf_level; //mdB
+};
+
+//each file contains lines "frequency(MHz) level(mdB) candidate_symbol_rate"
+static std::vector<test_spectrum_t> load_recorded_spectra(const std::string& spectrum_path) {
+	std::vector<test_spectrum_t> ret;
+	std::error_code ec;
+	for (auto& entry : fs::recursive_directory_iterator(spectrum_path, ec)) {
+		auto name = entry.path().filename().string();
+		const std::string suffix{"_spectrum.dat"};
+		if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+			continue;
+		FILE* fp = fopen(entry.path().c_str(), "r");
+		if (!fp)
+			continue;
+		test_spectrum_t s;
+		s.name = entry.path().string();
+		double freq_mhz{0};
+		int level{0};
+		int symbol_rate{0};
+		while (fscanf(fp, "%lf %d %d", &freq_mhz, &level, &symbol_rate) == 3) {
+			s.freq.push_back(std::lround(freq_mhz * 1000));
+			s.rf_level.push_back(level);
+		}
+		fclose(fp);
+		if (s.freq.size() > 0)
+			ret.push_back(std::move(s));
+	}
+	return ret;
+}
+
+/*
+	Ku low band at 50kHz resolution with noise and transponders of random bandwidth and level
+*/
+static std::vector<test_spectrum_t> make_random_spectra(std::mt19937& rng, int num_spectra) {
+	std::vector<test_spectrum_t> ret;
+	std::normal_distribution<double> noise(0, 300);
+	std::uniform_int_distribution<int> num_tps(10, 60);
+	std::uniform_int_distribution<int> bw(1000, 40000); //kHz
+	std::uniform_int_distribution<int> level(2000, 15000); //mdB above noise
+	const int start_freq = 10700000;
+	const int end_freq = 11700000;
+	const int step = 50;
+	for (int i = 0; i < num_spectra; ++i) {
+		test_spectrum_t s;
+		s.name = "random" + std::to_string(i);
+		int n = (end_freq - start_freq) / step;
+		std::vector<double> level_db(n, -60000.);
+		std::uniform_int_distribution<int> centre(start_freq, end_freq);
+		for (int t = num_tps(rng); t > 0; --t) {
+			double c = centre(rng);
+			double half = bw(rng) / 2.;
+			double l = level(rng);
+			double rolloff = half * 0.2;
+			for (int j = 0; j < n; ++j) {
+				double d = std::abs(start_freq + j * step - c);
+				double v = d <= half - rolloff ? l
+					: d >= half + rolloff ? 0 : l * (half + rolloff - d) / (2 * rolloff);
+				level_db[j] = std::max(level_db[j], -60000. + v);
+			}
+		}
+		for (int j = 0; j < n; ++j) {
+			s.freq.push_back(start_freq + j * step);
+			s.rf_level.push_back((int32_t)(level_db[j] + noise(rng)));
+		}
+		ret.push_back(std::move(s));
+	}
+	return ret;
+}
+
+int main(int argc, char** argv) {
+	if (options.parse_options(argc, argv) < 0)
+		return -1;
+	std::mt19937 rng(options.seed);
+	auto spectra = options.spectrum_path.empty() ? make_random_spectra(rng, options.num_random)
+		: load_recorded_spectra(options.spectrum_path);
+	if (spectra.empty()) {
+		printf("No spectra found in %s\n", options.spectrum_path.c_str());
+		return -1;
+	}
+
+	int num_errors{0};
+	int total_peaks{0};
+	int total_early{0};
+	int total_retracted{0};
+	spectrum_peak_stream_t stream;
+	for (auto& s : spectra) {
+		ss::vector<spectral_peak_t, 512> batch;
+		find_tps(batch, s.rf_level, s.freq);
+
+		stream.clear();
+		ss::vector<spectral_peak_t, 512> early;
+		double lag_sum{0}; //fraction of spectrum acquired after a peak, before it was confirmed
+		int n = s.freq.size();
+		for (int i = 0; i < n; i += options.chunk_size) {
+			int count = std::min(options.chunk_size, n - i);
+			int old_size = early.size();
+			stream.add(&s.rf_level[i], &s.freq[i], count, early);
+			for (int j = old_size; j < (int) early.size(); ++j) {
+				int peak_idx = 0;
+				while (peak_idx < n && s.freq[peak_idx] != (uint32_t) early[j].freq)
+					++peak_idx;
+				lag_sum += (i + count - peak_idx) / (double) n;
+			}
+		}
+		ss::vector<spectral_peak_t, 512> streamed;
+		stream.finish(streamed);
+
+		bool same = streamed.size() == batch.size();
+		for (int j = 0; same && j < batch.size(); ++j)
+			same = streamed[j].freq == batch[j].freq && streamed[j].symbol_rate == batch[j].symbol_rate &&
+				streamed[j].snr == batch[j].snr && streamed[j].level == batch[j].level;
+		if (!same) {
+			printf("%s: streamed result differs from batch result\n", s.name.c_str());
+			num_errors++;
+		}
+		printf("%s: samples=%d peaks=%d early=%d retracted=%d mean_lag=%.1f%%\n", s.name.c_str(), n,
+					 (int) batch.size(), (int) early.size(), stream.num_retracted(),
+					 early.size() == 0 ? 0. : 100. * lag_sum / early.size());
+		total_peaks += batch.size();
+		total_early += early.size();
+		total_retracted += stream.num_retracted();
+	}
+	printf("spectra=%d peaks=%d early=%d retracted=%d errors=%d\n", (int) spectra.size(), total_peaks, total_early,
+				 total_retracted, num_errors);
+	return num_errors == 0 ? 0 : -1;
+}
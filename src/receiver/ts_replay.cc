@@ -0,0 +1,194 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "ts_replay.h"
+#include "util/logger.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+static constexpr int packet_size = 188;
+static constexpr int64_t bitrate_scan_size = 16 * 1024 * 1024;
+
+int ts_replay_t::open(const ts_replay_options_t& options_) {
+	close();
+	options = options_;
+	fd = ::open(options.filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		dterrorf("Could not open {}: {}", options.filename, strerror(errno));
+		return -1;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		dterrorf("Could not stat {}: {}", options.filename, strerror(errno));
+		close();
+		return -1;
+	}
+	file_size = st.st_size;
+
+	//find the first position where three consecutive packets start with a sync byte
+	uint8_t buffer[3 * packet_size];
+	auto len = ::pread(fd, buffer, sizeof(buffer), 0);
+	sync_offset = -1;
+	for (int i = 0; i + 2 * packet_size < len; ++i) {
+		if (buffer[i] == 0x47 && buffer[i + packet_size] == 0x47 && buffer[i + 2 * packet_size] == 0x47) {
+			sync_offset = i;
+			break;
+		}
+	}
+	if (sync_offset < 0) {
+		dterrorf("{} is not a transport stream", options.filename);
+		close();
+		return -1;
+	}
+
+	auto rate = options.bitrate > 0 ? options.bitrate : estimate_bitrate();
+	if (rate <= 0) {
+		dterrorf("Could not determine the bitrate of {}; please specify it", options.filename);
+		close();
+		return -1;
+	}
+	bitrate = options.speed > 0 ? rate * options.speed : 0;
+	file_pos = sync_offset;
+	start_time = steady_clock_t::now();
+	num_bytes_consumed = 0;
+	num_bytes_served = 0;
+	num_loops = 0;
+	dtinfof("Replaying {}: {:.1f} Mbit/s speed={}", options.filename, rate * 8e-6, options.speed);
+	return 0;
+}
+
+void ts_replay_t::close() {
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+}
+
+/*
+	compute the bitrate from the first and last pcr of the first pid carrying a pcr,
+	in the first part of the file
+*/
+int64_t ts_replay_t::estimate_bitrate() {
+	std::vector<uint8_t> buffer(bitrate_scan_size);
+	auto len = ::pread(fd, buffer.data(), buffer.size(), sync_offset);
+	int pcr_pid{-1};
+	int64_t first_pos{-1}, last_pos{-1};
+	int64_t first_pcr{-1}, last_pcr{-1};
+	for (int64_t pos = 0; pos + packet_size <= len; pos += packet_size) {
+		auto* p = &buffer[pos];
+		if (p[0] != 0x47)
+			continue;
+		bool has_adaptation = p[3] & 0x20;
+		if (!has_adaptation || p[4] < 7 || !(p[5] & 0x10))
+			continue;
+		int pid = ((p[1] & 0x1f) << 8) | p[2];
+		if (pcr_pid < 0)
+			pcr_pid = pid;
+		else if (pid != pcr_pid)
+			continue;
+		int64_t base = ((int64_t)p[6] << 25) | (p[7] << 17) | (p[8] << 9) | (p[9] << 1) | (p[10] >> 7);
+		int64_t pcr = base * 300 + (((p[10] & 1) << 8) | p[11]);
+		if (first_pcr < 0 || pcr < last_pcr) { //start, or pcr wrap/discontinuity
+			first_pcr = pcr;
+			first_pos = pos;
+		}
+		last_pcr = pcr;
+		last_pos = pos;
+	}
+	if (last_pcr <= first_pcr)
+		return -1;
+	return (last_pos - first_pos) * 27000000 / (last_pcr - first_pcr);
+}
+
+void ts_replay_t::add_pid(uint16_t pid) {
+	pids.set(pid & 0x1fff);
+}
+
+void ts_replay_t::remove_pid(uint16_t pid) {
+	pids.reset(pid & 0x1fff);
+}
+
+ssize_t ts_replay_t::read(uint8_t* p, ssize_t size) {
+	if (fd < 0)
+		return -1;
+	int64_t due = size - size % packet_size;
+	if (bitrate > 0) {
+		auto elapsed = std::chrono::duration<double>(steady_clock_t::now() - start_time).count();
+		due = std::min(due, (int64_t)(elapsed * bitrate) - num_bytes_consumed);
+		due -= due % packet_size;
+	}
+	if (due <= 0)
+		return 0;
+
+	ssize_t out{0};
+	while (due > 0) {
+		auto available = (file_size - file_pos) / packet_size * packet_size;
+		if (available == 0) {
+			if (!options.loop)
+				return out > 0 ? out : -1;
+			file_pos = sync_offset;
+			num_loops++;
+			continue;
+		}
+		auto ret = ::pread(fd, p + out, std::min(due, available), file_pos);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			dterrorf("Error reading {}: {}", options.filename, strerror(errno));
+			return -1;
+		}
+		ret -= ret % packet_size;
+		if (ret == 0) { //file was truncated
+			file_size = file_pos;
+			continue;
+		}
+		file_pos += ret;
+		num_bytes_consumed += ret;
+		due -= ret;
+
+		//pid filtering, in place
+		auto* dst = p + out;
+		for (auto* src = p + out; src < p + out + ret; src += packet_size) {
+			int pid = ((src[1] & 0x1f) << 8) | src[2];
+			if (src[0] != 0x47 || !(all_pids || pids.test(pid)))
+				continue;
+			if (dst != src)
+				memmove(dst, src, packet_size);
+			dst += packet_size;
+		}
+		out = dst - p;
+	}
+	num_bytes_served += out;
+	return out;
+}
+
+std::chrono::microseconds ts_replay_t::time_to_next_data() const {
+	if (bitrate <= 0)
+		return {};
+	auto due_time = start_time + std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::duration<double>((num_bytes_consumed + packet_size) / bitrate));
+	auto now = steady_clock_t::now();
+	return due_time > now ? std::chrono::duration_cast<std::chrono::microseconds>(due_time - now)
+		: std::chrono::microseconds{};
+}
@@ -0,0 +1,113 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include "util/time_util.h"
+#include <bitset>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+
+struct ts_replay_options_t {
+	std::string filename;
+	double speed{1.}; //1: real time; 4: four times faster than real time; 0: as fast as possible
+	int64_t bitrate{0}; //bytes per second; 0: estimate from the pcr in the file
+	bool loop{true}; //restart at the beginning of the file at the end
+	int32_t snr{12000}; //reported with every lock (dB * 1000)
+	int32_t signal_strength{-45000}; //reported with every lock (dB * 1000)
+};
+
+//fake signal information, as the frontend would report it
+struct ts_replay_signal_t {
+	bool locked{false};
+	int32_t snr{0};
+	int32_t signal_strength{0};
+};
+
+/*
+	Replays a captured transport stream file in the way a tuner delivers a mux: packets become available
+	at the bitrate of the mux (or faster, depending on speed) and only the packets of the requested pids
+	are returned, as from a demux fd in DMX_OUT_TSDEMUX_TAP mode.
+
+	Used by the virtual dvb adapters (vdvb.h) to feed their demuxes. Not thread safe; each virtual tuner
+	has its own ts_replay_t.
+*/
+class ts_replay_t {
+	ts_replay_options_t options;
+	int fd{-1};
+	int64_t file_size{0};
+	int64_t sync_offset{0}; //offset of the first sync byte in the file
+	int64_t file_pos{0}; //next byte to read from the file
+	std::bitset<8192> pids;
+	bool all_pids{false};
+	double bitrate{0}; //bytes per second, after applying speed
+	steady_time_t start_time{};
+	int64_t num_bytes_consumed{0}; //bytes read from the file (before pid filtering) since start_time
+	int64_t num_bytes_served{0}; //bytes returned to the caller
+	int num_loops{0};
+
+	int64_t estimate_bitrate();
+
+public:
+	~ts_replay_t() {
+		close();
+	}
+
+	//returns -1 on error
+	int open(const ts_replay_options_t& options);
+	void close();
+
+	bool is_open() const {
+		return fd >= 0;
+	}
+
+	void add_pid(uint16_t pid);
+	void remove_pid(uint16_t pid);
+	void set_all_pids(bool on) {
+		all_pids = on;
+	}
+
+	/*
+		Copy up to size bytes of packets which are due by now and which match the pid filter to p.
+		Returns the number of bytes copied (a multiple of 188), 0 if no data is due yet, or -1
+		at the end of the file (if not looping) or on error.
+	*/
+	ssize_t read(uint8_t* p, ssize_t size);
+
+	//time until more data becomes available; zero if data is available now
+	std::chrono::microseconds time_to_next_data() const;
+
+	ts_replay_signal_t signal() const {
+		return {is_open(), options.snr, options.signal_strength};
+	}
+
+	double get_bitrate() const {
+		return bitrate;
+	}
+
+	int64_t get_num_bytes_served() const {
+		return num_bytes_served;
+	}
+
+	int get_num_loops() const {
+		return num_loops;
+	}
+};
@@ -88,9 +88,14 @@ public:
 
 		//wait for access to the wtxn
 		int my_ticket = ++last_issued_ticket;
+		bool timed = owning_ticket != -1 && db.stats->enabled;
+		auto wait_start = timed ? steady_clock_t::now() : steady_time_t{};
 		cv.wait(lk, [this] {
 			return (owning_ticket == -1) ;
 		});
+		if(timed)
+			db.stats->on_wtxn_wait(std::chrono::duration_cast<std::chrono::microseconds>
+														 (steady_clock_t::now() - wait_start).count());
 
 		last_owner = std::this_thread::get_id();
 		owning_ticket = my_ticket;
@@ -0,0 +1,307 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "uring_writer.h"
+#include "util/dtassert.h"
+#include "util/logger.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+static const int uring_pagesize = sysconf(_SC_PAGESIZE);
+
+#ifdef HAVE_LIBURING
+struct uring_writer_t::ring_t {
+	struct io_uring ring;
+	bool registered{false};
+};
+#else
+struct uring_writer_t::ring_t {
+};
+#endif
+
+uring_writer_t::uring_writer_t(const uring_writer_options_t& options_)
+	: options(options_)
+{
+	buffer_size = options.window_size - options.window_size % uring_pagesize;
+}
+
+std::unique_ptr<uring_writer_t> uring_writer_t::make(const uring_writer_options_t& options) {
+#ifdef HAVE_LIBURING
+	std::unique_ptr<uring_writer_t> ret{new uring_writer_t(options)};
+	auto& w = *ret;
+	w.ring = std::make_unique<ring_t>();
+	auto err = io_uring_queue_init(std::max(options.max_inflight, 1) * 2, &w.ring->ring, 0);
+	if (err < 0) {
+		dterrorf("io_uring_queue_init failed: {}", strerror(-err));
+		w.ring.reset();
+		return nullptr;
+	}
+	//anonymous mapping: page aligned, as needed for O_DIRECT
+	auto* mem = (uint8_t*)mmap(NULL, w.buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == (uint8_t*)-1) {
+		dterrorf("Error in mmap: {}", strerror(errno));
+		return nullptr;
+	}
+	w.buffer = mem;
+	struct iovec iov{w.buffer, (size_t)w.buffer_size};
+	err = io_uring_register_buffers(&w.ring->ring, &iov, 1);
+	if (err < 0) {
+		//not fatal: we will use regular writes
+		dtdebugf("io_uring_register_buffers failed: {}", strerror(-err));
+	} else
+		w.ring->registered = true;
+	return ret;
+#else
+	dtdebugf("io_uring support not compiled in");
+	return nullptr;
+#endif
+}
+
+uring_writer_t::~uring_writer_t() {
+	if (!ring)
+		return;
+	drain(submit_pointer, true);
+#ifdef HAVE_LIBURING
+	if (ring->registered)
+		io_uring_unregister_buffers(&ring->ring);
+	io_uring_queue_exit(&ring->ring);
+#endif
+	close_direct_fd();
+	if (buffer && munmap(buffer, buffer_size) < 0) {
+		dterrorf("Error while unmapping: {}", strerror(errno));
+	}
+	dtdebugf("uring writer: writes={:d} bytes={:d} short={:d} tail={:d} errors={:d} throttled={:d} drains={:d} "
+					 "max_drain={:d}us",
+					 stats.num_writes, stats.num_bytes_written, stats.num_short_writes, stats.num_tail_writes, stats.num_errors,
+					 stats.num_throttled, stats.num_drains, stats.max_drain_time.count());
+}
+
+void uring_writer_t::close_direct_fd() {
+	while (direct_fd >= 0 && ::close(direct_fd) < 0) {
+		if (errno != EINTR) {
+			dterrorf("Error closing file: {:s}", strerror(errno));
+			break;
+		}
+	}
+	direct_fd = -1;
+}
+
+int uring_writer_t::set_file(int fd_, off_t offset_, int valid_bytes) {
+	assert(offset_ % uring_pagesize == 0);
+	assert(valid_bytes >= 0 && valid_bytes <= buffer_size);
+	drain(submit_pointer, true);
+	close_direct_fd();
+	fd = fd_;
+	offset = offset_;
+	if (options.use_o_direct) {
+		/*
+			reopen the file with O_DIRECT, so that writes of the tail of the data (not a multiple of the
+			block size) can still be done through the regular fd
+		*/
+		ss::string<32> path;
+		path.format("/proc/self/fd/{:d}", fd);
+		direct_fd = ::open(path.c_str(), O_WRONLY | O_DIRECT);
+		if (direct_fd < 0)
+			dterrorf("Could not open {} with O_DIRECT: {}", path, strerror(errno));
+	}
+	for (int done = 0; done < valid_bytes;) {
+		auto ret = ::pread(fd, buffer + done, valid_bytes - done, offset + done);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			dterrorf("Could not read start of file: {}", ret < 0 ? strerror(errno) : "end of file");
+			return -1;
+		}
+		done += ret;
+	}
+	//with O_DIRECT, the first write must start on a block boundary and will rewrite the data we just read
+	persist_pointer = submit_pointer = (direct_fd >= 0) ? 0 : valid_bytes;
+	tail_pointer = valid_bytes;
+	last_submit_time = steady_clock_t::now();
+	return 0;
+}
+
+/*
+	fallback for short writes and for the unaligned tail of O_DIRECT files
+*/
+void uring_writer_t::write_sync(int start, int len) {
+	while (len > 0) {
+		auto ret = ::pwrite(fd, buffer + start, len, offset + start);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			dterrorf("Error while writing: {}", strerror(errno));
+			stats.num_errors++;
+			return;
+		}
+		stats.num_bytes_written += ret;
+		start += ret;
+		len -= ret;
+	}
+}
+
+int uring_writer_t::submit(int end_pointer, bool include_tail) {
+	assert(end_pointer <= buffer_size);
+	int num_submitted = 0;
+	auto now = steady_clock_t::now();
+	//data of low bitrate services would otherwise only reach the file when draining
+	bool tail_due = !include_tail && now - last_submit_time >= options.max_tail_delay;
+#ifdef HAVE_LIBURING
+	for (;;) {
+		int len = std::min(end_pointer - submit_pointer, options.max_write_size);
+		if (direct_fd >= 0)
+			len -= len % uring_pagesize;
+		if (len <= 0 || (!include_tail && !tail_due && len < options.min_write_size))
+			break;
+		if ((int)inflight.size() >= options.max_inflight) {
+			stats.num_throttled++;
+			break;
+		}
+		auto* sqe = io_uring_get_sqe(&ring->ring);
+		if (!sqe) {
+			stats.num_throttled++;
+			break;
+		}
+		if (ring->registered)
+			io_uring_prep_write_fixed(sqe, write_fd(), buffer + submit_pointer, len, offset + submit_pointer, 0);
+		else
+			io_uring_prep_write(sqe, write_fd(), buffer + submit_pointer, len, offset + submit_pointer);
+		auto seqno = next_seqno++;
+		io_uring_sqe_set_data64(sqe, seqno);
+		inflight.push_back(write_t{seqno, submit_pointer, len, false});
+		if (tail_due && len < options.min_write_size)
+			stats.num_tail_writes++;
+		submit_pointer += len;
+		num_submitted++;
+	}
+	if (num_submitted > 0) {
+		auto err = io_uring_submit(&ring->ring);
+		if (err < 0)
+			dterrorf("io_uring_submit failed: {}", strerror(-err));
+		stats.num_writes += num_submitted;
+		last_submit_time = now;
+	}
+#endif
+	if (include_tail && submit_pointer < end_pointer && inflight.size() == 0) {
+		//unaligned tail with O_DIRECT
+		write_sync(submit_pointer, end_pointer - submit_pointer);
+		persist_pointer = submit_pointer = tail_pointer = end_pointer;
+	} else if (tail_due && direct_fd >= 0 && end_pointer - submit_pointer < uring_pagesize &&
+						 tail_pointer < end_pointer) {
+		/*
+			unaligned tail with O_DIRECT: write it through the regular fd, but leave submit_pointer
+			on a block boundary; the block will be rewritten with O_DIRECT when it is complete
+		*/
+		write_sync(submit_pointer, end_pointer - submit_pointer);
+		tail_pointer = end_pointer;
+		stats.num_tail_writes++;
+		last_submit_time = now;
+	}
+	return num_submitted;
+}
+
+void uring_writer_t::on_completion(uint64_t seqno, int res) {
+	assert(inflight.size() > 0);
+	auto idx = seqno - inflight.front().seqno;
+	assert(idx < inflight.size());
+	auto& w = inflight[idx];
+	if (res < 0) {
+		dterrorf("Error while writing: {}", strerror(-res));
+		stats.num_errors++;
+		/*we do not want readers to wait forever; retry synchronously (which could
+			also fail, but will at least log an error)*/
+		write_sync(w.start, w.len);
+	} else {
+		stats.num_bytes_written += res;
+		if (res < w.len) {
+			stats.num_short_writes++;
+			write_sync(w.start + res, w.len - res);
+		}
+	}
+	w.done = true;
+	while (inflight.size() > 0 && inflight.front().done) {
+		auto& f = inflight.front();
+		assert(f.start == persist_pointer);
+		persist_pointer = f.start + f.len;
+		inflight.pop_front();
+	}
+}
+
+int uring_writer_t::reap(bool wait) {
+	int num_reaped = 0;
+#ifdef HAVE_LIBURING
+	while (inflight.size() > 0) {
+		struct io_uring_cqe* cqe = nullptr;
+		auto err = (wait && num_reaped == 0) ? io_uring_wait_cqe(&ring->ring, &cqe)
+			: io_uring_peek_cqe(&ring->ring, &cqe);
+		if (err == -EINTR)
+			continue;
+		if (err == -EAGAIN || !cqe)
+			break;
+		if (err < 0) {
+			dterrorf("Error while waiting for io_uring completion: {}", strerror(-err));
+			break;
+		}
+		auto seqno = io_uring_cqe_get_data64(cqe);
+		auto res = cqe->res;
+		io_uring_cqe_seen(&ring->ring, cqe);
+		on_completion(seqno, res);
+		num_reaped++;
+	}
+#endif
+	return num_reaped;
+}
+
+int uring_writer_t::drain(int end_pointer, bool include_tail) {
+	auto start = steady_clock_t::now();
+	bool waited = false;
+	for (;;) {
+		submit(end_pointer, include_tail);
+		if (inflight.size() == 0)
+			break;
+		reap(true);
+		waited = true;
+	}
+	if (waited) {
+		stats.num_drains++;
+		auto delta = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock_t::now() - start);
+		stats.max_drain_time = std::max(stats.max_drain_time, delta);
+	}
+	return persist_pointer;
+}
+
+void uring_writer_t::shift(int extra, int end_pointer) {
+	assert(inflight.size() == 0); //writes in flight would read from the moved memory
+	assert(extra % uring_pagesize == 0);
+	assert(extra <= persist_pointer);
+	assert(end_pointer >= extra);
+	if (end_pointer > extra)
+		memmove(buffer, buffer + extra, end_pointer - extra);
+	offset += extra;
+	submit_pointer -= extra;
+	persist_pointer -= extra;
+	tail_pointer = std::max(tail_pointer - extra, 0);
+}
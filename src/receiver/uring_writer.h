@@ -0,0 +1,144 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <stdint.h>
+#include <sys/types.h>
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <memory>
+
+struct uring_writer_options_t {
+	int window_size{32*1024*1024}; //size of the anonymous buffer into which data is received
+	int min_write_size{64*1024}; //do not submit writes smaller than this, except when draining
+	int max_write_size{1024*1024}; //maximal size of a single write
+	int max_inflight{8}; //maximal number of writes in flight
+	/*submit writes smaller than min_write_size when nothing was submitted for this long, so that
+		readers do not wait for the data of low bitrate services*/
+	std::chrono::milliseconds max_tail_delay{200};
+	bool use_o_direct{false};
+};
+
+struct uring_writer_stats_t {
+	int64_t num_writes{0};
+	int64_t num_bytes_written{0};
+	int64_t num_short_writes{0};
+	int64_t num_errors{0};
+	int64_t num_throttled{0}; //number of times submission was postponed because max_inflight was reached
+	int64_t num_drains{0};
+	int64_t num_tail_writes{0}; //writes smaller than min_write_size submitted because of max_tail_delay
+	std::chrono::microseconds max_drain_time{};
+};
+
+/*
+	Alternative for a MAP_SHARED file mapping for livebuffer writers.
+	Data is received, decrypted and parsed in an anonymous buffer (registered with io_uring)
+	and is then written to file asynchronously, with a bounded number of writes in flight.
+	This avoids the large writeback stalls caused by dirty pages in a shared mapping.
+
+	All pointers are byte offsets into buffer, which corresponds to file offset "offset".
+	Data in [0, persist_pointer) is on file and can be read by other processes/threads,
+	data in [persist_pointer, submit_pointer) is being written.
+	With O_DIRECT, data in [submit_pointer, tail_pointer) was written through the regular fd because it does
+	not fill a block. It will be rewritten later by an aligned write.
+
+	Not thread safe: the owner (mmap_t) is only used from the service thread.
+*/
+class uring_writer_t {
+	struct ring_t;
+	struct write_t {
+		uint64_t seqno{0};
+		int start{0};
+		int len{0};
+		bool done{false};
+	};
+	std::unique_ptr<ring_t> ring;
+	std::deque<write_t> inflight;
+	uint64_t next_seqno{0};
+	std::chrono::steady_clock::time_point last_submit_time{};
+
+	int direct_fd{-1}; //fd opened with O_DIRECT, or -1
+
+	uring_writer_t(const uring_writer_options_t& options);
+	int write_fd() const {
+		return direct_fd >= 0 ? direct_fd : fd;
+	}
+	void close_direct_fd();
+	void on_completion(uint64_t seqno, int res);
+	void write_sync(int start, int len);
+public:
+	const uring_writer_options_t options;
+	uint8_t* buffer{nullptr};
+	int buffer_size{0};
+	int fd{-1}; //not owned
+	off_t offset{0}; //file offset corresponding to buffer[0]
+	int submit_pointer{0};
+	int persist_pointer{0};
+	int tail_pointer{0};
+	uring_writer_stats_t stats;
+
+	/*
+		returns nullptr if io_uring is not available (not compiled in, or refused by the kernel)
+	*/
+	static std::unique_ptr<uring_writer_t> make(const uring_writer_options_t& options);
+
+	~uring_writer_t();
+
+	/*
+		number of bytes at the start of the buffer which are on file
+	*/
+	int num_bytes_persisted() const {
+		return inflight.size() == 0 ? std::max(persist_pointer, tail_pointer) : persist_pointer;
+	}
+
+	/*
+		start writing to a new file, with buffer[0] corresponding to file offset offset (which must
+		be page aligned). The first valid_bytes bytes are read from the file, so that buffer contents
+		are the same as they would be in a file mapping.
+		Any pending writes to the old file are completed first.
+	*/
+	int set_file(int fd, off_t offset, int valid_bytes);
+
+	/*
+		submit writes for data in [submit_pointer, end_pointer), without waiting.
+		include_tail: also write data which does not satisfy min_write_size or O_DIRECT alignment
+		Without include_tail, data smaller than min_write_size is still written when nothing was submitted
+		during the last options.max_tail_delay
+		Returns the number of writes submitted
+	*/
+	int submit(int end_pointer, bool include_tail);
+
+	/*
+		process completions; if wait, wait for at least one completion if writes are in flight
+	*/
+	int reap(bool wait);
+
+	/*
+		write all data in [submit_pointer, end_pointer) and wait until everything is on file
+	*/
+	int drain(int end_pointer, bool include_tail);
+
+	/*
+		discard the first extra bytes of the buffer, which must have been persisted, and
+		move [extra, end_pointer) to the start of the buffer
+	*/
+	void shift(int extra, int end_pointer);
+};
@@ -0,0 +1,997 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "vdvb.h"
+#include "neumofrontend.h"
+#include "ts_replay.h"
+#include "util/logger.h"
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <fcntl.h>
+#include <filesystem>
+#include <limits.h>
+#include <linux/dvb/dmx.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+static constexpr int packet_size = 188;
+static constexpr int max_events = 8; //same as the kernel
+static constexpr int max_write_size = (PIPE_BUF / packet_size) * packet_size; //pipe writes up to PIPE_BUF are atomic
+static constexpr int read_size = 188 * 1024;
+static constexpr int max_reads_per_wakeup = 4;
+static constexpr int64_t lof_low = 9750000;
+static constexpr int64_t lof_high = 10600000;
+static constexpr int32_t no_signal_level = -75000; //dB*1000
+static constexpr int default_scan_resolution = 2000; //kHz
+
+static constexpr auto locked_status = (fe_status_t)(FE_HAS_SIGNAL | FE_HAS_CARRIER | FE_HAS_VITERBI | FE_HAS_SYNC |
+																										FE_HAS_LOCK | FE_HAS_TIMING_LOCK);
+
+struct capture_t {
+	int64_t frequency{0}; //kHz
+	char pol{'H'};
+	int stream_id{-1}; //-1: matches any stream_id
+	std::string filename;
+};
+
+struct spectrum_point_t {
+	int64_t frequency{0}; //kHz
+	int32_t level{0};
+	int32_t symbol_rate{0}; //non-zero for candidates
+};
+
+struct vdemux_t {
+	int read_fd{-1}; //-1 after dvb_close; data is still sent as long as another process has the pipe open
+	int write_fd{-1};
+	std::bitset<8192> pids;
+	bool all_pids{false};
+	bool started{false};
+	size_t buffer_size{2 * 1024 * 1024};
+	std::vector<uint8_t> pending; //packets not yet accepted by the pipe, starting at pending_start
+	size_t pending_start{0};
+	int64_t num_dropped{0};
+
+	size_t num_pending() const {
+		return pending.size() - pending_start;
+	}
+
+	void add_pid(uint16_t pid) {
+		if (pid >= 0x2000)
+			all_pids = true; //full transport stream
+		else
+			pids.set(pid);
+	}
+
+	void remove_pid(uint16_t pid) {
+		if (pid >= 0x2000)
+			all_pids = false;
+		else
+			pids.reset(pid);
+	}
+};
+
+struct vadapter_t {
+	int adapter_no{-1};
+	std::vector<int> fe_fds; //eventfds of the open frontend devices
+	std::deque<dvb_frontend_event> events;
+	std::vector<std::shared_ptr<vdemux_t>> demuxes;
+
+	//parameters set by FE_SET_PROPERTY and the sec ioctls
+	int64_t frequency{0}; //driver frequency in kHz
+	int64_t symbol_rate{0};
+	int delivery_system{SYS_DVBS2};
+	int modulation{QPSK};
+	int inner_fec{FEC_AUTO};
+	int inversion{INVERSION_AUTO};
+	int rolloff{ROLLOFF_35};
+	int pilot{PILOT_AUTO};
+	int stream_id{-1};
+	int voltage{SEC_VOLTAGE_OFF};
+	int tone{SEC_TONE_OFF};
+	int heartbeat_interval{0}; //ms
+	int64_t scan_start_frequency{0};
+	int64_t scan_end_frequency{0};
+	int scan_resolution{default_scan_resolution};
+
+	//state
+	bool tuning{false}; //tune or spectrum acquisition started, but lock_time has not yet passed
+	bool spectrum{false}; //last tune was a spectrum acquisition
+	bool active{false}; //tune has finished; until DTV_STOP or the next tune
+	fe_status_t status{};
+	steady_time_t tune_time{};
+	steady_time_t next_heartbeat{};
+	int locktime_ms{0};
+	const capture_t* capture{nullptr};
+	ts_replay_t replay;
+
+	void clear_parameters() {
+		frequency = 0;
+		symbol_rate = 0;
+		delivery_system = SYS_DVBS2;
+		modulation = QPSK;
+		inner_fec = FEC_AUTO;
+		inversion = INVERSION_AUTO;
+		rolloff = ROLLOFF_35;
+		pilot = PILOT_AUTO;
+		stream_id = -1;
+	}
+
+	int64_t lof() const {
+		return tone == SEC_TONE_ON ? lof_high : lof_low;
+	}
+
+	//polarisations selected by the current voltage
+	const char* pols() const {
+		return voltage == SEC_VOLTAGE_18 ? "HL" : voltage == SEC_VOLTAGE_13 ? "VR" : "";
+	}
+
+	void stop() {
+		tuning = false;
+		active = false;
+		status = {};
+		capture = nullptr;
+		replay.close();
+	}
+};
+
+class vdvb_t {
+	vdvb_options_t options;
+	std::vector<capture_t> captures;
+	std::map<char, std::vector<spectrum_point_t>> spectra; //indexed by polarisation
+	std::vector<std::unique_ptr<vadapter_t>> adapters;
+
+	struct fd_entry_t {
+		vadapter_t* adapter{nullptr};
+		std::shared_ptr<vdemux_t> demux; //nullptr for frontend fds
+	};
+	std::map<int, fd_entry_t> fds;
+
+	std::mutex mutex; //protects everything
+	std::condition_variable cv;
+	bool must_exit{false};
+	vdvb_stats_t stats;
+	std::thread thread;
+	std::vector<uint8_t> buffer;
+	std::vector<uint8_t> filtered;
+
+	void load_captures();
+	void load_spectra();
+	const capture_t* find_capture(const vadapter_t& a) const;
+
+	void push_event(vadapter_t& a);
+	void tune(vadapter_t& a, bool spectrum);
+	void end_tune(vadapter_t& a, steady_time_t now);
+	steady_time_t service(vadapter_t& a, steady_time_t now);
+	steady_time_t feed(vadapter_t& a, steady_time_t now);
+	void send(vdemux_t& d, const uint8_t* p, size_t len);
+	ssize_t write_packets(vdemux_t& d, const uint8_t* p, size_t len);
+	bool flush(vdemux_t& d);
+	void close_demux(vdemux_t& d);
+
+	int frontend_ioctl(vadapter_t& a, unsigned long request, void* arg);
+	int demux_ioctl(vdemux_t& d, unsigned long request, void* arg);
+	int set_properties(vadapter_t& a, dtv_properties* props);
+	int get_properties(vadapter_t& a, dtv_properties* props);
+	void get_spectrum(const vadapter_t& a, dtv_fe_spectrum& s) const;
+	void run();
+
+public:
+	~vdvb_t();
+	int start(const vdvb_options_t& options);
+
+	bool is_virtual(int adapter_no) const {
+		return adapter_no >= options.first_adapter_no && adapter_no < options.first_adapter_no + (int)adapters.size();
+	}
+
+	std::vector<int> adapter_nos() const;
+
+	vdvb_stats_t get_stats() {
+		std::scoped_lock lck(mutex);
+		return stats;
+	}
+
+	int open(int adapter_no, const char* device, int flags);
+	//returns false if fd is not a virtual device
+	bool ioctl(int fd, unsigned long request, void* arg, int& ret);
+	bool close(int fd, int& ret);
+};
+
+static std::atomic<vdvb_t*> vdvb_instance{nullptr};
+
+void vdvb_t::load_captures() {
+	std::error_code ec;
+	for (auto& entry : fs::directory_iterator(options.dir, ec)) {
+		if (entry.path().extension() != ".ts")
+			continue;
+		auto stem = entry.path().stem().string();
+		capture_t c;
+		unsigned int frequency{0};
+		int stream_id{-1};
+		auto n = sscanf(stem.c_str(), "%u%c-%d", &frequency, &c.pol, &stream_id);
+		if (n < 2 || !strchr("HVLR", c.pol)) {
+			dtdebugf("Ignoring {}: name is not <frequency><pol>[-<stream_id>].ts", entry.path().c_str());
+			continue;
+		}
+		c.frequency = frequency < 100000 ? frequency * 1000 : frequency; //MHz or kHz
+		c.stream_id = n == 3 ? stream_id : -1;
+		c.filename = entry.path().string();
+		captures.push_back(c);
+	}
+	if (ec)
+		dterrorf("Cannot read {}: {}", options.dir, ec.message());
+	std::sort(captures.begin(), captures.end(),
+						[](const capture_t& a, const capture_t& b) { return a.frequency < b.frequency; });
+}
+
+/*
+	spectra as saved by statdb::save_spectrum_scan: lines of frequency in MHz, level and symbol_rate
+	(non-zero for candidates)
+*/
+void vdvb_t::load_spectra() {
+	for (auto pol : {'H', 'V', 'L', 'R'}) {
+		auto fname = fs::path(options.dir) / fmt::format("{:c}_spectrum.dat", pol);
+		FILE* fp = fopen(fname.c_str(), "r");
+		if (!fp)
+			continue;
+		auto& points = spectra[pol];
+		double frequency;
+		int level, symbol_rate;
+		while (fscanf(fp, "%lf %d %d", &frequency, &level, &symbol_rate) == 3)
+			points.push_back({(int64_t)(frequency * 1000 + 0.5), level, symbol_rate});
+		fclose(fp);
+		std::sort(points.begin(), points.end(),
+							[](const spectrum_point_t& a, const spectrum_point_t& b) { return a.frequency < b.frequency; });
+		dtinfof("Loaded spectrum {} with {:d} points", fname.c_str(), (int)points.size());
+	}
+}
+
+const capture_t* vdvb_t::find_capture(const vadapter_t& a) const {
+	auto pols = a.pols();
+	auto frequency = a.frequency + a.lof();
+	auto tolerance = std::max((int64_t)2000, a.symbol_rate / 2000);
+	int stream_id = a.stream_id < 0 ? -1 : (a.stream_id & 0xff);
+	const capture_t* ret{nullptr};
+	for (auto& c : captures) {
+		if (!strchr(pols, c.pol) || std::abs(c.frequency - frequency) > tolerance)
+			continue;
+		if (c.stream_id >= 0 && c.stream_id != stream_id)
+			continue;
+		if (!ret || std::abs(c.frequency - frequency) < std::abs(ret->frequency - frequency))
+			ret = &c;
+	}
+	return ret;
+}
+
+int vdvb_t::start(const vdvb_options_t& options_) {
+	options = options_;
+	if (!fs::is_directory(options.dir)) {
+		dterrorf("Virtual dvb directory {} does not exist", options.dir);
+		return -1;
+	}
+	load_captures();
+	load_spectra();
+	for (int i = 0; i < options.num_adapters; ++i) {
+		adapters.push_back(std::make_unique<vadapter_t>());
+		adapters.back()->adapter_no = options.first_adapter_no + i;
+	}
+	dtinfof("Virtual dvb: {:d} adapters starting at adapter{:d}, {:d} captures in {} speed={}", options.num_adapters,
+					options.first_adapter_no, (int)captures.size(), options.dir, options.speed);
+	buffer.resize(read_size);
+	signal(SIGPIPE, SIG_IGN); //writes to a demux whose readers have gone fail with EPIPE instead
+	thread = std::thread([this]() { run(); });
+	return 0;
+}
+
+vdvb_t::~vdvb_t() {
+	{
+		std::scoped_lock lck(mutex);
+		must_exit = true;
+	}
+	cv.notify_one();
+	if (thread.joinable())
+		thread.join();
+	for (auto& [fd, e] : fds)
+		::close(fd);
+	for (auto& a : adapters) {
+		for (auto& d : a->demuxes)
+			close_demux(*d);
+	}
+}
+
+std::vector<int> vdvb_t::adapter_nos() const {
+	std::vector<int> ret;
+	for (auto& a : adapters)
+		ret.push_back(a->adapter_no);
+	return ret;
+}
+
+int vdvb_t::open(int adapter_no, const char* device, int flags) {
+	std::scoped_lock lck(mutex);
+	auto& a = *adapters[adapter_no - options.first_adapter_no];
+	if (strcmp(device, "frontend0") == 0) {
+		int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (fd < 0)
+			return -1;
+		a.fe_fds.push_back(fd);
+		fds[fd] = {&a, nullptr};
+		return fd;
+	}
+	if (strcmp(device, "demux0") == 0) {
+		int p[2];
+		if (pipe2(p, O_CLOEXEC) < 0)
+			return -1;
+		if (flags & O_NONBLOCK)
+			fcntl(p[0], F_SETFL, O_NONBLOCK);
+		fcntl(p[1], F_SETFL, O_NONBLOCK);
+		auto d = std::make_shared<vdemux_t>();
+		d->read_fd = p[0];
+		d->write_fd = p[1];
+		a.demuxes.push_back(d);
+		fds[p[0]] = {&a, d};
+		return p[0];
+	}
+	errno = ENOENT;
+	return -1;
+}
+
+bool vdvb_t::close(int fd, int& ret) {
+	std::scoped_lock lck(mutex);
+	auto it = fds.find(fd);
+	if (it == fds.end())
+		return false;
+	auto [a, d] = it->second;
+	fds.erase(it);
+	ret = ::close(fd);
+	if (d) {
+		d->read_fd = -1;
+		if (!d->started) {
+			//nothing was ever written, so no other process can be waiting for data
+			close_demux(*d);
+			a->demuxes.erase(std::remove(a->demuxes.begin(), a->demuxes.end(), d), a->demuxes.end());
+			return true;
+		}
+		/*the demux is removed when writing to it fails, which is immediately unless another process
+			(e.g., a streamer) still has the pipe open*/
+		return true;
+	}
+	a->fe_fds.erase(std::remove(a->fe_fds.begin(), a->fe_fds.end(), fd), a->fe_fds.end());
+	if (a->fe_fds.empty()) {
+		a->stop();
+		a->events.clear();
+	}
+	return true;
+}
+
+void vdvb_t::close_demux(vdemux_t& d) {
+	if (d.num_dropped > 0)
+		dtinfof("Virtual demux dropped {:d} bytes", d.num_dropped);
+	if (d.write_fd >= 0)
+		::close(d.write_fd);
+	d.write_fd = -1;
+	d.pending.clear();
+	d.pending_start = 0;
+}
+
+bool vdvb_t::ioctl(int fd, unsigned long request, void* arg, int& ret) {
+	std::scoped_lock lck(mutex);
+	auto it = fds.find(fd);
+	if (it == fds.end())
+		return false;
+	auto& [a, d] = it->second;
+	ret = d ? demux_ioctl(*d, request, arg) : frontend_ioctl(*a, request, arg);
+	return true;
+}
+
+void vdvb_t::push_event(vadapter_t& a) {
+	dvb_frontend_event event{};
+	event.status = a.status;
+	if ((int)a.events.size() >= max_events)
+		a.events.pop_front();
+	a.events.push_back(event);
+	uint64_t one{1};
+	for (auto fd : a.fe_fds) {
+		if (::write(fd, &one, sizeof(one)) < 0)
+			dterrorf("Cannot signal frontend event: {}", strerror(errno));
+	}
+}
+
+void vdvb_t::tune(vadapter_t& a, bool spectrum) {
+	a.stop();
+	a.events.clear();
+	a.tuning = true;
+	a.spectrum = spectrum;
+	a.tune_time = steady_clock_t::now();
+	cv.notify_one();
+}
+
+void vdvb_t::end_tune(vadapter_t& a, steady_time_t now) {
+	a.tuning = false;
+	a.active = true;
+	a.locktime_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - a.tune_time).count();
+	if (a.spectrum) {
+		a.status = locked_status; //signals that the spectrum is available
+	} else {
+		a.capture = find_capture(a);
+		ts_replay_options_t o;
+		if (a.capture) {
+			o.filename = a.capture->filename;
+			o.speed = options.speed;
+		}
+		if (a.capture && a.replay.open(o) >= 0) {
+			a.replay.set_all_pids(true);
+			a.status = locked_status;
+			dtdebugf("adapter{:d}: locked on {}", a.adapter_no, a.capture->filename);
+		} else {
+			a.capture = nullptr;
+			a.status = FE_TIMEDOUT;
+			dtdebugf("adapter{:d}: no capture for {:d}{:s}", a.adapter_no, a.frequency + a.lof(), a.pols());
+		}
+	}
+	push_event(a);
+	a.next_heartbeat = now + std::chrono::milliseconds(a.heartbeat_interval);
+}
+
+/*
+	returns the time at which service must be called again
+*/
+steady_time_t vdvb_t::service(vadapter_t& a, steady_time_t now) {
+	auto next = now + 100ms;
+	if (a.tuning) {
+		auto lock_due = a.tune_time + options.lock_time;
+		if (now < lock_due)
+			return std::min(next, lock_due);
+		end_tune(a, now);
+	}
+	if (a.active && !a.spectrum && a.heartbeat_interval > 0) {
+		if (now >= a.next_heartbeat) {
+			push_event(a);
+			a.next_heartbeat = now + std::chrono::milliseconds(a.heartbeat_interval);
+		}
+		next = std::min(next, a.next_heartbeat);
+	}
+	if (a.replay.is_open())
+		next = std::min(next, feed(a, now));
+	return next;
+}
+
+/*
+	Read the data which is due from the capture and distribute it over the demuxes
+*/
+steady_time_t vdvb_t::feed(vadapter_t& a, steady_time_t now) {
+	bool blocked{false};
+	for (auto& d : a.demuxes)
+		blocked |= !flush(*d);
+	a.demuxes.erase(std::remove_if(a.demuxes.begin(), a.demuxes.end(),
+																 [](auto& d) { return d->write_fd < 0; }),
+									a.demuxes.end());
+	if (blocked && options.speed <= 0)
+		return now + 1ms; //wait for the slowest reader
+	for (int i = 0; i < max_reads_per_wakeup; ++i) {
+		auto n = a.replay.read(buffer.data(), buffer.size());
+		if (n < 0) {
+			dterrorf("adapter{:d}: replay failed; reporting loss of lock", a.adapter_no);
+			a.replay.close();
+			a.status = FE_TIMEDOUT;
+			push_event(a);
+			return now + 100ms;
+		}
+		for (auto& d : a.demuxes) {
+			if (!d->started || d->write_fd < 0)
+				continue;
+			if (d->all_pids) {
+				send(*d, buffer.data(), n);
+				continue;
+			}
+			filtered.clear();
+			for (auto* p = buffer.data(); p < buffer.data() + n; p += packet_size) {
+				int pid = ((p[1] & 0x1f) << 8) | p[2];
+				if (d->pids.test(pid))
+					filtered.insert(filtered.end(), p, p + packet_size);
+			}
+			send(*d, filtered.data(), filtered.size());
+		}
+		if (n < (ssize_t)buffer.size())
+			break; //no more data due
+	}
+	if (options.speed <= 0)
+		return now;
+	return now + std::max(a.replay.time_to_next_data(), std::chrono::microseconds(2000));
+}
+
+void vdvb_t::send(vdemux_t& d, const uint8_t* p, size_t len) {
+	if (len == 0)
+		return;
+	size_t done{0};
+	if (d.num_pending() == 0) {
+		auto ret = write_packets(d, p, len);
+		if (ret < 0)
+			return;
+		done = ret;
+	}
+	if (done == len)
+		return;
+	if (options.speed > 0 && d.num_pending() + len - done > d.buffer_size) {
+		//demux buffer overflow
+		d.num_dropped += len - done;
+		stats.num_bytes_dropped += len - done;
+		return;
+	}
+	if (d.pending_start > 0 && d.pending_start >= d.pending.size() / 2) {
+		d.pending.erase(d.pending.begin(), d.pending.begin() + d.pending_start);
+		d.pending_start = 0;
+	}
+	d.pending.insert(d.pending.end(), p + done, p + len);
+	flush(d);
+}
+
+//returns false if there is still pending data
+bool vdvb_t::flush(vdemux_t& d) {
+	if (d.num_pending() == 0 || d.write_fd < 0)
+		return true;
+	auto ret = write_packets(d, d.pending.data() + d.pending_start, d.num_pending());
+	if (ret < 0)
+		return true;
+	d.pending_start += ret;
+	if (d.num_pending() > 0)
+		return false;
+	d.pending.clear();
+	d.pending_start = 0;
+	return true;
+}
+
+/*
+	returns the number of bytes written (always complete packets), or -1 if the demux is no longer
+	open in any process
+*/
+ssize_t vdvb_t::write_packets(vdemux_t& d, const uint8_t* p, size_t len) {
+	size_t done{0};
+	while (done < len) {
+		auto ret = ::write(d.write_fd, p + done, std::min(len - done, (size_t)max_write_size));
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				break; //pipe is full
+			if (errno != EPIPE)
+				dterrorf("Error writing to virtual demux: {}", strerror(errno));
+			close_demux(d);
+			return -1;
+		}
+		done += ret;
+	}
+	stats.num_bytes_sent += done;
+	return done;
+}
+
+int vdvb_t::demux_ioctl(vdemux_t& d, unsigned long request, void* arg) {
+	switch (request) {
+	case DMX_SET_BUFFER_SIZE:
+		d.buffer_size = (unsigned long)arg;
+		//a large pipe saves system calls; not fatal if this fails (e.g., limited by /proc/sys/fs/pipe-max-size)
+		fcntl(d.write_fd, F_SETPIPE_SZ, (int)std::min(d.buffer_size, (size_t)1024 * 1024));
+		return 0;
+	case DMX_SET_PES_FILTER: {
+		auto* f = (dmx_pes_filter_params*)arg;
+		d.pids.reset();
+		d.all_pids = false;
+		d.add_pid(f->pid);
+		d.started = f->flags & DMX_IMMEDIATE_START;
+		return 0;
+	}
+	case DMX_START:
+		d.started = true;
+		return 0;
+	case DMX_STOP:
+		d.started = false;
+		return 0;
+	case DMX_ADD_PID:
+		d.add_pid(*(uint16_t*)arg);
+		return 0;
+	case DMX_REMOVE_PID:
+		d.remove_pid(*(uint16_t*)arg);
+		return 0;
+	default:
+		errno = ENOTTY;
+		return -1;
+	}
+}
+
+int vdvb_t::frontend_ioctl(vadapter_t& a, unsigned long request, void* arg) {
+	switch (request) {
+	case FE_GET_EXTENDED_INFO: {
+		auto* info = (dvb_frontend_extended_info*)arg;
+		memset(info, 0, sizeof(*info));
+		snprintf(info->card_name, sizeof(info->card_name), "NeumoDVB virtual adapter");
+		snprintf(info->card_short_name, sizeof(info->card_short_name), "Replay");
+		snprintf(info->adapter_name, sizeof(info->adapter_name), "V%d Replay", a.adapter_no);
+		snprintf(info->card_address, sizeof(info->card_address), "virtual%d", a.adapter_no);
+		info->supports_neumo = true;
+		info->num_rf_inputs = 1;
+		info->default_rf_input = 0;
+		info->rf_inputs[0] = 0;
+		info->card_mac_address = -1; //the frontend will make a unique one from adapter_no
+		info->adapter_mac_address = -1;
+		info->frequency_min = 950000;
+		info->frequency_max = 2150000;
+		info->symbol_rate_min = 1000000;
+		info->symbol_rate_max = 45000000;
+		info->caps = (fe_caps)(FE_CAN_INVERSION_AUTO | FE_CAN_FEC_AUTO | FE_CAN_QPSK | FE_CAN_2G_MODULATION |
+													 FE_CAN_MULTISTREAM);
+		info->extended_caps = FE_CAN_SPECTRUM_SWEEP;
+		return 0;
+	}
+	case FE_GET_INFO: {
+		auto* info = (dvb_frontend_info*)arg;
+		memset(info, 0, sizeof(*info));
+		snprintf(info->name, sizeof(info->name), "NeumoDVB virtual adapter");
+		info->type = FE_QPSK;
+		info->frequency_min = 950000;
+		info->frequency_max = 2150000;
+		info->symbol_rate_min = 1000000;
+		info->symbol_rate_max = 45000000;
+		info->caps = (fe_caps)(FE_CAN_INVERSION_AUTO | FE_CAN_FEC_AUTO | FE_CAN_QPSK | FE_CAN_2G_MODULATION |
+													 FE_CAN_MULTISTREAM);
+		return 0;
+	}
+	case FE_SET_PROPERTY:
+		return set_properties(a, (dtv_properties*)arg);
+	case FE_GET_PROPERTY:
+		return get_properties(a, (dtv_properties*)arg);
+	case FE_GET_EVENT: {
+		if (a.events.empty()) {
+			errno = EWOULDBLOCK;
+			return -1;
+		}
+		*(dvb_frontend_event*)arg = a.events.front();
+		a.events.pop_front();
+		if (a.events.empty()) {
+			uint64_t count;
+			for (auto fd : a.fe_fds) {
+				if (::read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+					dterrorf("Cannot clear frontend event: {}", strerror(errno));
+			}
+		}
+		return 0;
+	}
+	case FE_READ_STATUS:
+		*(fe_status_t*)arg = a.status;
+		return 0;
+	case FE_SET_TONE:
+		a.tone = (int)(intptr_t)arg;
+		return 0;
+	case FE_SET_VOLTAGE:
+		a.voltage = (int)(intptr_t)arg;
+		return 0;
+	case FE_ENABLE_HIGH_LNB_VOLTAGE:
+	case FE_DISEQC_SEND_MASTER_CMD:
+	case FE_DISEQC_SEND_BURST:
+	case FE_DISEQC_RESET_OVERLOAD:
+		return 0; //there is no lnb, switch or positioner
+	case FE_SET_RF_INPUT: {
+		auto* ic = (fe_rf_input_control*)arg;
+		return ic->mode == FE_RESERVATION_MODE_SLAVE ? FE_RESERVATION_SLAVE : FE_RESERVATION_MASTER;
+	}
+	case FE_ALGO_CTRL: {
+		auto* algo_ctrl = (dtv_algo_ctrl*)arg;
+		if (algo_ctrl->cmd == DTV_STOP) {
+			a.stop();
+			a.heartbeat_interval = 0;
+		}
+		return 0;
+	}
+	default:
+		errno = ENOTTY;
+		return -1;
+	}
+}
+
+int vdvb_t::set_properties(vadapter_t& a, dtv_properties* props) {
+	for (uint32_t i = 0; i < props->num; ++i) {
+		auto& p = props->props[i];
+		switch (p.cmd) {
+		case DTV_CLEAR:
+			a.clear_parameters();
+			break;
+		case DTV_FREQUENCY:
+			a.frequency = p.u.data;
+			break;
+		case DTV_SYMBOL_RATE:
+			a.symbol_rate = p.u.data;
+			break;
+		case DTV_DELIVERY_SYSTEM:
+			a.delivery_system = p.u.data;
+			break;
+		case DTV_MODULATION:
+			a.modulation = p.u.data;
+			break;
+		case DTV_INNER_FEC:
+			a.inner_fec = p.u.data;
+			break;
+		case DTV_INVERSION:
+			a.inversion = p.u.data;
+			break;
+		case DTV_ROLLOFF:
+			a.rolloff = p.u.data;
+			break;
+		case DTV_PILOT:
+			a.pilot = p.u.data;
+			break;
+		case DTV_STREAM_ID:
+			a.stream_id = (int)p.u.data;
+			break;
+		case DTV_VOLTAGE:
+			a.voltage = p.u.data;
+			break;
+		case DTV_TONE:
+			a.tone = p.u.data;
+			break;
+		case DTV_HEARTBEAT:
+			a.heartbeat_interval = p.u.data;
+			a.next_heartbeat = steady_clock_t::now() + std::chrono::milliseconds(a.heartbeat_interval);
+			break;
+		case DTV_SCAN_START_FREQUENCY:
+			a.scan_start_frequency = p.u.data;
+			break;
+		case DTV_SCAN_END_FREQUENCY:
+			a.scan_end_frequency = p.u.data;
+			break;
+		case DTV_SCAN_RESOLUTION:
+			a.scan_resolution = p.u.data > 0 ? p.u.data : default_scan_resolution;
+			break;
+		case DTV_TUNE:
+			tune(a, false);
+			break;
+		case DTV_SPECTRUM:
+			tune(a, true);
+			break;
+		default:
+			break; //accepted and ignored (algorithm, search range, pls codes...)
+		}
+	}
+	return 0;
+}
+
+static void set_stat(dtv_fe_stats& st, int scale, int64_t value) {
+	memset(&st, 0, sizeof(st));
+	st.len = 1;
+	st.stat[0].scale = scale;
+	if (scale == FE_SCALE_DECIBEL)
+		st.stat[0].svalue = value;
+	else
+		st.stat[0].uvalue = value;
+}
+
+int vdvb_t::get_properties(vadapter_t& a, dtv_properties* props) {
+	bool locked = a.replay.is_open();
+	auto sig = a.replay.signal();
+	for (uint32_t i = 0; i < props->num; ++i) {
+		auto& p = props->props[i];
+		p.result = 0;
+		switch (p.cmd) {
+		case DTV_ENUM_DELSYS:
+			p.u.buffer.data[0] = SYS_DVBS;
+			p.u.buffer.data[1] = SYS_DVBS2;
+			p.u.buffer.len = 2;
+			break;
+		case DTV_DELIVERY_SYSTEM:
+			p.u.data = a.delivery_system == SYS_AUTO ? SYS_DVBS2 : a.delivery_system;
+			break;
+		case DTV_FREQUENCY:
+			//after a blind tune, the frequency found is that of the capture
+			p.u.data = a.capture ? a.capture->frequency - a.lof() : a.frequency;
+			break;
+		case DTV_SYMBOL_RATE:
+			p.u.data = a.symbol_rate > 0 ? a.symbol_rate : 27500000;
+			break;
+		case DTV_MODULATION:
+			p.u.data = a.modulation;
+			break;
+		case DTV_INNER_FEC:
+			p.u.data = a.inner_fec;
+			break;
+		case DTV_INVERSION:
+			p.u.data = a.inversion;
+			break;
+		case DTV_ROLLOFF:
+			p.u.data = a.rolloff;
+			break;
+		case DTV_PILOT:
+			p.u.data = a.pilot;
+			break;
+		case DTV_STREAM_ID:
+			p.u.data = a.stream_id;
+			break;
+		case DTV_VOLTAGE:
+			p.u.data = a.voltage;
+			break;
+		case DTV_TONE:
+			p.u.data = a.tone;
+			break;
+		case DTV_STAT_SIGNAL_STRENGTH:
+			set_stat(p.u.st, FE_SCALE_DECIBEL, locked ? sig.signal_strength : no_signal_level);
+			break;
+		case DTV_STAT_CNR:
+			set_stat(p.u.st, FE_SCALE_DECIBEL, locked ? sig.snr : 0);
+			break;
+		case DTV_STAT_PRE_ERROR_BIT_COUNT:
+			set_stat(p.u.st, FE_SCALE_COUNTER, 0);
+			break;
+		case DTV_STAT_PRE_TOTAL_BIT_COUNT:
+			set_stat(p.u.st, FE_SCALE_COUNTER, a.replay.get_num_bytes_served() * 8);
+			break;
+		case DTV_MATYPE:
+			p.u.data = 0xf0; //transport stream, single input stream, ccm
+			break;
+		case DTV_LOCKTIME:
+			p.u.data = locked ? a.locktime_ms : 0;
+			break;
+		case DTV_BITRATE:
+			p.u.data = locked ? (uint32_t)(a.replay.get_bitrate() * 8) : 0;
+			break;
+		case DTV_ISI_LIST:
+			memset(p.u.buffer.data, 0, sizeof(p.u.buffer.data));
+			p.u.buffer.len = sizeof(p.u.buffer.data);
+			break;
+		case DTV_MATYPE_LIST:
+			p.u.matype_list.num_entries = 0;
+			break;
+		case DTV_CONSTELLATION:
+			p.u.constellation.num_samples = 0;
+			break;
+		case DTV_SPECTRUM: {
+			auto spectrum = p.u.spectrum; //p is packed
+			get_spectrum(a, spectrum);
+			p.u.spectrum = spectrum;
+		} break;
+		default:
+			p.u.data = 0;
+			break;
+		}
+	}
+	return 0;
+}
+
+/*
+	Return the recorded spectrum for the current polarisation, converted to driver frequencies, or a spectrum
+	without any signal
+*/
+void vdvb_t::get_spectrum(const vadapter_t& a, dtv_fe_spectrum& s) const {
+	const std::vector<spectrum_point_t>* points{nullptr};
+	for (auto* pol = a.pols(); *pol && !points; ++pol) {
+		auto it = spectra.find(*pol);
+		if (it != spectra.end())
+			points = &it->second;
+	}
+	uint32_t num_freq{0};
+	uint32_t num_candidates{0};
+	auto lof = a.lof();
+	if (points) {
+		for (auto& point : *points) {
+			auto frequency = point.frequency - lof;
+			if (frequency < a.scan_start_frequency || frequency > a.scan_end_frequency)
+				continue;
+			if (num_freq < s.num_freq) {
+				s.freq[num_freq] = frequency;
+				s.rf_level[num_freq] = point.level;
+				num_freq++;
+			}
+			if (point.symbol_rate > 0 && s.candidates && num_candidates < s.num_candidates)
+				s.candidates[num_candidates++] = {(int32_t)frequency, point.symbol_rate, 0, point.level};
+		}
+	} else {
+		for (auto frequency = a.scan_start_frequency; frequency <= a.scan_end_frequency && num_freq < s.num_freq;
+				 frequency += a.scan_resolution) {
+			s.freq[num_freq] = frequency;
+			s.rf_level[num_freq] = no_signal_level;
+			num_freq++;
+		}
+	}
+	s.num_freq = num_freq;
+	s.num_candidates = num_candidates;
+	s.scale = FE_SCALE_DECIBEL;
+}
+
+void vdvb_t::run() {
+	pthread_setname_np(pthread_self(), "vdvb");
+	std::unique_lock<std::mutex> lck(mutex);
+	while (!must_exit) {
+		auto now = steady_clock_t::now();
+		auto next = now + 100ms;
+		for (auto& a : adapters)
+			next = std::min(next, service(*a, now));
+		cv.wait_until(lck, next);
+	}
+}
+
+int vdvb::start(const vdvb_options_t& options) {
+	if (vdvb_instance.load() || options.num_adapters <= 0)
+		return 0;
+	auto v = std::make_unique<vdvb_t>();
+	if (v->start(options) < 0)
+		return -1;
+	vdvb_instance.store(v.release());
+	return 0;
+}
+
+void vdvb::stop() {
+	delete vdvb_instance.exchange(nullptr);
+}
+
+std::vector<int> vdvb::adapter_nos() {
+	auto* v = vdvb_instance.load();
+	return v ? v->adapter_nos() : std::vector<int>{};
+}
+
+bool vdvb::is_virtual(int adapter_no) {
+	auto* v = vdvb_instance.load();
+	return v && v->is_virtual(adapter_no);
+}
+
+vdvb_stats_t vdvb::get_stats() {
+	auto* v = vdvb_instance.load();
+	return v ? v->get_stats() : vdvb_stats_t{};
+}
+
+int dvb_open(const char* fname, int flags) {
+	auto* v = vdvb_instance.load();
+	int adapter_no{-1};
+	char device[32];
+	if (v && sscanf(fname, "/dev/dvb/adapter%d/%31s", &adapter_no, device) == 2 && v->is_virtual(adapter_no))
+		return v->open(adapter_no, device, flags);
+	return ::open(fname, flags);
+}
+
+int dvb_ioctl(int fd, unsigned long request, ...) {
+	va_list ap;
+	va_start(ap, request);
+	void* arg = va_arg(ap, void*); //as in glibc: the argument is a pointer or an integer
+	va_end(ap);
+	auto* v = vdvb_instance.load();
+	int ret;
+	if (v && v->ioctl(fd, request, arg, ret))
+		return ret;
+	return ::ioctl(fd, request, arg);
+}
+
+int dvb_close(int fd) {
+	auto* v = vdvb_instance.load();
+	int ret;
+	if (v && v->close(fd, ret))
+		return ret;
+	return ::close(fd);
+}
@@ -0,0 +1,84 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifndef EXPORT
+#define EXPORT __attribute__((visibility("default")))
+#endif
+
+/*
+	Virtual dvb adapters, which replay captured transport streams instead of receiving them from hardware.
+	They allow running (and load testing) the complete receiver on a computer without dvb cards.
+
+	A virtual adapter has the same device names as a real one (/dev/dvb/adapterN/frontend0 and demux0),
+	but the devices only exist inside the process: all code must use dvb_open, dvb_ioctl and dvb_close
+	instead of open, ioctl and close for dvb devices. These functions pass calls for real devices on unchanged.
+
+	-The frontend behaves as a neumo api DVB-S/S2 frontend connected to a universal lnb (lof 9750/10600 MHz,
+	 tone selects the high band, 18V selects H/L and 13V selects V/R). Diseqc commands are accepted and ignored.
+	 Tuning selects the capture whose frequency and polarisation match the tuned frequency. lock_time later,
+	 a lock event is reported (or FE_TIMEDOUT if there is no matching capture), followed by periodic events
+	 if a heartbeat was requested. Signal strength and snr are fixed.
+	-Demux fds are pipes, which receive the packets of the tuned capture matching the pid filter of the demux,
+	 at the bitrate of the capture multiplied by speed. Packets are dropped when the reader falls behind
+	 more than the demux buffer size, as on a real demux, except with speed=0 (as fast as possible), where the
+	 replay waits for the slowest reader instead.
+	-Spectrum acquisition returns the data in H_spectrum.dat, V_spectrum.dat, L_spectrum.dat or R_spectrum.dat,
+	 files in the format saved by neumoDVB, if present.
+
+	Captures are files named <frequency><pol>[-<stream_id>].ts in dir, e.g., 11538000V.ts or 11538V.ts
+	(frequency in kHz or MHz).
+*/
+struct vdvb_options_t {
+	std::string dir;
+	int num_adapters{0};
+	double speed{1.}; //1: real time; 0: as fast as possible
+	int first_adapter_no{64}; //real adapters use lower numbers
+	std::chrono::milliseconds lock_time{200};
+};
+
+struct vdvb_stats_t {
+	int64_t num_bytes_sent{0}; //written to virtual demuxes
+	int64_t num_bytes_dropped{0}; //lost because a reader fell behind
+};
+
+namespace vdvb {
+	static constexpr int api_version = 1500; //neumo api version emulated by virtual frontends
+
+	//returns -1 on error
+	int start(const vdvb_options_t& options);
+	void stop();
+
+	//adapter numbers of all virtual adapters
+	std::vector<int> adapter_nos();
+	bool is_virtual(int adapter_no);
+
+	//totals for all virtual demuxes since start
+	EXPORT vdvb_stats_t get_stats();
+};
+
+int dvb_open(const char* fname, int flags);
+int dvb_ioctl(int fd, unsigned long request, ...);
+int dvb_close(int fd);
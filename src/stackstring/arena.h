@@ -0,0 +1,184 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <stdint.h>
+
+/*
+	Arena allocation for the overflow buffers of ss::string and ss::vector.
+
+	When a stackstring container outgrows its inline capacity, it allocates a buffer with operator new.
+	For code which creates many short lived containers (parsing epg sections, deserializing records),
+	this results in a malloc/free pair per oversized field. Such code can instead install an arena:
+
+		ss::arena_t arena;
+		{
+			ss::arena_scope_t scope(arena);
+			...  //overflow buffers of containers which grow in this scope are allocated from arena
+		}
+		arena.reset(); //release all memory at once
+
+	Freeing an arena buffer is a no-op. Rules:
+	-containers which grow while the scope is active must be destroyed before arena.reset()
+	 and before the arena is destroyed. This includes long lived containers which happen to grow
+	 while the scope is active, so scopes should be kept narrow.
+	-moving a container with an arena buffer into another one copies the data instead of stealing
+	 the buffer, so results can be safely moved out of the scope (after the scope has ended)
+	-the arena is per thread: a scope only affects allocations by the thread which created it
+
+	Allocations are counted per thread; get_alloc_stats() returns the totals over all threads.
+*/
+namespace ss {
+
+	struct alloc_stats_t {
+		int64_t num_heap_allocs{0};
+		int64_t num_heap_frees{0};
+		int64_t num_arena_allocs{0};
+		int64_t num_arena_bytes{0};
+	};
+
+	/*
+		Allocation counters of one thread. They are only updated by the owning thread, which can therefore
+		use plain (relaxed) loads and stores instead of atomic increments, but can be read by any thread.
+		Each thread registers its counters, and adds them to those of exited threads when it exits
+	*/
+	struct thread_alloc_stats_t {
+		std::atomic<int64_t> num_heap_allocs{0};
+		std::atomic<int64_t> num_heap_frees{0};
+		std::atomic<int64_t> num_arena_allocs{0};
+		std::atomic<int64_t> num_arena_bytes{0};
+		thread_alloc_stats_t* next{nullptr}; //in list of registered threads
+
+		thread_alloc_stats_t();
+		~thread_alloc_stats_t();
+		thread_alloc_stats_t(const thread_alloc_stats_t& other) = delete;
+		thread_alloc_stats_t& operator=(const thread_alloc_stats_t& other) = delete;
+
+		static inline void add(std::atomic<int64_t>& counter, int64_t n = 1) {
+			counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+		}
+
+		alloc_stats_t get() const;
+	};
+
+	class arena_t {
+		struct chunk_t {
+			chunk_t* next{nullptr};
+			size_t size{0}; //usable bytes after the chunk header
+		};
+
+		chunk_t* chunks{nullptr}; //most recent chunk first
+		char* ptr{nullptr}; //next free byte in the current chunk
+		char* end{nullptr}; //end of the current chunk
+		const size_t chunk_size;
+		int64_t num_bytes_allocated{0}; //since last reset
+
+		chunk_t* new_chunk(size_t size);
+		void* allocate_slow(size_t size);
+
+	public:
+		static constexpr size_t alignment = 16;
+
+		arena_t(size_t chunk_size = 64 * 1024)
+			: chunk_size(chunk_size)
+			{}
+		~arena_t();
+		arena_t(const arena_t& other) = delete;
+		arena_t& operator=(const arena_t& other) = delete;
+
+		inline void* allocate(size_t size) {
+			size = (size + alignment - 1) & ~(alignment - 1);
+			num_bytes_allocated += size;
+			if (__builtin_expect(size <= size_t(end - ptr), 1)) {
+				auto* ret = ptr;
+				ptr += size;
+				return ret;
+			}
+			return allocate_slow(size);
+		}
+
+		/*
+			Release all allocations at once. One chunk is kept for reuse
+		*/
+		void reset();
+
+		int64_t get_num_bytes_allocated() const {
+			return num_bytes_allocated;
+		}
+	};
+
+	extern thread_local arena_t* current_arena;
+	extern thread_local thread_alloc_stats_t alloc_stats; //allocations by the calling thread
+
+	//allocations by all threads, including those which have exited
+	alloc_stats_t get_alloc_stats();
+
+	/*
+		Install an arena for the calling thread for the lifetime of this object.
+		arena_scope_t(nullptr) temporarily restores heap allocation, e.g., for containers which must
+		outlive the arena
+	*/
+	class arena_scope_t {
+		arena_t* saved;
+	public:
+		arena_scope_t(arena_t* arena)
+			: saved(current_arena) {
+			current_arena = arena;
+		}
+
+		arena_scope_t(arena_t& arena)
+			: arena_scope_t(&arena)
+			{}
+
+		~arena_scope_t() {
+			current_arena = saved;
+		}
+
+		arena_scope_t(const arena_scope_t& other) = delete;
+		arena_scope_t& operator=(const arena_scope_t& other) = delete;
+	};
+
+	//allocate an overflow buffer of type D (a header_t::data_with_capacity)
+	template <typename D> inline D* allocate_buffer(size_t size) {
+		D* p;
+		if (current_arena) {
+			p = (D*)current_arena->allocate(size);
+			p->arena_ = true;
+			thread_alloc_stats_t::add(alloc_stats.num_arena_allocs);
+			thread_alloc_stats_t::add(alloc_stats.num_arena_bytes, size);
+		} else {
+			p = (D*)operator new(size);
+			p->arena_ = false;
+			thread_alloc_stats_t::add(alloc_stats.num_heap_allocs);
+		}
+		return p;
+	}
+
+	template <typename D> inline void free_buffer(D* p) {
+		if (!p || p->arena_)
+			return;
+		thread_alloc_stats_t::add(alloc_stats.num_heap_frees);
+		operator delete(p);
+	}
+
+}; // namespace ss
@@ -29,6 +29,7 @@
 #include <iconv.h>
 #include <sys/errno.h>
 #include <cstdarg>
+#include <mutex>
 
 #ifdef USE_BOOST_LOCALE
 #include <boost/locale.hpp>
@@ -321,6 +322,123 @@ namespace ss {
 
 	template class databuffer_<char>;
 
+	thread_local arena_t* current_arena{nullptr};
+	thread_local thread_alloc_stats_t alloc_stats;
+
+	namespace {
+		//registered per thread counters, and the totals of threads which have exited
+		struct alloc_stats_registry_t {
+			std::mutex mutex;
+			thread_alloc_stats_t* threads{nullptr};
+			alloc_stats_t exited;
+		};
+
+		alloc_stats_registry_t& alloc_stats_registry() {
+			static auto* registry = new alloc_stats_registry_t; //never destroyed: threads may exit late
+			return *registry;
+		}
+
+		inline void accumulate(alloc_stats_t& total, const alloc_stats_t& s) {
+			total.num_heap_allocs += s.num_heap_allocs;
+			total.num_heap_frees += s.num_heap_frees;
+			total.num_arena_allocs += s.num_arena_allocs;
+			total.num_arena_bytes += s.num_arena_bytes;
+		}
+	};
+
+	thread_alloc_stats_t::thread_alloc_stats_t() {
+		auto& r = alloc_stats_registry();
+		std::scoped_lock lck(r.mutex);
+		next = r.threads;
+		r.threads = this;
+	}
+
+	thread_alloc_stats_t::~thread_alloc_stats_t() {
+		auto& r = alloc_stats_registry();
+		std::scoped_lock lck(r.mutex);
+		accumulate(r.exited, get());
+		for (auto** p = &r.threads; *p; p = &(*p)->next) {
+			if (*p == this) {
+				*p = next;
+				break;
+			}
+		}
+	}
+
+	alloc_stats_t thread_alloc_stats_t::get() const {
+		alloc_stats_t ret;
+		ret.num_heap_allocs = num_heap_allocs.load(std::memory_order_relaxed);
+		ret.num_heap_frees = num_heap_frees.load(std::memory_order_relaxed);
+		ret.num_arena_allocs = num_arena_allocs.load(std::memory_order_relaxed);
+		ret.num_arena_bytes = num_arena_bytes.load(std::memory_order_relaxed);
+		return ret;
+	}
+
+	alloc_stats_t get_alloc_stats() {
+		auto& r = alloc_stats_registry();
+		std::scoped_lock lck(r.mutex);
+		auto ret = r.exited;
+		for (auto* t = r.threads; t; t = t->next)
+			accumulate(ret, t->get());
+		return ret;
+	}
+
+	arena_t::chunk_t* arena_t::new_chunk(size_t size) {
+		auto* c = (chunk_t*)operator new(sizeof(chunk_t) + size);
+		c->size = size;
+		return c;
+	}
+
+	void* arena_t::allocate_slow(size_t size) {
+		if (size > chunk_size / 4) {
+			//dedicated chunk; keep allocating small objects from the current chunk
+			auto* c = new_chunk(size);
+			if (chunks) {
+				c->next = chunks->next;
+				chunks->next = c;
+			} else {
+				c->next = nullptr;
+				chunks = c;
+			}
+			return (char*)(c + 1);
+		}
+		auto* c = new_chunk(chunk_size);
+		c->next = chunks;
+		chunks = c;
+		ptr = (char*)(c + 1) + size;
+		end = (char*)(c + 1) + chunk_size;
+		return (char*)(c + 1);
+	}
+
+	void arena_t::reset() {
+		chunk_t* keep{nullptr};
+		for (auto* c = chunks; c;) {
+			auto* next = c->next;
+			if (!keep && c->size == chunk_size)
+				keep = c;
+			else
+				operator delete(c);
+			c = next;
+		}
+		chunks = keep;
+		if (keep) {
+			keep->next = nullptr;
+			ptr = (char*)(keep + 1);
+			end = ptr + chunk_size;
+		} else {
+			ptr = end = nullptr;
+		}
+		num_bytes_allocated = 0;
+	}
+
+	arena_t::~arena_t() {
+		for (auto* c = chunks; c;) {
+			auto* next = c->next;
+			operator delete(c);
+			c = next;
+		}
+	}
+
 }; // namespace ss
 
 #if 0
@@ -29,6 +29,7 @@
 #include <string.h>
 #include "fmt/format.h"
 #include "stackstring_header.h"
+#include "arena.h"
 
 extern int gcd(int a, int b);
 
@@ -89,12 +90,12 @@ namespace ss {
 		auto old = s.steal_allocated_buffer();
 		s.clear(true);
 		s.reserve(old_length);
-		memcpy(s.header.allocated_buffer(), old, (old_length + zero_terminate) * s.item_size);
+		memcpy(s.header.allocated_buffer()->data(), old->data(), (old_length + zero_terminate) * s.item_size);
 		s.set_size(old_length);
 #ifdef SS_ASSERT
 		assert(!s.is_view());
 #endif
-		operator delete(old);
+		free_buffer(old);
 	}
 
 /*
@@ -196,7 +197,7 @@ namespace ss {
 						p[i].~data_t();
 				}
 				auto old = steal_allocated_buffer();
-				operator delete(old);
+				free_buffer(old);
 			}
 			if (release)
 				set_inline_buffer();
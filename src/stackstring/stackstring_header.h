@@ -148,7 +148,8 @@ struct ss::header_t {
 
 	template<int N>
 	struct PACKED data_with_capacity {
-		uint32_t capacity_{0};
+		uint32_t capacity_ : 31 {0};
+		uint32_t arena_ : 1 {0}; //allocated from an ss::arena_t; see arena.h
 		typename std::aligned_storage<sizeof(T), alignof(T)>::type data_[N];
 
 		INLINE T* data() {
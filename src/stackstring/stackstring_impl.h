@@ -112,7 +112,7 @@ inline int next_power_of_two(int n) {
 		using D1 = typename header_t<data_t>::template data_with_capacity<1>;
 		using D2 = typename header_t<data_t>::template data_with_capacity<2>;
 		auto s= sizeof(D1) + (sizeof(D2)-sizeof(D1))*(newcap-1);
-		auto* p  = (D1*) operator new (s);
+		auto* p  = allocate_buffer<D1>(s);
 		auto* old_data = buffer();
 		p->capacity_ = newcap;
 		if constexpr (std::is_trivial<data_t>::value) {
@@ -126,7 +126,7 @@ inline int next_power_of_two(int n) {
 		}
 		if(is_allocated()) {
 			auto* src = header.allocated_buffer();
-			operator delete (src);
+			free_buffer(src);
 		}
 
 		set_external_buffer(p);
@@ -146,7 +146,7 @@ template<typename data_t>
 				for(int i=0; i< size(); ++i)
 					p[i].~data_t();
 			}
-			operator delete (header.allocated_buffer());
+			free_buffer(header.allocated_buffer());
 		}
 	}
 
@@ -198,6 +198,12 @@ template<typename data_t>
 			other.clear(true);
 			return;
 		}
+		if(other.header.allocated_buffer()->arena_) {
+			//arena buffers must not escape into containers which may outlive the arena
+			copy(other);
+			other.clear(true);
+			return;
+		}
 		if(other.size() < capacity() && !is_allocated()) {
 			//copying is better as no reallocation is needed
 			copy(other);
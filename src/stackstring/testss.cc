@@ -22,6 +22,7 @@
 #include "../util/logger.h"
 #include <map>
 #include <stdint.h>
+#include <thread>
 #include <vector>
 
 struct zorro_t {
@@ -38,8 +39,81 @@ ss::accu_t f(ss::string_& s) {
 	return a;
 }
 
+/*
+	overflow buffers of containers which grow in an arena scope come from the arena; when the current chunk
+	is exhausted, the arena allocates a new chunk from the heap (or a dedicated one for large buffers).
+	Returns the number of failed checks
+*/
+static int test_arena() {
+	int num_errors{0};
+	auto check = [&num_errors](bool ok, const char* what) {
+		if (!ok) {
+			printf("arena test failed: %s\n", what);
+			num_errors++;
+		}
+	};
+	const size_t chunk_size = 1024;
+	ss::arena_t arena(chunk_size);
+	auto start = ss::get_alloc_stats();
+	{
+		ss::arena_scope_t scope(arena);
+		ss::string<8> s;
+		for (int i = 0; i < 10; ++i)
+			s.append("0123456789");
+		auto stats = ss::get_alloc_stats();
+		check(s.size() == 100 && s[99] == '9', "string overflowing into arena");
+		check(stats.num_arena_allocs > start.num_arena_allocs, "overflow buffer allocated from arena");
+		check(stats.num_heap_allocs == start.num_heap_allocs, "no heap buffers while arena is installed");
+		check(arena.get_num_bytes_allocated() > 0 && arena.get_num_bytes_allocated() < (int64_t)chunk_size,
+					"small buffers fit in first chunk");
+
+		//exhaust the first chunk; this includes buffers too large for a shared chunk
+		ss::vector<int32_t, 1> v;
+		for (int i = 0; i < 1000; ++i)
+			v.push_back(i);
+		bool ok = v.size() == 1000;
+		for (int i = 0; ok && i < 1000; ++i)
+			ok = v[i] == i;
+		check(ok, "vector growing beyond the first chunk");
+		check(arena.get_num_bytes_allocated() > (int64_t)chunk_size, "arena allocated additional chunks");
+		check(s.size() == 100 && s[0] == '0' && s[99] == '9', "earlier buffers unaffected by new chunks");
+
+		{
+			ss::arena_scope_t heap_scope(nullptr);
+			ss::string<8> h;
+			h.append("a string which does not fit inline");
+			check(ss::get_alloc_stats().num_heap_allocs > stats.num_heap_allocs, "heap allocation without arena");
+		}
+	}
+	arena.reset();
+	check(arena.get_num_bytes_allocated() == 0, "reset releases all allocations");
+	{
+		ss::arena_scope_t scope(arena);
+		ss::string<8> s;
+		s.append("0123456789abcdef");
+		check(s == ss::string<8>("0123456789abcdef"), "allocation after reset");
+		check(arena.get_num_bytes_allocated() > 0, "arena reused after reset");
+	}
+	arena.reset();
+
+	//allocations of threads which have exited are still counted
+	auto before = ss::get_alloc_stats();
+	std::thread t([]() {
+		ss::string<8> s;
+		s.append("a string which does not fit inline");
+	});
+	t.join();
+	auto after = ss::get_alloc_stats();
+	check(after.num_heap_allocs > before.num_heap_allocs && after.num_heap_frees > before.num_heap_frees,
+				"allocations by other threads");
+	printf("arena test: %s\n", num_errors == 0 ? "ok" : "FAILED");
+	return num_errors;
+}
+
 int main(int argc, char** argv) {
 	set_logconfig(nullptr);
+	if (test_arena() != 0)
+		return 1;
 	ss::string<16> dirname;
 	dirname << "28.2E 10";
 
@@ -0,0 +1,311 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#include "async_logger.h"
+#include "logger.h"
+#include <condition_variable>
+#include <log4cxx/helpers/transcoder.h>
+#include <log4cxx/mdc.h>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dtlog {
+
+	std::atomic<bool> async_enabled_{false};
+
+	/*
+		single producer (the owning thread), single consumer (the logger thread)
+	*/
+	struct ring_t {
+		static constexpr uint32_t size = 256; //power of 2
+		alignas(64) std::atomic<uint32_t> head{0}; //written by producer
+		alignas(64) std::atomic<uint32_t> tail{0}; //written by consumer
+		std::atomic<bool> thread_exited{false};
+		char thread_name[32]{};
+		std::mutex thread_name_mutex;
+		record_t records[size];
+
+		inline bool empty() const {
+			return head.load(std::memory_order_acquire) == tail.load(std::memory_order_relaxed);
+		}
+	};
+
+	struct state_t {
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::vector<std::shared_ptr<ring_t>> rings;
+		std::thread thread;
+		bool must_exit{false};
+		bool running{false};
+		bool stopped{false}; //consumer has exited and the rings have been drained for the last time
+		std::atomic<int64_t> num_deferred{0};
+		std::atomic<int64_t> num_preformatted{0};
+		std::atomic<int64_t> num_dropped{0};
+		std::atomic<int64_t> num_sync{0};
+	};
+
+	//never destroyed: threads may still log during exit
+	static state_t& state = *new state_t;
+
+	struct ring_owner_t {
+		std::shared_ptr<ring_t> ring;
+		~ring_owner_t() {
+			if (ring)
+				ring->thread_exited = true; //consumer releases the ring after draining it
+		}
+	};
+
+	static thread_local ring_owner_t ring_owner;
+
+	static ring_t* this_thread_ring() {
+		auto& r = ring_owner.ring;
+		if (!r) {
+			r = std::make_shared<ring_t>();
+			pthread_getname_np(pthread_self(), r->thread_name, sizeof(r->thread_name));
+			std::scoped_lock lck(state.mutex);
+			state.rings.push_back(r);
+		}
+		return r.get();
+	}
+
+	void set_thread_name(const char* name) {
+		auto* r = ring_owner.ring.get();
+		if (!r)
+			return; //name will be read when the ring is created
+		std::scoped_lock lck(r->thread_name_mutex);
+		strncpy(r->thread_name, name, sizeof(r->thread_name) - 1);
+	}
+
+	static inline const LevelPtr& to_log4cxx(level_t level) {
+		static const LevelPtr debug = Level::getDebug();
+		static const LevelPtr info = Level::getInfo();
+		static const LevelPtr error = Level::getError();
+		switch (level) {
+		case level_t::DEBUG:
+			return debug;
+		case level_t::INFO:
+			return info;
+		default:
+			return error;
+		}
+	}
+
+	void log_sync(level_t level, log4cxx::Logger* logger, const char* file, const char* func, int line,
+								const char* msg) {
+		logger->forcedLog(to_log4cxx(level), msg,
+#ifdef LOG4CXX_VERSION_MAJOR
+											::log4cxx::spi::LocationInfo(file, file, func, line));
+#else
+											::log4cxx::spi::LocationInfo(file, func, line));
+#endif
+	}
+
+	record_t* reserve(level_t level, log4cxx::Logger* logger, const char* file, const char* func, int line) {
+		if (!async_enabled())
+			return nullptr; //stopping; caller logs synchronously
+		auto* ring = this_thread_ring();
+		auto head = ring->head.load(std::memory_order_relaxed);
+		auto tail = ring->tail.load(std::memory_order_acquire);
+		if (head - tail >= ring_t::size) {
+			if (level == level_t::ERROR)
+				state.num_sync++;
+			else
+				state.num_dropped++;
+			state.cv.notify_one();
+			return nullptr;
+		}
+		auto* r = &ring->records[head & (ring_t::size - 1)];
+		r->logger = logger;
+		r->file = file;
+		r->func = func;
+		r->line = line;
+		r->level = level;
+		r->time = steady_clock_t::now();
+		r->ndc[0] = 0;
+		if (!log4cxx::NDC::empty()) {
+			LOG4CXX_ENCODE_CHAR(ndc, log4cxx::NDC::peek());
+			auto len = std::min(ndc.size(), sizeof(r->ndc) - 1);
+			memcpy(r->ndc, ndc.c_str(), len);
+			r->ndc[len] = 0;
+		}
+		return r;
+	}
+
+	static void drain_after_stop();
+
+	void commit(record_t* r, bool deferred) {
+		auto* ring = ring_owner.ring.get();
+		auto head = ring->head.load(std::memory_order_relaxed) + 1;
+		ring->head.store(head, std::memory_order_release);
+		(deferred ? state.num_deferred : state.num_preformatted)
+			.fetch_add(1, std::memory_order_relaxed);
+		//wake up the consumer early when the ring starts filling up
+		if (head - ring->tail.load(std::memory_order_relaxed) == ring_t::size / 2)
+			state.cv.notify_one();
+		if (!async_enabled())
+			drain_after_stop(); //record was reserved while logging was being stopped
+	}
+
+	static void output(ring_t& ring, const record_t& r, ss::string_& msg) {
+		msg.clear();
+		if (r.format)
+			r.format(r, msg);
+		else
+			msg.append((const char*)r.payload, r.len);
+		{
+			std::scoped_lock lck(ring.thread_name_mutex);
+			log4cxx::MDC::put("thread_name", ring.thread_name);
+		}
+		if (r.ndc[0])
+			log4cxx::NDC::push(r.ndc);
+		log_sync(r.level, r.logger, r.file, r.func, r.line, msg.c_str());
+		if (r.ndc[0])
+			log4cxx::NDC::pop();
+	}
+
+	/*
+		output() sets the MDC thread_name of the calling thread to the name of the thread which made
+		the message. When draining on a thread which also logs itself (stop_async_logging), its own
+		name must be restored afterwards
+	*/
+	struct thread_name_restorer_t {
+		std::string saved{log4cxx::MDC::get("thread_name")};
+		~thread_name_restorer_t() {
+			if (saved.empty())
+				log4cxx::MDC::remove("thread_name");
+			else
+				log4cxx::MDC::put("thread_name", saved);
+		}
+	};
+
+	/*
+		Write out all messages available in the rings, merging the messages from different threads
+		in time order
+	*/
+	static int drain(std::vector<std::shared_ptr<ring_t>>& rings, ss::string_& msg) {
+		thread_name_restorer_t thread_name_restorer;
+		int count = 0;
+		for (;;) {
+			ring_t* best = nullptr;
+			const record_t* best_record = nullptr;
+			for (auto& ring : rings) {
+				auto tail = ring->tail.load(std::memory_order_relaxed);
+				if (ring->head.load(std::memory_order_acquire) == tail)
+					continue;
+				auto* r = &ring->records[tail & (ring_t::size - 1)];
+				if (!best_record || r->time < best_record->time) {
+					best = ring.get();
+					best_record = r;
+				}
+			}
+			if (!best)
+				return count;
+			output(*best, *best_record, msg);
+			best->tail.store(best->tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			count++;
+		}
+	}
+
+	/*
+		Write out the messages in the ring of the current thread which were committed after stop_async_logging
+		has drained the rings for the last time. Messages committed earlier are written by stop_async_logging
+	*/
+	static void drain_after_stop() {
+		std::scoped_lock lck(state.mutex);
+		if (!state.stopped)
+			return;
+		ss::string<1024> msg;
+		std::vector<std::shared_ptr<ring_t>> rings{ring_owner.ring};
+		drain(rings, msg);
+	}
+
+	static void consumer() {
+		pthread_setname_np(pthread_self(), "logger");
+		ss::string<1024> msg;
+		std::vector<std::shared_ptr<ring_t>> rings;
+		for (;;) {
+			bool must_exit;
+			{
+				std::unique_lock lck(state.mutex);
+				state.cv.wait_for(lck, std::chrono::milliseconds(10));
+				must_exit = state.must_exit;
+				//release rings of threads which have exited and whose messages have been written
+				std::erase_if(state.rings, [](auto& r) { return r->thread_exited && r->empty(); });
+				rings = state.rings;
+			}
+			drain(rings, msg);
+			if (must_exit)
+				break;
+		}
+		//messages may have been added while draining
+		drain(rings, msg);
+	}
+
+	void start_async_logging() {
+		std::scoped_lock lck(state.mutex);
+		if (state.running)
+			return;
+		static bool atexit_registered = false;
+		if (!atexit_registered) {
+			atexit(stop_async_logging);
+			atexit_registered = true;
+		}
+		state.must_exit = false;
+		state.running = true;
+		state.stopped = false;
+		state.thread = std::thread(consumer);
+		async_enabled_ = true;
+	}
+
+	void stop_async_logging() {
+		{
+			std::scoped_lock lck(state.mutex);
+			if (!state.running)
+				return;
+			async_enabled_ = false;
+			state.must_exit = true;
+			state.running = false;
+		}
+		state.cv.notify_one();
+		state.thread.join();
+		/*records reserved before async logging was disabled may have been committed after the
+			consumer's last drain, possibly in rings the consumer did not know about*/
+		std::scoped_lock lck(state.mutex);
+		ss::string<1024> msg;
+		drain(state.rings, msg);
+		std::erase_if(state.rings, [](auto& r) { return r->thread_exited; });
+		state.stopped = true;
+	}
+
+	stats_t get_stats() {
+		stats_t ret;
+		ret.num_deferred = state.num_deferred;
+		ret.num_preformatted = state.num_preformatted;
+		ret.num_dropped = state.num_dropped;
+		ret.num_sync = state.num_sync;
+		return ret;
+	}
+
+}; //namespace dtlog
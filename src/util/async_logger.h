@@ -0,0 +1,158 @@
+/*
+ * Neumo dvb (C) 2019-2024 deeptho@gmail.com
+ * Copyright notice:
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string.h>
+#include <tuple>
+#include <type_traits>
+#include "fmt/format.h"
+#include "stackstring.h"
+#include "time_util.h"
+
+namespace log4cxx {
+	class Logger;
+};
+
+/*
+	Optional asynchronous backend for the dtdebugf/dtinfof/dterrorf macros.
+
+	Each thread owns a single producer/single consumer ring of fixed size records. Messages whose
+	arguments are plain values (numbers, enums, durations) are stored in binary form and are formatted
+	by the consumer thread, which then hands them to the log4cxx appenders. Other messages are formatted
+	by the producer (as pointers and strings may not remain valid), but still written out by the consumer.
+
+	When a ring is full, debug and info messages are dropped (and counted), error messages are
+	logged synchronously.
+*/
+namespace dtlog {
+
+	enum class level_t : uint8_t {
+		DEBUG,
+		INFO,
+		ERROR
+	};
+
+	struct record_t;
+	using format_fn_t = void (*)(const record_t& r, ss::string_& out);
+
+	struct record_t {
+		static constexpr int payload_size = 256;
+		log4cxx::Logger* logger{nullptr};
+		const char* file{nullptr};
+		const char* func{nullptr};
+		int line{0};
+		level_t level{level_t::DEBUG};
+		steady_time_t time; //used to merge the output of different threads in the right order
+		format_fn_t format{nullptr}; //nullptr means: payload contains formatted text
+		const char* fmt{nullptr};
+		int16_t len{0}; //length of text in payload
+		char ndc[64];
+		alignas(16) uint8_t payload[payload_size];
+	};
+
+	struct stats_t {
+		int64_t num_deferred{0}; //formatted on consumer side
+		int64_t num_preformatted{0}; //formatted on producer side
+		int64_t num_dropped{0};
+		int64_t num_sync{0}; //logged synchronously because ring was full
+	};
+
+	extern std::atomic<bool> async_enabled_;
+
+	inline bool async_enabled() {
+		return async_enabled_.load(std::memory_order_relaxed);
+	}
+
+	/*
+		start/stop the consumer thread. stop drains all pending messages; afterwards messages
+		are logged synchronously.
+	*/
+	void start_async_logging();
+	void stop_async_logging();
+	stats_t get_stats();
+
+	//remember the name of the current thread, to be reported by the consumer
+	void set_thread_name(const char* name);
+
+	/*
+		reserve a record in the ring of the current thread; returns nullptr if the ring is full
+		or if async logging is disabled
+	*/
+	record_t* reserve(level_t level, log4cxx::Logger* logger, const char* file, const char* func, int line);
+	void commit(record_t* r, bool deferred);
+	void log_sync(level_t level, log4cxx::Logger* logger, const char* file, const char* func, int line,
+								const char* msg);
+
+	template<typename T>
+	struct is_duration : std::false_type {};
+	template<typename Rep, typename Period>
+	struct is_duration<std::chrono::duration<Rep, Period>> : std::true_type {};
+
+	/*
+		Arguments which can safely be formatted later, on another thread
+	*/
+	template<typename T>
+	constexpr bool is_deferrable_v = std::is_arithmetic_v<std::decay_t<T>> || std::is_enum_v<std::decay_t<T>> ||
+		is_duration<std::decay_t<T>>::value;
+
+	template<typename... Args>
+	void format_record(const record_t& r, ss::string_& out) {
+		using tuple_t = std::tuple<std::decay_t<Args>...>;
+		auto& args = *std::launder(reinterpret_cast<const tuple_t*>(r.payload));
+		std::apply([&](auto&... a) {
+			fmt::vformat_to(std::back_insert_iterator(out), fmt::string_view(r.fmt, r.len),
+											fmt::make_format_args(a...));
+		}, args);
+	}
+
+	template<typename... Args>
+	inline void log(level_t level, log4cxx::Logger* logger, const char* file, const char* func, int line,
+									fmt::format_string<Args...> f, Args&&... args) {
+		using tuple_t = std::tuple<std::decay_t<Args>...>;
+		auto* r = reserve(level, logger, file, func, line);
+		if (!r) {
+			if (level == level_t::ERROR || !async_enabled()) {
+				ss::string<256> msg;
+				msg.format(f, std::forward<Args>(args)...);
+				log_sync(level, logger, file, func, line, msg.c_str());
+			}
+			return;
+		}
+		if constexpr ((is_deferrable_v<Args> && ...) && sizeof(tuple_t) <= record_t::payload_size &&
+									alignof(tuple_t) <= 16 && std::is_trivially_destructible_v<tuple_t>) {
+			new (r->payload) tuple_t(std::forward<Args>(args)...);
+			r->format = &format_record<Args...>;
+			fmt::string_view sv = f;
+			r->fmt = sv.data();
+			r->len = sv.size();
+			commit(r, true);
+		} else {
+			auto ret = fmt::format_to_n((char*)r->payload, record_t::payload_size - 1, f, std::forward<Args>(args)...);
+			r->len = std::min((int)ret.size, record_t::payload_size - 1);
+			r->payload[r->len] = 0;
+			r->format = nullptr;
+			commit(r, false);
+		}
+	}
+
+}; //namespace dtlog
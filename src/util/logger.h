@@ -30,6 +30,7 @@
 #include "log4cxx/ndc.h"
 #include "time_util.h"
 #include "stackstring.h"
+#include "async_logger.h"
 
 using namespace log4cxx;
 extern thread_local LoggerPtr logger;
@@ -49,9 +50,20 @@ namespace dtdemux {
 }
 
 
+/*
+	The logging macros below check the log level before formatting anything. When asynchronous
+	logging has been enabled (dtlog::start_async_logging), messages are handed to a background thread
+	instead of being written out by the calling thread
+*/
+
 //alternative for dtdebug
 #define dtinfof(fmt, args...)																						\
 	do {																																	\
+		if(!logger->isInfoEnabled()) break;																	\
+		if(dtlog::async_enabled()) {																				\
+			dtlog::log(dtlog::level_t::INFO, &*logger, __FILE__, __func__, __LINE__, fmt, ##args); \
+			break;																														\
+		}																																		\
 		ss::string<256> msg;																								\
 		msg.format(fmt, ##args);																						\
 		LOG4CXX_INFO(logger, msg.c_str());																	\
@@ -59,29 +71,48 @@ namespace dtdemux {
 
 #define dterror_nicef(fmt, args...)																			\
 	do {																																	\
+		if(!logger->isErrorEnabled()) break;																\
 		static int ___count=0; static time_t ___last=0; time_t ___now=time(NULL);	\
 		if(___now-___last<1) {___count++;break;}														\
-		ss::string<256> msg;																								\
-		msg.format(fmt, ##args);																						\
-		LOG4CXX_ERROR(logger, msg.c_str());																	\
-		if(___count) LOG4CXX_ERROR(logger, "Last message repeated " << ___count << " times"); \
+		if(dtlog::async_enabled()) {																				\
+			dtlog::log(dtlog::level_t::ERROR, &*logger, __FILE__, __func__, __LINE__, fmt, ##args); \
+			if(___count) dtlog::log(dtlog::level_t::ERROR, &*logger, __FILE__, __func__, __LINE__, \
+															"Last message repeated {:d} times", ___count); \
+		} else {																														\
+			ss::string<256> msg;																							\
+			msg.format(fmt, ##args);																					\
+			LOG4CXX_ERROR(logger, msg.c_str());																\
+			if(___count) LOG4CXX_ERROR(logger, "Last message repeated " << ___count << " times"); \
+		}																																		\
 		___count=0;___last=___now;																					\
 	} while(0)
 
 #define dtdebug_nicef(fmt, args...)																			\
 	do {																																	\
+		if(!logger->isDebugEnabled()) break;																\
 		static int ___count=0; static time_t ___last=0; time_t ___now=time(NULL);	\
 		if(___now-___last<1) {___count++;break;}														\
-		ss::string<256> msg;																								\
-		msg.format(fmt, ##args);																						\
-		LOG4CXX_DEBUG(logger, msg.c_str());																	\
-		if(___count) LOG4CXX_DEBUG(logger, "Last message repeated " << ___count << " times"); \
+		if(dtlog::async_enabled()) {																				\
+			dtlog::log(dtlog::level_t::DEBUG, &*logger, __FILE__, __func__, __LINE__, fmt, ##args); \
+			if(___count) dtlog::log(dtlog::level_t::DEBUG, &*logger, __FILE__, __func__, __LINE__, \
+															"Last message repeated {:d} times", ___count); \
+		} else {																														\
+			ss::string<256> msg;																							\
+			msg.format(fmt, ##args);																					\
+			LOG4CXX_DEBUG(logger, msg.c_str());																\
+			if(___count) LOG4CXX_DEBUG(logger, "Last message repeated " << ___count << " times"); \
+		}																																		\
 		___count=0;___last=___now;																					\
 	} while(0)
 
 //alternative for dtdebug
 #define dtdebugf(fmt, args...)																					\
 	do {																																	\
+		if(!logger->isDebugEnabled()) break;																\
+		if(dtlog::async_enabled()) {																				\
+			dtlog::log(dtlog::level_t::DEBUG, &*logger, __FILE__, __func__, __LINE__, fmt, ##args); \
+			break;																														\
+		}																																		\
 		ss::string<256> msg;																								\
 		msg.format(fmt, ##args);																						\
 		LOG4CXX_DEBUG(logger, msg.c_str());																	\
@@ -90,6 +121,11 @@ namespace dtdemux {
 //alternative for dtdebug
 #define dterrorf(fmt, args...)																					\
 	do {																																	\
+		if(!logger->isErrorEnabled()) break;																\
+		if(dtlog::async_enabled()) {																				\
+			dtlog::log(dtlog::level_t::ERROR, &*logger, __FILE__, __func__, __LINE__, fmt, ##args); \
+			break;																														\
+		}																																		\
 		ss::string<256> msg;																								\
 		msg.format(fmt, ##args);																						\
 		LOG4CXX_ERROR(logger, msg.c_str());																	\
@@ -128,4 +164,5 @@ inline void log4cxx_store_threadname()
 	pthread_getname_np(pthread_self(), thread_name, sizeof(thread_name));
 	assert(strlen(thread_name)>0);
 	log4cxx::MDC::put( "thread_name", thread_name);
+	dtlog::set_thread_name(thread_name);
 }
@@ -54,23 +54,33 @@ class MpvPlayer_;
 struct playback_info_t;
 
 
+//texture holding the rasterized version of an svg
+struct svg_texture_t {
+	GLuint id{0};
+	int generation{-1}; //generation of the svg surface currently in the texture
+	int width{-1};
+	int height{-1};
+};
+
 class mpv_overlay_t {
-	GLuint g_texture{0};
+	svg_texture_t osd_texture;
+	svg_texture_t radiobg_texture;
 	ss::string<64> signal_info;
 	ss::string<64> service_info;
 	std::unique_ptr<svg_overlay_t> svg_overlay;
 	std::unique_ptr<svg_radiobg_t> svg_radiobg;
-	void render(svg_t* svgptr, int window_width, int window_height);
+	void render(svg_t* svgptr, svg_texture_t& texture, int window_width, int window_height);
+	void upload(svg_t* svg, svg_texture_t& texture, const uint8_t* data);
 public:
 	void set_signal_info(const signal_info_t& signal_info, const playback_info_t& info);
 	void set_playback_info(const playback_info_t& info);
 
 	void render_osd(int window_width, int window_height) {
-		return render(svg_overlay.get(), window_width, window_height);
+		return render(svg_overlay.get(), osd_texture, window_width, window_height);
 	}
 
 	void render_radiobg(int window_width, int window_height) {
-		return render(svg_radiobg.get(), window_width, window_height);
+		return render(svg_radiobg.get(), radiobg_texture, window_width, window_height);
 	}
 
 	mpv_overlay_t(MpvPlayer_* player);
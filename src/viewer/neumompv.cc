@@ -945,6 +945,35 @@ int MpvPlayer::jump(int seconds) {
 	return self->jump(seconds);
 }
 
+/*
+	direction > 0: fast forward; direction < 0: rewind; direction == 0: normal playback.
+	Repeated calls in the same direction double the speed; a call in the opposite direction
+	first returns to normal playback.
+*/
+int MpvPlayer_::trick_play(int direction) {
+	std::scoped_lock lck(subscription.m);
+	if (!mpv || !subscription.mpm) {
+		dterrorf("mpv not ready");
+		return -1;
+	}
+	auto& mpm = subscription.mpm;
+	float speed = mpm->get_trick_play_speed();
+	if (direction == 0 || (std::abs(speed) > 1 && (direction > 0) != (speed > 0)))
+		speed = 0;
+	else if (std::abs(speed) <= 1)
+		speed = direction > 0 ? 4 : -4;
+	else if (std::abs(speed) < 64)
+		speed *= 2;
+	mpm->set_trick_play_speed(speed);
+	dtdebugf("PLAY SUBSCRIPTION {:p} trick play speed={}", fmt::ptr(this), speed);
+	return 0;
+}
+
+int MpvPlayer::trick_play(int direction) {
+	auto* self = dynamic_cast<MpvPlayer_*>(this);
+	return self->trick_play(direction);
+}
+
 void mpv_subscription_t::close(bool unsubscribe) {
 	pmt_change_count = 0;
 	if (!mpm)
@@ -1187,18 +1216,58 @@ void MpvPlayer::update_playback_info() {
 	self->update_playback_info();
 }
 
-void mpv_overlay_t::render(svg_t* svg, int window_width, int window_height) {
+/*
+	Copy the rasterized svg to the texture, but only if it changed since the last upload.
+	If only part of the svg changed since then, only that part is copied
+*/
+void mpv_overlay_t::upload(svg_t* svg, svg_texture_t& texture, const uint8_t* data) {
 	GLenum err;
-	static int called = 0;
-	if(!svg)
+	auto width = svg->get_width();
+	auto height = svg->get_height();
+	auto generation = svg->get_generation();
+	bool same_size = texture.width == width && texture.height == height;
+	if (same_size && texture.generation == generation)
 		return;
-	if (!called) {
-		called = 1;
+	glPixelStorei(GL_UNPACK_ALIGNMENT,
+								1); // set texture parameter
+										// The following copies the data
+										// https://gamedev.stackexchange.com/questions/168045/avoid-useless-copies-of-buffers
+	auto& r = svg->get_changed_rect();
+	if (same_size && texture.generation + 1 == generation && !r.empty()) {
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, r.x);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, r.y);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_BGRA, GL_UNSIGNED_BYTE, data);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+		svg->stats.num_partial_uploads++;
+	} else {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, data);
+		texture.width = width;
+		texture.height = height;
+		svg->stats.num_uploads++;
+	}
+	while ((err = glGetError()) != GL_NO_ERROR) {
+		dterrorf("OPENGL error {:d}\n", err);
 	}
+	texture.generation = generation;
+	auto& stats = svg->stats;
+	if (stats.num_frames % 3000 == 0)
+		dtdebugf("osd frames={:d}: rasterized {:d} full + {:d} partial; uploaded {:d} full + {:d} partial",
+						 stats.num_frames, stats.num_rasterizations, stats.num_partial_rasterizations,
+						 stats.num_uploads, stats.num_partial_uploads);
+}
+
+void mpv_overlay_t::render(svg_t* svg, svg_texture_t& texture, int window_width, int window_height) {
+	GLenum err;
+	if(!svg)
+		return;
 	uint8_t* data = svg->render(window_width, window_height);
+	if (!data)
+		return;
 
-	assert(data);
-	glBindTexture(GL_TEXTURE_2D, g_texture); // make the texture 2d
+	glBindTexture(GL_TEXTURE_2D, texture.id); // make the texture 2d
 	while ((err = glGetError()) != GL_NO_ERROR) {
 		dterrorf("OPENGL error {:d}\n", err);
 	}
@@ -1209,23 +1278,8 @@ void mpv_overlay_t::render(svg_t* svg, int window_width, int window_height) {
 		dterrorf("OPENGL error {:d}\n", err);
 	}
 
-	while ((err = glGetError()) != GL_NO_ERROR) {
-		dterrorf("OPENGL error {:d}\n", err);
-	}
-	glPixelStorei(GL_UNPACK_ALIGNMENT,
-								1); // set texture parameter
-										// The following copies the data
-										// https://gamedev.stackexchange.com/questions/168045/avoid-useless-copies-of-buffers
-	auto width = svg->get_width();
-	auto height = svg->get_height();
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_BYTE, data);
-	while ((err = glGetError()) != GL_NO_ERROR) {
-		dterrorf("OPENGL error {:d}\n", err);
-	}
+	upload(svg, texture, data);
 
-	while ((err = glGetError()) != GL_NO_ERROR) {
-		dterrorf("OPENGL error {:d}\n", err);
-	}
 	glEnable(GL_BLEND);
 	while ((err = glGetError()) != GL_NO_ERROR) {
 		dterrorf("OPENGL error {:d}\n", err);
@@ -1270,7 +1324,8 @@ mpv_overlay_t::mpv_overlay_t(MpvPlayer_* player) {
 		auto radiobg_path = config_path / o->radiobg_svg;
 		svg_radiobg = svg_radiobg_t::make(radiobg_path.c_str());
 	}
-	InitializeTexture(g_texture);
+	InitializeTexture(osd_texture.id);
+	InitializeTexture(radiobg_texture.id);
 }
 
 void MpvPlayer::toggle_overlay(){
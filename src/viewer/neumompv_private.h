@@ -133,6 +133,7 @@ public:
 
 	template <typename _mux_t> int play_mux(const _mux_t& mux, bool blindscan);
 	int jump(int seconds);
+	int trick_play(int direction);
 	int stop_play();
 	int pause();
 	int run();
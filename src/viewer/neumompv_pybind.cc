@@ -66,6 +66,8 @@ PYBIND11_MODULE(pyneumompv, m) {
 		.def("play_recording", &MpvPlayer::play_recording, py::arg("recording"),
 				 py::arg("start_play_time") = milliseconds_t(0))
 		.def("jump", &MpvPlayer::jump, py::arg("seconds"))
+		.def("trick_play", &MpvPlayer::trick_play, py::arg("direction"),
+				 "Fast forward (direction>0) or rewind (direction<0) showing only i-frames; 0: normal playback")
 		.def("mpv_command", &MpvPlayer::mpv_command, py::arg("command"), py::arg("arg1") = nullptr,
 				 py::arg("arg2") = nullptr)
 		.def("stop_play", &MpvPlayer::stop_play)
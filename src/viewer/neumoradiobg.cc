@@ -90,15 +90,18 @@ int svg_radiobg_impl_t::init() {
 
 uint8_t* svg_radiobg_t::render(int window_width, int window_height) {
 	auto* self = dynamic_cast<svg_radiobg_impl_t*>(this);
-	if (self->uptodate && surface && this->window_width == window_width && this->window_height == window_height) {
-		return surface;
+	stats.num_frames++;
+	if (self->uptodate && !surface.empty() && this->window_width == window_width &&
+			this->window_height == window_height) {
+		return surface.data();
 	}
 
 	self->uptodate = true;
-	surface = self->doc->RenderGetRef(window_width, window_height, NULL, true, true); //crash sometimes
-	this->window_width = window_width;
-	this->window_height = window_height;
-	return surface;
+	auto* data = self->doc->RenderGetRef(window_width, window_height, NULL, true, true); //crash sometimes
+	if (data)
+		set_surface(data, window_width, window_height);
+	stats.num_rasterizations++;
+	return surface.data();
 }
 
 
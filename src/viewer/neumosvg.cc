@@ -32,6 +32,7 @@
 #include "stackstring.h"
 #include "util/logger.h"
 #include <cairo/cairo.h>
+#include <cmath>
 
 float get_width(wxSVGElement* el) {
 	wxSVGTransformable* element = wxSVGTransformable::GetSVGTransformable(*el);
@@ -87,7 +88,52 @@ static wxSVGElement* find_child_of_type(wxSVGElement*parent, const char *tagname
 }
 #endif
 
-struct level_indicator {
+/*
+	Part of the osd which changes at runtime. Widgets record which part of the document needs to be
+	redrawn when their content changes, so that the osd is only rasterized when needed, and only
+	in the changed area
+*/
+struct svg_widget_t {
+	bool dirty{false};
+	bool extent_known{true}; //false if the changed area cannot be determined
+	double x0{}, y0{}, x1{}, y1{}; //changed area in svg user coordinates, if dirty
+
+	void add_dirty_element(wxSVGElement* el, bool full_width = false);
+	void clear_dirty() {
+		dirty = false;
+		extent_known = true;
+	}
+};
+
+/*
+	mark the current area of el as dirty. This should be called both before and after modifying el.
+	full_width: mark the complete band of the screen occupied by el, because the bounding box of text
+	is only updated when it is rendered again
+*/
+void svg_widget_t::add_dirty_element(wxSVGElement* el, bool full_width) {
+	wxSVGTransformable* element = el ? wxSVGTransformable::GetSVGTransformable(*el) : nullptr;
+	auto bbox = element ? element->GetResultBBox(wxSVG_COORDINATES_VIEWPORT) : wxSVGRect();
+	if (bbox.IsEmpty()) {
+		dirty = true;
+		extent_known = false;
+		return;
+	}
+	double bx0 = full_width ? -1e6 : bbox.GetX();
+	double bx1 = full_width ? 1e6 : bbox.GetX() + bbox.GetWidth();
+	double by0 = bbox.GetY();
+	double by1 = bbox.GetY() + bbox.GetHeight();
+	if (!dirty) {
+		x0 = bx0; x1 = bx1; y0 = by0; y1 = by1;
+	} else {
+		x0 = std::min(x0, bx0);
+		x1 = std::max(x1, bx1);
+		y0 = std::min(y0, by0);
+		y1 = std::max(y1, by1);
+	}
+	dirty = true;
+}
+
+struct level_indicator : public svg_widget_t {
 	const char* scroller_id;
 	const char* bar_id;
 	double min_val{};	 // lower bound of the displayed value
@@ -100,7 +146,11 @@ struct level_indicator {
 	double scroller_width{};
 	wxSVGElement* scroller{nullptr};
 	wxSVGElement* bar{nullptr};
+	wxSVGElement* text_element{nullptr};
 	wxSvgXmlNode* text{nullptr};
+	double shown_low_x{NAN}; //currently displayed scroller position
+	double shown_high_x{NAN};
+	ss::string<16> shown_text;
 
 	level_indicator(const char* scroller_id, const char* bar_id, double min_val, double max_val)
 		: scroller_id(scroller_id), bar_id(bar_id), min_val(min_val), max_val(max_val), low_val(min_val),
@@ -115,6 +165,7 @@ struct livebuffer_t : public level_indicator {
 	wxSVGElement* indicator_ref{nullptr}; // element which points to the playback time
 	wxSVGElement* indicator_box{nullptr}; // full box containing indicator
 	int indicator_ref_x{0};
+	double shown_indicator_x{NAN};
 	livebuffer_t(const char* scroller_id, const char* bar_id, double min_val, double max_val)
 		: level_indicator(scroller_id, bar_id, min_val, max_val) {}
 
@@ -123,12 +174,16 @@ struct livebuffer_t : public level_indicator {
 	void set_indicator_value(double val);
 };
 
-struct text_box {
+struct text_box : public svg_widget_t {
 	const char* id;
+	wxSVGElement* text_element{nullptr};
 	wxSvgXmlNode* text{nullptr};
+	bool has_value{false};
+	ss::string<64> shown_value;
 
 	text_box(const char* id) : id(id) {}
 	void init(wxSVGDocument* doc);
+	void set_content(const char* val);
 	void set_value(const char* val);
 	void set_value(const ss::string_& val);
 	void set_value(int x, const char* fmt);
@@ -160,6 +215,7 @@ void level_indicator::init(wxSVGDocument* doc) {
 	temp.format("{:s}-text", scroller_id);
 	// magic: span elements seem to be hidden
 	auto* p = doc->GetElementById(temp.c_str());
+	text_element = p;
 	if (p)
 		p = (wxSVGElement*)p->GetChildren();
 	if (p)
@@ -192,17 +248,26 @@ void level_indicator::set_values(double low, double high) {
 		high_val = std::min(std::max(high, low_val), max_val);
 		auto low_x = ((low_val - min_val) * width) / (max_val - min_val);
 		auto high_x = ((high_val - min_val) * width) / (max_val - min_val);
-
-    // works, but only for rectangle and not for scaled group
-		auto* s = dynamic_cast<wxSVGRectElement*>(scroller);
-		s->SetX(min_x + low_x);
-		s->SetWidth(high_x - low_x);
+		if (low_x != shown_low_x || high_x != shown_high_x) {
+			add_dirty_element(scroller);
+			// works, but only for rectangle and not for scaled group
+			auto* s = dynamic_cast<wxSVGRectElement*>(scroller);
+			s->SetX(min_x + low_x);
+			s->SetWidth(high_x - low_x);
+			shown_low_x = low_x;
+			shown_high_x = high_x;
+			add_dirty_element(scroller);
+		}
 	}
 	if (text) {
 		ss::string<16> str;
 		str.format("{:3.1f}dB", high);
-		auto s = wxString::FromUTF8(str.c_str());
-		text->SetContent(s);
+		if (str != shown_text) {
+			add_dirty_element(text_element, true);
+			auto s = wxString::FromUTF8(str.c_str());
+			text->SetContent(s);
+			shown_text = str;
+		}
 	}
 }
 
@@ -210,6 +275,10 @@ void livebuffer_t::set_indicator_value(double val) {
 	if (indicator_box) {
 		val = std::min(std::max(val, min_val), max_val);
 		auto x = ((val - min_val) * width) / (max_val - min_val);
+		if (x == shown_indicator_x)
+			return;
+		shown_indicator_x = x;
+		add_dirty_element(indicator_box);
 		{
 			wxSVGTransformable* element = wxSVGTransformable::GetSVGTransformable(*indicator_box);
 			wxSVGTransformList transforms = element->GetTransform().GetBaseVal();
@@ -219,6 +288,7 @@ void livebuffer_t::set_indicator_value(double val) {
 			transforms[transforms.Count() - 1].SetMatrix(matrix);
 			element->SetTransform(transforms);
 		}
+		add_dirty_element(indicator_box);
 	}
 }
 
@@ -228,6 +298,7 @@ void text_box::init(wxSVGDocument* doc) {
 	temp.format("{:s}-text", id);
 	// magic: span elements seem to be hidden
 	auto* p = doc->GetElementById(temp.c_str());
+	text_element = p;
 	if (p)
 		p = (wxSVGElement*)p->GetChildren();
 	if (p)
@@ -236,41 +307,61 @@ void text_box::init(wxSVGDocument* doc) {
 		dterrorf("Could not find svg element {:s}", temp.c_str());
 }
 
+void text_box::set_content(const char* val) {
+	if (!text || (has_value && strcmp(shown_value.c_str(), val) == 0))
+		return;
+	add_dirty_element(text_element, true);
+	auto s = wxString::FromUTF8(val);
+	text->SetContent(s);
+	shown_value = val;
+	has_value = true;
+}
+
 void text_box::set_value(const ss::string_& val) {
-	if (text) {
-		auto s = wxString::FromUTF8(val.c_str());
-		text->SetContent(s);
-	}
+	set_content(val.c_str());
 }
 
 void text_box::set_value(const char* val) {
-	if (text) {
-		auto s = wxString::FromUTF8(val);
-		text->SetContent(s);
-	}
+	set_content(val);
 }
 
 void text_box::set_value(int x, const char* fmt) {
 	ss::string<32> val;
 	val.format(fmt::runtime(fmt), x);
-	if (text) {
-		auto s = wxString::FromUTF8(val.c_str());
-		text->SetContent(s);
-	}
+	set_content(val.c_str());
 }
 
 void text_box::set_time_value(time_t t, const char* fmt_) {
 	ss::string<32> val;
 	val.format(fmt::runtime(fmt_), fmt::localtime(t));
-	if (text) {
-		auto s = wxString::FromUTF8(val.c_str());
-		text->SetContent(s);
-	}
+	set_content(val.c_str());
+}
+
+void svg_t::set_surface(const uint8_t* data, int window_width, int window_height) {
+	surface.assign(data, data + 4 * (size_t)window_width * window_height);
+	this->window_width = window_width;
+	this->window_height = window_height;
+	changed_rect = {0, 0, window_width, window_height};
+	generation++;
+}
+
+/*
+	copy a rasterized part of the svg (r.w x r.h pixels) into surface at position (r.x, r.y)
+*/
+void svg_t::set_surface_region(const uint8_t* data, const svg_rect_t& r) {
+	for (int y = 0; y < r.h; ++y)
+		memcpy(&surface[4 * ((size_t)(r.y + y) * window_width + r.x)], data + 4 * (size_t)y * r.w, 4 * r.w);
+	changed_rect = r;
+	generation++;
 }
 
 class svg_overlay_impl_t : public svg_overlay_t {
 	friend class svg_overlay_t;
 	wxSVGCtrl svgctrl;
+	std::vector<svg_widget_t*> widgets;
+
+	bool collect_dirty(double& x0, double& y0, double& x1, double& y1, bool& extent_known) const;
+	bool to_pixels(double x0, double y0, double x1, double y1, svg_rect_t& r) const;
 
 public:
 	bool uptodate{false};
@@ -298,8 +389,67 @@ public:
 	void traverse_xml(wxSVGElement* parent, int level = 0);
 	int init();
 	void show_snr(bool show);
+	void rasterize(int window_width, int window_height);
 };
 
+/*
+	Compute the union of the areas changed by all widgets since the last rasterization.
+	Returns false if nothing changed
+*/
+bool svg_overlay_impl_t::collect_dirty(double& x0, double& y0, double& x1, double& y1, bool& extent_known) const {
+	bool dirty{false};
+	extent_known = true;
+	for (auto* w : widgets) {
+		if (!w->dirty)
+			continue;
+		if (!w->extent_known)
+			extent_known = false;
+		if (!dirty) {
+			x0 = w->x0; y0 = w->y0; x1 = w->x1; y1 = w->y1;
+		} else {
+			x0 = std::min(x0, w->x0);
+			y0 = std::min(y0, w->y0);
+			x1 = std::max(x1, w->x1);
+			y1 = std::max(y1, w->y1);
+		}
+		dirty = true;
+	}
+	return dirty;
+}
+
+/*
+	Convert an area in svg user coordinates to pixels on the surface, using the same transformation
+	as wxSVGDocument::RenderGetRef (preserving aspect ratio, centered). A few pixels are added on each
+	side to account for anti-aliasing.
+	Returns false if the mapping is not known, in which case the complete surface must be rasterized
+*/
+bool svg_overlay_impl_t::to_pixels(double x0, double y0, double x1, double y1, svg_rect_t& r) const {
+	auto* svg = doc->GetRootElement();
+	if (!svg || !svg->GetViewBox().GetAnimVal().IsEmpty())
+		return false;
+	double doc_width = svg->GetWidth().GetAnimVal();
+	double doc_height = svg->GetHeight().GetAnimVal();
+	if (doc_width <= 0 || doc_height <= 0)
+		return false;
+	double scale = std::min(window_width / doc_width, window_height / doc_height);
+	int xmargin = window_width - scale * doc_width;
+	int ymargin = window_height - scale * doc_height;
+	const int pad = 4;
+	int px0 = std::max(0, (int)std::floor(xmargin / 2 + scale * x0) - pad);
+	int py0 = std::max(0, (int)std::floor(ymargin / 2 + scale * y0) - pad);
+	int px1 = std::min(window_width, (int)std::ceil(xmargin / 2 + scale * x1) + pad);
+	int py1 = std::min(window_height, (int)std::ceil(ymargin / 2 + scale * y1) + pad);
+	r = {px0, py0, px1 - px0, py1 - py0};
+	return true;
+}
+
+void svg_overlay_impl_t::rasterize(int window_width, int window_height) {
+	auto* data = doc->RenderGetRef(window_width, window_height, NULL, true, true); //crash sometimes
+	if (data)
+		set_surface(data, window_width, window_height);
+	stats.num_rasterizations++;
+}
+
 /*
 	show or hide the snr date (show if data is available, otherwise hide)
 */
@@ -367,20 +517,50 @@ int svg_overlay_impl_t::init() {
 	play_time.init(doc);
 	livebuffer.init(doc);
 	rec.init(doc);
+	widgets = {&snr, &margin_snr, &min_snr, &strength, &livebuffer,
+		&chno, &service, &lang, &epg, &start_time, &end_time, &play_time, &rec};
 	return 0;
 }
 
+/*
+	Rasterize the svg only if it changed since the last call. Small changes (e.g., the play time
+	which changes every second) only rasterize the changed part of the svg
+*/
 uint8_t* svg_overlay_t::render(int window_width, int window_height) {
 	auto* self = dynamic_cast<svg_overlay_impl_t*>(this);
-	if (self->uptodate && surface && this->window_width == window_width && this->window_height == window_height) {
-		return surface;
+	stats.num_frames++;
+	double x0{}, y0{}, x1{}, y1{};
+	bool extent_known{true};
+	bool dirty = self->collect_dirty(x0, y0, x1, y1, extent_known);
+	bool resized = surface.empty() || this->window_width != window_width || this->window_height != window_height;
+	for (auto* w : self->widgets)
+		w->clear_dirty();
+	svg_rect_t r;
+	if (resized || !self->uptodate || !extent_known || (dirty && !self->to_pixels(x0, y0, x1, y1, r))) {
+		self->uptodate = true;
+		self->rasterize(window_width, window_height);
+		return surface.data();
 	}
-
-	self->uptodate = true;
-	surface = self->doc->RenderGetRef(window_width, window_height, NULL, true, true); //crash sometimes
-	this->window_width = window_width;
-	this->window_height = window_height;
-	return surface;
+	if (!dirty || r.empty())
+		return surface.data();
+	if ((int64_t)r.w * r.h > (int64_t)window_width * window_height / 2) {
+		self->rasterize(window_width, window_height);
+		return surface.data();
+	}
+	/*
+		RenderGetRef offsets the rendered area by rect.x*scale pixels and produces (int)(rect.w*scale)
+		pixels per line; choose rect such that this maps exactly to r
+	*/
+	double scale = self->doc->GetScale();
+	wxSVGRect rect(r.x / scale, r.y / scale, (r.w + 0.5) / scale, (r.h + 0.5) / scale);
+	auto* data = self->doc->RenderGetRef(window_width, window_height, &rect, true, true);
+	if (!data) {
+		self->uptodate = false;
+		return surface.data();
+	}
+	set_surface_region(data, r);
+	stats.num_partial_rasterizations++;
+	return surface.data();
 }
 
 std::unique_ptr<svg_overlay_t> svg_overlay_t::make(const char* filename) {
@@ -398,8 +578,6 @@ void svg_overlay_t::update_snr(double snr, double strength, double min_snr) {
 	self->strength.set_upper_value(strength);
 	if (self->scrollbar_scroller) {
 	}
-
-	self->uptodate = false;
 }
 
 
@@ -449,7 +627,6 @@ static const char* recording_status_text(epgdb::rec_status_t status, bool is_tim
 void svg_overlay_t::set_playback_info(const playback_info_t& playback_info) {
 	set_livebuffer_info(playback_info);
 	auto* self = dynamic_cast<svg_overlay_impl_t*>(this);
-	self->uptodate = false;
 	self->show_snr(!playback_info.is_recording);
 	self->chno.set_value(playback_info.service.ch_order, "{:4d}");
 	self->service.set_value(playback_info.service.name);
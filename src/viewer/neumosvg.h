@@ -19,6 +19,7 @@
  */
 
 #include "stackstring.h"
+#include <vector>
 
 class wxSVGCtrl;
 class wxImage;
@@ -31,17 +32,50 @@ struct epg_record_t;
 struct signal_info_t;
 struct playback_info_t;
 
+//area of the rendered surface, in pixels
+struct svg_rect_t {
+	int x{0};
+	int y{0};
+	int w{0};
+	int h{0};
+	inline bool empty() const { return w <= 0 || h <= 0;}
+};
+
+/*
+	counters which show how often the svg was rasterized and uploaded compared to the number
+	of frames it was displayed in
+*/
+struct svg_render_stats_t {
+	int64_t num_frames{0};
+	int64_t num_rasterizations{0}; //complete surface
+	int64_t num_partial_rasterizations{0}; //changed region only
+	int64_t num_uploads{0}; //complete texture
+	int64_t num_partial_uploads{0}; //changed region only
+};
+
 class svg_t {
 protected:
 	svg_t() {};
-	uint8_t* surface{nullptr};
+	std::vector<uint8_t> surface; //BGRA, 4*window_width bytes per line
 	int window_width{-1};
 	int window_height{-1};
+	int generation{0}; //incremented each time surface changes
+	svg_rect_t changed_rect; //part of surface changed in the last rasterization
+
+	void set_surface(const uint8_t* data, int window_width, int window_height);
+	void set_surface_region(const uint8_t* data, const svg_rect_t& r);
 
 public:
+	svg_render_stats_t stats;
 	inline int get_width() { return window_width;}
 	inline int get_height() { return window_height;}
+	inline int get_generation() const { return generation;}
+	inline const svg_rect_t& get_changed_rect() const { return changed_rect;}
 	virtual ~svg_t() {};
+	/*
+		returns the rendered surface (window_width x window_height BGRA pixels), rasterizing the svg
+		only if something changed
+	*/
 	virtual uint8_t* render(int window_width, int window_height) = 0;
 };
 